@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/utsname.h>
+#include "AllocationCounter.hpp"
+#include "Benchmark.hpp"
+#include "ChannelRouter.hpp"
+#include "Mixer.hpp"
+#include "Resampler.hpp"
+#include "SpectralVad.hpp"
+#include "VoxDetector.hpp"
+
+static const double MIN_RUN_TIME = 0.2;	// seconds
+
+std::vector<BenchDefinition>& benchRegistry() {
+	static std::vector<BenchDefinition> registry;
+	return registry;
+}
+
+/**
+ * Result of one benchmark run
+ */
+struct BenchResult {
+	std::string name;
+	size_t iterations;
+	double nsPerIteration;
+	double itemsPerSecond;
+	std::map<std::string, double> counters;
+};
+
+static void help() {
+	printf("mumpiBench - micro-benchmarks for mumpi's audio hot paths\n\n");
+	printf("Usage:\n");
+	printf("mumpiBench [options] [filter]\n\n");
+	printf("Runs every benchmark whose name contains filter (default: all).\n\n");
+	printf("Options:\n");
+	printf("--format <table|json|csv>  output format. Default: table\n");
+	printf("--out <file>               write results to file instead of stdout\n");
+	exit(1);
+}
+
+/**
+ * @brief Runs one benchmark, growing the iteration count until a run lasts
+ * MIN_RUN_TIME
+ */
+static BenchResult runBenchmark(const BenchDefinition &bench) {
+	BenchState state;
+	state.iterations = 1;
+	double elapsed = 0.0;
+	uint64_t allocations = 0;
+	while(true) {
+		state.itemsPerIteration = 1;
+		state.counters.clear();
+		const uint64_t allocationsBefore = AllocationCounter::getAllocations();
+		auto start = std::chrono::steady_clock::now();
+		bench.function(state);
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		allocations = AllocationCounter::getAllocations() - allocationsBefore;
+		if(elapsed >= MIN_RUN_TIME)
+			break;
+		const double growth = elapsed > 0.0 ? std::min(10.0, 1.5 * MIN_RUN_TIME / elapsed) : 10.0;
+		state.iterations = (size_t) (state.iterations * growth) + 1;
+	}
+
+	BenchResult result;
+	result.name = bench.name;
+	result.iterations = state.iterations;
+	result.nsPerIteration = elapsed * 1e9 / state.iterations;
+	result.itemsPerSecond = state.iterations * state.itemsPerIteration / elapsed;
+	result.counters = state.counters;
+	// the benchmark's setup is spread over the iterations, anything near 1
+	// or above means the hot loop allocates
+	if(AllocationCounter::isEnabled())
+		result.counters["allocs_per_iteration"] = (double) allocations / state.iterations;
+	return result;
+}
+
+/**
+ * @brief Describes the build and machine, so results from a Pi and an x86
+ * box can be told apart
+ */
+static std::map<std::string, std::string> getEnvironment() {
+	std::map<std::string, std::string> env;
+	struct utsname uts;
+	if(uname(&uts) == 0) {
+		env["machine"] = uts.machine;
+		env["kernel"] = uts.release;
+	}
+#if defined(__clang__)
+	env["compiler"] = "clang " __clang_version__;
+#elif defined(__GNUC__)
+	env["compiler"] = "gcc " __VERSION__;
+#endif
+	env["mixer_kernel"] = Mixer::getKernelName();
+	env["vox_kernel"] = VoxDetector::getKernelName();
+	env["vad_kernel"] = SpectralVad::getKernelName();
+	env["resampler_kernel"] = Resampler::getKernelName();
+	env["router_kernel"] = ChannelRouter::getKernelName();
+
+	char date[32];
+	const time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+	env["date"] = date;
+	return env;
+}
+
+static void printTableHeader(FILE *out) {
+	fprintf(out, "%-40s %12s %14s %16s\n", "benchmark", "iterations", "ns/iteration", "M items/s");
+}
+
+static void printTableRow(FILE *out, const BenchResult &result) {
+	fprintf(out, "%-40s %12zu %14.1f %16.2f", result.name.c_str(), result.iterations,
+	        result.nsPerIteration, result.itemsPerSecond / 1e6);
+	for(auto &counter : result.counters)
+		fprintf(out, "  %s=%.2f", counter.first.c_str(), counter.second);
+	fprintf(out, "\n");
+}
+
+/**
+ * @brief Writes one row per benchmark. Counters go into a single
+ * "key=value;..." column so every row has the same columns.
+ */
+static void printCsv(FILE *out, const std::vector<BenchResult> &results) {
+	fprintf(out, "benchmark,iterations,ns_per_iteration,items_per_second,counters\n");
+	for(auto &result : results) {
+		fprintf(out, "%s,%zu,%.3f,%.1f,", result.name.c_str(), result.iterations,
+		        result.nsPerIteration, result.itemsPerSecond);
+		bool first = true;
+		for(auto &counter : result.counters) {
+			fprintf(out, "%s%s=%g", first ? "" : ";", counter.first.c_str(), counter.second);
+			first = false;
+		}
+		fprintf(out, "\n");
+	}
+}
+
+static std::string jsonString(const std::string &str) {
+	std::string escaped = "\"";
+	for(char c : str) {
+		if(c == '"' || c == '\\')
+			escaped += '\\';
+		if((unsigned char) c >= 0x20)
+			escaped += c;
+	}
+	return escaped + "\"";
+}
+
+static void printJson(FILE *out, const std::vector<BenchResult> &results) {
+	fprintf(out, "{\n  \"environment\": {");
+	bool first = true;
+	for(auto &entry : getEnvironment()) {
+		fprintf(out, "%s\n    %s: %s", first ? "" : ",", jsonString(entry.first).c_str(),
+		        jsonString(entry.second).c_str());
+		first = false;
+	}
+	fprintf(out, "\n  },\n  \"benchmarks\": [");
+	for(size_t i = 0; i < results.size(); i++) {
+		const BenchResult &result = results[i];
+		fprintf(out, "%s\n    {\"name\": %s, \"iterations\": %zu, \"ns_per_iteration\": %.3f, "
+		        "\"items_per_second\": %.1f, \"counters\": {",
+		        i == 0 ? "" : ",", jsonString(result.name).c_str(), result.iterations,
+		        result.nsPerIteration, result.itemsPerSecond);
+		first = true;
+		for(auto &counter : result.counters) {
+			fprintf(out, "%s%s: %g", first ? "" : ", ", jsonString(counter.first).c_str(), counter.second);
+			first = false;
+		}
+		fprintf(out, "}}");
+	}
+	fprintf(out, "\n  ]\n}\n");
+}
+
+/**
+ * Runs every registered benchmark whose name contains the filter (or all of
+ * them) and reports time per iteration, item throughput and counters as a
+ * table, JSON or CSV.
+ */
+int main(int argc, char **argv) {
+	std::string filter;
+	std::string format = "table";
+	const char *out_path = NULL;
+	for(int i = 1; i < argc; i++) {
+		if(std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+			format = argv[++i];
+		else if(std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			out_path = argv[++i];
+		else if(argv[i][0] == '-')
+			help();
+		else
+			filter = argv[i];
+	}
+	if(format != "table" && format != "json" && format != "csv")
+		help();
+
+	FILE *out = stdout;
+	if(out_path != NULL) {
+		out = fopen(out_path, "w");
+		if(out == NULL) {
+			perror(out_path);
+			return 1;
+		}
+	}
+
+	// the table streams as it goes, the other formats are written at the end
+	std::vector<BenchResult> results;
+	if(format == "table")
+		printTableHeader(out);
+	for(auto &bench : benchRegistry()) {
+		if(bench.name.find(filter) == std::string::npos)
+			continue;
+		results.push_back(runBenchmark(bench));
+		if(format == "table") {
+			printTableRow(out, results.back());
+			fflush(out);
+		} else if(out != stdout) {
+			printTableRow(stdout, results.back());
+		}
+	}
+
+	if(format == "json")
+		printJson(out, results);
+	else if(format == "csv")
+		printCsv(out, results);
+
+	if(out != stdout)
+		fclose(out);
+	return 0;
+}
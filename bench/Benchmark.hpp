@@ -0,0 +1,54 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal micro-benchmark registry for mumpiBench. A benchmark is a function
+ * that runs its hot loop state.iterations times. The runner grows the
+ * iteration count until a run lasts long enough to time reliably.
+ */
+struct BenchState {
+    size_t iterations;      // number of times to run the hot loop
+    size_t itemsPerIteration; // set by the benchmark, e.g. samples per loop
+    std::map<std::string, double> counters; // extra results, e.g. latencies
+};
+
+typedef void (*BenchFunction)(BenchState &state);
+
+struct BenchDefinition {
+    std::string name;
+    BenchFunction function;
+};
+
+/**
+ * @brief Returns all registered benchmarks, in registration order
+ */
+std::vector<BenchDefinition>& benchRegistry();
+
+/**
+ * Registers a benchmark at static initialization time
+ */
+struct BenchRegistrar {
+    BenchRegistrar(const char *name, BenchFunction function) {
+        benchRegistry().push_back(BenchDefinition{name, function});
+    }
+};
+
+/**
+ * @brief Prevents the compiler from optimizing away a computed value
+ */
+template <class T>
+inline void doNotOptimize(const T &val) {
+    asm volatile("" : : "g"(&val) : "memory");
+}
+
+#define MUMPI_BENCHMARK(name) \
+    static void name(BenchState &state); \
+    static BenchRegistrar name##_registrar(#name, name); \
+    static void name(BenchState &state)
+
+#endif /* Benchmark_hpp */
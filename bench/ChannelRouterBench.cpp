@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <vector>
+#include "Benchmark.hpp"
+#include "ChannelRouter.hpp"
+
+// one PortAudio buffer, as Bridge opens the streams with
+static const size_t BUFFER_FRAMES = 512;
+
+/**
+ * Takes one stereo device buffer to mono per iteration, the capture side's
+ * work per callback. Items are frames.
+ */
+static void downmix(BenchState &state, int channel, bool scalar) {
+	std::vector<int16_t> stereo(2 * BUFFER_FRAMES);
+	for(size_t i = 0; i < stereo.size(); i++)
+		stereo[i] = (int16_t) (i * 37);
+	std::vector<int16_t> mono(BUFFER_FRAMES);
+	const ChannelRouter router(2, channel, 2, channel);
+	for(size_t it = 0; it < state.iterations; it++) {
+		if(scalar)
+			router.downmixScalar(stereo.data(), BUFFER_FRAMES, mono.data());
+		else
+			router.downmix(stereo.data(), BUFFER_FRAMES, mono.data());
+		doNotOptimize(mono[0]);
+	}
+	state.itemsPerIteration = BUFFER_FRAMES;
+}
+
+/**
+ * Plays one mono buffer on a stereo device per iteration, mixed into the
+ * other pipeline's channel as on a shared card. Items are frames.
+ */
+static void upmix(BenchState &state, bool scalar) {
+	std::vector<int16_t> mono(BUFFER_FRAMES);
+	for(size_t i = 0; i < mono.size(); i++)
+		mono[i] = (int16_t) (i * 37);
+	std::vector<int16_t> stereo(2 * BUFFER_FRAMES);
+	const ChannelRouter router(2, 1, 2, 1);
+	for(size_t it = 0; it < state.iterations; it++) {
+		if(scalar)
+			router.upmixScalar(mono.data(), BUFFER_FRAMES, stereo.data(), true);
+		else
+			router.upmix(mono.data(), BUFFER_FRAMES, stereo.data(), true);
+		doNotOptimize(stereo[0]);
+	}
+	state.itemsPerIteration = BUFFER_FRAMES;
+}
+
+MUMPI_BENCHMARK(Router_SelectRight) {
+	downmix(state, 1, false);
+}
+
+MUMPI_BENCHMARK(Router_SelectRight_Scalar) {
+	downmix(state, 1, true);
+}
+
+MUMPI_BENCHMARK(Router_Mix) {
+	downmix(state, ChannelRouter::ALL, false);
+}
+
+MUMPI_BENCHMARK(Router_Mix_Scalar) {
+	downmix(state, ChannelRouter::ALL, true);
+}
+
+MUMPI_BENCHMARK(Router_UpmixMixRight) {
+	upmix(state, false);
+}
+
+MUMPI_BENCHMARK(Router_UpmixMixRight_Scalar) {
+	upmix(state, true);
+}
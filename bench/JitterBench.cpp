@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "Benchmark.hpp"
+#include "ThreadTuning.hpp"
+
+// a 64-frame buffer at 48 kHz, a low-latency sound card setting
+static const std::chrono::microseconds CALLBACK_PERIOD(1333);
+static const size_t STRESS_BYTES = 8 << 20;    // larger than the Pi's caches
+static const int RT_PRIORITY = 60;
+
+/**
+ * CPUs this process may run on
+ */
+static std::vector<int> allowedCpus() {
+	std::vector<int> cpus;
+	cpu_set_t set;
+	if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if(CPU_ISSET(cpu, &set))
+				cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+/**
+ * Simulates a sound card callback thread woken every CALLBACK_PERIOD for
+ * state.iterations callbacks, under tuning, and measures how late each
+ * wakeup is. With stress, one thread per CPU at normal priority streams
+ * through memory, as a busy Pi's other processes would; with isolate, the
+ * callback gets the last CPU and the stress threads the others.
+ */
+static void callbackJitter(BenchState &state, bool stress, ThreadTuning::Policy policy, bool isolate) {
+	const std::vector<int> cpus = allowedCpus();
+	std::vector<int> callbackCpus, stressCpus = cpus;
+	if(isolate && cpus.size() > 1) {
+		callbackCpus.push_back(cpus.back());
+		stressCpus.pop_back();
+	}
+	const ThreadTuning tuning(policy, policy == ThreadTuning::OTHER ? 0 : RT_PRIORITY, callbackCpus);
+	const ThreadTuning stressTuning(ThreadTuning::OTHER, 0, stressCpus);
+
+	std::atomic<bool> stopping(false);
+	std::vector<std::thread> stressThreads;
+	if(stress) {
+		for(size_t i = 0; i < cpus.size(); i++) {
+			stressThreads.push_back(std::thread([&]() {
+				std::vector<char> memory(STRESS_BYTES);
+				while(!stopping.load(std::memory_order_relaxed)) {
+					for(size_t j = 0; j < memory.size(); j += 64)
+						memory[j]++;
+				}
+				doNotOptimize(memory);
+			}));
+			if(isolate)
+				stressTuning.apply(stressThreads.back().native_handle());
+		}
+	}
+
+	std::vector<double> lateUs(state.iterations);
+	int error = 0;
+	std::thread callback([&]() {
+		error = tuning.applyToCurrentThread();
+		std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+		for(size_t it = 0; it < state.iterations; it++) {
+			next += CALLBACK_PERIOD;
+			std::this_thread::sleep_until(next);
+			lateUs[it] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - next).count();
+		}
+	});
+	callback.join();
+	stopping = true;
+	for(auto &thread : stressThreads)
+		thread.join();
+
+	double total = 0.0;
+	for(double us : lateUs)
+		total += us;
+	std::sort(lateUs.begin(), lateUs.end());
+	state.itemsPerIteration = 1;
+	state.counters["mean_late_us"] = total / lateUs.size();
+	state.counters["p99_late_us"] = lateUs[std::min(lateUs.size() - 1, lateUs.size() * 99 / 100)];
+	state.counters["max_late_us"] = lateUs.back();
+	// 0 when the real-time policy or pinning was refused, e.g. without root:
+	// the results are then those of the normal scheduler
+	state.counters["granted"] = error == 0 ? 1.0 : 0.0;
+}
+
+MUMPI_BENCHMARK(Jitter_Idle) {
+	callbackJitter(state, false, ThreadTuning::OTHER, false);
+}
+
+MUMPI_BENCHMARK(Jitter_Stress) {
+	callbackJitter(state, true, ThreadTuning::OTHER, false);
+}
+
+MUMPI_BENCHMARK(Jitter_StressFifo) {
+	callbackJitter(state, true, ThreadTuning::FIFO, false);
+}
+
+MUMPI_BENCHMARK(Jitter_StressFifoPinned) {
+	callbackJitter(state, true, ThreadTuning::FIFO, true);
+}
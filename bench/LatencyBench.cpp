@@ -0,0 +1,23 @@
+#include "Benchmark.hpp"
+#include "LatencyHistogram.hpp"
+#include "SampleTimeline.hpp"
+
+/**
+ * Cost the latency taps add per PortAudio callback
+ */
+MUMPI_BENCHMARK(Latency_Record) {
+	LatencyHistogram histogram("bench");
+	for(size_t it = 0; it < state.iterations; it++)
+		histogram.record((int64_t) (it & 0xffff));
+	doNotOptimize(histogram);
+}
+
+MUMPI_BENCHMARK(Latency_MarkAndLookup) {
+	SampleTimeline timeline(48000);
+	double time = 0.0;
+	for(size_t it = 0; it < state.iterations; it++) {
+		timeline.mark(it * 512, it * 0.01);
+		timeline.timeAt(it * 512 + 100, time);
+	}
+	doNotOptimize(time);
+}
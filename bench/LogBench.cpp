@@ -0,0 +1,40 @@
+#include <cstdio>
+#include "Benchmark.hpp"
+#include "LogRecord.hpp"
+#include "MpmcQueue.hpp"
+
+/**
+ * What an audio callback pays per message: capture and queue, no formatting
+ */
+MUMPI_BENCHMARK(Log_CaptureAndQueue) {
+	MpmcQueue<LogRecord> queue(1024);
+	LogRecord record;
+	LogRecord popped;
+	for(size_t it = 0; it < state.iterations; it++) {
+		record.capture(NULL, 600, "requested_samples: %zu available_samples: %zu", (size_t) 512, it);
+		queue.push(record);
+		queue.pop(popped);
+	}
+	doNotOptimize(popped);
+}
+
+/**
+ * What the background thread pays to format the same message
+ */
+MUMPI_BENCHMARK(Log_Format) {
+	LogRecord record;
+	record.capture(NULL, 600, "requested_samples: %zu available_samples: %zu", (size_t) 512, (size_t) 1024);
+	char message[512];
+	for(size_t it = 0; it < state.iterations; it++) {
+		record.formatTo(message, sizeof(message));
+		doNotOptimize(message[0]);
+	}
+}
+
+MUMPI_BENCHMARK(Log_Snprintf) {
+	char message[512];
+	for(size_t it = 0; it < state.iterations; it++) {
+		snprintf(message, sizeof(message), "requested_samples: %zu available_samples: %zu", (size_t) 512, it);
+		doNotOptimize(message[0]);
+	}
+}
@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <vector>
+#include "Benchmark.hpp"
+#include "Mixer.hpp"
+
+// one 10 ms playout frame at 48 kHz
+static const size_t FRAME_SAMPLES = 480;
+
+/**
+ * Mixes one playout frame from the given number of speakers, reporting
+ * output samples per second.
+ */
+static void mixSpeakers(BenchState &state, size_t speakers, bool simd) {
+	std::vector<std::vector<int16_t>> sources(speakers, std::vector<int16_t>(FRAME_SAMPLES, 1000));
+	std::vector<int32_t> acc(FRAME_SAMPLES);
+	std::vector<int16_t> out(FRAME_SAMPLES);
+	for(size_t it = 0; it < state.iterations; it++) {
+		std::fill(acc.begin(), acc.end(), 0);
+		for(auto &src : sources) {
+			if(simd)
+				Mixer::accumulate(acc.data(), src.data(), FRAME_SAMPLES);
+			else
+				Mixer::accumulateScalar(acc.data(), src.data(), FRAME_SAMPLES);
+		}
+		if(simd)
+			Mixer::saturate(out.data(), acc.data(), FRAME_SAMPLES);
+		else
+			Mixer::saturateScalar(out.data(), acc.data(), FRAME_SAMPLES);
+		doNotOptimize(out[0]);
+	}
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+MUMPI_BENCHMARK(Mixer_1Speaker_Scalar) {
+	mixSpeakers(state, 1, false);
+}
+
+MUMPI_BENCHMARK(Mixer_1Speaker_Simd) {
+	mixSpeakers(state, 1, true);
+}
+
+MUMPI_BENCHMARK(Mixer_4Speakers_Scalar) {
+	mixSpeakers(state, 4, false);
+}
+
+MUMPI_BENCHMARK(Mixer_4Speakers_Simd) {
+	mixSpeakers(state, 4, true);
+}
+
+MUMPI_BENCHMARK(Mixer_16Speakers_Scalar) {
+	mixSpeakers(state, 16, false);
+}
+
+MUMPI_BENCHMARK(Mixer_16Speakers_Simd) {
+	mixSpeakers(state, 16, true);
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "AudioPipeline.hpp"
+#include "Benchmark.hpp"
+#include "FileAudioBackend.hpp"
+#include "VoxGate.hpp"
+#include "WavFile.hpp"
+
+static const int SAMPLE_RATE = 48000;
+static const size_t OPUS_FRAME_SIZE = 960;
+static const size_t FRAMES_PER_BUFFER = 512;
+static const size_t BUFFER_SAMPLES = 32768;
+
+static double cpuSeconds() {
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Writes numFrames Opus frames of radio-like traffic: 2 s transmissions of
+ * a noisy tone separated by 3 s of low-level noise
+ */
+static void writeTraffic(const std::string &path, size_t numFrames) {
+	WavWriter writer(path, SAMPLE_RATE, 1);
+	std::vector<int16_t> frame(OPUS_FRAME_SIZE);
+	uint32_t seed = 1;
+	uint64_t n = 0;
+	for(size_t f = 0; f < numFrames; f++) {
+		const bool keyed = (n / SAMPLE_RATE) % 5 < 2;
+		for(size_t i = 0; i < OPUS_FRAME_SIZE; i++, n++) {
+			seed = seed * 1664525 + 1013904223;
+			const double noise = (int32_t) seed / 2147483648.0 * 30.0;
+			const double tone = keyed ? 8000.0 * std::sin(2.0 * M_PI * 440.0 * n / SAMPLE_RATE) : 0.0;
+			frame[i] = (int16_t) (tone + noise);
+		}
+		writer.write(frame.data(), frame.size());
+	}
+}
+
+/**
+ * A recording pushed through FileAudioBackend unpaced, the capture buffer
+ * and the VOX gate as fast as they go, with a counting sink in place of the
+ * encoder. One iteration is one 20 ms Opus frame. Counters are measured over
+ * the replay only, excluding writing the recording.
+ */
+MUMPI_BENCHMARK(Pipeline_FileReplay) {
+	const std::string path = "/tmp/mumpi-bench-" + std::to_string(getpid()) + ".wav";
+	writeTraffic(path, state.iterations);
+
+	AudioPipeline pipeline(SAMPLE_RATE, 1, OPUS_FRAME_SIZE, BUFFER_SAMPLES);
+	FileAudioBackend backend(path, "", false, FRAMES_PER_BUFFER);
+	VoxGate vox(SAMPLE_RATE, -40.0, 0.050);
+	std::vector<int16_t> wrap(OPUS_FRAME_SIZE);
+	uint64_t sent = 0;
+
+	const double cpuStart = cpuSeconds();
+	const auto start = std::chrono::steady_clock::now();
+	backend.start(pipeline);
+	SpscRingBuffer<int16_t> &rec = pipeline.getCaptureBuffer();
+	while(true) {
+		int16_t *frame = rec.peekReadLinear(OPUS_FRAME_SIZE, wrap.data());
+		if(frame != NULL) {
+			if(vox.process(frame, OPUS_FRAME_SIZE))
+				sent++;
+			rec.consumeRead(OPUS_FRAME_SIZE);
+		} else if(backend.isFinished()) {
+			break;
+		} else {
+			pipeline.getFrameReady().waitFor(std::chrono::milliseconds(1));
+		}
+	}
+	backend.stop();
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double cpu = cpuSeconds() - cpuStart;
+	doNotOptimize(sent);
+	std::remove(path.c_str());
+
+	state.itemsPerIteration = OPUS_FRAME_SIZE;
+	state.counters["cpu_ns_per_frame"] = cpu * 1e9 / state.iterations;
+	state.counters["realtime_factor"] = state.iterations * OPUS_FRAME_SIZE / (double) SAMPLE_RATE / wall;
+	state.counters["transmitted_fraction"] = (double) vox.getTransmittedFrames() / vox.getFrames();
+}
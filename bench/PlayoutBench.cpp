@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <vector>
+#include "Benchmark.hpp"
+#include "DriftController.hpp"
+#include "SpscRingBuffer.hpp"
+
+// PortAudio's buffer at 48 kHz and the 10 ms playout frame
+static const size_t CALLBACK_SAMPLES = 512;
+static const size_t PLAYOUT_FRAME_SAMPLES = 480;
+static const size_t OUT_BUF_SIZE = 32768;
+
+/**
+ * paOutputCallback's fill path with out_buf holding enough audio
+ */
+MUMPI_BENCHMARK(OutputFill_Full) {
+	SpscRingBuffer<int16_t> buf(OUT_BUF_SIZE);
+	std::vector<int16_t> in(CALLBACK_SAMPLES, 1);
+	std::vector<int16_t> out(CALLBACK_SAMPLES);
+	for(size_t it = 0; it < state.iterations; it++) {
+		buf.push(in.data(), 0, CALLBACK_SAMPLES);
+		buf.topPadded(out.data(), 0, CALLBACK_SAMPLES, 0);
+		doNotOptimize(out[0]);
+	}
+	state.itemsPerIteration = CALLBACK_SAMPLES;
+}
+
+/**
+ * paOutputCallback's fill path on underrun: half the buffer is zero-filled
+ */
+MUMPI_BENCHMARK(OutputFill_Underrun) {
+	SpscRingBuffer<int16_t> buf(OUT_BUF_SIZE);
+	std::vector<int16_t> in(CALLBACK_SAMPLES / 2, 1);
+	std::vector<int16_t> out(CALLBACK_SAMPLES);
+	for(size_t it = 0; it < state.iterations; it++) {
+		buf.push(in.data(), 0, in.size());
+		buf.topPadded(out.data(), 0, CALLBACK_SAMPLES, 0);
+		doNotOptimize(out[0]);
+	}
+	state.itemsPerIteration = CALLBACK_SAMPLES;
+}
+
+/**
+ * playout_thread's drift correction on a speech frame
+ */
+static void driftProcess(BenchState &state, size_t fill, bool silent) {
+	DriftController drift(48000, 2400);
+	std::vector<int16_t> in(PLAYOUT_FRAME_SAMPLES, 1000);
+	std::vector<int16_t> out(DriftController::getMaxOutput(PLAYOUT_FRAME_SAMPLES));
+	for(size_t it = 0; it < state.iterations; it++) {
+		drift.updateFill(fill);
+		const size_t n = drift.process(in.data(), PLAYOUT_FRAME_SAMPLES, silent, out.data(), out.size());
+		doNotOptimize(n);
+	}
+	state.itemsPerIteration = PLAYOUT_FRAME_SAMPLES;
+}
+
+MUMPI_BENCHMARK(Drift_AtTarget) {
+	driftProcess(state, 2400, false);
+}
+
+MUMPI_BENCHMARK(Drift_Resample) {
+	driftProcess(state, 9600, false);
+}
+
+MUMPI_BENCHMARK(Drift_Silence) {
+	driftProcess(state, 9600, true);
+}
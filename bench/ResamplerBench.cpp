@@ -0,0 +1,53 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Benchmark.hpp"
+#include "Resampler.hpp"
+
+// one PortAudio buffer, as Bridge opens the streams with
+static const size_t BUFFER_FRAMES = 512;
+
+/**
+ * Converts one device buffer of a tone per iteration, the capture side's
+ * work per callback. Items are input samples.
+ */
+static void resample(BenchState &state, int inRate, int outRate, Resampler::Quality quality) {
+	std::vector<int16_t> input(BUFFER_FRAMES);
+	for(size_t i = 0; i < BUFFER_FRAMES; i++)
+		input[i] = (int16_t) (8000.0 * std::sin(i * 0.05));
+	Resampler resampler(inRate, outRate, 1, quality, BUFFER_FRAMES);
+	std::vector<int16_t> output(resampler.getMaxOutput(BUFFER_FRAMES));
+	for(size_t it = 0; it < state.iterations; it++) {
+		const size_t produced = resampler.process(input.data(), BUFFER_FRAMES, output.data());
+		doNotOptimize(produced);
+		doNotOptimize(output[0]);
+	}
+	state.itemsPerIteration = BUFFER_FRAMES;
+	state.counters["taps"] = resampler.getTaps();
+	state.counters["delay_ms"] = resampler.getDelay() * 1000.0;
+}
+
+MUMPI_BENCHMARK(Resample_44k1_48k) {
+	resample(state, 44100, 48000, Resampler::MEDIUM);
+}
+
+MUMPI_BENCHMARK(Resample_48k_44k1) {
+	resample(state, 48000, 44100, Resampler::MEDIUM);
+}
+
+MUMPI_BENCHMARK(Resample_16k_48k) {
+	resample(state, 16000, 48000, Resampler::MEDIUM);
+}
+
+MUMPI_BENCHMARK(Resample_48k_16k) {
+	resample(state, 48000, 16000, Resampler::MEDIUM);
+}
+
+// the quality knob, on the most common conversion
+MUMPI_BENCHMARK(Resample_44k1_48k_Low) {
+	resample(state, 44100, 48000, Resampler::LOW);
+}
+
+MUMPI_BENCHMARK(Resample_44k1_48k_High) {
+	resample(state, 44100, 48000, Resampler::HIGH);
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "Benchmark.hpp"
+#include "RingBuffer.hpp"
+#include "SpscRingBuffer.hpp"
+
+// one 20 ms Opus frame at 48 kHz
+static const size_t FRAME_SAMPLES = 960;
+// 0.5 s at 48 kHz, as sized in main() before and after rounding with nextPowerOf2
+static const size_t MODULO_SIZE = 24000;
+static const size_t POW2_SIZE = 32768;
+
+template <class Buffer>
+static void pushTopPerSample(BenchState &state, size_t size) {
+	Buffer buf(size);
+	int16_t sum = 0;
+	for(size_t it = 0; it < state.iterations; it++) {
+		for(size_t i = 0; i < FRAME_SAMPLES; i++)
+			buf.push((int16_t) i);
+		for(size_t i = 0; i < FRAME_SAMPLES; i++)
+			sum += buf.top();
+	}
+	doNotOptimize(sum);
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+template <class Buffer>
+static void pushTopBulk(BenchState &state, size_t size) {
+	Buffer buf(size);
+	std::vector<int16_t> in(FRAME_SAMPLES, 1);
+	std::vector<int16_t> out(FRAME_SAMPLES);
+	for(size_t it = 0; it < state.iterations; it++) {
+		buf.push(in.data(), 0, FRAME_SAMPLES);
+		buf.top(out.data(), 0, FRAME_SAMPLES);
+		doNotOptimize(out[0]);
+	}
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+MUMPI_BENCHMARK(RingBuffer_PerSample) {
+	pushTopPerSample<RingBuffer<int16_t>>(state, MODULO_SIZE);
+}
+
+MUMPI_BENCHMARK(RingBuffer_Bulk) {
+	pushTopBulk<RingBuffer<int16_t>>(state, MODULO_SIZE);
+}
+
+MUMPI_BENCHMARK(RingBuffer_BulkPow2) {
+	pushTopBulk<RingBuffer<int16_t>>(state, POW2_SIZE);
+}
+
+MUMPI_BENCHMARK(SpscRingBuffer_PerSample) {
+	pushTopPerSample<SpscRingBuffer<int16_t>>(state, MODULO_SIZE);
+}
+
+MUMPI_BENCHMARK(SpscRingBuffer_Bulk) {
+	pushTopBulk<SpscRingBuffer<int16_t>>(state, MODULO_SIZE);
+}
+
+MUMPI_BENCHMARK(SpscRingBuffer_BulkPow2) {
+	pushTopBulk<SpscRingBuffer<int16_t>>(state, POW2_SIZE);
+}
+
+// the consumer commits with a compare-and-swap under drop-oldest
+MUMPI_BENCHMARK(SpscRingBuffer_BulkPow2DropOldest) {
+	SpscRingBuffer<int16_t> buf(POW2_SIZE, ringbuffer::DROP_OLDEST);
+	std::vector<int16_t> in(FRAME_SAMPLES, 1);
+	std::vector<int16_t> out(FRAME_SAMPLES);
+	for(size_t it = 0; it < state.iterations; it++) {
+		buf.push(in.data(), 0, FRAME_SAMPLES);
+		buf.top(out.data(), 0, FRAME_SAMPLES);
+		doNotOptimize(out[0]);
+	}
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+/**
+ * Moves state.iterations 20 ms frames from a producer thread pushing
+ * PortAudio-sized chunks to the calling thread reading Opus frames, like
+ * paRecordCallback and input_consumer_thread. pushChunk returns how many
+ * elements it stored.
+ */
+template <class Buffer, class PushFn>
+static void pushTopContended(BenchState &state, PushFn pushChunk) {
+	const size_t CALLBACK_SAMPLES = 512;
+	Buffer buf(POW2_SIZE);
+	const size_t total = state.iterations * FRAME_SAMPLES;
+	size_t spins = 0;
+
+	std::thread producer([&]() {
+		std::vector<int16_t> chunk(CALLBACK_SAMPLES, 1);
+		size_t pushed = 0;
+		while(pushed < total) {
+			const size_t n = std::min(CALLBACK_SAMPLES, total - pushed);
+			size_t done = 0;
+			while(done < n) {
+				done += pushChunk(buf, chunk.data(), done, n - done);
+				if(done < n)
+					std::this_thread::yield();
+			}
+			pushed += n;
+		}
+	});
+
+	std::vector<int16_t> frame(FRAME_SAMPLES);
+	size_t consumed = 0;
+	while(consumed < total) {
+		const size_t n = buf.top(frame.data(), 0, std::min(FRAME_SAMPLES, total - consumed));
+		if(n == 0) {
+			spins++;
+			std::this_thread::yield();
+		}
+		consumed += n;
+	}
+	producer.join();
+	state.itemsPerIteration = FRAME_SAMPLES;
+	state.counters["empty_polls_per_frame"] = (double) spins / state.iterations;
+}
+
+MUMPI_BENCHMARK(RingBuffer_Contended) {
+	// the mutex buffer overwrites when full, so only push what fits
+	pushTopContended<RingBuffer<int16_t>>(state,
+		[](RingBuffer<int16_t> &b, const int16_t *src, size_t off, size_t len) {
+			const size_t n = std::min(len, b.getSize() - b.getRemaining());
+			b.push(src, (int) off, n);
+			return n;
+		});
+}
+
+MUMPI_BENCHMARK(SpscRingBuffer_Contended) {
+	pushTopContended<SpscRingBuffer<int16_t>>(state,
+		[](SpscRingBuffer<int16_t> &b, const int16_t *src, size_t off, size_t len) {
+			return b.push(src, (int) off, len);
+		});
+}
@@ -0,0 +1,198 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "Benchmark.hpp"
+#include "VadGate.hpp"
+#include "VoxGate.hpp"
+#include "WavFile.hpp"
+
+static const int SAMPLE_RATE = 48000;
+static const size_t FRAME_SAMPLES = 960;
+static const double THRESHOLD_DB = -40.0;
+static const size_t SCENE_FRAMES = 3000;	// 60 s
+static const size_t CYCLE_FRAMES = 300;		// 6 s
+
+/**
+ * Frames to gate, each labelled speech or not
+ */
+struct Scene {
+	std::vector<int16_t> samples;
+	std::vector<char> speech;		// per frame
+	std::vector<char> scored;		// per frame, false in the hangover after speech
+	bool labelled;
+};
+
+/**
+ * 60 s of simulated radio traffic in 6 s cycles: static at about -50 dB
+ * throughout, a -25 dB static burst (squelch tail) at 1.5 s, and 2 s of
+ * speech from 3 s. The speech is syllables of a gliding harmonic pitch,
+ * each starting with a short fricative noise.
+ */
+static void makeScene(Scene &scene) {
+	scene.samples.assign(SCENE_FRAMES * FRAME_SAMPLES, 0);
+	scene.speech.assign(SCENE_FRAMES, 0);
+	scene.scored.assign(SCENE_FRAMES, 1);
+	scene.labelled = true;
+	uint32_t seed = 1;
+	double phase = 0.0;
+	for(size_t n = 0; n < scene.samples.size(); n++) {
+		const size_t frame = n / FRAME_SAMPLES;
+		const size_t inCycle = frame % CYCLE_FRAMES;
+		seed = seed * 1664525 + 1013904223;
+		const double white = (int32_t) seed / 2147483648.0;
+		double v = white * 180.0;
+		if(inCycle >= 75 && inCycle < 90)
+			v = white * 3200.0;
+		if(inCycle >= 150 && inCycle < 250) {
+			// 250 ms syllables: 40 ms fricative, then voiced with a pitch glide
+			const double t = (double) (n - 150 * FRAME_SAMPLES) / SAMPLE_RATE;
+			const double s = std::fmod(t, 0.25);
+			if(s < 0.04) {
+				v += white * 1500.0;
+			} else {
+				const double f0 = 120.0 + 60.0 * s / 0.25;
+				phase += 2.0 * M_PI * f0 / SAMPLE_RATE;
+				// sin(h * phase) for each harmonic by rotating e^(i * phase)
+				const double c = std::cos(phase);
+				const double d = std::sin(phase);
+				double re = 1.0, im = 0.0, voiced = 0.0;
+				for(int h = 1; h <= 20; h++) {
+					const double r = re * c - im * d;
+					im = re * d + im * c;
+					re = r;
+					voiced += im / h;
+				}
+				v += 2500.0 * std::sin(M_PI * (s - 0.04) / 0.21) * voiced;
+			}
+			scene.speech[frame] = 1;
+		} else if(inCycle >= 250 && inCycle < 265) {
+			scene.scored[frame] = 0;	// either gate's hold may still be open
+		}
+		scene.samples[n] = (int16_t) std::max(-32768.0, std::min(32767.0, v));
+	}
+}
+
+/**
+ * The recording named by MUMPI_VAD_RECORDING (48 kHz mono WAV or raw PCM)
+ * if set, since there are no labels only transmitted_fraction is reported.
+ * Otherwise the simulated scene.
+ */
+static const Scene& getScene() {
+	static Scene scene;
+	if(scene.samples.empty()) {
+		const char *path = std::getenv("MUMPI_VAD_RECORDING");
+		if(path != NULL) {
+			WavReader reader(path);
+			std::vector<int16_t> frame(FRAME_SAMPLES);
+			while(reader.read(frame.data(), FRAME_SAMPLES) == FRAME_SAMPLES)
+				scene.samples.insert(scene.samples.end(), frame.begin(), frame.end());
+			const size_t frames = scene.samples.size() / FRAME_SAMPLES;
+			scene.speech.assign(frames, 0);
+			scene.scored.assign(frames, 0);
+			scene.labelled = false;
+		}
+		if(scene.samples.empty())
+			makeScene(scene);
+	}
+	return scene;
+}
+
+/**
+ * Counts transmitted frames against the scene's labels
+ */
+struct GateScore {
+	uint64_t frames;
+	uint64_t transmitted;
+	uint64_t noiseFrames;
+	uint64_t falseTriggers;
+	uint64_t speechFrames;
+	uint64_t speechSent;
+
+	GateScore() : frames(0), transmitted(0), noiseFrames(0), falseTriggers(0),
+			speechFrames(0), speechSent(0) {}
+
+	void add(const Scene &scene, size_t frame, bool sent) {
+		frames++;
+		transmitted += sent;
+		if(scene.speech[frame]) {
+			speechFrames++;
+			speechSent += sent;
+		} else if(scene.scored[frame]) {
+			noiseFrames++;
+			falseTriggers += sent;
+		}
+	}
+
+	void report(BenchState &state, const Scene &scene) const {
+		state.counters["transmitted_fraction"] = (double) transmitted / frames;
+		if(scene.labelled) {
+			state.counters["false_trigger_rate"] = (double) falseTriggers / noiseFrames;
+			state.counters["speech_sent_rate"] = (double) speechSent / speechFrames;
+		}
+	}
+};
+
+/**
+ * The energy VOX as configured by default, -40 dB with 50 ms hold. One
+ * iteration is one 20 ms frame.
+ */
+MUMPI_BENCHMARK(Vad_EnergyVox) {
+	const Scene &scene = getScene();
+	const size_t frames = scene.speech.size();
+	VoxGate gate(SAMPLE_RATE, THRESHOLD_DB, 0.050);
+	GateScore score;
+	for(size_t it = 0; it < state.iterations; it++) {
+		const size_t f = it % frames;
+		const bool sent = gate.process(&scene.samples[f * FRAME_SAMPLES], FRAME_SAMPLES);
+		score.add(scene, f, sent);
+	}
+	score.report(state, scene);
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+/**
+ * --vad with its defaults: 10 frames hangover, 3 frames pre-roll. Pre-roll
+ * frames count as transmitted when they are sent.
+ */
+MUMPI_BENCHMARK(Vad_Spectral) {
+	const Scene &scene = getScene();
+	const size_t frames = scene.speech.size();
+	VadGate gate(SAMPLE_RATE, FRAME_SAMPLES, THRESHOLD_DB, 10, 3);
+	GateScore score;
+	for(size_t it = 0; it < state.iterations; it++) {
+		const size_t f = it % frames;
+		const bool sent = gate.process(&scene.samples[f * FRAME_SAMPLES]);
+		for(size_t i = 0; sent && i < gate.getPreRollCount(); i++)
+			score.add(scene, (f + frames - gate.getPreRollCount() + i) % frames, true);
+		score.add(scene, f, sent);
+	}
+	score.report(state, scene);
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+/**
+ * SpectralVad's analysis alone at the smaller Opus frame sizes of the
+ * lower sample rates
+ */
+static void spectralVad(BenchState &state, int sampleRate) {
+	const size_t frameSize = sampleRate / 50;
+	std::vector<int16_t> pcm(frameSize);
+	for(size_t i = 0; i < frameSize; i++)
+		pcm[i] = (int16_t) (8000.0 * std::sin(i * 0.05));
+	SpectralVad vad(sampleRate, frameSize, THRESHOLD_DB);
+	bool voice = false;
+	for(size_t it = 0; it < state.iterations; it++) {
+		voice ^= vad.isVoice(pcm.data());
+		doNotOptimize(voice);
+	}
+	state.itemsPerIteration = frameSize;
+}
+
+MUMPI_BENCHMARK(Vad_Detector_24k) {
+	spectralVad(state, 24000);
+}
+
+MUMPI_BENCHMARK(Vad_Detector_12k) {
+	spectralVad(state, 12000);
+}
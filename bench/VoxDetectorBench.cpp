@@ -0,0 +1,81 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "Benchmark.hpp"
+#include "VoxDetector.hpp"
+
+// one 20 ms Opus frame at 48 kHz
+static const size_t FRAME_SAMPLES = 960;
+
+static std::vector<int16_t> makeFrame(size_t len = FRAME_SAMPLES) {
+	std::vector<int16_t> pcm(len);
+	for(size_t i = 0; i < len; i++)
+		pcm[i] = (int16_t) (8000.0 * std::sin(i * 0.05));
+	return pcm;
+}
+
+/**
+ * The VOX loop as it was in input_consumer_thread: double conversion per
+ * sample plus sqrt and log10 per frame.
+ */
+MUMPI_BENCHMARK(Vox_DoubleLog10) {
+	const std::vector<int16_t> pcm = makeFrame();
+	bool voice = false;
+	for(size_t it = 0; it < state.iterations; it++) {
+		double sum = 0;
+		for(size_t i = 0; i < FRAME_SAMPLES; i++) {
+			const double sample = std::abs(pcm[i]) / 32767.0;
+			sum += sample * sample;
+		}
+		const double rms = std::sqrt(sum / FRAME_SAMPLES);
+		voice ^= 20.0 * std::log10(rms) >= -40.0;
+		doNotOptimize(voice);
+	}
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+MUMPI_BENCHMARK(Vox_SumOfSquaresScalar) {
+	const std::vector<int16_t> pcm = makeFrame();
+	for(size_t it = 0; it < state.iterations; it++) {
+		uint64_t sum = VoxDetector::sumOfSquaresScalar(pcm.data(), FRAME_SAMPLES);
+		doNotOptimize(sum);
+	}
+	state.itemsPerIteration = FRAME_SAMPLES;
+}
+
+/**
+ * input_consumer_thread's VOX decision on one OPUS_FRAME_SIZE (20 ms) frame
+ * at sampleRate, optionally with the dB value it logs in verbose mode
+ */
+static void voxDetector(BenchState &state, int sampleRate, bool withDb) {
+	const size_t frameSize = sampleRate / 50;
+	const std::vector<int16_t> pcm = makeFrame(frameSize);
+	VoxDetector vox(-40.0);
+	bool voice = false;
+	double db = 0.0;
+	for(size_t it = 0; it < state.iterations; it++) {
+		voice ^= vox.isVoice(pcm.data(), frameSize);
+		if(withDb)
+			db += vox.getLastDb();
+		doNotOptimize(voice);
+	}
+	doNotOptimize(db);
+	state.itemsPerIteration = frameSize;
+}
+
+MUMPI_BENCHMARK(Vox_Detector) {
+	voxDetector(state, 48000, false);
+}
+
+MUMPI_BENCHMARK(Vox_Detector_24k) {
+	voxDetector(state, 24000, false);
+}
+
+MUMPI_BENCHMARK(Vox_Detector_12k) {
+	voxDetector(state, 12000, false);
+}
+
+MUMPI_BENCHMARK(Vox_DetectorDb) {
+	voxDetector(state, 48000, true);
+}
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "Benchmark.hpp"
+#include "EventSignal.hpp"
+#include "SpscRingBuffer.hpp"
+
+// 48 kHz capture: PortAudio delivers 512-sample buffers, the encoder wants
+// 960-sample (20 ms) frames
+static const size_t CALLBACK_SAMPLES = 512;
+static const size_t FRAME_SAMPLES = 960;
+static const std::chrono::microseconds CALLBACK_PERIOD(10667);
+
+/**
+ * Simulates paRecordCallback feeding input_consumer_thread for
+ * state.iterations frames and measures the time from a frame becoming
+ * available to the consumer picking it up.
+ *
+ * @param useSignal true to wait on EventSignal, false for the old 20 ms sleep polling
+ */
+static void wakeupLatency(BenchState &state, bool useSignal) {
+	SpscRingBuffer<int16_t> buf(32768);
+	EventSignal frameReady;
+	std::vector<int16_t> block(CALLBACK_SAMPLES, 0);
+	std::vector<int16_t> frame(FRAME_SAMPLES);
+	const size_t frames = state.iterations;
+	// time each frame became complete, written before the push that completes it
+	std::vector<std::chrono::steady_clock::time_point> readyAt(frames + 1);
+
+	std::thread producer([&]() {
+		size_t pushed = 0;
+		std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+		while(pushed < frames * FRAME_SAMPLES) {
+			next += CALLBACK_PERIOD;
+			std::this_thread::sleep_until(next);
+			const size_t completed = (pushed + CALLBACK_SAMPLES) / FRAME_SAMPLES;
+			if(completed > pushed / FRAME_SAMPLES && completed <= frames)
+				readyAt[completed - 1] = std::chrono::steady_clock::now();
+			pushed += buf.push(block.data(), 0, CALLBACK_SAMPLES);
+			if(useSignal && buf.getRemaining() >= FRAME_SAMPLES)
+				frameReady.notify();
+		}
+	});
+
+	double totalUs = 0.0;
+	double maxUs = 0.0;
+	size_t consumed = 0;
+	while(consumed < frames) {
+		if(buf.getRemaining() >= FRAME_SAMPLES) {
+			const double us = std::chrono::duration<double, std::micro>(
+				std::chrono::steady_clock::now() - readyAt[consumed]).count();
+			totalUs += us;
+			maxUs = std::max(maxUs, us);
+			buf.top(frame.data(), 0, FRAME_SAMPLES);
+			consumed++;
+		} else if(useSignal) {
+			frameReady.waitFor(std::chrono::milliseconds(100));
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+	}
+	producer.join();
+
+	state.itemsPerIteration = 1;
+	state.counters["mean_latency_us"] = totalUs / frames;
+	state.counters["max_latency_us"] = maxUs;
+}
+
+MUMPI_BENCHMARK(Wakeup_Poll20ms) {
+	wakeupLatency(state, false);
+}
+
+MUMPI_BENCHMARK(Wakeup_EventSignal) {
+	wakeupLatency(state, true);
+}
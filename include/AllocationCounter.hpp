@@ -0,0 +1,22 @@
+#ifndef AllocationCounter_hpp
+#define AllocationCounter_hpp
+
+#include <cstdint>
+
+/**
+ * Counts heap allocations made through operator new, to check that the audio
+ * paths don't allocate once they are warmed up. Allocator locks are shared
+ * between the audio, worker and network threads, so a stray allocation shows
+ * up as a latency spike on a loaded Pi.
+ *
+ * Counting is only compiled in with MUMPI_COUNT_ALLOCATIONS, which the tests
+ * and benchmarks are built with; mumpi itself keeps the plain allocator and
+ * isEnabled() is false.
+ */
+class AllocationCounter {
+public:
+    static bool isEnabled();
+    static uint64_t getAllocations();
+};
+
+#endif /* AllocationCounter_hpp */
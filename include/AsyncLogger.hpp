@@ -0,0 +1,92 @@
+#ifndef AsyncLogger_hpp
+#define AsyncLogger_hpp
+
+#include <atomic>
+#include <thread>
+#include <log4cpp/Category.hh>
+#include "EventSignal.hpp"
+#include "LogRateLimiter.hpp"
+#include "LogRecord.hpp"
+#include "MpmcQueue.hpp"
+
+/**
+ * Moves log4cpp's formatting and locking off the audio and network threads.
+ *
+ * Callers capture a LogRecord into a preallocated lock-free queue, which
+ * involves no formatting, locks or allocation. A background thread formats
+ * the records and hands them to their log4cpp category. If the queue is full
+ * the message is dropped and counted. Messages below the category's priority
+ * are discarded before they are queued.
+ */
+class AsyncLogger {
+public:
+    AsyncLogger(size_t capacity = 1024);
+    ~AsyncLogger();
+
+    void start();
+    void stop();
+
+    template <class... Args>
+    bool log(log4cpp::Category &category, int priority, const char *format, Args... args);
+    template <class... Args>
+    bool log(LogRateLimiter &limiter, log4cpp::Category &category, int priority, const char *format, Args... args);
+
+    uint64_t getDropped() const { return _dropped.load(std::memory_order_relaxed); }
+    std::thread::native_handle_type getNativeHandle() { return _thread.native_handle(); }
+
+private:
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    bool enqueue(const LogRecord &record);
+    void run();
+    void drain();
+
+    MpmcQueue<LogRecord> _queue;
+    EventSignal _pending;
+    std::atomic<bool> _running;
+    std::atomic<uint64_t> _dropped;
+    std::thread _thread;
+};
+
+///////////////////////////
+// TEMPLATE IMPLEMENTATION
+///////////////////////////
+
+/**
+ * @brief Queues a message for category. Real-time safe.
+ *
+ * @param category log4cpp category to log to
+ * @param priority log4cpp priority
+ * @param format   printf format string, must be a string literal
+ * @param args     numbers and strings, strings are copied and may be truncated
+ * @return false if the message was discarded or dropped
+ */
+template <class... Args>
+bool AsyncLogger::log(log4cpp::Category &category, int priority, const char *format, Args... args) {
+    if(!category.isPriorityEnabled(priority))
+        return false;
+    LogRecord record;
+    record.capture(&category, priority, format, args...);
+    return enqueue(record);
+}
+
+/**
+ * @brief Queues a message unless limiter has passed one too recently. The
+ * number of messages suppressed in between is appended to the next one.
+ * Real-time safe.
+ */
+template <class... Args>
+bool AsyncLogger::log(LogRateLimiter &limiter, log4cpp::Category &category, int priority, const char *format, Args... args) {
+    if(!category.isPriorityEnabled(priority))
+        return false;
+    uint64_t suppressed;
+    if(!limiter.allow(suppressed))
+        return false;
+    LogRecord record;
+    record.capture(&category, priority, format, args...);
+    record.suppressed = suppressed;
+    return enqueue(record);
+}
+
+#endif /* AsyncLogger_hpp */
@@ -0,0 +1,53 @@
+#ifndef AudioBackend_hpp
+#define AudioBackend_hpp
+
+#include <string>
+#include "AudioPipeline.hpp"
+#include "ThreadTuning.hpp"
+
+/**
+ * Source of captured audio and sink of played audio for an AudioPipeline:
+ * sound hardware, or files for testing. The backend drives the pipeline
+ * from its own thread(s) between start() and stop().
+ */
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+
+    /**
+     * @brief Starts calling pipeline.capture() and pipeline.render()
+     * @throws AudioBackendException if the audio devices or files can't be used
+     */
+    virtual void start(AudioPipeline &pipeline) = 0;
+
+    /**
+     * @brief Stops calling the pipeline and releases the devices or files
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief True once a finite input (e.g. a file) has been fully captured
+     */
+    virtual bool isFinished() const = 0;
+
+    /**
+     * @brief Fraction of real time spent in the audio callbacks
+     */
+    virtual double getCpuLoad() const = 0;
+
+    /**
+     * @brief Sets the scheduling and CPUs of the threads that call the
+     * pipeline, applied as they start. Must be called before start().
+     */
+    virtual void setThreadTuning(const ThreadTuning &tuning) = 0;
+
+    /**
+     * @brief What those threads run with, see ThreadTuning::report(). Empty
+     * until they have started.
+     */
+    virtual std::string getThreadReport() = 0;
+
+    virtual const char* getName() const = 0;
+};
+
+#endif /* AudioBackend_hpp */
@@ -0,0 +1,18 @@
+#ifndef AudioBackendException_hpp
+#define AudioBackendException_hpp
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Exception to indicate that an audio backend could not be opened or started.
+ */
+class AudioBackendException : public std::runtime_error
+{
+public:
+    AudioBackendException(const std::string &message) :
+        std::runtime_error(message) {
+    }
+};
+
+#endif /* end of include guard: AudioBackendException_hpp */
@@ -0,0 +1,124 @@
+#ifndef AudioPipeline_hpp
+#define AudioPipeline_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ChannelRouter.hpp"
+#include "EventSignal.hpp"
+#include "LatencyHistogram.hpp"
+#include "Resampler.hpp"
+#include "SampleTimeline.hpp"
+#include "SpscRingBuffer.hpp"
+
+/**
+ * Per-stage latency measurement between microphone and network and between
+ * network and speaker, all on the steady clock
+ */
+struct PipelineLatency {
+    PipelineLatency(int sampleRate);
+
+    LatencyHistogram captureToVox;      // ADC time of a frame's last sample until its VOX decision
+    LatencyHistogram voxToSent;         // VOX decision until sendAudioData returns, includes encoding
+    LatencyHistogram receiveToPlayout;  // MumpiCallback::audio until the samples reach the DAC
+    SampleTimeline captureTimes;        // capture buffer index -> ADC time
+    SampleTimeline playoutArrivals;     // playout buffer index -> receive time
+};
+
+/**
+ * How the backend's device differs from an AudioPipeline: its sample rate
+ * and, for mono pipelines, its channels and which of them are used. The
+ * defaults match the pipeline.
+ */
+struct DeviceFormat {
+    DeviceFormat();
+
+    int rate;                           // 0 for the pipeline's sample rate
+    Resampler::Quality resampleQuality;
+    int inputChannels;                  // 0 for the pipeline's channels
+    int inputChannel;                   // 0-based, or ChannelRouter::ALL to average all
+    int outputChannels;                 // 0 for the pipeline's channels
+    int outputChannel;                  // 0-based, or ChannelRouter::ALL to play on all
+};
+
+/**
+ * The audio device side of mumpi, independent of where the audio comes from.
+ *
+ * An AudioBackend calls capture() with each recorded buffer and render() for
+ * each buffer it plays, from its audio thread(s). capture() queues samples
+ * in the capture buffer for the encoder thread and wakes it once a full Opus
+ * frame is ready. Several pipelines can share one wakeup signal, so a single
+ * thread can wait for all of them. render() plays what the playout thread queued in the
+ * playout buffer, and silence when it runs dry. Both are real-time safe.
+ *
+ * The backend runs at the device rate, which may differ from the sample
+ * rate the buffers and Opus use when a sound card doesn't support it (e.g.
+ * 44.1 or 16 kHz USB interfaces). Then capture() and render() resample
+ * between the two. A mono pipeline also takes one channel of a multi-channel
+ * device, or their average, and plays on one or all of its channels (see
+ * ChannelRouter), so several pipelines can share one device.
+ *
+ * Buffer times are in seconds on the backend's clock (PortAudio's stream
+ * time), and are converted to the steady clock for latency measurement.
+ * Pass 0 when the backend doesn't know them.
+ */
+class AudioPipeline {
+public:
+    AudioPipeline(int sampleRate, int channels, size_t opusFrameSize, size_t bufferSamples,
+                  EventSignal *frameReady = NULL, const DeviceFormat &device = DeviceFormat(),
+                  ringbuffer::OverflowPolicy captureOverflow = ringbuffer::DROP_NEWEST,
+                  ringbuffer::OverflowPolicy playoutOverflow = ringbuffer::DROP_NEWEST);
+
+    // backend side
+    void capture(const int16_t *input, size_t frames, double adcTime, double currentTime);
+    size_t render(int16_t *output, size_t frames, double dacTime, double currentTime, bool mix = false);
+    size_t getMaxCaptured(size_t frames) const;
+
+    // encoder and playout side
+    SpscRingBuffer<int16_t>& getCaptureBuffer() { return _captureBuf; }
+    const SpscRingBuffer<int16_t>& getCaptureBuffer() const { return _captureBuf; }
+    SpscRingBuffer<int16_t>& getPlayoutBuffer() { return _playoutBuf; }
+    EventSignal& getFrameReady() { return _frameReady; }
+    PipelineLatency& getLatency() { return _latency; }
+
+    int getSampleRate() const { return _sampleRate; }
+    int getDeviceRate() const { return _deviceRate; }
+    int getChannels() const { return _channels; }
+    int getInputChannels() const { return _inputChannels; }
+    int getOutputChannels() const { return _outputChannels; }
+    const ChannelRouter* getRouter() const { return _router.get(); }
+    size_t getOpusFrameSize() const { return _opusFrameSize; }
+
+    static double steadySeconds();
+
+private:
+    AudioPipeline(const AudioPipeline&) = delete;
+    AudioPipeline& operator=(const AudioPipeline&) = delete;
+
+    void store(const int16_t *input, size_t samples);
+
+    const int _sampleRate;
+    const int _deviceRate;
+    const int _channels;
+    const int _inputChannels;           // of the device
+    const int _outputChannels;
+    const size_t _opusFrameSize;
+    SpscRingBuffer<int16_t> _captureBuf;
+    SpscRingBuffer<int16_t> _playoutBuf;
+    EventSignal _ownFrameReady;
+    EventSignal &_frameReady;           // raised once the capture buffer holds a full Opus frame
+    PipelineLatency _latency;
+    uint64_t _capturedSamples;          // stored in _captureBuf, capture() only
+    uint64_t _playedSamples;            // read from _playoutBuf, render() only
+    size_t _playoutPosition;            // _playoutBuf's read position when _playedSamples was updated
+    std::unique_ptr<Resampler> _captureResampler;   // device -> sample rate, NULL if they're equal
+    std::unique_ptr<Resampler> _renderResampler;    // sample -> device rate
+    std::unique_ptr<ChannelRouter> _router;         // mono pipelines only
+    std::vector<int16_t> _downmixed;    // capture() router output
+    std::vector<int16_t> _captured;     // capture() resampler output
+    std::vector<int16_t> _toRender;     // render() resampler input
+    std::vector<int16_t> _rendered;     // render() router input
+};
+
+#endif /* AudioPipeline_hpp */
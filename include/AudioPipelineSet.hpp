@@ -0,0 +1,41 @@
+#ifndef AudioPipelineSet_hpp
+#define AudioPipelineSet_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AudioPipeline.hpp"
+
+/**
+ * The pipelines an AudioBackend drives from one device: usually one, or
+ * several mono pipelines on the channels of a shared sound card, so one
+ * stereo card with one stream serves two bridges.
+ *
+ * The backend hands every buffer to all of them; the first pipeline renders
+ * into the output buffer and the others mix in. Pipelines are added before
+ * the backend starts and never removed, so the audio thread reads the set
+ * without locking.
+ */
+class AudioPipelineSet {
+public:
+    AudioPipelineSet(size_t expected = 1);
+
+    bool add(AudioPipeline &pipeline);
+    bool isComplete() const { return _pipelines.size() == _expected; }
+
+    void capture(const int16_t *input, size_t frames, double adcTime, double currentTime);
+    size_t render(int16_t *output, size_t frames, double dacTime, double currentTime);
+    bool hasCaptureRoom(size_t frames) const;
+
+    // device format, the same for every pipeline
+    int getDeviceRate() const { return _pipelines.front()->getDeviceRate(); }
+    int getInputChannels() const { return _pipelines.front()->getInputChannels(); }
+    int getOutputChannels() const { return _pipelines.front()->getOutputChannels(); }
+    size_t size() const { return _pipelines.size(); }
+
+private:
+    const size_t _expected;
+    std::vector<AudioPipeline*> _pipelines;
+};
+
+#endif /* AudioPipelineSet_hpp */
@@ -0,0 +1,124 @@
+#ifndef Bridge_hpp
+#define Bridge_hpp
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <boost/asio.hpp>
+#include <log4cpp/Category.hh>
+#include "AsyncLogger.hpp"
+#include "AudioBackend.hpp"
+#include "AudioPipeline.hpp"
+#include "BridgeConfig.hpp"
+#include "DriftController.hpp"
+#include "JitterBufferSet.hpp"
+#include "MumpiCallback.hpp"
+#include "Recorder.hpp"
+#include "ReplayBuffer.hpp"
+#include "VadGate.hpp"
+#include "VoxGate.hpp"
+
+/**
+ * One radio <-> channel bridge: an audio backend, a Mumble connection and the
+ * VOX, encoder and playout state between them.
+ *
+ * A bridge has no threads of its own. Its Mumble connection runs on a shared
+ * io_service (see MumbleService) and its audio work runs in service(), which
+ * a BridgeScheduler submits to a shared WorkerPool whenever a captured frame
+ * is ready or the next 10 ms playout frame is due. trySchedule() makes sure
+ * at most one service() per bridge is queued or running, so the VOX, drift
+ * controller and buffers only ever see one thread at a time.
+ */
+class Bridge {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    Bridge(const BridgeConfig &config,
+           const std::shared_ptr<AudioBackend> &backend,
+           boost::asio::io_service &ioService,
+           AsyncLogger &asyncLogger,
+           EventSignal &frameReady);
+    ~Bridge();
+
+    void start();
+    void stop();
+
+    // network side, called on the io_service thread
+    void maintainConnection(Clock::time_point now);
+    void connectionFailed(Clock::time_point now, const char *what);
+    void disconnect();
+
+    // audio side
+    bool needsService(Clock::time_point now) const;
+    bool trySchedule() { return !_scheduled.exchange(true, std::memory_order_acquire); }
+    void cancelSchedule() { _scheduled.store(false, std::memory_order_release); }
+    Clock::time_point getNextPlayout() const;
+    static void service(void *bridge);
+
+    bool isFinished() const;
+    void logStats();
+    void logLatency();
+    const BridgeConfig& getConfig() const { return _config; }
+    Recorder* getRecorder() { return _recorder.get(); }
+
+    // replay, called on the main thread
+    ReplayBuffer* getReplayBuffer() { return _history.get(); }
+    size_t replay(ReplayBuffer::Track track, double from, double to);
+    void pumpReplay();
+    bool isReplaying() const;
+
+    static std::shared_ptr<AudioBackend> createBackend(const BridgeConfig &config, AsyncLogger &asyncLogger,
+                                                       size_t pipelines = 1);
+
+private:
+    Bridge(const Bridge&) = delete;
+    Bridge& operator=(const Bridge&) = delete;
+
+    bool captureReady() const;
+    void serviceCapture();
+    void servicePlayout(Clock::time_point now);
+    void archiveTransmitted(const int16_t *pcm, double time);
+    void logBufferStats(const char *name, const SpscRingBuffer<int16_t> &buffer);
+
+    static DeviceFormat makeDeviceFormat(const BridgeConfig &config);
+    static mumlib::MumlibConfiguration makeMumlibConfiguration(const BridgeConfig &config);
+
+    const BridgeConfig _config;
+    AsyncLogger &_asyncLogger;
+    log4cpp::Category &_logger;
+    LogRateLimiter _voxLogLimit;
+    const size_t _opusFrameSize;
+    const size_t _playoutFrameSize;
+    const size_t _targetFill;
+
+    AudioPipeline _pipeline;
+    std::shared_ptr<AudioBackend> _backend;     // shared by bridges on the same sound card
+    std::shared_ptr<JitterBufferSet> _speakers;
+    std::unique_ptr<Recorder> _recorder;        // with record-dir only
+    std::unique_ptr<ReplayBuffer> _history;     // with replay-file only, opened by start()
+    SpscRingBuffer<int16_t> _replayOut;         // replayed audio, main thread to service()
+    std::vector<int16_t> _replayClip;           // main thread only
+    size_t _replayPosition;                     // of _replayClip queued to _replayOut
+    MumpiCallback _callback;
+    mumlib::MumlibConfiguration _mumConf;
+    mumlib::Mumlib _mum;
+    bool _connecting;                           // io_service thread only
+    Clock::time_point _reconnectAt;             // io_service thread only
+
+    // service() state
+    VoxGate _vox;
+    std::unique_ptr<VadGate> _vad;              // replaces _vox with --vad
+    DriftController _drift;
+    std::vector<int16_t> _wrapBuf;              // frames that wrap around the capture buffer
+    std::vector<int16_t> _replayWrap;           // and around _replayOut
+    std::vector<int16_t> _frame;
+    std::vector<int16_t> _corrected;
+    uint64_t _recIndex;                         // capture buffer index of the next frame
+    size_t _recPosition;                        // capture buffer read position at _recIndex
+    uint64_t _outIndex;                         // playout buffer index of the next sample
+    std::atomic<bool> _scheduled;
+    std::atomic<Clock::rep> _nextPlayout;       // time_since_epoch of the next playout frame
+};
+
+#endif /* Bridge_hpp */
@@ -0,0 +1,61 @@
+#ifndef BridgeConfig_hpp
+#define BridgeConfig_hpp
+
+#include <istream>
+#include <string>
+#include <vector>
+#include "Resampler.hpp"
+#include "SpscRingBuffer.hpp"
+
+/**
+ * Settings of one radio <-> channel bridge: the Mumble connection, the audio
+ * devices or files and the VOX and playout parameters. The defaults match
+ * mumpi's command line defaults.
+ */
+struct BridgeConfig {
+    BridgeConfig();
+
+    void set(const std::string &key, const std::string &value);
+    void validate(bool requireServer = true) const;
+    bool sharesDevice(const BridgeConfig &other) const;
+    int getDeviceRate() const { return deviceRate != 0 ? deviceRate : sampleRate; }
+
+    static std::vector<BridgeConfig> parse(std::istream &in);
+    static std::vector<BridgeConfig> parseFile(const std::string &path);
+
+    std::string name;           // used in log messages
+    std::string server;
+    int port;
+    std::string username;
+    std::string password;
+    int sampleRate;             // of encoding and playout
+    int deviceRate;             // of the sound card or files, 0 for sampleRate
+    Resampler::Quality resampleQuality;
+    int inputChannels;          // of the sound card or input file
+    int inputChannel;           // 1-based channel to capture, 0 to mix all of them
+    int outputChannels;
+    int outputChannel;          // 1-based channel to play on, 0 for all of them
+    int frameMs;                // Opus frame duration: 10, 20, 40 or 60
+    int bitrate;                // Opus target bitrate, bit/s
+    double voxThreshold;        // dB relative to full scale
+    double voiceHold;           // s
+    bool vad;                   // SpectralVad instead of the energy VOX
+    int vadHangover;            // frames to keep transmitting after voice, --vad only
+    int vadPreRoll;             // frames before voice to send with it, --vad only
+    double targetDelay;         // s of audio kept queued for the output device
+    double outputDelay;         // s suggested output latency, negative for the device default
+    ringbuffer::OverflowPolicy captureOverflow;     // when the encoder falls behind
+    ringbuffer::OverflowPolicy playoutOverflow;     // when the output device falls behind
+    bool fullDuplex;
+    std::string inputDevice;    // PortAudio device index or part of its name, empty for the default
+    std::string outputDevice;
+    std::string inputFile;      // files replace the devices if either is set
+    std::string outputFile;
+    bool unpaced;
+    std::string recordDir;      // directory for Ogg Opus recordings, empty to not record
+    int recordSegment;          // s per recording file
+    std::string replayFile;     // memory-mapped history of both directions, empty for none
+    int replayMinutes;          // of continuous audio the history holds
+};
+
+#endif /* BridgeConfig_hpp */
@@ -0,0 +1,18 @@
+#ifndef BridgeConfigException_hpp
+#define BridgeConfigException_hpp
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Exception to indicate an invalid bridge configuration file or setting.
+ */
+class BridgeConfigException : public std::runtime_error
+{
+public:
+    BridgeConfigException(const std::string &message) :
+        std::runtime_error(message) {
+    }
+};
+
+#endif /* end of include guard: BridgeConfigException_hpp */
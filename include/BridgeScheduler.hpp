@@ -0,0 +1,44 @@
+#ifndef BridgeScheduler_hpp
+#define BridgeScheduler_hpp
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "EventSignal.hpp"
+#include "WorkerPool.hpp"
+
+class Bridge;
+
+/**
+ * Hands bridge audio work to a WorkerPool. One thread sleeps on the capture
+ * wakeup signal all bridges share, or until the earliest playout frame is
+ * due, then submits Bridge::service() for every bridge with work pending and
+ * not already scheduled.
+ */
+class BridgeScheduler {
+public:
+    BridgeScheduler(WorkerPool &pool, EventSignal &frameReady);
+    ~BridgeScheduler();
+
+    void add(Bridge &bridge);
+    void start();
+    void stop();
+
+    uint64_t getSubmitted() const { return _submitted.load(std::memory_order_relaxed); }
+    std::thread::native_handle_type getNativeHandle() { return _thread.native_handle(); }
+
+private:
+    BridgeScheduler(const BridgeScheduler&) = delete;
+    BridgeScheduler& operator=(const BridgeScheduler&) = delete;
+
+    void run();
+
+    WorkerPool &_pool;
+    EventSignal &_frameReady;
+    std::vector<Bridge*> _bridges;
+    std::thread _thread;
+    std::atomic<bool> _running;
+    std::atomic<uint64_t> _submitted;
+};
+
+#endif /* BridgeScheduler_hpp */
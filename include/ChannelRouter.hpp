@@ -0,0 +1,45 @@
+#ifndef ChannelRouter_hpp
+#define ChannelRouter_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Maps a sound card's interleaved channels to and from a mono pipeline.
+ *
+ * Capture takes one input channel (e.g. the radio on the left channel of a
+ * stereo interface) or the average of all of them. Playout goes to one
+ * output channel, with the others silent, or to all of them. Two bridges can
+ * so share one stereo card, each on its own channel.
+ *
+ * Playout can overwrite the device buffer or mix into it with saturation,
+ * for the second and later pipelines on a shared device. Stereo, the common
+ * case, uses SSE2 or NEON when available; other channel counts are scalar.
+ */
+class ChannelRouter {
+public:
+    static const int ALL = -1;
+
+    ChannelRouter(int inputChannels, int inputChannel, int outputChannels, int outputChannel);
+
+    void downmix(const int16_t *input, size_t frames, int16_t *mono) const;
+    void upmix(const int16_t *mono, size_t frames, int16_t *output, bool mix) const;
+
+    int getInputChannels() const { return _inputChannels; }
+    int getInputChannel() const { return _inputChannel; }
+    int getOutputChannels() const { return _outputChannels; }
+    int getOutputChannel() const { return _outputChannel; }
+
+    // kernels, exposed for tests and benchmarks
+    void downmixScalar(const int16_t *input, size_t frames, int16_t *mono) const;
+    void upmixScalar(const int16_t *mono, size_t frames, int16_t *output, bool mix) const;
+    static const char* getKernelName();
+
+private:
+    const int _inputChannels;
+    const int _inputChannel;            // 0-based, or ALL to average every channel
+    const int _outputChannels;
+    const int _outputChannel;           // 0-based, or ALL to play on every channel
+};
+
+#endif /* ChannelRouter_hpp */
@@ -0,0 +1,33 @@
+#ifndef CommandPipe_hpp
+#define CommandPipe_hpp
+
+#include <string>
+
+/**
+ * Reads text commands, one per line, from a named pipe without blocking, so
+ * operators can control the running daemon with e.g.
+ * echo "replay repeater 60 30" > /run/mumpi.control
+ *
+ * The pipe is created if it doesn't exist and held open for writing too, so
+ * it doesn't report end of file between writers. Lines longer than
+ * MAX_LINE are discarded.
+ */
+class CommandPipe {
+public:
+    static const size_t MAX_LINE = 1024;
+
+    CommandPipe(const std::string &path);
+    ~CommandPipe();
+
+    bool readLine(std::string &line);
+
+private:
+    CommandPipe(const CommandPipe&) = delete;
+    CommandPipe& operator=(const CommandPipe&) = delete;
+
+    int _fd;
+    std::string _buffer;    // read but not yet returned
+    bool _discarding;       // in the rest of an overlong line
+};
+
+#endif /* CommandPipe_hpp */
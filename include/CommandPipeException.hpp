@@ -0,0 +1,18 @@
+#ifndef CommandPipeException_hpp
+#define CommandPipeException_hpp
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Exception to indicate that the command pipe can't be created or opened.
+ */
+class CommandPipeException : public std::runtime_error
+{
+public:
+    CommandPipeException(const std::string &message) :
+        std::runtime_error(message) {
+    }
+};
+
+#endif /* end of include guard: CommandPipeException_hpp */
@@ -0,0 +1,68 @@
+#ifndef DriftController_hpp
+#define DriftController_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counters reported by DriftController
+ */
+struct DriftStats {
+    double fillSamples;             // smoothed output buffer fill level
+    double correctionPpm;           // current resampling correction, > 0 removes samples
+    uint64_t insertedSamples;       // samples added by stretching or silence insertion
+    uint64_t droppedSamples;        // samples removed by squeezing or silence dropping
+    uint64_t resampledFrames;       // speech frames played with a non-zero correction
+    uint64_t silenceAdjustedFrames; // silent frames that were shortened or lengthened
+};
+
+/**
+ * Holds the output buffer at a target fill level despite the sender's clock
+ * and the sound card's clock running at slightly different rates.
+ *
+ * The playout thread reports the buffer's fill level every frame. The
+ * controller smooths it and derives a small rate correction (a few hundred
+ * ppm at most by default) that pulls the fill level back to the target over
+ * about ten seconds. Speech frames are resampled by that ratio with linear
+ * interpolation, which is inaudible at these rates. Silent frames are
+ * shortened or lengthened directly, which corrects faster and doesn't touch
+ * speech at all.
+ *
+ * process() and updateFill() must be called from one thread. getStats() is
+ * safe from any thread.
+ */
+class DriftController {
+public:
+    DriftController(int sampleRate,
+                    size_t targetFillSamples,
+                    double maxCorrectionPpm = 2000.0);
+
+    void updateFill(size_t fillSamples);
+    size_t process(const int16_t *in, size_t len, bool silent, int16_t *out, size_t outCapacity);
+    size_t getTargetFill() const { return _targetFill; }
+    static size_t getMaxOutput(size_t len) { return len + len / 8 + 2; }
+    DriftStats getStats() const;
+
+private:
+    size_t resample(const int16_t *in, size_t len, int16_t *out, size_t outCapacity);
+
+    const int _sampleRate;
+    const size_t _targetFill;
+    const double _maxCorrection;
+
+    double _fill;           // smoothed fill level
+    bool _haveFill;
+    double _correction;     // fraction of samples to remove, negative to insert
+    double _pos;            // resampler read position relative to the current frame
+    int16_t _prev;          // last sample of the previous frame
+
+    std::atomic<int64_t> _fillStat;
+    std::atomic<int64_t> _correctionPpmStat;
+    std::atomic<uint64_t> _inserted;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _resampledFrames;
+    std::atomic<uint64_t> _silenceAdjustedFrames;
+};
+
+#endif /* DriftController_hpp */
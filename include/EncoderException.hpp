@@ -0,0 +1,18 @@
+#ifndef EncoderException_hpp
+#define EncoderException_hpp
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Exception to indicate that an Opus encoder could not be created or set up.
+ */
+class EncoderException : public std::runtime_error
+{
+public:
+    EncoderException(const std::string &message) :
+        std::runtime_error(message) {
+    }
+};
+
+#endif /* end of include guard: EncoderException_hpp */
@@ -0,0 +1,65 @@
+#ifndef EncoderSurvey_hpp
+#define EncoderSurvey_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "BridgeConfig.hpp"
+
+/**
+ * Opus encoder settings compared by EncoderSurvey
+ */
+struct EncoderSetting {
+    enum Mode { CBR, CVBR, VBR };
+
+    int frameMs;
+    Mode mode;
+    bool dtx;
+
+    const char* getModeName() const;
+};
+
+/**
+ * What one EncoderSetting cost on the recording
+ */
+struct EncoderResult {
+    EncoderSetting setting;
+    uint64_t frames;            // frames the VOX passed to the encoder
+    uint64_t packets;           // packets that would be sent, DTX frames excluded
+    double cpuUsPerFrame;       // encode CPU time per frame
+    double cpuPercent;          // encode CPU time per second of audio, one core
+    double packetsPerSecond;
+    double payloadKbps;         // Opus payload only
+    double wireKbps;            // payload plus Mumble voice, crypt and UDP/IP headers
+};
+
+/**
+ * --measure-encoder: encodes a recording with every frame duration, rate
+ * control mode and DTX setting at the bridge's sample rate and bitrate, and
+ * reports encode CPU and the resulting packet and bit rates, to pick
+ * settings for constrained uplinks.
+ *
+ * Frames are gated by the bridge's VOX first, as on the send path, so only
+ * what mumpi would transmit is encoded. Rates are per second of the whole
+ * recording. With DTX, frames Opus encodes to 2 bytes or less carry no
+ * audio and are counted as not sent.
+ *
+ * Uses libopus directly: mumlib owns the send path's encoder and only lets
+ * mumpi set its bitrate, so VBR and DTX can be measured here but not
+ * switched on the send path, which runs libopus' defaults (VBR, no DTX).
+ */
+class EncoderSurvey {
+public:
+    EncoderSurvey(const BridgeConfig &config, const std::vector<int16_t> &audio);
+
+    EncoderResult measure(const EncoderSetting &setting) const;
+    std::vector<EncoderResult> measureAll() const;
+
+    static void print(FILE *out, const std::vector<EncoderResult> &results);
+
+private:
+    const BridgeConfig _config;
+    const std::vector<int16_t> &_audio;
+};
+
+#endif /* EncoderSurvey_hpp */
@@ -0,0 +1,36 @@
+#ifndef EventSignal_hpp
+#define EventSignal_hpp
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * One-shot wakeup signal from any number of notifying threads to one waiting
+ * thread, built on a Linux futex.
+ *
+ * notify() is safe to call from a PortAudio real-time callback: it is one
+ * atomic exchange, plus a FUTEX_WAKE system call only when the waiter is
+ * actually asleep. It never blocks or allocates. Notifications don't queue:
+ * several notify() calls before a wait wake the waiter once.
+ */
+class EventSignal {
+public:
+    EventSignal();
+
+    void notify();
+    bool waitFor(std::chrono::nanoseconds timeout);
+
+private:
+    EventSignal(const EventSignal&) = delete;
+    EventSignal& operator=(const EventSignal&) = delete;
+
+    enum State {
+        IDLE = 0,       // nothing pending, nobody waiting
+        SIGNALED = 1,   // notify() called, not consumed yet
+        WAITING = 2     // waiter is (about to be) asleep in the futex
+    };
+
+    std::atomic<int> _state;
+};
+
+#endif /* EventSignal_hpp */
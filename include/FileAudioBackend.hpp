@@ -0,0 +1,71 @@
+#ifndef FileAudioBackend_hpp
+#define FileAudioBackend_hpp
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include "AudioBackend.hpp"
+#include "AudioPipelineSet.hpp"
+#include "WavFile.hpp"
+
+/**
+ * AudioBackend that captures from a WAV/raw PCM file or named pipe and plays
+ * into another, for testing the pipeline without sound hardware.
+ *
+ * Paced, it delivers one buffer per buffer duration like a sound card.
+ * Unpaced, it runs as fast as the encoder side consumes: instead of
+ * overflowing the capture buffer it waits for room, so every input sample
+ * goes through the VOX and encoder. Playout is rendered in step with
+ * capture; when unpaced that mostly renders silence since the playout
+ * thread runs in real time.
+ *
+ * Without an input file it captures silence, without an output file the
+ * rendered audio is discarded. Files have the device rate and channels; a
+ * stereo file can feed two bridges, one per channel, like a shared sound
+ * card.
+ */
+class FileAudioBackend : public AudioBackend {
+public:
+    FileAudioBackend(const std::string &inputPath,
+                     const std::string &outputPath,
+                     bool paced,
+                     size_t framesPerBuffer,
+                     size_t pipelines = 1);
+    ~FileAudioBackend();
+
+    virtual void start(AudioPipeline &pipeline) override;
+    virtual void stop() override;
+    virtual bool isFinished() const override { return _finished.load(std::memory_order_acquire); }
+    virtual double getCpuLoad() const override;
+    virtual void setThreadTuning(const ThreadTuning &tuning) override { _tuning = tuning; }
+    virtual std::string getThreadReport() override;
+    virtual const char* getName() const override { return "file"; }
+
+    uint64_t getFramesCaptured() const { return _framesCaptured.load(std::memory_order_relaxed); }
+
+private:
+    FileAudioBackend(const FileAudioBackend&) = delete;
+    FileAudioBackend& operator=(const FileAudioBackend&) = delete;
+
+    void run();
+
+    const std::string _inputPath;
+    const std::string _outputPath;
+    const bool _paced;
+    const size_t _framesPerBuffer;
+
+    AudioPipelineSet _pipelines;
+    std::unique_ptr<WavReader> _reader;
+    std::unique_ptr<WavWriter> _writer;
+    std::thread _thread;
+    ThreadTuning _tuning;
+    int _tuningError;                   // ThreadTuning::apply() on _thread
+    std::atomic<bool> _running;
+    std::atomic<bool> _finished;
+    std::atomic<uint64_t> _framesCaptured;
+    std::atomic<uint64_t> _busyNs;      // time spent in capture() and render()
+    std::atomic<uint64_t> _elapsedNs;   // time since start()
+};
+
+#endif /* FileAudioBackend_hpp */
@@ -0,0 +1,123 @@
+#ifndef JitterBuffer_hpp
+#define JitterBuffer_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Per-session statistics reported by JitterBuffer
+ */
+struct JitterBufferStats {
+    uint64_t received;          // packets accepted into the buffer
+    uint64_t late;              // packets that arrived after their playout time
+    uint64_t lost;              // 10 ms frames that never arrived
+    uint64_t concealed;         // lost frames replaced by concealment audio
+    uint64_t reordered;         // packets that arrived before an earlier sequence number
+    uint64_t duplicates;        // packets repeating frames already buffered or playing
+    uint64_t dropped;           // packets discarded because the buffer was full
+    uint64_t underruns;         // times playout ran dry and had to rebuffer
+    size_t depthSamples;        // audio currently buffered
+    size_t targetDelaySamples;  // playout delay the buffer currently aims for
+    double jitterMs;            // smoothed arrival jitter estimate
+};
+
+/**
+ * Adaptive jitter buffer for the audio of one Mumble session.
+ *
+ * Packets are stored by sequence number and played out in sequence order.
+ * Mumble sequence numbers count 10 ms frames, so a 20 ms packet advances the
+ * sequence by 2. Playout of a talk spurt starts once targetDelay worth of
+ * audio is buffered. The target follows the measured arrival jitter
+ * (RFC 3550 estimator) and is applied at the start of each talk spurt, so the
+ * delay never changes in the middle of speech.
+ *
+ * Frames missing from the middle of a talk spurt are concealed at their
+ * position in the stream: the last pitch period played is repeated, fading
+ * out after 20 ms, and crossfaded into the audio that follows. Opus' own PLC
+ * would need the decoder, which mumlib keeps to itself. Gaps longer than
+ * MAX_CONCEAL_FRAMES are skipped instead.
+ *
+ * Not thread-safe, callers serialize push() and pull().
+ */
+class JitterBuffer {
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    JitterBuffer(int sampleRate,
+                 double minDelayMs = 40.0,
+                 double maxDelayMs = 400.0);
+
+    void push(int sequenceNumber, const int16_t *pcm, size_t len, TimePoint arrival);
+    size_t pull(int16_t *dest, size_t len, TimePoint *arrival = NULL);
+    void reset();
+    void clearStats();
+
+    bool isIdle() const { return !_playing && _numBuffered == 0; }
+    size_t getDepth() const;
+    JitterBufferStats getStats() const;
+
+private:
+    struct Slot {
+        bool used;
+        int seq;            // sequence number of the first 10 ms frame
+        int frames;         // number of 10 ms frames in the packet
+        size_t len;         // number of samples
+        TimePoint arrival;  // time the packet was received
+    };
+
+    static const size_t NUM_SLOTS = 32;
+    static const int MAX_CONCEAL_FRAMES = 20;
+
+    Slot* findSlot(int seq);
+    Slot* findEarliest();
+    Slot* findFree();
+    void release(Slot &slot);
+    void releasePlayed();
+    void updateJitter(int seq, TimePoint arrival);
+    size_t msToSamples(double ms) const;
+    void startConcealment();
+    void synthesize(int16_t *dest, size_t len);
+    void remember(const int16_t *pcm, size_t len);
+    int16_t* slotSamples(const Slot &slot) { return &_samples[(&slot - &_slots[0]) * _maxPacketSamples]; }
+
+    const int _sampleRate;
+    const size_t _frameSamples;     // samples per 10 ms sequence step
+    const size_t _maxPacketSamples;
+    const size_t _minDelaySamples;
+    const size_t _maxDelaySamples;
+
+    std::vector<Slot> _slots;
+    std::vector<int16_t> _samples;  // NUM_SLOTS * _maxPacketSamples, preallocated
+    size_t _numBuffered;
+
+    bool _playing;
+    int _nextSeq;                   // sequence number to play next
+    size_t _readOffset;             // samples already played from _nextSeq's packet
+    int _highestSeq;
+    bool _haveHighest;
+
+    bool _haveTransit;
+    double _lastTransitMs;
+    double _jitterMs;
+    size_t _lastPacketSamples;
+
+    // concealment
+    const size_t _minPitch;             // shortest pitch period searched, 2.5 ms
+    const size_t _maxPitch;             // longest, about 16 ms
+    const size_t _crossfadeSamples;
+    const double _decay;                // per sample, halves the level every 10 ms
+    std::vector<int16_t> _history;      // last 2 * _maxPitch samples played
+    std::vector<int16_t> _concealBuf;   // the concealment frame being played
+    std::vector<int16_t> _fadeBuf;      // concealment continued for the crossfade
+    bool _concealing;
+    size_t _pitch;                      // period repeated by the concealment
+    size_t _pitchPos;                   // next sample of the period to repeat
+    size_t _concealedSamples;           // synthesized since the concealment started
+    double _gain;
+
+    JitterBufferStats _stats;
+};
+
+#endif /* JitterBuffer_hpp */
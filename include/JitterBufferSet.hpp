@@ -0,0 +1,52 @@
+#ifndef JitterBufferSet_hpp
+#define JitterBufferSet_hpp
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "JitterBuffer.hpp"
+#include "Mixer.hpp"
+
+/**
+ * One JitterBuffer per Mumble session, so each speaker is reordered and
+ * delayed independently and simultaneous speakers are played together
+ * instead of one after another. Thread-safe: push() is called from the mumlib
+ * I/O thread and pull() from the playout thread.
+ *
+ * The buffers are a pool of maxSpeakers allocated up front: a session takes a
+ * free one on its first packet, or the one idle the longest, so neither new
+ * speakers nor a long-running server's growing session ids allocate. Packets
+ * of a session that finds every buffer busy are dropped and counted.
+ */
+class JitterBufferSet {
+public:
+    static const size_t DEFAULT_MAX_SPEAKERS = 8;
+
+    JitterBufferSet(int sampleRate, double minDelayMs = 40.0, double maxDelayMs = 400.0,
+                    size_t maxSpeakers = DEFAULT_MAX_SPEAKERS);
+
+    void push(int sessionId, int sequenceNumber, const int16_t *pcm, size_t len);
+    size_t pull(int16_t *dest, size_t len, JitterBuffer::TimePoint *oldestArrival = NULL);
+    std::map<int, JitterBufferStats> getStats();
+    uint64_t getRejectedPackets();
+
+private:
+    struct Speaker {
+        bool assigned;
+        int sessionId;
+        uint64_t lastPush;          // _pushes at the session's last packet
+        std::unique_ptr<JitterBuffer> buffer;
+    };
+
+    Speaker* findSpeaker(int sessionId);
+
+    std::vector<Speaker> _speakers;
+    uint64_t _pushes;
+    uint64_t _rejected;             // packets of sessions without a buffer
+    std::vector<int16_t> _speakerBuf;
+    Mixer _mixer;
+    std::mutex _mutex;
+};
+
+#endif /* JitterBufferSet_hpp */
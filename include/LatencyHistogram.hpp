@@ -0,0 +1,57 @@
+#ifndef LatencyHistogram_hpp
+#define LatencyHistogram_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Summary of the latencies recorded by a LatencyHistogram, in microseconds
+ */
+struct LatencySummary {
+    uint64_t count;
+    double meanUs;
+    double p50Us;
+    double p99Us;
+    double maxUs;
+};
+
+/**
+ * Lock-free histogram of latencies in microseconds.
+ *
+ * Buckets are log-linear: every power of 2 is split into 16 buckets, so a
+ * percentile is accurate to about 6% from 1 us up to several days. record()
+ * is a few relaxed atomic adds with no locks or allocation, so any thread,
+ * including a PortAudio callback, can record while another reads a summary.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram(const std::string &name);
+
+    void record(int64_t us);
+    void recordSeconds(double seconds) { record((int64_t) (seconds * 1e6)); }
+    LatencySummary getSummary() const;
+    const std::string& getName() const { return _name; }
+
+    static size_t bucketIndex(uint64_t us);
+    static uint64_t bucketLowerBound(size_t index);
+
+private:
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    static const unsigned SUB_BITS = 4;
+    static const unsigned MAX_BITS = 40;    // 2^40 us, about 12 days
+    static const size_t NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    double percentile(const uint64_t *counts, uint64_t total, double fraction) const;
+
+    const std::string _name;
+    std::atomic<uint64_t> _buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _max;
+};
+
+#endif /* LatencyHistogram_hpp */
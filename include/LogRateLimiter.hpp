@@ -0,0 +1,27 @@
+#ifndef LogRateLimiter_hpp
+#define LogRateLimiter_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Limits a message that would otherwise be logged per packet or per audio
+ * callback to at most maxPerSecond, counting what it suppresses so the next
+ * message that gets through can report it. Lock-free and real-time safe;
+ * concurrent callers may occasionally both get through.
+ */
+class LogRateLimiter {
+public:
+    LogRateLimiter(double maxPerSecond);
+
+    bool allow(uint64_t &suppressed);
+    bool allow(uint64_t &suppressed, std::chrono::steady_clock::time_point now);
+
+private:
+    const int64_t _intervalNs;
+    std::atomic<int64_t> _nextNs;       // earliest time the next message may pass
+    std::atomic<uint64_t> _suppressed;
+};
+
+#endif /* LogRateLimiter_hpp */
@@ -0,0 +1,99 @@
+#ifndef LogRecord_hpp
+#define LogRecord_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/**
+ * One argument of a deferred log message
+ */
+struct LogArg {
+    enum Type { INT, UINT, DOUBLE, STRING };
+    Type type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        size_t textOffset;  // offset of the string in LogRecord::text
+    };
+};
+
+/**
+ * Fixed-size, unformatted log message. Capturing one copies the format
+ * string pointer and up to MAX_ARGS numbers or short strings into the record,
+ * with no formatting and no allocation, so it is cheap enough for the audio
+ * threads. format() produces the text later on a background thread.
+ *
+ * The format string must outlive the record (use a string literal). String
+ * arguments are copied and truncated to fit the record's text storage.
+ * Conversions follow printf; integer and floating point length modifiers are
+ * ignored since the stored argument's type is known.
+ */
+struct LogRecord {
+    static const size_t MAX_ARGS = 6;
+    static const size_t TEXT_SIZE = 96;
+
+    const void *category;       // where the message goes, opaque here
+    int priority;
+    const char *format;
+    uint64_t suppressed;        // messages dropped by rate limiting before this one
+    size_t numArgs;
+    size_t textUsed;
+    LogArg args[MAX_ARGS];
+    char text[TEXT_SIZE];
+
+    template <class... Args>
+    void capture(const void *category, int priority, const char *format, Args... args);
+
+    size_t formatTo(char *dest, size_t size) const;
+
+private:
+    void add(const char *str);
+    void add(const std::string &str) { add(str.c_str()); }
+    void add(double val);
+    void add(float val) { add((double) val); }
+    void add(long double val) { add((double) val); }
+    template <class I>
+    typename std::enable_if<std::is_integral<I>::value || std::is_enum<I>::value>::type add(I val);
+
+    void addAll() {}
+    template <class First, class... Rest>
+    void addAll(First first, Rest... rest) { add(first); addAll(rest...); }
+};
+
+///////////////////////////
+// TEMPLATE IMPLEMENTATION
+///////////////////////////
+
+/**
+ * @brief Stores a message without formatting it. Arguments past MAX_ARGS are
+ * ignored. Real-time safe.
+ */
+template <class... Args>
+void LogRecord::capture(const void *category, int priority, const char *format, Args... args) {
+    this->category = category;
+    this->priority = priority;
+    this->format = format;
+    suppressed = 0;
+    numArgs = 0;
+    textUsed = 0;
+    addAll(args...);
+}
+
+template <class I>
+typename std::enable_if<std::is_integral<I>::value || std::is_enum<I>::value>::type LogRecord::add(I val) {
+    if(numArgs == MAX_ARGS)
+        return;
+    LogArg &arg = args[numArgs++];
+    if(std::is_signed<I>::value || std::is_enum<I>::value) {
+        arg.type = LogArg::INT;
+        arg.i = (long long) val;
+    } else {
+        arg.type = LogArg::UINT;
+        arg.u = (unsigned long long) val;
+    }
+}
+
+#endif /* LogRecord_hpp */
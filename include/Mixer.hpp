@@ -0,0 +1,38 @@
+#ifndef Mixer_hpp
+#define Mixer_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Mixes any number of int16 PCM sources into one frame. Sources are summed in
+ * an int32 accumulator and saturated back to int16 once at the end, so the
+ * result does not depend on the order speakers are added in.
+ *
+ * The kernels use SSE2 on x86 and NEON on ARM when the compiler targets them,
+ * with a scalar fallback otherwise.
+ */
+class Mixer {
+public:
+    Mixer(size_t maxFrameSize);
+
+    void clear(size_t len);
+    void add(const int16_t *src, size_t len);
+    void mixTo(int16_t *dest) const;
+    size_t getSourceCount() const { return _sources; }
+
+    // kernels, exposed for tests and benchmarks
+    static void accumulate(int32_t *acc, const int16_t *src, size_t len);
+    static void saturate(int16_t *dest, const int32_t *acc, size_t len);
+    static void accumulateScalar(int32_t *acc, const int16_t *src, size_t len);
+    static void saturateScalar(int16_t *dest, const int32_t *acc, size_t len);
+    static const char* getKernelName();
+
+private:
+    std::vector<int32_t> _acc;
+    size_t _len;
+    size_t _sources;
+};
+
+#endif /* Mixer_hpp */
@@ -0,0 +1,146 @@
+#ifndef MpmcQueue_hpp
+#define MpmcQueue_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bounded lock-free queue for any number of producer and consumer threads
+ * (Dmitry Vyukov's bounded MPMC queue).
+ *
+ * Every slot carries a sequence number that tells producers and consumers
+ * whether it is free or full for their lap around the buffer, so a push or
+ * pop is one compare-and-swap on a position plus one release store. All
+ * storage is allocated in the constructor. push() never blocks: it fails
+ * when the queue is full, which makes it usable from real-time threads.
+ *
+ * The size is rounded up to a power of 2.
+ */
+template <class T>
+class MpmcQueue {
+
+public:
+    MpmcQueue(size_t size);
+    ~MpmcQueue();
+
+    bool push(const T &val);
+    bool pop(T &val);
+    size_t getSize() const { return _mask + 1; }
+
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    static size_t roundUpPowerOf2(size_t size);
+
+    Cell* const _cells;
+    const size_t _mask;
+
+    char _pad0[CACHE_LINE_SIZE];
+    std::atomic<size_t> _enqueuePos;
+    char _pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _dequeuePos;
+    char _pad2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+///////////////////////////
+// TEMPLATE IMPLEMENTATION
+///////////////////////////
+
+/**
+ * @brief Default constructor
+ *
+ * @param size minimum number of elements the queue holds
+ * @tparam T Type the MpmcQueue should hold
+ */
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t size) :
+        _cells(new Cell[roundUpPowerOf2(size)]),
+        _mask(roundUpPowerOf2(size) - 1),
+        _enqueuePos(0),
+        _dequeuePos(0) {
+    for(size_t i = 0; i <= _mask; i++)
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Default destructor
+ */
+template <typename T>
+MpmcQueue<T>::~MpmcQueue() {
+    delete[] _cells;
+}
+
+/**
+ * @brief Puts an element at the end of the queue. Real-time safe.
+ *
+ * @param val the element to put
+ * @return true if stored, false if the queue was full
+ */
+template <typename T>
+bool MpmcQueue<T>::push(const T &val) {
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while(true) {
+        cell = &_cells[pos & _mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if(diff == 0) {
+            if(_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if(diff < 0) {
+            return false;   // full
+        } else {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->data = val;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Takes the element at the front of the queue
+ *
+ * @param val set to the element
+ * @return true if an element was taken, false if the queue was empty
+ */
+template <typename T>
+bool MpmcQueue<T>::pop(T &val) {
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while(true) {
+        cell = &_cells[pos & _mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+        if(diff == 0) {
+            if(_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if(diff < 0) {
+            return false;   // empty
+        } else {
+            pos = _dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    val = cell->data;
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::roundUpPowerOf2(size_t size) {
+    size_t rounded = 1;
+    while(rounded < size)
+        rounded <<= 1;
+    return rounded;
+}
+
+#endif /* MpmcQueue_hpp */
@@ -0,0 +1,50 @@
+#ifndef MumbleService_hpp
+#define MumbleService_hpp
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <log4cpp/Category.hh>
+
+class Bridge;
+
+/**
+ * Runs the Mumble connections of all bridges on one io_service and thread,
+ * instead of a thread per connection. mumlib decodes received audio in its
+ * handlers, so decoding runs here too.
+ *
+ * mumlib reports connection errors by throwing TransportException out of
+ * io_service::run(). The exception doesn't say which connection failed, so
+ * every bridge that isn't connected afterwards waits and reconnects.
+ */
+class MumbleService {
+public:
+    MumbleService();
+    ~MumbleService();
+
+    boost::asio::io_service& getIoService() { return _ioService; }
+    std::thread::native_handle_type getNativeHandle() { return _thread.native_handle(); }
+
+    void add(Bridge &bridge);
+    void start();
+    void stop();
+
+private:
+    MumbleService(const MumbleService&) = delete;
+    MumbleService& operator=(const MumbleService&) = delete;
+
+    void scheduleCheck();
+    void checkConnections();
+    void run();
+
+    boost::asio::io_service _ioService;
+    std::unique_ptr<boost::asio::io_service::work> _work;
+    boost::asio::steady_timer _timer;
+    std::vector<Bridge*> _bridges;
+    std::thread _thread;
+    bool _stopping;                 // io_service thread only
+    log4cpp::Category& _logger = log4cpp::Category::getInstance("mumpi.MumbleService");
+};
+
+#endif /* MumbleService_hpp */
@@ -0,0 +1,99 @@
+#ifndef MumbleWire_hpp
+#define MumbleWire_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Mumble control message types (the 16-bit type of the TCP framing)
+ */
+enum class MumbleMessageType : uint16_t {
+    VERSION = 0,
+    UDP_TUNNEL = 1,
+    AUTHENTICATE = 2,
+    PING = 3,
+    REJECT = 4,
+    SERVER_SYNC = 5,
+    CHANNEL_REMOVE = 6,
+    CHANNEL_STATE = 7,
+    USER_REMOVE = 8,
+    USER_STATE = 9,
+    TEXT_MESSAGE = 11,
+    CRYPT_SETUP = 15,
+    CODEC_VERSION = 21
+};
+
+/**
+ * Builds a protobuf message field by field, for the handful of Mumble
+ * messages the tools here need without generated protobuf code. Fields may
+ * be added in any order.
+ */
+class ProtoWriter {
+public:
+    void addVarint(int field, uint64_t val);
+    void addBool(int field, bool val) { addVarint(field, val ? 1 : 0); }
+    void addString(int field, const std::string &str);
+    void addBytes(int field, const uint8_t *data, size_t len);
+
+    const std::vector<uint8_t>& getData() const { return _data; }
+
+private:
+    void putVarint(uint64_t val);
+
+    std::vector<uint8_t> _data;
+};
+
+/**
+ * Iterates the fields of a protobuf message. Unknown fields are skipped by
+ * the caller simply by calling next() again.
+ *
+ *     ProtoReader reader(payload, len);
+ *     while(reader.next()) {
+ *         if(reader.getField() == 1)
+ *             session = reader.getVarint();
+ *     }
+ */
+class ProtoReader {
+public:
+    enum WireType { VARINT = 0, FIXED64 = 1, LENGTH_DELIMITED = 2, FIXED32 = 5 };
+
+    ProtoReader(const uint8_t *data, size_t len);
+
+    bool next();
+
+    int getField() const { return _field; }
+    WireType getWireType() const { return _wireType; }
+    uint64_t getVarint() const { return _varint; }
+    std::string getString() const;
+
+private:
+    uint64_t readVarint();
+
+    const uint8_t *_data;
+    size_t _len;
+    size_t _pos;
+    int _field;
+    WireType _wireType;
+    uint64_t _varint;           // value of a VARINT or FIXED field
+    const uint8_t *_bytes;      // contents of a LENGTH_DELIMITED field
+    size_t _bytesLen;
+};
+
+/**
+ * Framing and encodings shared by the Mumble TCP control channel and the
+ * voice packets it tunnels
+ */
+struct MumbleWire {
+    static const size_t HEADER_SIZE = 6;        // 16-bit type, 32-bit length, big endian
+    static const size_t MAX_VARINT_SIZE = 10;
+
+    static std::vector<uint8_t> frame(MumbleMessageType type, const std::vector<uint8_t> &payload);
+    static void parseHeader(const uint8_t *header, uint16_t &type, uint32_t &len);
+
+    static size_t writeVarint(int64_t val, uint8_t *dest);
+    static size_t readVarint(const uint8_t *src, size_t len, int64_t &val);
+};
+
+#endif /* MumbleWire_hpp */
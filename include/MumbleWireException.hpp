@@ -0,0 +1,18 @@
+#ifndef MumbleWireException_hpp
+#define MumbleWireException_hpp
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Exception to indicate a malformed Mumble control or voice message.
+ */
+class MumbleWireException : public std::runtime_error
+{
+public:
+    MumbleWireException(const std::string &message) :
+        std::runtime_error(message) {
+    }
+};
+
+#endif /* end of include guard: MumbleWireException_hpp */
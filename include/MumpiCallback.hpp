@@ -3,7 +3,9 @@
 
 #include <string>
 #include <stdio.h>
-#include "RingBuffer.hpp"
+#include "AsyncLogger.hpp"
+#include "JitterBufferSet.hpp"
+#include "Recorder.hpp"
 #include "mumlib/Transport.hpp"
 
 /**
@@ -12,7 +14,7 @@
  */
 class MumpiCallback : public mumlib::BasicCallback {
 public:
-    MumpiCallback(std::shared_ptr<RingBuffer<int16_t>> out_buf);
+    MumpiCallback(std::shared_ptr<JitterBufferSet> speakers, AsyncLogger &asyncLogger, Recorder *recorder = NULL);
     ~MumpiCallback();
 
     virtual void serverSync(std::string welcome_text,
@@ -34,7 +36,10 @@ public:
 
     mumlib::Mumlib *mum;
 private:
-    std::shared_ptr<RingBuffer<int16_t>> _out_buf;
+    std::shared_ptr<JitterBufferSet> _speakers;
+    AsyncLogger &_asyncLogger;
+    Recorder *_recorder;                    // NULL unless recording
+    LogRateLimiter _audioLogLimit;
     log4cpp::Category& _logger = log4cpp::Category::getInstance("mumpi.MumpiCallback");
 };
 
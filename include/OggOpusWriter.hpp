@@ -0,0 +1,62 @@
+#ifndef OggOpusWriter_hpp
+#define OggOpusWriter_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Packs Opus packets into an Ogg Opus stream (RFC 7845) in memory.
+ *
+ * The constructor writes the OpusHead and OpusTags header pages. Packets are
+ * collected into a page until it holds a second of audio or its lacing table
+ * is full, then the page is completed with its granule position and CRC.
+ * getPages() returns only completed pages, so whatever the caller writes out
+ * is a whole number of pages and a file cut short by a crash or full disk is
+ * still readable up to its last page.
+ *
+ * One channel (mapping family 0), which is all the bridges carry.
+ */
+class OggOpusWriter {
+public:
+    static const size_t MAX_PACKET_BYTES = 255 * 254;   // fits one page's lacing table
+    static const uint64_t MAX_PAGE_DURATION = 48000;    // 1 s, so players can seek
+
+    OggOpusWriter(uint32_t serial,
+                  int inputSampleRate,
+                  int preSkip,
+                  const std::string &vendor,
+                  const std::vector<std::string> &comments);
+
+    bool writePacket(const unsigned char *packet, size_t len, int samples);
+    void flush();
+    void finish();
+
+    std::vector<unsigned char>& getPages() { return _pages; }
+    uint64_t getGranulePosition() const { return _granule; }
+    uint32_t getPageCount() const { return _sequence; }
+    bool isFinished() const { return _finished; }
+
+    static uint32_t checksum(const unsigned char *data, size_t len);
+
+private:
+    enum {
+        BEGIN_OF_STREAM = 0x02,
+        END_OF_STREAM = 0x04
+    };
+
+    void addPacket(const unsigned char *packet, size_t len);
+    void writePage(uint8_t flags);
+
+    const uint32_t _serial;
+    uint32_t _sequence;                 // number of the next page
+    uint64_t _granule;                  // 48 kHz samples in the packets so far
+    uint64_t _pageStart;                // _granule when the open page began
+    bool _finished;
+    std::vector<unsigned char> _lacing; // the open page's segment table
+    std::vector<unsigned char> _body;   // and its packets
+    std::vector<unsigned char> _pages;  // completed pages
+};
+
+#endif /* OggOpusWriter_hpp */
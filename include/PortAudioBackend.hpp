@@ -0,0 +1,96 @@
+#ifndef PortAudioBackend_hpp
+#define PortAudioBackend_hpp
+
+#include <atomic>
+#include <string>
+#include <portaudio.h>
+#include <log4cpp/Category.hh>
+#include "AsyncLogger.hpp"
+#include "AudioBackend.hpp"
+#include "AudioPipelineSet.hpp"
+
+/**
+ * AudioBackend on the default PortAudio input and output devices.
+ *
+ * In full-duplex mode a single stream does capture and playout, so both
+ * share one device clock and cost one wakeup per buffer. Otherwise, or when
+ * the devices can't run duplex, separate input and output streams are used.
+ * Devices are picked by index or by part of their name, so several backends
+ * can each drive their own sound card. Bridges on the same card share one
+ * backend and its streams, each on its own channels (see AudioPipelineSet).
+ *
+ * PortAudio creates the callback threads and has no portable way to set
+ * their priority or affinity, so each callback thread applies the
+ * ThreadTuning to itself on its first callback.
+ */
+class PortAudioBackend : public AudioBackend {
+public:
+    PortAudioBackend(double outputDelay,
+                     bool fullDuplex,
+                     unsigned long framesPerBuffer,
+                     AsyncLogger &asyncLogger,
+                     const std::string &inputDevice = "",
+                     const std::string &outputDevice = "",
+                     size_t pipelines = 1);
+    ~PortAudioBackend();
+
+    virtual void start(AudioPipeline &pipeline) override;
+    virtual void stop() override;
+    virtual bool isFinished() const override { return false; }
+    virtual double getCpuLoad() const override;
+    virtual void setThreadTuning(const ThreadTuning &tuning) override { _tuning = tuning; }
+    virtual std::string getThreadReport() override;
+    virtual const char* getName() const override;
+
+private:
+    PortAudioBackend(const PortAudioBackend&) = delete;
+    PortAudioBackend& operator=(const PortAudioBackend&) = delete;
+
+    static int recordCallback(const void *inputBuffer,
+                              void *outputBuffer,
+                              unsigned long framesPerBuffer,
+                              const PaStreamCallbackTimeInfo* timeInfo,
+                              PaStreamCallbackFlags statusFlags,
+                              void *userData);
+    static int outputCallback(const void *inputBuffer,
+                              void *outputBuffer,
+                              unsigned long framesPerBuffer,
+                              const PaStreamCallbackTimeInfo* timeInfo,
+                              PaStreamCallbackFlags statusFlags,
+                              void *userData);
+    static int duplexCallback(const void *inputBuffer,
+                              void *outputBuffer,
+                              unsigned long framesPerBuffer,
+                              const PaStreamCallbackTimeInfo* timeInfo,
+                              PaStreamCallbackFlags statusFlags,
+                              void *userData);
+
+    void tuneCallbackThread(int stream);
+    PaDeviceIndex findDevice(const std::string &device, bool input);
+    void logStreamInfo(PaStream *stream, const char *name);
+
+    static const int NUM_STREAMS = 3;
+
+    // a stream's callback thread, written by it on its first callback
+    struct CallbackThread {
+        std::atomic<bool> tuned;
+        pthread_t thread;
+        int error;                  // ThreadTuning::apply()
+    };
+
+    const std::string _inputDevice;
+    const std::string _outputDevice;
+    double _outputDelay;
+    const bool _fullDuplex;
+    const unsigned long _framesPerBuffer;
+    AsyncLogger &_asyncLogger;
+    LogRateLimiter _outputLogLimit;
+    AudioPipelineSet _pipelines;
+    bool _initialized;
+    PaStream *_streams[NUM_STREAMS];    // duplex, input, output; unused ones NULL
+    ThreadTuning _tuning;
+    CallbackThread _callbackThreads[NUM_STREAMS];
+    log4cpp::Category& _logger = log4cpp::Category::getInstance("mumpi.PortAudioBackend");
+};
+
+#endif /* PortAudioBackend_hpp */
@@ -0,0 +1,132 @@
+#ifndef Recorder_hpp
+#define Recorder_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <log4cpp/Category.hh>
+#include "EventSignal.hpp"
+#include "MpmcQueue.hpp"
+#include "OggOpusWriter.hpp"
+
+struct OpusEncoder;
+
+/**
+ * Archives a bridge's traffic as Ogg Opus files: what it transmitted after
+ * the VOX gate, and what it received from each Mumble session.
+ *
+ * mumlib encodes the transmitted audio itself and hands the received audio
+ * over decoded, without exposing either side's Opus packets, so the audio
+ * is encoded again here with libopus (20 ms frames, DTX on, the bridge's
+ * bitrate).
+ *
+ * The audio and network threads only copy frames into a preallocated
+ * lock-free queue; if it's full the frame is dropped and counted. A writer
+ * thread does the encoding and all file I/O, so an SD card that stalls on a
+ * write holds up nothing but the writer.
+ *
+ * Each direction and session is its own file, started when it first has
+ * audio in a segment. Gaps between transmissions are filled with 1-byte DTX
+ * packets, so a file's timeline is wall-clock time from the START_TIME in its
+ * tags. Files are closed and new ones started at every multiple of the
+ * segment length. Completed Ogg pages are written in batches of at least
+ * WRITE_BATCH bytes, or every FLUSH_INTERVAL, and files are synced on close.
+ */
+class Recorder {
+public:
+    static const int TRANSMITTED = -1;          // source of the transmitted audio, sessions are >= 0
+    static const size_t DEFAULT_CAPACITY = 512; // queued 20 ms chunks, about 10 s
+
+    Recorder(const std::string &directory,
+             const std::string &name,
+             int sampleRate,
+             int bitrate,
+             int segmentSeconds,
+             size_t capacity = DEFAULT_CAPACITY);
+    ~Recorder();
+
+    void start();
+    void stop();
+
+    bool recordTransmitted(const int16_t *pcm, size_t len, double time);
+    bool recordReceived(int sessionId, const int16_t *pcm, size_t len, double time);
+
+    uint64_t getRecordedSamples() const { return _recordedSamples.load(std::memory_order_relaxed); }
+    uint64_t getDroppedSamples() const { return _droppedSamples.load(std::memory_order_relaxed); }
+    uint64_t getBytesWritten() const { return _bytesWritten.load(std::memory_order_relaxed); }
+    uint64_t getFilesWritten() const { return _filesWritten.load(std::memory_order_relaxed); }
+    uint64_t getErrors() const { return _errors.load(std::memory_order_relaxed); }
+    std::thread::native_handle_type getNativeHandle() { return _thread.native_handle(); }
+
+private:
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    static const size_t CHUNK_SAMPLES = 960;    // 20 ms at 48 kHz
+
+    // audio handed from the audio and network threads to the writer
+    struct Chunk {
+        int source;
+        uint32_t len;
+        double time;                // steady clock seconds at the end of the chunk
+        int16_t pcm[CHUNK_SAMPLES];
+    };
+
+    // one file being written
+    struct Stream {
+        int source;
+        int64_t segment;
+        std::string path;
+        int fd;
+        std::unique_ptr<OpusEncoder, void (*)(OpusEncoder*)> encoder;
+        std::unique_ptr<OggOpusWriter> ogg;
+        double startTime;           // steady clock seconds of the first frame
+        uint64_t frames;            // encoded and DTX frames since startTime
+        std::vector<int16_t> pending;
+        size_t pendingLen;
+        unsigned char dtxToc;       // TOC byte of a DTX packet for this encoder
+
+        Stream();
+    };
+
+    bool record(int source, const int16_t *pcm, size_t len, double time);
+    void run();
+    void drain();
+    void process(const Chunk &chunk);
+    Stream* openStream(int source, int64_t segment, double time);
+    void encodeFrame(Stream &stream);
+    void writeDtx(Stream &stream);
+    void writePages(Stream &stream, bool force);
+    void closeStream(Stream &stream);
+    void closeStreams(int64_t beforeSegment);
+    int64_t getSegment(double wallTime) const;
+    double toWallTime(double steadyTime) const;
+
+    const std::string _directory;
+    const std::string _name;
+    const int _sampleRate;
+    const int _bitrate;
+    const int _segmentSeconds;
+    const size_t _frameSize;                        // 20 ms at _sampleRate
+    MpmcQueue<Chunk> _queue;
+    EventSignal _pending;
+    std::atomic<bool> _running;
+    std::thread _thread;
+    std::map<int, std::unique_ptr<Stream>> _streams;    // writer thread only
+    std::vector<unsigned char> _packet;             // writer thread only
+    double _lastFlush;                              // writer thread only
+
+    std::atomic<uint64_t> _recordedSamples;
+    std::atomic<uint64_t> _droppedSamples;
+    std::atomic<uint64_t> _bytesWritten;
+    std::atomic<uint64_t> _filesWritten;
+    std::atomic<uint64_t> _errors;
+    log4cpp::Category& _logger = log4cpp::Category::getInstance("mumpi.Recorder");
+};
+
+#endif /* Recorder_hpp */
@@ -0,0 +1,18 @@
+#ifndef RecorderException_hpp
+#define RecorderException_hpp
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Exception to indicate that recordings can't be written.
+ */
+class RecorderException : public std::runtime_error
+{
+public:
+    RecorderException(const std::string &message) :
+        std::runtime_error(message) {
+    }
+};
+
+#endif /* end of include guard: RecorderException_hpp */
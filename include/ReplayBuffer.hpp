@@ -0,0 +1,89 @@
+#ifndef ReplayBuffer_hpp
+#define ReplayBuffer_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A rolling history of a bridge's audio in both directions, kept in a
+ * fixed-size memory-mapped file so it survives a restart.
+ *
+ * The file is a header and a ring of 10 ms blocks, each holding its track,
+ * the wall clock time of its first sample and its samples. The writer only
+ * ever appends the next block, overwriting the oldest: no locks, no system
+ * calls and no allocation, so it's called from service(). Readers on other
+ * threads copy blocks out under a per-block sequence number and skip any
+ * that were overwritten meanwhile. One writer thread at a time, any number
+ * of readers.
+ *
+ * Only audio is stored, silence isn't, so the history covers at least the
+ * configured length and more when the channel is quiet. The mapping is
+ * populated and, if the limits allow, locked when opened, so the audio path
+ * doesn't page fault; the kernel writes it back to the file in its own time.
+ */
+class ReplayBuffer {
+public:
+    enum Track {
+        TRANSMITTED = 0,    // sent to Mumble after the VOX gate
+        RECEIVED = 1        // mixed from Mumble for playout
+    };
+
+    ReplayBuffer(const std::string &path, int sampleRate, double seconds);
+    ~ReplayBuffer();
+
+    // writer side
+    void append(Track track, const int16_t *pcm, size_t len, double time);
+
+    // reader side
+    std::vector<int16_t> extract(Track track, double from, double to, double maxGap) const;
+    uint64_t exportWav(const std::string &path, double from, double to) const;
+
+    int getSampleRate() const { return _sampleRate; }
+    size_t getBlockCount() const { return _blockCount; }
+    uint64_t getBlocksWritten() const;
+    double getOldestTime() const;
+    bool isRestored() const { return _restored; }
+    bool isLocked() const { return _locked; }
+
+    static double wallSeconds();
+
+private:
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t sampleRate;
+        uint32_t blockSamples;
+        uint32_t blockCount;
+        std::atomic<uint64_t> writeIndex;   // blocks ever written
+    };
+
+    struct BlockHeader {
+        std::atomic<uint64_t> sequence;     // index + 1, 0 while being written
+        double time;                        // wall clock seconds of the first sample
+        uint32_t track;
+        uint32_t len;
+    };
+
+    BlockHeader* blockAt(uint64_t index) const;
+    bool readBlock(uint64_t index, BlockHeader &header, int16_t *pcm) const;
+
+    const int _sampleRate;
+    const size_t _blockSamples;
+    const size_t _blockBytes;
+    size_t _blockCount;
+    size_t _mapSize;
+    int _fd;
+    unsigned char *_map;
+    FileHeader *_header;
+    uint64_t _writeIndex;                   // writer's copy of _header->writeIndex
+    bool _restored;
+    bool _locked;
+};
+
+#endif /* ReplayBuffer_hpp */
@@ -0,0 +1,85 @@
+#ifndef Resampler_hpp
+#define Resampler_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * Streaming sample rate converter for interleaved int16 PCM, between a sound
+ * card's native rate and the Opus rate.
+ *
+ * A rational polyphase FIR: the rates' ratio is reduced to L / M, and each
+ * output sample is one dot product of the latest input samples with one of
+ * the L phases of a Kaiser windowed sinc lowpass designed at L times the
+ * input rate. The lowpass' stopband starts at the lower rate's Nyquist
+ * frequency, so nothing aliases; the quality trades taps per phase (CPU)
+ * against passband width and stopband attenuation:
+ *
+ *     quality  taps  attenuation  passband up to, 44.1 <-> 48 kHz  16 <-> 48 kHz
+ *     low        16        60 dB                        12.1 kHz        4.4 kHz
+ *     medium     32        80 dB                        15.1 kHz        5.5 kHz
+ *     high       64        96 dB                        17.8 kHz        6.5 kHz
+ *
+ * Taps are counted at the input rate when upsampling and scale with the
+ * ratio when downsampling. All buffers are allocated by the constructor, so
+ * process() is real-time safe. The dot products use AVX2/FMA (selected at
+ * runtime), SSE or NEON when available, with a scalar fallback.
+ */
+class Resampler {
+public:
+    enum Quality { LOW, MEDIUM, HIGH };
+
+    static const size_t MAX_PHASES = 1024;  // L, limits the coefficient table
+
+    Resampler(int inRate, int outRate, int channels, Quality quality, size_t maxInputFrames);
+
+    size_t process(const int16_t *input, size_t frames, int16_t *output,
+                   size_t maxOutput = std::numeric_limits<size_t>::max());
+    void reset();
+
+    size_t getInputNeeded(size_t outFrames) const;
+    size_t getMaxOutput(size_t inFrames) const;
+    size_t getMaxInput() const { return _maxInput; }
+    double getDelay() const;
+
+    int getInRate() const { return _inRate; }
+    int getOutRate() const { return _outRate; }
+    size_t getPhases() const { return _phases; }
+    size_t getTaps() const { return _taps; }
+
+    static size_t getPhases(int inRate, int outRate);
+    static bool parseQuality(const std::string &name, Quality &quality);
+    static const char* getQualityName(Quality quality);
+
+    // exposed for tests and benchmarks
+    static const char* getKernelName();
+
+private:
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    const int _inRate;
+    const int _outRate;
+    const int _channels;
+    const size_t _phases;               // L, upsampling factor
+    const size_t _step;                 // M, downsampling factor
+    const size_t _stepWhole;            // M / L
+    const size_t _stepRemainder;        // M % L
+    const size_t _maxInput;             // frames per process() call
+    size_t _taps;                       // per phase, a multiple of 8
+
+    std::vector<float> _coeffs;         // _phases x _taps, each phase reversed
+    std::vector<float> _history;        // per channel, _historySize input samples
+    size_t _historySize;
+    size_t _historyLen;                 // valid samples per channel
+    size_t _next;                       // history index of the next output's newest input
+    size_t _phase;                      // the next output's phase, 0 .. _phases - 1
+    std::vector<uint32_t> _offsets;     // per output of one call: first history index
+    std::vector<uint32_t> _phaseIndex;  // and phase
+    std::vector<float> _out;            // one channel of one call's output
+};
+
+#endif /* Resampler_hpp */
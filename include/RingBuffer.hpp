@@ -3,9 +3,13 @@
 
 #include <mutex>
 #include <EmptyBufferException.hpp>
+#include <RingBufferCopy.hpp>
 
 /**
  * Simple unbounded circular buffer implementation. Thread-safe.
+ *
+ * Bulk operations copy in at most two contiguous segments. When the size is a
+ * power of 2 indexes wrap with a mask instead of a modulo.
  */
 template <class T>
 class RingBuffer {
@@ -19,15 +23,21 @@ public:
     size_t top(T* dest, int offset, size_t len);
     size_t topRemaining(T* outbuf);
     void push(T val);
-    void push(T* src, int offset, size_t len);
+    void push(const T* src, int offset, size_t len);
     bool isEmpty();
     size_t getSize() const { return _size; };
     size_t getRemaining() const;
     unsigned int getFront() const { return _front; }
     unsigned int getBack() const { return _back; }
+    bool isPowerOf2Size() const { return _mask != 0; }
 private:
+    unsigned int wrap(size_t index) const {
+        return _mask != 0 ? (index & _mask) : (index % _size);
+    }
+
     T* _array;
     size_t _size;
+    size_t _mask;
     unsigned int _front;
     unsigned int _back;
     size_t _remaining;
@@ -47,6 +57,7 @@ private:
 template <typename T>
 RingBuffer<T>::RingBuffer(size_t size)  {
     _size = size;
+    _mask = ringbuffer::isPowerOf2(size) ? size - 1 : 0;
     _array = new T[size];
     _front = 0;
     _back = 0;
@@ -72,7 +83,7 @@ T& RingBuffer<T>::top() {
     std::unique_lock<std::recursive_mutex> lock(_mutex);
     if(!this->isEmpty()) {
         T &val = _array[_front];
-        _front = (_front + 1) % _size;
+        _front = wrap(_front + 1);
         _remaining--;
         return val;
     } else {
@@ -93,11 +104,9 @@ size_t RingBuffer<T>::top(T* dest, int offset, size_t len) {
     std::unique_lock<std::recursive_mutex> lock(_mutex);
     if(!this->isEmpty()) {
         const size_t ELEMENTS_TO_GET = std::min(getRemaining(), len);
-        for(unsigned i = 0; i < ELEMENTS_TO_GET; i++) {
-            dest[offset+i] = _array[_front];
-            _front = (_front + 1) % _size;
-            _remaining--;
-        }
+        ringbuffer::copyFromRing(dest + offset, _array, _size, _front, ELEMENTS_TO_GET);
+        _front = wrap(_front + ELEMENTS_TO_GET);
+        _remaining -= ELEMENTS_TO_GET;
         return ELEMENTS_TO_GET;
     } else {
         return 0;
@@ -113,13 +122,7 @@ size_t RingBuffer<T>::top(T* dest, int offset, size_t len) {
 template <typename T>
 size_t RingBuffer<T>::topRemaining(T* outbuf) {
     std::unique_lock<std::recursive_mutex> lock(_mutex);
-    const int remainingSaved = _remaining;
-    for(unsigned i = 0; i < remainingSaved; i++) {
-        outbuf[i] = _array[_front];
-        _front = (_front + 1) % _size;
-        _remaining--;
-    }
-    return remainingSaved;
+    return top(outbuf, 0, _remaining);
 }
 
 /**
@@ -130,10 +133,7 @@ size_t RingBuffer<T>::topRemaining(T* outbuf) {
  */
 template <typename T>
 void RingBuffer<T>::push(T val) {
-    std::unique_lock<std::recursive_mutex> lock(_mutex);
-    _array[_back] = val;
-    _back = (_back + 1) % _size;   // increase index and loop buffer if needed
-    _remaining = std::min(_size, ++_remaining);
+    push(&val, 0, 1);
 }
 
 /**
@@ -145,25 +145,23 @@ void RingBuffer<T>::push(T val) {
  * @param len number of elements to push
  */
 template <typename T>
-void RingBuffer<T>::push(T* src, int offset, size_t len) {
+void RingBuffer<T>::push(const T* src, int offset, size_t len) {
     std::unique_lock<std::recursive_mutex> lock(_mutex);
-    for(unsigned i = 0; i < len; i++) {
-        _array[_back] = src[offset+i];
-        if(_remaining == _size) {   // just overwritten, need move front
-            _front = (_front + 1) % _size;
-            // printf("moving _front to %d\n", _front);
-        }
-        // printf("put %d at idx %d\n", _array[_back], i);
-        _back = (_back + 1) % _size;
-        _remaining = std::min(_size, ++_remaining);
-
+    if(len > _size) {
+        // only the newest _size elements survive, skip the ones they would overwrite
+        const size_t skip = len - _size;
+        _back = wrap(_back + skip);
+        offset += skip;
+        len = _size;
+    }
+    ringbuffer::copyToRing(_array, _size, _back, src + offset, len);
+    _back = wrap(_back + len);
+    if(_remaining + len >= _size) {   // overwritten, front follows back
+        _front = _back;
+        _remaining = _size;
+    } else {
+        _remaining += len;
     }
-
-    // printf("Current state:\n");
-    // printf("Front: %d Back: %d\n", _front, _back);
-    // for(unsigned i = 0; i < _size; i++) {
-    //     printf("buf[%d] = %d\n", i, _array[i]);
-    // }
 }
 
 template <class T>
@@ -0,0 +1,74 @@
+#ifndef RingBufferCopy_hpp
+#define RingBufferCopy_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Copy helpers shared by RingBuffer and SpscRingBuffer. A bulk transfer into or
+ * out of a ring touches at most two contiguous segments: from the start index
+ * to the end of the array, then from the beginning of the array.
+ */
+namespace ringbuffer {
+
+/**
+ * @brief Returns true if val is a non-zero power of 2
+ */
+inline bool isPowerOf2(size_t val) {
+    return val != 0 && (val & (val - 1)) == 0;
+}
+
+/**
+ * @brief Copies len contiguous elements, using memcpy for trivially copyable types
+ */
+template <class T>
+inline void copyElements(T* dest, const T* src, size_t len,
+                         typename std::enable_if<std::is_trivially_copyable<T>::value>::type* = 0) {
+    std::memcpy(dest, src, len * sizeof(T));
+}
+
+template <class T>
+inline void copyElements(T* dest, const T* src, size_t len,
+                         typename std::enable_if<!std::is_trivially_copyable<T>::value>::type* = 0) {
+    std::copy(src, src + len, dest);
+}
+
+/**
+ * @brief Copies len elements from src into ring, starting at ring[index] and
+ * wrapping to ring[0] if needed.
+ *
+ * @param ring ring array
+ * @param ringSize number of elements in ring
+ * @param index start index in ring, must be < ringSize
+ * @param src source buffer
+ * @param len number of elements to copy, must be <= ringSize
+ */
+template <class T>
+inline void copyToRing(T* ring, size_t ringSize, size_t index, const T* src, size_t len) {
+    const size_t FIRST = std::min(len, ringSize - index);
+    copyElements(ring + index, src, FIRST);
+    copyElements(ring, src + FIRST, len - FIRST);
+}
+
+/**
+ * @brief Copies len elements out of ring, starting at ring[index] and wrapping
+ * to ring[0] if needed.
+ *
+ * @param dest destination buffer
+ * @param ring ring array
+ * @param ringSize number of elements in ring
+ * @param index start index in ring, must be < ringSize
+ * @param len number of elements to copy, must be <= ringSize
+ */
+template <class T>
+inline void copyFromRing(T* dest, const T* ring, size_t ringSize, size_t index, size_t len) {
+    const size_t FIRST = std::min(len, ringSize - index);
+    copyElements(dest, ring + index, FIRST);
+    copyElements(dest + FIRST, ring, len - FIRST);
+}
+
+} // namespace ringbuffer
+
+#endif /* RingBufferCopy_hpp */
@@ -0,0 +1,46 @@
+#ifndef SampleTimeline_hpp
+#define SampleTimeline_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include "SpscRingBuffer.hpp"
+
+/**
+ * Passes timestamps for positions in a sample stream from the thread that
+ * produces the samples to the thread that consumes them, alongside the
+ * samples' own ring buffer.
+ *
+ * The producer marks a sample index with a time, e.g. the ADC time of the
+ * first sample of each capture buffer. The consumer either interpolates the
+ * time of any later sample from the newest mark at or before it (timeAt), or
+ * takes the marks in order as it reaches them (popBefore). Lock-free, one
+ * producer and one consumer thread. Marks are dropped if the consumer falls
+ * too far behind.
+ */
+class SampleTimeline {
+public:
+    /**
+     * A sample index and its time in seconds
+     */
+    struct Mark {
+        uint64_t sampleIndex;
+        double time;
+    };
+
+    SampleTimeline(int sampleRate, size_t capacity = 256);
+
+    // producer side
+    bool mark(uint64_t sampleIndex, double time);
+
+    // consumer side
+    bool timeAt(uint64_t sampleIndex, double &time);
+    bool popBefore(uint64_t endIndex, Mark &mark);
+
+private:
+    const double _sampleRate;
+    SpscRingBuffer<Mark> _marks;
+    Mark _current;          // newest mark at or before the last timeAt() index
+    bool _haveCurrent;
+};
+
+#endif /* SampleTimeline_hpp */
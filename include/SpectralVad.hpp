@@ -0,0 +1,75 @@
+#ifndef SpectralVad_hpp
+#define SpectralVad_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "VoxDetector.hpp"
+
+/**
+ * Voice activity detector working on band energies of each Opus frame, for
+ * channels where an RMS threshold alone keys up on static.
+ *
+ * Each frame is Hann windowed, zero padded to a power of 2 and transformed
+ * with a real FFT. Its power spectrum gives three features:
+ *
+ * - the frame level, which must reach the VOX threshold as with VoxDetector
+ * - the mean SNR of NUM_BANDS speech bands (250 - 4000 Hz) against a noise
+ *   floor tracked per band, so steady static never counts as voice
+ * - the spectral flatness over 300 - 3400 Hz. Static bursts are flat like
+ *   white noise while voiced speech has resolved pitch harmonics, so bursts
+ *   loud enough to beat the noise floor are still rejected.
+ *
+ * Unvoiced onsets fail the flatness test by design; VadGate's pre-roll sends
+ * the frames before the first voiced one.
+ *
+ * The windowing, FFT butterflies and power spectrum use SSE when available.
+ */
+class SpectralVad {
+public:
+    static const size_t NUM_BANDS = 8;
+
+    SpectralVad(int sampleRate, size_t frameSize, double thresholdDb, double snrDb = 6.0);
+
+    bool isVoice(const int16_t *pcm);
+
+    double getLastDb() const { return _level.getLastDb(); }
+    double getLastSnrDb() const { return _lastSnrDb; }
+    double getLastFlatness() const { return _lastFlatness; }
+    double getThresholdDb() const { return _level.getThresholdDb(); }
+    size_t getFrameSize() const { return _frameSize; }
+
+    // exposed for tests
+    size_t getFftSize() const { return _fftSize; }
+    const std::vector<float>& getPowerSpectrum() const { return _power; }
+    static const char* getKernelName();
+
+private:
+    void powerSpectrum(const int16_t *pcm);
+    void fft();
+
+    const size_t _frameSize;
+    const size_t _fftSize;              // real FFT size, a power of 2 >= _frameSize
+    const double _snrDb;
+    VoxDetector _level;
+
+    std::vector<float> _window;         // Hann window, _frameSize
+    std::vector<float> _windowed;       // windowed frame zero padded to _fftSize
+    std::vector<float> _re;             // complex FFT of _fftSize / 2 points,
+    std::vector<float> _im;             // split into real and imaginary parts
+    std::vector<float> _twiddleRe;      // per stage, stage with half size h at h - 1
+    std::vector<float> _twiddleIm;
+    std::vector<float> _postRe;         // real FFT post-processing twiddles
+    std::vector<float> _postIm;
+    std::vector<uint32_t> _bitReverse;
+    std::vector<float> _power;          // |X[k]|^2 for k = 0 .. _fftSize / 2
+
+    size_t _bandStart[NUM_BANDS + 1];   // bin ranges of the bands
+    size_t _flatStart;                  // bin range of the flatness measure
+    size_t _flatEnd;
+    double _noise[NUM_BANDS];           // noise floor per band
+    double _lastSnrDb;
+    double _lastFlatness;
+};
+
+#endif /* SpectralVad_hpp */
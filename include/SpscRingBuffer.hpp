@@ -0,0 +1,547 @@
+#ifndef SpscRingBuffer_hpp
+#define SpscRingBuffer_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <EmptyBufferException.hpp>
+#include <RingBufferCopy.hpp>
+
+namespace ringbuffer {
+
+/**
+ * What SpscRingBuffer::push() does with elements that don't fit
+ */
+enum OverflowPolicy {
+    DROP_NEWEST,    // store what fits, drop the rest of the push
+    DROP_OLDEST,    // discard the oldest unread elements to make room
+    REJECT          // store nothing unless the whole push fits
+};
+
+/**
+ * Overflow and underrun counters of a SpscRingBuffer
+ */
+struct Stats {
+    uint64_t overwritten;   // unread elements discarded to make room, DROP_OLDEST
+    uint64_t dropped;       // pushed elements not stored, DROP_NEWEST and REJECT
+    uint64_t rejected;      // pushes refused whole, REJECT
+    uint64_t underruns;     // topPadded() calls that ran short
+    uint64_t padded;        // elements topPadded() wrote as padding
+};
+
+/**
+ * @brief Parses "drop-newest", "drop-oldest" or "reject"
+ *
+ * @return false if str is none of them
+ */
+inline bool parseOverflowPolicy(const std::string &str, OverflowPolicy &policy) {
+    if(str == "drop-newest")
+        policy = DROP_NEWEST;
+    else if(str == "drop-oldest")
+        policy = DROP_OLDEST;
+    else if(str == "reject")
+        policy = REJECT;
+    else
+        return false;
+    return true;
+}
+
+inline const char* getOverflowPolicyName(OverflowPolicy policy) {
+    switch(policy) {
+    case DROP_OLDEST:
+        return "drop-oldest";
+    case REJECT:
+        return "reject";
+    default:
+        return "drop-newest";
+    }
+}
+
+}
+
+/**
+ * Lock-free, wait-free circular buffer for exactly one producer thread and
+ * exactly one consumer thread.
+ *
+ * The read and write positions are free-running counters that live on separate
+ * cache lines. The producer publishes elements with a release store of the
+ * write position and the consumer frees slots with a release store of the read
+ * position, so neither side ever blocks the other. This makes it safe to use
+ * from PortAudio's real-time callbacks.
+ *
+ * What push() does when the buffer is full is its OverflowPolicy. By default
+ * it stores as many elements as fit and drops the rest (DROP_NEWEST), or it
+ * refuses the whole push (REJECT). With DROP_OLDEST the producer discards
+ * unread elements instead, moving the read position with a compare-and-swap.
+ * The consumer's reads then also commit with a compare-and-swap, and top()
+ * retries if the producer overwrote what it was copying. A region from
+ * peekRead() may be overwritten while the consumer works on it;
+ * consumeRead() reports that. Both sides count what they drop, overwrite or
+ * pad, see getStats().
+ *
+ * Bulk operations copy in at most two contiguous segments. When the size is a
+ * power of 2 positions wrap with a mask instead of a modulo.
+ *
+ * reserveWrite()/commitWrite() and peekRead()/consumeRead() hand out regions of
+ * the buffer's own storage so producers and consumers can work in place
+ * instead of copying through an intermediate buffer.
+ */
+template <class T>
+class SpscRingBuffer {
+
+public:
+    SpscRingBuffer(size_t size, ringbuffer::OverflowPolicy policy = ringbuffer::DROP_NEWEST);
+    ~SpscRingBuffer();
+
+    /**
+     * Contiguous region of the buffer's storage
+     */
+    struct Region {
+        T* data;
+        size_t len;
+    };
+
+    // consumer side
+    T top();
+    size_t top(T* dest, int offset, size_t len);
+    size_t topRemaining(T* outbuf);
+    size_t topPadded(T* dest, int offset, size_t len, const T &pad);
+    Region peekRead(size_t len);
+    T* peekReadLinear(size_t len, T* scratch);
+    bool consumeRead(size_t len);
+    size_t getReadPosition() const { return _head.load(std::memory_order_acquire); }
+
+    // producer side
+    bool push(T val);
+    size_t push(const T* src, int offset, size_t len);
+    size_t pushFill(const T &val, size_t len);
+    Region reserveWrite(size_t len);
+    void commitWrite(size_t len);
+
+    // either side
+    bool isEmpty() const;
+    size_t getSize() const { return _size; };
+    size_t getRemaining() const;
+    size_t getFree() const { return _size - getRemaining(); }
+    bool isPowerOf2Size() const { return _mask != 0; }
+    ringbuffer::OverflowPolicy getOverflowPolicy() const { return _policy; }
+    ringbuffer::Stats getStats() const;
+
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t wrap(size_t pos) const {
+        return _mask != 0 ? (pos & _mask) : (pos % _size);
+    }
+
+    // positions are free-running and may wrap, so compare their difference
+    static bool isBefore(size_t a, size_t b) {
+        return (ptrdiff_t) (a - b) < 0;
+    }
+
+    // counters have one writer each, so they need no atomic read-modify-write
+    static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    size_t readable(size_t head, size_t len);
+    bool release(size_t head, size_t len);
+    size_t makeRoom(size_t tail, size_t len);
+
+    T* const _array;
+    const size_t _size;
+    const size_t _mask;
+    const ringbuffer::OverflowPolicy _policy;
+
+    // consumer-owned cache line
+    char _pad0[CACHE_LINE_SIZE];
+    std::atomic<size_t> _head;      // next position to read, also moved by a DROP_OLDEST producer
+    size_t _cachedTail;             // consumer's last view of _tail
+    size_t _peekHead;               // _head at the last peekRead()
+    std::atomic<uint64_t> _underruns;
+    std::atomic<uint64_t> _padded;
+    char _pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - 2 * sizeof(size_t) - 2 * sizeof(std::atomic<uint64_t>)];
+
+    // producer-owned cache line
+    std::atomic<size_t> _tail;      // next position to write
+    size_t _cachedHead;             // producer's last view of _head
+    std::atomic<uint64_t> _overwritten;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _rejected;
+    char _pad2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t) - 3 * sizeof(std::atomic<uint64_t>)];
+};
+
+///////////////////////////
+// TEMPLATE IMPLEMENTATION
+///////////////////////////
+
+/**
+ * @brief Default constructor
+ *
+ * @param size size of ring buffer
+ * @param policy what push() does when the buffer is full
+ * @tparam T Type the SpscRingBuffer should hold
+ */
+template <typename T>
+SpscRingBuffer<T>::SpscRingBuffer(size_t size, ringbuffer::OverflowPolicy policy) :
+        _array(new T[size]),
+        _size(size),
+        _mask(ringbuffer::isPowerOf2(size) ? size - 1 : 0),
+        _policy(policy),
+        _head(0),
+        _cachedTail(0),
+        _peekHead(0),
+        _underruns(0),
+        _padded(0),
+        _tail(0),
+        _cachedHead(0),
+        _overwritten(0),
+        _dropped(0),
+        _rejected(0) {
+}
+
+/**
+ * @brief Default destructor
+ */
+template <typename T>
+SpscRingBuffer<T>::~SpscRingBuffer() {
+    delete[] _array;
+}
+
+/**
+ * @brief Gets the next element from the front of the buffer. Consumer only.
+ *
+ * @return the next element
+ * @throws EmptyBufferException if buffer is empty
+ */
+template <typename T>
+T SpscRingBuffer<T>::top() {
+    if(_policy == ringbuffer::DROP_OLDEST) {
+        T val;
+        if(top(&val, 0, 1) == 0)
+            throw EmptyBufferException();
+        return val;
+    }
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if(head == _cachedTail) {
+        _cachedTail = _tail.load(std::memory_order_acquire);
+        if(head == _cachedTail)
+            throw EmptyBufferException();
+    }
+    T val = _array[wrap(head)];
+    _head.store(head + 1, std::memory_order_release);
+    return val;
+}
+
+/**
+ * @brief Elements readable from head, up to len. Consumer only.
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::readable(size_t head, size_t len) {
+    // also reloads if a DROP_OLDEST producer moved head past the cached tail
+    if(isBefore(_cachedTail, head + len))
+        _cachedTail = _tail.load(std::memory_order_acquire);
+    // more than _size if the producer is overwriting what's being read,
+    // which release() then detects
+    return std::min(std::min(_cachedTail - head, _size), len);
+}
+
+/**
+ * @brief Moves the read position from head past len elements. Consumer only.
+ *
+ * @return false, without moving it, if a DROP_OLDEST producer moved it first,
+ *         overwriting some of the elements
+ */
+template <typename T>
+bool SpscRingBuffer<T>::release(size_t head, size_t len) {
+    if(_policy != ringbuffer::DROP_OLDEST) {
+        _head.store(head + len, std::memory_order_release);
+        return true;
+    }
+    return _head.compare_exchange_strong(head, head + len, std::memory_order_release, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the next len elements from the front of the buffer. Consumer only.
+ *
+ * @param dest destination buffer to store the elements in
+ * @param offset offset in dest buffer to start storing
+ * @param len number of elements to get
+ * @return number of elements retrieved
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::top(T* dest, int offset, size_t len) {
+    while(true) {
+        const size_t head = _head.load(std::memory_order_acquire);
+        const size_t ELEMENTS_TO_GET = readable(head, len);
+        ringbuffer::copyFromRing(dest + offset, _array, _size, wrap(head), ELEMENTS_TO_GET);
+        // copy again from the new read position if the producer overwrote it
+        if(release(head, ELEMENTS_TO_GET))
+            return ELEMENTS_TO_GET;
+    }
+}
+
+/**
+ * @brief Gets the remaining elements from the front of the buffer. Consumer only.
+ *
+ * @param outbuf destination buffer to store elements in, must hold getSize() elements
+ * @return number of elements retrieved
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::topRemaining(T* outbuf) {
+    return top(outbuf, 0, _size);
+}
+
+/**
+ * @brief Gets exactly len elements, filling whatever the buffer can't supply
+ * with pad. This is what an audio output callback needs on underrun.
+ * Consumer only.
+ *
+ * @param dest destination buffer to store the elements in
+ * @param offset offset in dest buffer to start storing
+ * @param len number of elements to write to dest
+ * @param pad value written after the retrieved elements
+ * @return number of elements retrieved from the buffer
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::topPadded(T* dest, int offset, size_t len, const T &pad) {
+    const size_t retrieved = top(dest, offset, len);
+    if(retrieved < len) {
+        std::fill(dest + offset + retrieved, dest + offset + len, pad);
+        add(_underruns, 1);
+        add(_padded, len - retrieved);
+    }
+    return retrieved;
+}
+
+/**
+ * @brief Puts a new element at the end of the buffer. Producer only.
+ *
+ * @param val the element to put
+ * @return true if stored, false if the buffer was full
+ */
+template <typename T>
+bool SpscRingBuffer<T>::push(T val) {
+    return push(&val, 0, 1) == 1;
+}
+
+/**
+ * @brief Applies the overflow policy to a push of len elements at tail.
+ * Producer only.
+ *
+ * @return number of elements to store, at most _size
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::makeRoom(size_t tail, size_t len) {
+    if(_size - (tail - _cachedHead) < len)
+        _cachedHead = _head.load(std::memory_order_acquire);
+    const size_t free = _size - (tail - _cachedHead);
+    if(free >= len)
+        return len;
+
+    switch(_policy) {
+    case ringbuffer::REJECT:
+        add(_dropped, len);
+        add(_rejected, 1);
+        return 0;
+    case ringbuffer::DROP_OLDEST: {
+        // the consumer may be moving the read position too; whoever is
+        // further ahead wins
+        len = std::min(len, _size);
+        const size_t needed = tail + len - _size;
+        size_t head = _cachedHead;
+        while(isBefore(head, needed)) {
+            if(_head.compare_exchange_weak(head, needed, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                add(_overwritten, needed - head);
+                head = needed;
+            }
+        }
+        _cachedHead = head;
+        return len;
+    }
+    default:
+        add(_dropped, len - free);
+        return free;
+    }
+}
+
+/**
+ * @brief Bulk puts new elements at the end of the buffer. Producer only.
+ * Elements that do not fit are handled by the overflow policy; with
+ * DROP_OLDEST and more than getSize() elements only the last getSize() are
+ * stored.
+ *
+ * @param src src buffer to push from
+ * @param offset offset in src buffer to start copying from
+ * @param len number of elements to push
+ * @return number of elements stored
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::push(const T* src, int offset, size_t len) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t ELEMENTS_TO_PUT = makeRoom(tail, len);
+    if(_policy == ringbuffer::DROP_OLDEST && len > _size) {
+        // the start of the push is older than anything stored
+        add(_overwritten, len - _size);
+        offset += len - _size;
+    }
+    ringbuffer::copyToRing(_array, _size, wrap(tail), src + offset, ELEMENTS_TO_PUT);
+    _tail.store(tail + ELEMENTS_TO_PUT, std::memory_order_release);
+    return ELEMENTS_TO_PUT;
+}
+
+/**
+ * @brief Puts len copies of val at the end of the buffer, e.g. silence,
+ * following the overflow policy like push(). Producer only.
+ *
+ * @return number of elements stored
+ */
+template <typename T>
+size_t SpscRingBuffer<T>::pushFill(const T &val, size_t len) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t ELEMENTS_TO_PUT = makeRoom(tail, len);
+    if(_policy == ringbuffer::DROP_OLDEST && len > _size)
+        add(_overwritten, len - _size);
+    const size_t index = wrap(tail);
+    const size_t first = std::min(ELEMENTS_TO_PUT, _size - index);
+    std::fill(_array + index, _array + index + first, val);
+    std::fill(_array, _array + (ELEMENTS_TO_PUT - first), val);
+    _tail.store(tail + ELEMENTS_TO_PUT, std::memory_order_release);
+    return ELEMENTS_TO_PUT;
+}
+
+/**
+ * @brief Returns the contiguous readable region at the front of the buffer,
+ * up to len elements. The region is shorter than len if fewer elements are
+ * available or the data wraps around the end of the storage. The elements
+ * stay valid until consumeRead(). Consumer only.
+ *
+ * @param len maximum number of elements wanted
+ * @return region of the buffer's storage, len 0 if empty
+ */
+template <typename T>
+typename SpscRingBuffer<T>::Region SpscRingBuffer<T>::peekRead(size_t len) {
+    const size_t head = _head.load(std::memory_order_acquire);
+    _peekHead = head;
+    const size_t index = wrap(head);
+    Region region;
+    region.data = _array + index;
+    region.len = std::min(readable(head, len), _size - index);
+    return region;
+}
+
+/**
+ * @brief Returns exactly len readable elements as one contiguous array,
+ * pointing into the buffer's storage when possible. Only when the elements
+ * wrap around the end of the storage are they copied into scratch. Follow
+ * with consumeRead(len). Consumer only.
+ *
+ * @param len number of elements wanted
+ * @param scratch buffer of at least len elements used when the data wraps
+ * @return pointer to len elements, or NULL if fewer than len are available
+ */
+template <typename T>
+T* SpscRingBuffer<T>::peekReadLinear(size_t len, T* scratch) {
+    const Region region = peekRead(len);
+    if(region.len == len)
+        return region.data;
+    if(readable(_peekHead, len) < len)
+        return NULL;
+    ringbuffer::copyFromRing(scratch, _array, _size, region.data - _array, len);
+    return scratch;
+}
+
+/**
+ * @brief Releases len elements previously returned by peekRead() or
+ * peekReadLinear(). Consumer only.
+ *
+ * @param len number of elements to release
+ * @return false if a DROP_OLDEST producer overwrote some of them while they
+ *         were in use
+ */
+template <typename T>
+bool SpscRingBuffer<T>::consumeRead(size_t len) {
+    if(release(_peekHead, len))
+        return true;
+    // the producer dropped some of them meanwhile; release the rest, unless
+    // it is already past them
+    size_t head = _head.load(std::memory_order_relaxed);
+    while(isBefore(head, _peekHead + len) &&
+          !_head.compare_exchange_weak(head, _peekHead + len, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the contiguous writable region at the back of the buffer, up
+ * to len elements. The region is shorter than len if the buffer is nearly full
+ * or the free space wraps around the end of the storage. Nothing is visible to
+ * the consumer until commitWrite(). The overflow policy doesn't apply: unread
+ * elements are never overwritten and nothing is counted. Producer only.
+ *
+ * @param len maximum number of elements wanted
+ * @return region of the buffer's storage, len 0 if full
+ */
+template <typename T>
+typename SpscRingBuffer<T>::Region SpscRingBuffer<T>::reserveWrite(size_t len) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if(_size - (tail - _cachedHead) < len)
+        _cachedHead = _head.load(std::memory_order_acquire);
+
+    const size_t index = wrap(tail);
+    Region region;
+    region.data = _array + index;
+    region.len = std::min(std::min(_size - (tail - _cachedHead), len), _size - index);
+    return region;
+}
+
+/**
+ * @brief Publishes len elements written into the region returned by
+ * reserveWrite(). Producer only.
+ *
+ * @param len number of elements written, at most the reserved length
+ */
+template <typename T>
+void SpscRingBuffer<T>::commitWrite(size_t len) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    _tail.store(tail + len, std::memory_order_release);
+}
+
+/**
+ * @brief Snapshot of the overflow and underrun counters, from any thread
+ */
+template <class T>
+ringbuffer::Stats SpscRingBuffer<T>::getStats() const {
+    ringbuffer::Stats stats;
+    stats.overwritten = _overwritten.load(std::memory_order_relaxed);
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.rejected = _rejected.load(std::memory_order_relaxed);
+    stats.underruns = _underruns.load(std::memory_order_relaxed);
+    stats.padded = _padded.load(std::memory_order_relaxed);
+    return stats;
+}
+
+template <class T>
+bool SpscRingBuffer<T>::isEmpty() const {
+    return getRemaining() == 0;
+}
+
+/**
+ * @brief Number of elements ready to be read. Exact when called from the
+ * producer or consumer thread, a snapshot otherwise.
+ */
+template <class T>
+size_t SpscRingBuffer<T>::getRemaining() const {
+    // load head first: tail can only move forward afterwards, so tail >= head
+    const size_t head = _head.load(std::memory_order_acquire);
+    const size_t tail = _tail.load(std::memory_order_acquire);
+    // a DROP_OLDEST producer may have moved both in between
+    return std::min(tail - head, _size);
+}
+
+#endif /* SpscRingBuffer_hpp */
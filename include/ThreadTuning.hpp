@@ -0,0 +1,53 @@
+#ifndef ThreadTuning_hpp
+#define ThreadTuning_hpp
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+/**
+ * Scheduling policy, real-time priority and CPU affinity for one of mumpi's
+ * threads.
+ *
+ * apply() asks the kernel for them. Without CAP_SYS_NICE or a high enough
+ * RLIMIT_RTPRIO the real-time policies are refused, and CPUs that don't
+ * exist can't be pinned to; neither is fatal. apply() returns why, and
+ * report() reads back what the thread actually runs with, for the startup
+ * report.
+ *
+ * OTHER leaves the thread's policy and priority as they are, and an empty
+ * CPU list leaves its affinity, so the default tuning changes nothing.
+ */
+class ThreadTuning {
+public:
+    enum Policy {
+        OTHER,      // the normal time-sharing scheduler
+        FIFO,       // SCHED_FIFO: runs until it blocks
+        RR          // SCHED_RR: time-sliced between threads of equal priority
+    };
+
+    ThreadTuning(Policy policy = OTHER, int priority = 0, const std::vector<int> &cpus = std::vector<int>());
+
+    int apply(pthread_t thread) const;
+    int applyToCurrentThread() const { return apply(pthread_self()); }
+    std::string report(pthread_t thread, int error) const;
+
+    Policy getPolicy() const { return _policy; }
+    int getPriority() const { return _priority; }
+    const std::vector<int>& getCpus() const { return _cpus; }
+    bool isDefault() const { return _policy == OTHER && _cpus.empty(); }
+
+    static std::string describe(pthread_t thread);
+    static bool parsePolicy(const std::string &name, Policy &policy);
+    static bool parseCpus(const std::string &list, std::vector<int> &cpus);
+    static std::string formatCpus(const std::vector<int> &cpus);
+    static int getMaxPriority(Policy policy);
+    static int lockMemory();
+
+private:
+    Policy _policy;
+    int _priority;              // 1 (lowest) to getMaxPriority(), FIFO and RR only
+    std::vector<int> _cpus;     // CPUs the thread may run on, empty for any
+};
+
+#endif /* ThreadTuning_hpp */
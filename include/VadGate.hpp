@@ -0,0 +1,48 @@
+#ifndef VadGate_hpp
+#define VadGate_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SpectralVad.hpp"
+
+/**
+ * Transmit gate driven by SpectralVad, the --vad alternative to VoxGate.
+ *
+ * After the last voice frame the gate keeps transmitting for a hangover
+ * counted in frames. Frames it doesn't transmit are kept in a ring of
+ * preRollFrames frames; when voice starts they are sent ahead of it, so the
+ * unvoiced start of a word that the detector can't tell from static isn't
+ * cut off.
+ */
+class VadGate {
+public:
+    VadGate(int sampleRate, size_t frameSize, double thresholdDb,
+            size_t hangoverFrames, size_t preRollFrames);
+
+    bool process(const int16_t *frame);
+    size_t getPreRollCount() const { return _preRollCount; }
+    int16_t* getPreRoll(size_t i);
+
+    const SpectralVad& getDetector() const { return _detector; }
+    uint64_t getFrames() const { return _frames; }
+    uint64_t getVoiceFrames() const { return _voiceFrames; }
+    uint64_t getTransmittedFrames() const { return _transmittedFrames; }
+
+private:
+    SpectralVad _detector;
+    const size_t _frameSize;
+    const size_t _hangoverFrames;
+    const size_t _preRollFrames;
+    std::vector<int16_t> _preRoll;  // _preRollFrames frames, preallocated
+    size_t _preRollNext;            // slot the next held frame goes to
+    size_t _preRollHeld;            // frames held since the last transmission
+    size_t _preRollCount;           // frames to send ahead of the current one
+    uint64_t _sinceVoice;           // frames since the last voice frame
+    bool _heardVoice;
+    uint64_t _frames;
+    uint64_t _voiceFrames;
+    uint64_t _transmittedFrames;
+};
+
+#endif /* VadGate_hpp */
@@ -0,0 +1,44 @@
+#ifndef VoxDetector_hpp
+#define VoxDetector_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Energy-based voice detector (VOX) and level meter for int16 PCM frames.
+ *
+ * The dB threshold is converted once into a sum-of-squares threshold, so the
+ * per-frame decision is one integer sum of squares and one comparison, with
+ * no floating point or log per frame. A frame is voice when its RMS level,
+ * relative to full scale, is at or above the threshold.
+ *
+ * The sum of squares uses AVX2 (selected at runtime), SSE2 or NEON when
+ * available, with a scalar fallback.
+ */
+class VoxDetector {
+public:
+    VoxDetector(double thresholdDb);
+
+    bool isVoice(const int16_t *pcm, size_t len);
+    uint64_t getLastSumOfSquares() const { return _lastSumOfSquares; }
+    size_t getLastLength() const { return _lastLength; }
+    double getLastDb() const;
+    double getThresholdDb() const { return _thresholdDb; }
+
+    static double toDb(uint64_t sumOfSquares, size_t len);
+
+    // kernels, exposed for tests and benchmarks
+    static uint64_t sumOfSquares(const int16_t *pcm, size_t len);
+    static uint64_t sumOfSquaresScalar(const int16_t *pcm, size_t len);
+    static const char* getKernelName();
+
+private:
+    const double _thresholdDb;
+    const double _thresholdPerSample;   // squared linear threshold for one sample
+    size_t _thresholdLength;            // frame length _threshold was computed for
+    uint64_t _threshold;                // sum-of-squares threshold for _thresholdLength
+    uint64_t _lastSumOfSquares;
+    size_t _lastLength;
+};
+
+#endif /* VoxDetector_hpp */
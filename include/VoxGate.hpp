@@ -0,0 +1,38 @@
+#ifndef VoxGate_hpp
+#define VoxGate_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include "VoxDetector.hpp"
+
+/**
+ * Decides which captured frames to transmit: frames the VoxDetector finds
+ * voice in, plus a hold time after the last one so word endings and short
+ * pauses aren't cut off.
+ *
+ * The hold is counted in samples rather than wall-clock time, so the gate
+ * behaves the same whether audio arrives in real time or is replayed from
+ * a file as fast as possible.
+ */
+class VoxGate {
+public:
+    VoxGate(int sampleRate, double thresholdDb, double holdSeconds);
+
+    bool process(const int16_t *frame, size_t len);
+
+    const VoxDetector& getDetector() const { return _detector; }
+    uint64_t getFrames() const { return _frames; }
+    uint64_t getVoiceFrames() const { return _voiceFrames; }
+    uint64_t getTransmittedFrames() const { return _transmittedFrames; }
+
+private:
+    VoxDetector _detector;
+    const uint64_t _holdSamples;
+    uint64_t _sinceVoice;       // samples since the end of the last voice frame
+    bool _heardVoice;
+    uint64_t _frames;
+    uint64_t _voiceFrames;
+    uint64_t _transmittedFrames;
+};
+
+#endif /* VoxGate_hpp */
@@ -0,0 +1,72 @@
+#ifndef WavFile_hpp
+#define WavFile_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * Reads 16-bit PCM samples from a WAV file, a raw PCM file or a named pipe.
+ *
+ * A stream starting with a RIFF/WAVE header is parsed as WAV, anything else
+ * is read as raw native-endian int16 samples. Only the first bytes are
+ * inspected, so pipes and stdin ("-") work too.
+ */
+class WavReader {
+public:
+    WavReader(const std::string &path);
+    ~WavReader();
+
+    size_t read(int16_t *dest, size_t len);
+
+    bool isWav() const { return _isWav; }
+    int getSampleRate() const { return _sampleRate; }   // 0 for raw input
+    int getChannels() const { return _channels; }       // 0 for raw input
+
+private:
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+
+    void parseHeader();
+
+    FILE *_file;
+    bool _ownsFile;
+    bool _isWav;
+    int _sampleRate;
+    int _channels;
+    uint64_t _dataRemaining;    // bytes left in the WAV data chunk
+    unsigned char _prefix[12];  // bytes read while detecting a raw stream
+    size_t _prefixLen;
+    size_t _prefixPos;
+};
+
+/**
+ * Writes 16-bit PCM samples as a WAV file, or as raw PCM if the path doesn't
+ * end in ".wav". The WAV header's sizes are filled in on close() when the
+ * file is seekable; for pipes and stdin ("-") they are left at their maximum.
+ */
+class WavWriter {
+public:
+    WavWriter(const std::string &path, int sampleRate, int channels);
+    ~WavWriter();
+
+    size_t write(const int16_t *src, size_t len);
+    void close();
+    uint64_t getSamplesWritten() const { return _samplesWritten; }
+
+private:
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    void writeHeader(uint32_t dataBytes);
+
+    FILE *_file;
+    bool _ownsFile;
+    bool _isWav;
+    const int _sampleRate;
+    const int _channels;
+    uint64_t _samplesWritten;
+};
+
+#endif /* WavFile_hpp */
@@ -0,0 +1,57 @@
+#ifndef WorkerPool_hpp
+#define WorkerPool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of threads running short tasks, shared by all bridges so the
+ * encode, VOX and playout work of many bridges doesn't need threads per
+ * bridge.
+ *
+ * Tasks are a function pointer and an argument, queued in a preallocated
+ * ring, so submitting doesn't allocate. Tasks run in submission order but
+ * concurrently on different workers; callers that need a task not to
+ * overlap with itself must not submit it again before it ran.
+ */
+class WorkerPool {
+public:
+    typedef void (*TaskFunction)(void *arg);
+
+    WorkerPool(size_t numThreads = 0, size_t capacity = 256);
+    ~WorkerPool();
+
+    bool submit(TaskFunction function, void *arg);
+    void stop();
+
+    size_t getSize() const { return _threads.size(); }
+    uint64_t getCompleted() const { return _completed.load(std::memory_order_relaxed); }
+    std::thread::native_handle_type getNativeHandle(size_t i) { return _threads[i].native_handle(); }
+
+private:
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    struct Task {
+        TaskFunction function;
+        void *arg;
+    };
+
+    void run();
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::vector<Task> _tasks;       // ring of queued tasks
+    size_t _head;                   // next task to run
+    size_t _count;                  // queued tasks
+    bool _stopping;
+    std::atomic<uint64_t> _completed;
+    std::vector<std::thread> _threads;
+};
+
+#endif /* WorkerPool_hpp */
@@ -0,0 +1,268 @@
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "MockMumbleServer.hpp"
+#include "WavFile.hpp"
+
+static const int SAMPLE_RATE = 48000;
+static const double SHUTDOWN_TIMEOUT = 10.0;	// s until stuck clients are killed
+
+static volatile sig_atomic_t sig_caught = 0;
+
+static void sigHandler(int signal) {
+	sig_caught = signal;
+}
+
+static void help() {
+	printf("mumpiLoadTest - runs mumpi clients against a local mock Mumble server\n\n");
+	printf("Usage:\n");
+	printf("mumpiLoadTest [options]\n\n");
+	printf("Starts a mock server and N mumpi processes that capture from generated\n");
+	printf("radio traffic files, then reports per-client CPU, voice throughput\n");
+	printf("through the server and packet-to-playout latency.\n\n");
+	printf("Options:\n");
+	printf("--clients <n>      number of mumpi clients. Default: 4\n");
+	printf("--duration <s>     seconds to run. Default: 30\n");
+	printf("--mumpi <path>     mumpi executable. Default: ./mumpi\n");
+	printf("--port <port>      server port, 0 for any free port. Default: 0\n");
+	printf("--loss <fraction>  voice packets the server drops, per recipient,\n");
+	printf("                   to exercise loss concealment. Default: 0\n");
+	printf("--server-only      only run the mock server until CTRL+C, printing\n");
+	printf("                   its counters every 5 s\n");
+	exit(1);
+}
+
+/**
+ * What the harness measured for one mumpi process
+ */
+struct ClientResult {
+	std::string name;
+	pid_t pid;
+	std::string logPath;
+	double cpuSeconds;
+	bool haveLatency;
+	unsigned long long latencyCount;
+	double latencyP50Ms;
+	double latencyP99Ms;
+};
+
+/**
+ * Writes seconds of radio-like traffic: 2 s transmissions of a noisy tone
+ * every 5 s, starting offset seconds into the cycle so clients take turns
+ */
+static void writeTraffic(const std::string &path, double seconds, double offset) {
+	WavWriter writer(path, SAMPLE_RATE, 1);
+	std::vector<int16_t> block(SAMPLE_RATE / 100);
+	uint32_t seed = 1;
+	const uint64_t total = seconds * SAMPLE_RATE;
+	const uint64_t start = offset * SAMPLE_RATE;
+	for(uint64_t n = 0; n < total; ) {
+		for(size_t i = 0; i < block.size(); i++, n++) {
+			const uint64_t t = n + start;
+			const bool keyed = (t / SAMPLE_RATE) % 5 < 2;
+			seed = seed * 1664525 + 1013904223;
+			const double noise = (int32_t) seed / 2147483648.0 * 30.0;
+			const double tone = keyed ? 8000.0 * std::sin(2.0 * M_PI * 440.0 * t / SAMPLE_RATE) : 0.0;
+			block[i] = (int16_t) (tone + noise);
+		}
+		writer.write(block.data(), block.size());
+	}
+}
+
+/**
+ * @brief Starts a mumpi process with its output going to logPath
+ */
+static pid_t spawnClient(const std::string &mumpi, const std::string &server, const std::string &name,
+                         const std::string &inputPath, const std::string &logPath) {
+	const pid_t pid = fork();
+	if(pid != 0)
+		return pid;
+
+	const int fd = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd >= 0) {
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+	}
+	// -40 dB VOX so only the tone bursts are sent, not the noise between them
+	execl(mumpi.c_str(), mumpi.c_str(), "-s", server.c_str(), "-u", name.c_str(), "-x", "-40",
+	      "--input-file", inputPath.c_str(), (char*) NULL);
+	perror(mumpi.c_str());
+	_exit(127);
+}
+
+/**
+ * @brief Waits for a client to exit and returns its CPU time, killing it if
+ * it doesn't exit within timeout
+ */
+static double reapClient(pid_t pid, double timeout) {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+	struct rusage usage;
+	int status;
+	while(wait4(pid, &status, WNOHANG, &usage) == 0) {
+		if(std::chrono::steady_clock::now() > deadline) {
+			fprintf(stderr, "client %d didn't exit, killing it\n", (int) pid);
+			kill(pid, SIGKILL);
+			wait4(pid, &status, 0, &usage);
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+	       usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+/**
+ * @brief Finds the receive->playout histogram mumpi logs on SIGUSR1
+ */
+static void parseLatency(ClientResult &result) {
+	result.haveLatency = false;
+	FILE *log = fopen(result.logPath.c_str(), "r");
+	if(log == NULL)
+		return;
+	char line[512];
+	while(fgets(line, sizeof(line), log) != NULL) {
+		const char *stage = std::strstr(line, "receive->playout");
+		if(stage == NULL)
+			continue;
+		double mean, max;
+		if(sscanf(stage + std::strlen("receive->playout"), " count %llu mean %lf ms p50 %lf ms p99 %lf ms max %lf ms",
+		          &result.latencyCount, &mean, &result.latencyP50Ms, &result.latencyP99Ms, &max) == 5)
+			result.haveLatency = true;
+	}
+	fclose(log);
+}
+
+static void printServerStats(const std::vector<MockClientStats> &stats, double seconds) {
+	printf("%-10s %8s %10s %10s %12s %12s %10s\n", "client", "session", "tx pkt/s", "rx pkt/s",
+	       "tx kbit/s", "rx kbit/s", "rx lost");
+	for(const MockClientStats &client : stats) {
+		printf("%-10s %8u %10.1f %10.1f %12.1f %12.1f %10llu\n", client.name.c_str(), client.session,
+		       client.audioPacketsIn / seconds, client.audioPacketsOut / seconds,
+		       client.audioBytesIn * 8 / seconds / 1000.0, client.audioBytesOut * 8 / seconds / 1000.0,
+		       (unsigned long long) client.audioPacketsDropped);
+	}
+}
+
+/**
+ * Runs a mock Mumble server and N mumpi clients with file-backed audio for a
+ * fixed time, then reports how much CPU each client used, the voice traffic
+ * through the server and each client's packet-to-playout latency.
+ */
+int main(int argc, char **argv) {
+	int num_clients = 4;
+	double duration = 30.0;
+	std::string mumpi = "./mumpi";
+	unsigned short port = 0;
+	bool server_only = false;
+	double loss = 0.0;
+	for(int i = 1; i < argc; i++) {
+		if(std::strcmp(argv[i], "--clients") == 0 && i + 1 < argc)
+			num_clients = std::atoi(argv[++i]);
+		else if(std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+			duration = std::atof(argv[++i]);
+		else if(std::strcmp(argv[i], "--mumpi") == 0 && i + 1 < argc)
+			mumpi = argv[++i];
+		else if(std::strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			port = std::atoi(argv[++i]);
+		else if(std::strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+			loss = std::atof(argv[++i]);
+		else if(std::strcmp(argv[i], "--server-only") == 0)
+			server_only = true;
+		else
+			help();
+	}
+	if(num_clients < 1 || duration <= 0.0 || loss < 0.0 || loss >= 1.0)
+		help();
+
+	struct sigaction action;
+	action.sa_handler = sigHandler;
+	action.sa_flags = 0;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	MockMumbleServer server(port);
+	server.setVoiceLoss(loss);
+	server.start();
+	const std::string address = "127.0.0.1:" + std::to_string(server.getPort());
+	printf("mock server listening on %s\n", address.c_str());
+
+	if(server_only) {
+		const auto start = std::chrono::steady_clock::now();
+		while(!sig_caught) {
+			std::this_thread::sleep_for(std::chrono::seconds(5));
+			const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			printServerStats(server.getStats(), elapsed);
+		}
+		server.stop();
+		return 0;
+	}
+
+	// inputs run longer than the test so clients are stopped mid-stream
+	// rather than finishing on their own
+	char dir_template[] = "/tmp/mumpiLoadTest-XXXXXX";
+	const std::string dir = mkdtemp(dir_template);
+	std::vector<ClientResult> clients(num_clients);
+	for(int i = 0; i < num_clients; i++) {
+		ClientResult &client = clients[i];
+		client.name = "load" + std::to_string(i);
+		client.logPath = dir + "/" + client.name + ".log";
+		const std::string input = dir + "/" + client.name + ".wav";
+		writeTraffic(input, duration + 10.0, 5.0 * i / num_clients);
+		client.pid = spawnClient(mumpi, address, client.name, input, client.logPath);
+	}
+
+	struct rusage self_start;
+	getrusage(RUSAGE_SELF, &self_start);
+	const auto start = std::chrono::steady_clock::now();
+	const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	                     std::chrono::duration<double>(duration));
+	while(!sig_caught && std::chrono::steady_clock::now() < end)
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const std::vector<MockClientStats> server_stats = server.getStats();
+	struct rusage self_end;
+	getrusage(RUSAGE_SELF, &self_end);
+
+	// latency histograms are logged on SIGUSR1, then the clients shut down
+	for(const ClientResult &client : clients)
+		kill(client.pid, SIGUSR1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	for(const ClientResult &client : clients)
+		kill(client.pid, SIGINT);
+	for(ClientResult &client : clients) {
+		client.cpuSeconds = reapClient(client.pid, SHUTDOWN_TIMEOUT);
+		parseLatency(client);
+	}
+	server.stop();
+
+	printf("\n%d clients, %.1f s\n\n", num_clients, elapsed);
+	printServerStats(server_stats, elapsed);
+	printf("\n%-10s %8s %12s %14s %14s\n", "client", "cpu %", "latency n", "playout p50", "playout p99");
+	for(const ClientResult &client : clients) {
+		printf("%-10s %8.2f", client.name.c_str(), 100.0 * client.cpuSeconds / elapsed);
+		if(client.haveLatency)
+			printf(" %12llu %11.2f ms %11.2f ms\n", client.latencyCount, client.latencyP50Ms, client.latencyP99Ms);
+		else
+			printf(" %12s %14s %14s   (see %s)\n", "-", "-", "-", client.logPath.c_str());
+	}
+	const double server_cpu = self_end.ru_utime.tv_sec - self_start.ru_utime.tv_sec +
+	                          (self_end.ru_utime.tv_usec - self_start.ru_utime.tv_usec) / 1e6 +
+	                          self_end.ru_stime.tv_sec - self_start.ru_stime.tv_sec +
+	                          (self_end.ru_stime.tv_usec - self_start.ru_stime.tv_usec) / 1e6;
+	printf("\nmock server cpu %.2f %%\n", 100.0 * server_cpu / elapsed);
+	printf("client logs and inputs in %s\n", dir.c_str());
+	return 0;
+}
@@ -0,0 +1,431 @@
+#include "MockMumbleServer.hpp"
+
+#include <deque>
+#include <stdexcept>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include "MumbleWire.hpp"
+#include "MumbleWireException.hpp"
+
+using boost::asio::ip::tcp;
+typedef std::shared_ptr<std::vector<uint8_t>> MessagePtr;
+
+// protocol version 1.2.4, what mumlib announces itself
+static const uint32_t SERVER_VERSION = 1 << 16 | 2 << 8 | 4;
+static const uint32_t MAX_MESSAGE_SIZE = 8 * 1024 * 1024;
+static const uint32_t MAX_BANDWIDTH = 558000;   // bits/s, Murmur's default
+static const int UDP_TYPE_PING = 1;
+
+static MessagePtr makeMessage(MumbleMessageType type, const ProtoWriter &writer) {
+    return std::make_shared<std::vector<uint8_t>>(MumbleWire::frame(type, writer.getData()));
+}
+
+/**
+ * @brief Generates a throwaway RSA key and self-signed certificate for the
+ * TLS control channel. mumlib doesn't verify the server certificate.
+ *
+ * @throws std::runtime_error if OpenSSL fails
+ */
+static void useSelfSignedCertificate(boost::asio::ssl::context &context) {
+    EVP_PKEY *key = NULL;
+    EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    const bool generated = keyContext != NULL &&
+                           EVP_PKEY_keygen_init(keyContext) > 0 &&
+                           EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048) > 0 &&
+                           EVP_PKEY_keygen(keyContext, &key) > 0;
+    EVP_PKEY_CTX_free(keyContext);
+    if(!generated)
+        throw std::runtime_error("Failed to generate server key");
+
+    X509 *cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*) "mumpi mock server", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    const bool ok = X509_sign(cert, key, EVP_sha256()) > 0 &&
+                    SSL_CTX_use_certificate(context.native_handle(), cert) > 0 &&
+                    SSL_CTX_use_PrivateKey(context.native_handle(), key) > 0;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    if(!ok)
+        throw std::runtime_error("Failed to set up server certificate");
+}
+
+/**
+ * One client connection: reads framed control messages and queues writes so
+ * at most one async_write is outstanding
+ */
+class MockMumbleServer::Session : public std::enable_shared_from_this<MockMumbleServer::Session> {
+public:
+    Session(MockMumbleServer &server, uint32_t id) :
+            _server(server),
+            _socket(server._ioService, server._sslContext),
+            _id(id),
+            _authenticated(false),
+            _closed(false) {
+    }
+
+    boost::asio::ssl::stream<tcp::socket>::lowest_layer_type& getSocket() { return _socket.lowest_layer(); }
+    uint32_t getId() const { return _id; }
+    const std::string& getName() const { return _name; }
+    bool isAuthenticated() const { return _authenticated; }
+
+    void start() {
+        auto self = shared_from_this();
+        _socket.async_handshake(boost::asio::ssl::stream_base::server,
+                                [this, self](const boost::system::error_code &error) {
+            if(error)
+                close();
+            else
+                readHeader();
+        });
+    }
+
+    void send(const MessagePtr &message) {
+        if(_closed)
+            return;
+        _writeQueue.push_back(message);
+        if(_writeQueue.size() == 1)
+            writeNext();
+    }
+
+    void close() {
+        if(_closed)
+            return;
+        _closed = true;
+        boost::system::error_code ignored;
+        _socket.lowest_layer().close(ignored);
+        _server.removed(*this);
+    }
+
+private:
+    void readHeader() {
+        auto self = shared_from_this();
+        boost::asio::async_read(_socket, boost::asio::buffer(_header),
+                                [this, self](const boost::system::error_code &error, size_t) {
+            if(error)
+                return close();
+            uint16_t type;
+            uint32_t len;
+            MumbleWire::parseHeader(_header, type, len);
+            if(len > MAX_MESSAGE_SIZE)
+                return close();
+            _payload.resize(len);
+            readPayload(type);
+        });
+    }
+
+    void readPayload(uint16_t type) {
+        auto self = shared_from_this();
+        boost::asio::async_read(_socket, boost::asio::buffer(_payload),
+                                [this, self, type](const boost::system::error_code &error, size_t) {
+            if(error)
+                return close();
+            try {
+                handleMessage((MumbleMessageType) type);
+            } catch(MumbleWireException &exp) {
+                return close();
+            }
+            readHeader();
+        });
+    }
+
+    void writeNext() {
+        auto self = shared_from_this();
+        boost::asio::async_write(_socket, boost::asio::buffer(*_writeQueue.front()),
+                                 [this, self](const boost::system::error_code &error, size_t) {
+            if(error)
+                return close();
+            _writeQueue.pop_front();
+            if(!_writeQueue.empty())
+                writeNext();
+        });
+    }
+
+    void handleMessage(MumbleMessageType type) {
+        switch(type) {
+        case MumbleMessageType::AUTHENTICATE: {
+            ProtoReader reader(_payload.data(), _payload.size());
+            while(reader.next()) {
+                if(reader.getField() == 1)
+                    _name = reader.getString();
+            }
+            _authenticated = true;
+            _server.authenticated(*this);
+            break;
+        }
+        case MumbleMessageType::PING: {
+            // echo the client's timestamp, which is all mumlib looks at
+            ProtoReader reader(_payload.data(), _payload.size());
+            ProtoWriter reply;
+            while(reader.next()) {
+                if(reader.getField() == 1)
+                    reply.addVarint(1, reader.getVarint());
+            }
+            send(makeMessage(MumbleMessageType::PING, reply));
+            std::lock_guard<std::mutex> lock(_server._statsMutex);
+            _server.statsFor(_id).pingsIn++;
+            break;
+        }
+        case MumbleMessageType::UDP_TUNNEL:
+            if(_authenticated && !_payload.empty())
+                relayVoice();
+            break;
+        case MumbleMessageType::TEXT_MESSAGE:
+            if(_authenticated)
+                relayText();
+            break;
+        default:
+            // Version, permission queries etc. need no answer here
+            break;
+        }
+    }
+
+    /**
+     * Client voice packets are header, sequence, payload. Relayed ones gain
+     * the sender's session after the header.
+     */
+    void relayVoice() {
+        const int udpType = _payload[0] >> 5;
+        if(udpType == UDP_TYPE_PING) {
+            send(std::make_shared<std::vector<uint8_t>>(MumbleWire::frame(MumbleMessageType::UDP_TUNNEL, _payload)));
+            return;
+        }
+        std::vector<uint8_t> relayed;
+        relayed.reserve(_payload.size() + MumbleWire::MAX_VARINT_SIZE);
+        relayed.push_back(_payload[0]);
+        uint8_t session[MumbleWire::MAX_VARINT_SIZE];
+        relayed.insert(relayed.end(), session, session + MumbleWire::writeVarint(_id, session));
+        relayed.insert(relayed.end(), _payload.begin() + 1, _payload.end());
+        {
+            std::lock_guard<std::mutex> lock(_server._statsMutex);
+            MockClientStats &stats = _server.statsFor(_id);
+            stats.audioPacketsIn++;
+            stats.audioBytesIn += _payload.size();
+        }
+        _server.broadcast(*this, std::make_shared<std::vector<uint8_t>>(
+                                 MumbleWire::frame(MumbleMessageType::UDP_TUNNEL, relayed)), true);
+    }
+
+    void relayText() {
+        std::string text;
+        ProtoReader reader(_payload.data(), _payload.size());
+        while(reader.next()) {
+            if(reader.getField() == 5)
+                text = reader.getString();
+        }
+        ProtoWriter relayed;
+        relayed.addVarint(1, _id);      // actor
+        relayed.addVarint(3, 0);        // channel_id: everything goes to root
+        relayed.addString(5, text);
+        {
+            std::lock_guard<std::mutex> lock(_server._statsMutex);
+            _server.statsFor(_id).textMessagesIn++;
+        }
+        _server.broadcast(*this, makeMessage(MumbleMessageType::TEXT_MESSAGE, relayed));
+    }
+
+    MockMumbleServer &_server;
+    boost::asio::ssl::stream<tcp::socket> _socket;
+    const uint32_t _id;
+    std::string _name;
+    bool _authenticated;
+    bool _closed;
+    uint8_t _header[MumbleWire::HEADER_SIZE];
+    std::vector<uint8_t> _payload;
+    std::deque<MessagePtr> _writeQueue;
+};
+
+/**
+ * @brief Constructor. Binds the listening socket on all interfaces.
+ *
+ * @param port TCP port, 0 for any free port (see getPort())
+ * @throws std::runtime_error if the certificate can't be created,
+ *         boost::system::system_error if the port can't be bound
+ */
+MockMumbleServer::MockMumbleServer(unsigned short port) :
+        _sslContext(boost::asio::ssl::context::tlsv12_server),
+        _acceptor(_ioService, tcp::endpoint(tcp::v4(), port)),
+        _nextSession(1),
+        _voiceLoss(0.0) {
+    useSelfSignedCertificate(_sslContext);
+}
+
+MockMumbleServer::~MockMumbleServer() {
+    stop();
+}
+
+/**
+ * @brief Starts accepting clients on a background thread
+ */
+void MockMumbleServer::start() {
+    accept();
+    _thread = std::thread([this]() { _ioService.run(); });
+}
+
+/**
+ * @brief Disconnects all clients and stops the background thread
+ */
+void MockMumbleServer::stop() {
+    if(!_thread.joinable())
+        return;
+    // once the acceptor and all sockets are closed their handlers complete
+    // with errors and start nothing new, so run() returns
+    _ioService.post([this]() {
+        boost::system::error_code ignored;
+        _acceptor.close(ignored);
+        auto sessions = _sessions;
+        for(auto &entry : sessions)
+            entry.second->close();
+    });
+    _thread.join();
+}
+
+/**
+ * @brief Sets the fraction of relayed voice packets to drop, independently
+ * per recipient. Call before start().
+ */
+void MockMumbleServer::setVoiceLoss(double fraction) {
+    _voiceLoss = fraction;
+}
+
+unsigned short MockMumbleServer::getPort() const {
+    return _acceptor.local_endpoint().port();
+}
+
+/**
+ * @brief Per-client counters, including clients that have disconnected
+ */
+std::vector<MockClientStats> MockMumbleServer::getStats() const {
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    std::vector<MockClientStats> stats;
+    for(const auto &entry : _stats)
+        stats.push_back(entry.second);
+    return stats;
+}
+
+void MockMumbleServer::accept() {
+    auto session = std::make_shared<Session>(*this, _nextSession++);
+    _acceptor.async_accept(session->getSocket(), [this, session](const boost::system::error_code &error) {
+        if(error == boost::asio::error::operation_aborted)
+            return;
+        if(!error) {
+            session->getSocket().set_option(tcp::no_delay(true));
+            _sessions[session->getId()] = session;
+            session->start();
+        }
+        accept();
+    });
+}
+
+/**
+ * @brief Sends the server state to a newly authenticated client and
+ * announces it to the others
+ */
+void MockMumbleServer::authenticated(Session &session) {
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        MockClientStats &stats = statsFor(session.getId());
+        stats.name = session.getName();
+        stats.connected = true;
+    }
+
+    ProtoWriter version;
+    version.addVarint(1, SERVER_VERSION);
+    version.addString(2, "mumpi mock server");
+    version.addString(3, "Linux");
+    session.send(makeMessage(MumbleMessageType::VERSION, version));
+
+    ProtoWriter root;
+    root.addVarint(1, 0);   // channel_id
+    root.addString(3, "Root");
+    session.send(makeMessage(MumbleMessageType::CHANNEL_STATE, root));
+
+    ProtoWriter user;
+    user.addVarint(1, session.getId());
+    user.addString(3, session.getName());
+    user.addVarint(5, 0);   // channel_id
+    const MessagePtr userState = makeMessage(MumbleMessageType::USER_STATE, user);
+    for(auto &entry : _sessions) {
+        Session &other = *entry.second;
+        if(!other.isAuthenticated() || &other == &session)
+            continue;
+        ProtoWriter existing;
+        existing.addVarint(1, other.getId());
+        existing.addString(3, other.getName());
+        existing.addVarint(5, 0);
+        session.send(makeMessage(MumbleMessageType::USER_STATE, existing));
+        other.send(userState);
+    }
+    session.send(userState);
+
+    ProtoWriter sync;
+    sync.addVarint(1, session.getId());
+    sync.addVarint(2, MAX_BANDWIDTH);
+    sync.addString(3, "mumpi mock server");
+    sync.addVarint(4, ~0ULL);   // all permissions
+    session.send(makeMessage(MumbleMessageType::SERVER_SYNC, sync));
+}
+
+/**
+ * @brief Forgets a closed client and tells the others it left
+ */
+void MockMumbleServer::removed(Session &session) {
+    const uint32_t id = session.getId();
+    const bool wasAuthenticated = session.isAuthenticated();
+    auto it = _sessions.find(id);
+    if(it == _sessions.end())
+        return;     // closed before it was accepted
+    std::shared_ptr<Session> keep = it->second;     // alive until this returns
+    _sessions.erase(it);
+    if(!wasAuthenticated)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        statsFor(id).connected = false;
+    }
+    ProtoWriter remove;
+    remove.addVarint(1, id);
+    broadcast(session, makeMessage(MumbleMessageType::USER_REMOVE, remove));
+}
+
+/**
+ * @brief Sends message to every authenticated client except from
+ *
+ * @param voice true to count message in the recipients' voice statistics
+ */
+void MockMumbleServer::broadcast(const Session &from, const MessagePtr &message, bool voice) {
+    for(auto &entry : _sessions) {
+        Session &to = *entry.second;
+        if(&to == &from || !to.isAuthenticated())
+            continue;
+        if(voice && _voiceLoss > 0.0
+                && std::uniform_real_distribution<double>(0.0, 1.0)(_lossRandom) < _voiceLoss) {
+            std::lock_guard<std::mutex> lock(_statsMutex);
+            statsFor(to.getId()).audioPacketsDropped++;
+            continue;
+        }
+        to.send(message);
+        if(voice) {
+            std::lock_guard<std::mutex> lock(_statsMutex);
+            MockClientStats &stats = statsFor(to.getId());
+            stats.audioPacketsOut++;
+            stats.audioBytesOut += message->size() - MumbleWire::HEADER_SIZE;
+        }
+    }
+}
+
+MockClientStats& MockMumbleServer::statsFor(uint32_t session) {
+    auto it = _stats.find(session);
+    if(it == _stats.end()) {
+        MockClientStats stats = MockClientStats();
+        stats.session = session;
+        it = _stats.insert(std::make_pair(session, stats)).first;
+    }
+    return it->second;
+}
@@ -0,0 +1,83 @@
+#ifndef MockMumbleServer_hpp
+#define MockMumbleServer_hpp
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+/**
+ * What the mock server saw from one client
+ */
+struct MockClientStats {
+    uint32_t session;
+    std::string name;
+    bool connected;
+    uint64_t audioPacketsIn;    // voice packets received from the client
+    uint64_t audioBytesIn;
+    uint64_t audioPacketsOut;   // voice packets relayed to the client
+    uint64_t audioBytesOut;
+    uint64_t audioPacketsDropped; // voice packets to the client dropped to simulate loss
+    uint64_t textMessagesIn;
+    uint64_t pingsIn;
+};
+
+/**
+ * Local stand-in for a Murmur server, for tests and load measurements.
+ *
+ * Implements just enough of the protocol for mumlib: a TLS control channel
+ * with a self-signed certificate, authentication answered with Version,
+ * ChannelState, UserState and ServerSync, Ping replies, and relaying of
+ * text messages and voice to every other client in the single root channel.
+ * No CryptSetup is sent, so clients tunnel voice through the control
+ * channel (UDPTunnel). There are no permissions, passwords or ACLs.
+ *
+ * setVoiceLoss() drops relayed voice packets at random, to exercise the
+ * clients' loss concealment.
+ *
+ * Runs its own io_service thread between start() and stop().
+ */
+class MockMumbleServer {
+public:
+    MockMumbleServer(unsigned short port = 0);
+    ~MockMumbleServer();
+
+    void start();
+    void stop();
+
+    void setVoiceLoss(double fraction);
+    unsigned short getPort() const;
+    std::vector<MockClientStats> getStats() const;
+
+private:
+    class Session;
+    friend class Session;
+
+    MockMumbleServer(const MockMumbleServer&) = delete;
+    MockMumbleServer& operator=(const MockMumbleServer&) = delete;
+
+    void accept();
+    void authenticated(Session &session);
+    void removed(Session &session);
+    void broadcast(const Session &from, const std::shared_ptr<std::vector<uint8_t>> &message, bool voice = false);
+    MockClientStats& statsFor(uint32_t session);    // callers hold _statsMutex
+
+    boost::asio::io_service _ioService;
+    boost::asio::ssl::context _sslContext;
+    boost::asio::ip::tcp::acceptor _acceptor;
+    std::thread _thread;
+    uint32_t _nextSession;
+    double _voiceLoss;
+    std::minstd_rand _lossRandom;                               // io_service thread only
+    std::map<uint32_t, std::shared_ptr<Session>> _sessions;    // io_service thread only
+    mutable std::mutex _statsMutex;
+    std::map<uint32_t, MockClientStats> _stats;
+};
+
+#endif /* MockMumbleServer_hpp */
@@ -0,0 +1,68 @@
+#include "AllocationCounter.hpp"
+
+#if defined(MUMPI_COUNT_ALLOCATIONS)
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocations(0);
+
+// replaces the global allocation functions; the array and nothrow forms would
+// otherwise go to the default operator new on some standard libraries
+
+static void* allocate(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new(std::size_t size) {
+    void *ptr = allocate(size);
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+bool AllocationCounter::isEnabled() {
+    return true;
+}
+
+uint64_t AllocationCounter::getAllocations() {
+    return allocations.load(std::memory_order_relaxed);
+}
+#else
+bool AllocationCounter::isEnabled() {
+    return false;
+}
+
+uint64_t AllocationCounter::getAllocations() {
+    return 0;
+}
+#endif
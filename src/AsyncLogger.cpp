@@ -0,0 +1,73 @@
+#include "AsyncLogger.hpp"
+
+#include <cstdio>
+
+// longest message handed to log4cpp, longer ones are truncated
+static const size_t MAX_MESSAGE_LENGTH = 512;
+
+/**
+ * @brief Constructor. Allocates the whole queue up front.
+ *
+ * @param capacity number of messages that can wait to be written
+ */
+AsyncLogger::AsyncLogger(size_t capacity) :
+        _queue(capacity),
+        _running(false),
+        _dropped(0) {
+}
+
+/**
+ * @brief Destructor, stops the background thread after writing what's queued
+ */
+AsyncLogger::~AsyncLogger() {
+    stop();
+}
+
+/**
+ * @brief Starts the background thread
+ */
+void AsyncLogger::start() {
+    if(_running.exchange(true))
+        return;
+    _thread = std::thread(&AsyncLogger::run, this);
+}
+
+/**
+ * @brief Writes everything queued so far and stops the background thread
+ */
+void AsyncLogger::stop() {
+    if(!_running.exchange(false))
+        return;
+    _pending.notify();
+    _thread.join();
+    drain();
+}
+
+bool AsyncLogger::enqueue(const LogRecord &record) {
+    if(!_queue.push(record)) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    _pending.notify();
+    return true;
+}
+
+void AsyncLogger::run() {
+    while(_running.load(std::memory_order_relaxed)) {
+        drain();
+        _pending.waitFor(std::chrono::milliseconds(100));
+    }
+}
+
+void AsyncLogger::drain() {
+    LogRecord record;
+    char message[MAX_MESSAGE_LENGTH];
+    while(_queue.pop(record)) {
+        size_t len = record.formatTo(message, sizeof(message));
+        if(record.suppressed > 0 && len < sizeof(message))
+            snprintf(message + len, sizeof(message) - len, " (%llu similar suppressed)",
+                     (unsigned long long) record.suppressed);
+        log4cpp::Category *category = (log4cpp::Category*) record.category;
+        category->log(record.priority, "%s", message);
+    }
+}
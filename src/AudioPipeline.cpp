@@ -0,0 +1,200 @@
+#include "AudioPipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+// device frames converted at a time, bounds the resamplers' and router's
+// buffers
+static const size_t CHUNK_FRAMES = 256;
+
+DeviceFormat::DeviceFormat() :
+        rate(0),
+        resampleQuality(Resampler::MEDIUM),
+        inputChannels(0),
+        inputChannel(ChannelRouter::ALL),
+        outputChannels(0),
+        outputChannel(ChannelRouter::ALL) {
+}
+
+PipelineLatency::PipelineLatency(int sampleRate) :
+        captureToVox("capture->vox"),
+        voxToSent("vox->sent"),
+        receiveToPlayout("receive->playout"),
+        captureTimes(sampleRate),
+        playoutArrivals(sampleRate) {
+}
+
+/**
+ * @brief Constructor. Allocates both ring buffers.
+ *
+ * @param sampleRate    sample rate of capture and playout
+ * @param channels      interleaved channels per frame
+ * @param opusFrameSize samples the encoder takes at a time
+ * @param bufferSamples size of each ring buffer
+ * @param frameReady    signal to raise when a frame is ready, NULL for the
+ *                      pipeline's own
+ * @param device        the backend's rate and channels; channel counts other
+ *                      than channels need a mono pipeline
+ * @param captureOverflow what capture() does when the encoder falls behind
+ * @param playoutOverflow what pushing to a full playout buffer does
+ */
+AudioPipeline::AudioPipeline(int sampleRate, int channels, size_t opusFrameSize, size_t bufferSamples,
+                             EventSignal *frameReady, const DeviceFormat &device,
+                             ringbuffer::OverflowPolicy captureOverflow,
+                             ringbuffer::OverflowPolicy playoutOverflow) :
+        _sampleRate(sampleRate),
+        _deviceRate(device.rate > 0 ? device.rate : sampleRate),
+        _channels(channels),
+        _inputChannels(device.inputChannels > 0 ? device.inputChannels : channels),
+        _outputChannels(device.outputChannels > 0 ? device.outputChannels : channels),
+        _opusFrameSize(opusFrameSize),
+        _captureBuf(bufferSamples, captureOverflow),
+        _playoutBuf(bufferSamples, playoutOverflow),
+        _frameReady(frameReady != NULL ? *frameReady : _ownFrameReady),
+        _latency(sampleRate),
+        _capturedSamples(0),
+        _playedSamples(0),
+        _playoutPosition(0) {
+    if(_deviceRate != _sampleRate) {
+        _captureResampler.reset(new Resampler(_deviceRate, _sampleRate, channels, device.resampleQuality,
+                                              CHUNK_FRAMES));
+        _captured.resize(_captureResampler->getMaxOutput(CHUNK_FRAMES) * channels);
+        // enough input for CHUNK_FRAMES output frames, see getInputNeeded()
+        const size_t maxInput = ((CHUNK_FRAMES + 1) * _sampleRate + _deviceRate - 1) / _deviceRate + 2;
+        _renderResampler.reset(new Resampler(_sampleRate, _deviceRate, channels, device.resampleQuality,
+                                             maxInput));
+        _toRender.resize(maxInput * channels);
+    }
+    if(channels == 1) {
+        _router.reset(new ChannelRouter(_inputChannels, device.inputChannel,
+                                        _outputChannels, device.outputChannel));
+        _downmixed.resize(CHUNK_FRAMES);
+    }
+    _rendered.resize(CHUNK_FRAMES * channels);
+}
+
+/**
+ * @brief Current steady_clock time in seconds, the time base of all latency
+ * measurements
+ */
+double AudioPipeline::steadySeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Queues one recorded buffer for the encoder. Samples that don't fit
+ * are handled by the capture buffer's overflow policy. Real-time safe.
+ *
+ * @param input       interleaved samples at the device rate, or NULL to
+ *                    record silence
+ * @param frames      frames in the buffer
+ * @param adcTime     time the first frame was captured, 0 if unknown
+ * @param currentTime backend time when called
+ */
+void AudioPipeline::capture(const int16_t *input, size_t frames, double adcTime, double currentTime) {
+    // tag the buffer's first sample with its ADC time on the steady clock;
+    // resampled, that sample is about the resampler's delay older
+    if(adcTime > 0.0) {
+        const double delay = _captureResampler ? _captureResampler->getDelay() : 0.0;
+        _latency.captureTimes.mark(_capturedSamples, steadySeconds() + (adcTime - currentTime) - delay);
+    }
+
+    if(!_captureResampler && _inputChannels == _channels) {
+        store(input, frames * _channels);
+    } else {
+        for(size_t pos = 0; pos < frames; pos += CHUNK_FRAMES) {
+            const size_t len = std::min(frames - pos, CHUNK_FRAMES);
+            const int16_t *chunk = input != NULL ? input + pos * _inputChannels : NULL;
+            if(_inputChannels != _channels && chunk != NULL) {
+                _router->downmix(chunk, len, _downmixed.data());
+                chunk = _downmixed.data();
+            }
+            if(_captureResampler) {
+                const size_t produced = _captureResampler->process(chunk, len, _captured.data());
+                store(_captured.data(), produced * _channels);
+            } else {
+                store(chunk, len * _channels);
+            }
+        }
+    }
+
+    // wake the encoder as soon as it has a full frame to work on
+    if(_captureBuf.getRemaining() >= _opusFrameSize)
+        _frameReady.notify();
+}
+
+/**
+ * @brief The most samples capture() stores for a buffer of frames device
+ * frames, e.g. to wait for room in the capture buffer
+ */
+size_t AudioPipeline::getMaxCaptured(size_t frames) const {
+    if(!_captureResampler)
+        return frames * _channels;
+    const size_t chunks = (frames + CHUNK_FRAMES - 1) / CHUNK_FRAMES;
+    return (_captureResampler->getMaxOutput(frames) + chunks) * _channels;
+}
+
+/**
+ * @brief Appends samples to the capture buffer, or silence for NULL input
+ */
+void AudioPipeline::store(const int16_t *input, size_t samples) {
+    if(input != NULL)
+        _capturedSamples += _captureBuf.push(input, 0, samples);
+    else
+        _capturedSamples += _captureBuf.pushFill(0, samples);
+}
+
+/**
+ * @brief Fills one output buffer from the playout buffer, padding with
+ * silence on underrun. Real-time safe.
+ *
+ * @param output      interleaved samples to fill, at the device rate
+ * @param frames      frames in the buffer
+ * @param dacTime     time the first frame will be played, 0 if unknown
+ * @param currentTime backend time when called
+ * @param mix         true to add to what output holds, for the second and
+ *                    later mono pipelines sharing a device
+ * @return number of samples taken from the playout buffer
+ */
+size_t AudioPipeline::render(int16_t *output, size_t frames, double dacTime, double currentTime, bool mix) {
+    size_t retrieved = 0;
+    const bool routed = mix || _outputChannels != _channels;
+    if(!_renderResampler && !routed) {
+        retrieved = _playoutBuf.topPadded(output, 0, frames * _channels, 0);
+    } else {
+        for(size_t pos = 0; pos < frames; pos += CHUNK_FRAMES) {
+            const size_t len = std::min(frames - pos, CHUNK_FRAMES);
+            int16_t *dest = output + pos * _outputChannels;
+            int16_t *pcm = routed ? _rendered.data() : dest;
+            if(_renderResampler) {
+                // pull exactly the playout samples that make up the chunk
+                const size_t needed = _renderResampler->getInputNeeded(len);
+                retrieved += _playoutBuf.topPadded(_toRender.data(), 0, needed * _channels, 0);
+                _renderResampler->process(_toRender.data(), needed, pcm, len);
+            } else {
+                retrieved += _playoutBuf.topPadded(pcm, 0, len * _channels, 0);
+            }
+            if(routed)
+                _router->upmix(pcm, len, dest, mix);
+        }
+    }
+
+    // received audio starting in this buffer reaches the DAC at dacTime
+    // plus its offset into the buffer. Follows the read position rather than
+    // counting retrieved, which would miss what a drop-oldest playout buffer
+    // discarded
+    const size_t readPosition = _playoutBuf.getReadPosition();
+    const uint64_t endIndex = _playedSamples + (size_t) (readPosition - _playoutPosition);
+    _playoutPosition = readPosition;
+    SampleTimeline::Mark mark;
+    const double dacSteady = steadySeconds() + (dacTime - currentTime)
+            + (_renderResampler ? _renderResampler->getDelay() : 0.0);
+    while(_latency.playoutArrivals.popBefore(endIndex, mark)) {
+        if(dacTime <= 0.0)
+            continue;
+        const uint64_t offset = mark.sampleIndex > _playedSamples ? mark.sampleIndex - _playedSamples : 0;
+        _latency.receiveToPlayout.recordSeconds(dacSteady + (double) offset / (_sampleRate * _channels) - mark.time);
+    }
+    _playedSamples = endIndex;
+    return retrieved;
+}
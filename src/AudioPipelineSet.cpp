@@ -0,0 +1,73 @@
+#include "AudioPipelineSet.hpp"
+
+#include <string>
+#include "AudioBackendException.hpp"
+
+/**
+ * @brief Constructor
+ *
+ * @param expected pipelines that will share the device
+ */
+AudioPipelineSet::AudioPipelineSet(size_t expected) :
+        _expected(expected) {
+    _pipelines.reserve(expected);
+}
+
+/**
+ * @brief Adds a pipeline
+ *
+ * @return true once all expected pipelines have been added, and the device
+ *         can be started
+ * @throws AudioBackendException if the pipeline wants a different device
+ *         rate or channel count than the others, or shares the device
+ *         without being mono
+ */
+bool AudioPipelineSet::add(AudioPipeline &pipeline) {
+    if(isComplete())
+        throw AudioBackendException("Audio device already has all of its " + std::to_string(_expected)
+                                    + " pipeline(s)");
+    if(!_pipelines.empty()) {
+        const AudioPipeline &first = *_pipelines.front();
+        if(pipeline.getDeviceRate() != first.getDeviceRate()
+                || pipeline.getInputChannels() != first.getInputChannels()
+                || pipeline.getOutputChannels() != first.getOutputChannels())
+            throw AudioBackendException("Bridges sharing an audio device must use the same device rate and channels");
+        if(pipeline.getChannels() != 1 || first.getChannels() != 1)
+            throw AudioBackendException("Only mono pipelines can share an audio device");
+    }
+    _pipelines.push_back(&pipeline);
+    return isComplete();
+}
+
+/**
+ * @brief Passes one recorded buffer to every pipeline. Real-time safe.
+ */
+void AudioPipelineSet::capture(const int16_t *input, size_t frames, double adcTime, double currentTime) {
+    for(AudioPipeline *pipeline : _pipelines)
+        pipeline->capture(input, frames, adcTime, currentTime);
+}
+
+/**
+ * @brief Fills one output buffer with every pipeline's playout mixed.
+ * Real-time safe.
+ *
+ * @return number of samples taken from the playout buffers
+ */
+size_t AudioPipelineSet::render(int16_t *output, size_t frames, double dacTime, double currentTime) {
+    size_t retrieved = 0;
+    for(size_t i = 0; i < _pipelines.size(); i++)
+        retrieved += _pipelines[i]->render(output, frames, dacTime, currentTime, i > 0);
+    return retrieved;
+}
+
+/**
+ * @brief True if every pipeline's capture buffer has room for a buffer of
+ * frames device frames
+ */
+bool AudioPipelineSet::hasCaptureRoom(size_t frames) const {
+    for(const AudioPipeline *pipeline : _pipelines) {
+        if(pipeline->getCaptureBuffer().getFree() < pipeline->getMaxCaptured(frames))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,509 @@
+#include "Bridge.hpp"
+
+#include <algorithm>
+#include "FileAudioBackend.hpp"
+#include "PortAudioBackend.hpp"
+
+// mumlib encodes and decodes mono; DeviceFormat maps it to the device's channels
+static const int NUM_CHANNELS = 1;
+static const int FRAMES_PER_BUFFER = 512;
+static const std::chrono::milliseconds PLAYOUT_INTERVAL(10);
+// after a longer stall playout skips ahead instead of catching up
+static const int MAX_PLAYOUT_CATCHUP = 5;   // frames
+static const std::chrono::seconds RECONNECT_DELAY(5);
+static const double VOX_LOG_RATE = 5.0;     // per second
+// silences longer than this are shortened when replaying into the channel
+static const double MAX_REPLAY_GAP = 0.5;   // s
+
+/**
+ * Gets the next power of 2 for the passed argument
+ *
+ * @param  val input value
+ * @return     next power of 2 for passed arg
+ */
+static unsigned nextPowerOf2(unsigned val) {
+    val--;
+    val = (val >> 1) | val;
+    val = (val >> 2) | val;
+    val = (val >> 4) | val;
+    val = (val >> 8) | val;
+    val = (val >> 16) | val;
+    return ++val;
+}
+
+/**
+ * @brief Constructor. Allocates all buffers; nothing runs until start().
+ *
+ * @param config      the bridge's settings, validated
+ * @param backend     the bridge's audio backend, see createBackend()
+ * @param ioService   io_service the Mumble connection runs on
+ * @param asyncLogger logger usable from the audio threads
+ * @param frameReady  raised when a captured frame is ready for service()
+ */
+Bridge::Bridge(const BridgeConfig &config,
+               const std::shared_ptr<AudioBackend> &backend,
+               boost::asio::io_service &ioService,
+               AsyncLogger &asyncLogger,
+               EventSignal &frameReady) :
+        _config(config),
+        _asyncLogger(asyncLogger),
+        _logger(log4cpp::Category::getInstance("mumpi.bridge." + config.name)),
+        _voxLogLimit(VOX_LOG_RATE),
+        // Opus can encode frames of 2.5, 5, 10, 20, 40, or 60 ms
+        // the Opus RFC 6716 recommends using 20ms frame sizes, longer
+        // frames send fewer packets for more latency
+        // so at 48k sample rate, 20ms is 960 samples
+        _opusFrameSize(config.sampleRate / 1000 * config.frameMs),
+        _playoutFrameSize(config.sampleRate / 100),
+        // ring buffers hold about 500ms, the output is held at targetDelay
+        _targetFill(std::min<size_t>(config.targetDelay * config.sampleRate,
+                                     nextPowerOf2(0.5 * config.sampleRate * NUM_CHANNELS) / 2)),
+        _pipeline(config.sampleRate, NUM_CHANNELS, _opusFrameSize,
+                  nextPowerOf2(0.5 * config.sampleRate * NUM_CHANNELS), &frameReady,
+                  makeDeviceFormat(config), config.captureOverflow, config.playoutOverflow),
+        _backend(backend),
+        _speakers(std::make_shared<JitterBufferSet>(config.sampleRate)),
+        _recorder(config.recordDir.empty() ? NULL
+                  : new Recorder(config.recordDir, config.name, config.sampleRate, config.bitrate,
+                                 config.recordSegment)),
+        // a second of replayed audio queued ahead, the main loop tops it up
+        _replayOut(nextPowerOf2(config.sampleRate)),
+        _replayPosition(0),
+        _callback(_speakers, asyncLogger, _recorder.get()),
+        _mumConf(makeMumlibConfiguration(config)),
+        _mum(_callback, ioService, _mumConf),
+        _connecting(false),
+        _vox(config.sampleRate, config.voxThreshold, config.voiceHold),
+        _drift(config.sampleRate, _targetFill),
+        _wrapBuf(_opusFrameSize),
+        _replayWrap(_opusFrameSize),
+        _frame(_playoutFrameSize),
+        _corrected(DriftController::getMaxOutput(_playoutFrameSize)),
+        _recIndex(0),
+        _recPosition(0),
+        _outIndex(0),
+        _scheduled(false),
+        _nextPlayout(0) {
+    _callback.mum = &_mum;
+    if(config.vad)
+        _vad.reset(new VadGate(config.sampleRate, _opusFrameSize, config.voxThreshold,
+                               config.vadHangover, config.vadPreRoll));
+
+    _logger.info("Server:        %s:%d", config.server.c_str(), config.port);
+    _logger.info("Username:      %s", config.username.c_str());
+    _logger.info("delay:         %f", config.outputDelay);
+    _logger.info("sample rate    %d", config.sampleRate);
+    if(_pipeline.getDeviceRate() != config.sampleRate)
+        _logger.info("device rate    %d, resampled with %s quality (%s)", _pipeline.getDeviceRate(),
+                     Resampler::getQualityName(config.resampleQuality), Resampler::getKernelName());
+    if(config.inputChannels > 1 || config.outputChannels > 1)
+        _logger.info("channels       %s of %d in, %s of %d out",
+                     config.inputChannel > 0 ? std::to_string(config.inputChannel).c_str() : "mix",
+                     config.inputChannels,
+                     config.outputChannel > 0 ? std::to_string(config.outputChannel).c_str() : "all",
+                     config.outputChannels);
+    _logger.info("frame          %d ms, %d bit/s", config.frameMs, config.bitrate);
+    _logger.info("vox threshold  %f", config.voxThreshold);
+    if(config.vad)
+        _logger.info("vad hangover   %d frames, pre-roll %d frames", config.vadHangover, config.vadPreRoll);
+    else
+        _logger.info("voice hold interval %f", config.voiceHold);
+    _logger.info("target delay   %f", config.targetDelay);
+    _logger.info("full duplex    %s", config.fullDuplex ? "yes" : "no");
+    if(!config.inputDevice.empty() || !config.outputDevice.empty()) {
+        _logger.info("input device   %s", config.inputDevice.c_str());
+        _logger.info("output device  %s", config.outputDevice.c_str());
+    }
+    if(!config.inputFile.empty() || !config.outputFile.empty()) {
+        _logger.info("input file     %s", config.inputFile.c_str());
+        _logger.info("output file    %s", config.outputFile.c_str());
+        _logger.info("unpaced        %s", config.unpaced ? "yes" : "no");
+    }
+    if(_recorder)
+        _logger.info("recording to   %s, %d s files", config.recordDir.c_str(), config.recordSegment);
+    _logger.info("OPUS_FRAME_SIZE: %zu", _opusFrameSize);
+}
+
+Bridge::~Bridge() {
+    stop();
+}
+
+/**
+ * @brief Creates the audio backend for a bridge and for the others that
+ * share its sound card or files (see BridgeConfig::sharesDevice())
+ *
+ * @param config      the first of the sharing bridges' settings
+ * @param asyncLogger logger usable from the audio threads
+ * @param pipelines   number of sharing bridges, the backend starts once
+ *                    every one of them has started
+ */
+std::shared_ptr<AudioBackend> Bridge::createBackend(const BridgeConfig &config, AsyncLogger &asyncLogger,
+                                                    size_t pipelines) {
+    // files replace the sound card on both sides, so a replay never mixes
+    // with live audio
+    if(!config.inputFile.empty() || !config.outputFile.empty())
+        return std::make_shared<FileAudioBackend>(config.inputFile, config.outputFile, !config.unpaced,
+                                                  FRAMES_PER_BUFFER, pipelines);
+    return std::make_shared<PortAudioBackend>(config.outputDelay, config.fullDuplex, FRAMES_PER_BUFFER, asyncLogger,
+                                              config.inputDevice, config.outputDevice, pipelines);
+}
+
+DeviceFormat Bridge::makeDeviceFormat(const BridgeConfig &config) {
+    DeviceFormat device;
+    device.rate = config.deviceRate;
+    device.resampleQuality = config.resampleQuality;
+    device.inputChannels = config.inputChannels;
+    device.outputChannels = config.outputChannels;
+    // 1-based, 0 (mix or all) becomes ChannelRouter::ALL
+    device.inputChannel = config.inputChannel - 1;
+    device.outputChannel = config.outputChannel - 1;
+    return device;
+}
+
+mumlib::MumlibConfiguration Bridge::makeMumlibConfiguration(const BridgeConfig &config) {
+    mumlib::MumlibConfiguration conf;
+    conf.opusEncoderBitrate = config.bitrate;
+    return conf;
+}
+
+/**
+ * @brief Queues the initial output delay and starts the audio backend. The
+ * connection is made by the next maintainConnection().
+ *
+ * @throws AudioBackendException if the devices or files can't be used
+ * @throws RecorderException if recordings or the replay history can't be
+ *         written
+ */
+void Bridge::start() {
+    if(!_config.replayFile.empty() && !_history) {
+        _history.reset(new ReplayBuffer(_config.replayFile, _config.sampleRate, 60.0 * _config.replayMinutes));
+        _logger.info("replay history %s, %d min, %s%s", _config.replayFile.c_str(), _config.replayMinutes,
+                     _history->isRestored() ? "restored" : "new",
+                     _history->isLocked() ? "" : ", not locked in memory");
+    }
+    if(_recorder)
+        _recorder->start();
+    std::vector<int16_t> prefill(_targetFill, 0);
+    _outIndex = _pipeline.getPlayoutBuffer().push(prefill.data(), 0, prefill.size());
+    _nextPlayout.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    _backend->start(_pipeline);
+    _logger.info("audio backend: %s", _backend->getName());
+}
+
+/**
+ * @brief Stops the audio backend. service() must not be running.
+ */
+void Bridge::stop() {
+    _backend->stop();
+    if(_recorder)
+        _recorder->stop();
+}
+
+/**
+ * @brief Connects, or reconnects RECONNECT_DELAY after a failure
+ */
+void Bridge::maintainConnection(Clock::time_point now) {
+    const mumlib::ConnectionState state = _mum.getConnectionState();
+    if(state == mumlib::ConnectionState::CONNECTED || state == mumlib::ConnectionState::IN_PROGRESS)
+        return;
+    if(_connecting && now < _reconnectAt)
+        return;
+    _logger.info("Connecting to %s", _config.server.c_str());
+    _connecting = true;
+    _reconnectAt = now + RECONNECT_DELAY;
+    _mum.connect(_config.server, _config.port, _config.username, _config.password);
+}
+
+/**
+ * @brief Called when a TransportException escaped the io_service. Bridges
+ * that aren't connected afterwards wait RECONNECT_DELAY before retrying.
+ */
+void Bridge::connectionFailed(Clock::time_point now, const char *what) {
+    if(_mum.getConnectionState() == mumlib::ConnectionState::CONNECTED)
+        return;
+    _logger.error("TransportException: %s.", what);
+    _logger.error("Attempting to reconnect in 5 s.");
+    _connecting = true;
+    _reconnectAt = now + RECONNECT_DELAY;
+}
+
+void Bridge::disconnect() {
+    _logger.info("Disconnecting...");
+    _mum.disconnect();
+}
+
+bool Bridge::captureReady() const {
+    return _pipeline.getCaptureBuffer().getRemaining() >= _opusFrameSize;
+}
+
+/**
+ * @brief True if a captured frame is waiting or the next playout frame is due
+ */
+bool Bridge::needsService(Clock::time_point now) const {
+    return captureReady() || now >= getNextPlayout();
+}
+
+Bridge::Clock::time_point Bridge::getNextPlayout() const {
+    return Clock::time_point(Clock::duration(_nextPlayout.load(std::memory_order_relaxed)));
+}
+
+/**
+ * @brief WorkerPool task: encodes every captured frame and queues the
+ * playout frames that are due. The caller must have won trySchedule().
+ *
+ * @param bridge the Bridge
+ */
+void Bridge::service(void *bridge) {
+    Bridge &self = *(Bridge*) bridge;
+    self.serviceCapture();
+    self.servicePlayout(Clock::now());
+    self._scheduled.store(false, std::memory_order_release);
+    // wakes the scheduler, which skips bridges while they are serviced, to
+    // pick up the next playout time and any frame captured meanwhile
+    self._pipeline.getFrameReady().notify();
+}
+
+void Bridge::serviceCapture() {
+    SpscRingBuffer<int16_t> &recBuf = _pipeline.getCaptureBuffer();
+    PipelineLatency &latency = _pipeline.getLatency();
+    while(true) {
+        // VOX and encoder work directly on the capture buffer's memory,
+        // unless the frame wraps around its end
+        // a drop-oldest capture buffer may have discarded samples since
+        const size_t position = recBuf.getReadPosition();
+        _recIndex += (size_t) (position - _recPosition);
+        _recPosition = position;
+        int16_t *frame = recBuf.peekReadLinear(_opusFrameSize, _wrapBuf.data());
+        if(frame == NULL)
+            break;
+
+        if(_mum.getConnectionState() == mumlib::ConnectionState::CONNECTED) {
+            const bool transmit = _vad ? _vad->process(frame) : _vox.process(frame, _opusFrameSize);
+            const double decisionTime = AudioPipeline::steadySeconds();
+            double adcTime;
+            const bool timed = latency.captureTimes.timeAt(_recIndex + _opusFrameSize - 1, adcTime);
+            if(timed)
+                latency.captureToVox.recordSeconds(decisionTime - adcTime);
+            if(_logger.isInfoEnabled()) {
+                if(_vad)
+                    _asyncLogger.log(_voxLogLimit, _logger, log4cpp::Priority::INFO,
+                                     "Recorded voice dB: %.2f SNR: %.1f flatness: %.2f",
+                                     _vad->getDetector().getLastDb(),
+                                     _vad->getDetector().getLastSnrDb(),
+                                     _vad->getDetector().getLastFlatness());
+                else
+                    _asyncLogger.log(_voxLogLimit, _logger, log4cpp::Priority::INFO,
+                                     "Recorded voice dB: %.2f", _vox.getDetector().getLastDb());
+            }
+
+            if(transmit) {  // only tx if vox threshold met or holding
+                // the frames held before a VAD onset go out first
+                const size_t preRoll = _vad ? _vad->getPreRollCount() : 0;
+                const double frameTime = timed ? adcTime : decisionTime;
+                for(size_t i = 0; i < preRoll; i++) {
+                    _mum.sendAudioData(_vad->getPreRoll(i), _opusFrameSize);
+                    archiveTransmitted(_vad->getPreRoll(i), frameTime - (double) (preRoll - i) * _config.frameMs / 1000);
+                }
+                _mum.sendAudioData(frame, _opusFrameSize);
+                archiveTransmitted(frame, frameTime);
+                latency.voxToSent.recordSeconds(AudioPipeline::steadySeconds() - decisionTime);
+            } else if(int16_t *replayed = _replayOut.peekReadLinear(_opusFrameSize, _replayWrap.data())) {
+                // replays go out a frame per captured frame, only while the
+                // radio is quiet, and aren't archived again
+                _mum.sendAudioData(replayed, _opusFrameSize);
+                _replayOut.consumeRead(_opusFrameSize);
+            }
+        }
+        // frames recorded while disconnected are dropped
+        recBuf.consumeRead(_opusFrameSize);
+    }
+}
+
+/**
+ * Every 10 ms, pulls a frame from each speaker's jitter buffer, mixes them
+ * and queues the result for the backend to render. Silence is queued too, so
+ * the playout buffer's fill level only moves with clock drift, which the
+ * drift controller corrects to hold the target delay.
+ */
+void Bridge::servicePlayout(Clock::time_point now) {
+    SpscRingBuffer<int16_t> &outBuf = _pipeline.getPlayoutBuffer();
+    Clock::time_point next = getNextPlayout();
+    for(int i = 0; i < MAX_PLAYOUT_CATCHUP && now >= next; i++) {
+        JitterBuffer::TimePoint arrival;
+        const bool silent = _speakers->pull(_frame.data(), _playoutFrameSize, &arrival) == 0;
+        _drift.updateFill(outBuf.getRemaining());
+        const size_t len = _drift.process(_frame.data(), _playoutFrameSize, silent,
+                                          _corrected.data(), _corrected.size());
+        if(!silent) {
+            const double arrivalTime = std::chrono::duration<double>(arrival.time_since_epoch()).count();
+            _pipeline.getLatency().playoutArrivals.mark(_outIndex, arrivalTime);
+            if(_history)
+                _history->append(ReplayBuffer::RECEIVED, _frame.data(), _playoutFrameSize,
+                                 std::chrono::duration<double>((next + PLAYOUT_INTERVAL).time_since_epoch()).count());
+        }
+        _outIndex += outBuf.push(_corrected.data(), 0, len);
+        next += PLAYOUT_INTERVAL;
+    }
+    if(now >= next)
+        next = now + PLAYOUT_INTERVAL;
+    _nextPlayout.store(next.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+/**
+ * Passes a transmitted frame to the recorder and the replay history
+ *
+ * @param time steady clock seconds at the frame's last sample
+ */
+void Bridge::archiveTransmitted(const int16_t *pcm, double time) {
+    if(_recorder)
+        _recorder->recordTransmitted(pcm, _opusFrameSize, time);
+    if(_history)
+        _history->append(ReplayBuffer::TRANSMITTED, pcm, _opusFrameSize, time);
+}
+
+/**
+ * @brief Starts sending a window of the replay history into the channel,
+ * with long silences shortened. service() sends it in the gaps between live
+ * transmissions; pumpReplay() must be called regularly until it's done.
+ *
+ * @param track which direction to replay
+ * @param from  wall clock seconds of the window's start
+ * @param to    and of its end
+ * @return samples to send, 0 if there's no history, no audio in the window
+ *         or a replay is already running
+ */
+size_t Bridge::replay(ReplayBuffer::Track track, double from, double to) {
+    if(!_history || isReplaying())
+        return 0;
+    _replayClip = _history->extract(track, from, to, MAX_REPLAY_GAP);
+    // the last frame is completed with silence
+    if(_replayClip.size() % _opusFrameSize != 0)
+        _replayClip.resize(_replayClip.size() + _opusFrameSize - _replayClip.size() % _opusFrameSize, 0);
+    _replayPosition = 0;
+    pumpReplay();
+    return _replayClip.size();
+}
+
+/**
+ * @brief Queues as much of the running replay as fits for service()
+ */
+void Bridge::pumpReplay() {
+    if(_replayPosition < _replayClip.size())
+        _replayPosition += _replayOut.push(_replayClip.data(), (int) _replayPosition,
+                                           std::min(_replayOut.getFree(), _replayClip.size() - _replayPosition));
+    if(_replayPosition == _replayClip.size() && !_replayClip.empty()) {
+        _replayClip.clear();
+        _replayClip.shrink_to_fit();
+        _replayPosition = 0;
+    }
+}
+
+/**
+ * @brief True while replayed audio is left to send
+ */
+bool Bridge::isReplaying() const {
+    return _replayPosition < _replayClip.size() || !_replayOut.isEmpty();
+}
+
+/**
+ * @brief True once a file input has been used up and fully encoded
+ */
+bool Bridge::isFinished() const {
+    return _backend->isFinished() && !captureReady();
+}
+
+/**
+ * @brief Logs backend CPU load, VOX, drift and per-speaker jitter statistics
+ */
+void Bridge::logStats() {
+    _logger.info("%s backend CPU load: %.3f", _backend->getName(), _backend->getCpuLoad());
+    if(_vad)
+        _logger.info("VAD: %llu frames, %llu with voice, %llu transmitted",
+                     (unsigned long long) _vad->getFrames(),
+                     (unsigned long long) _vad->getVoiceFrames(),
+                     (unsigned long long) _vad->getTransmittedFrames());
+    else
+        _logger.info("VOX: %llu frames, %llu with voice, %llu transmitted",
+                     (unsigned long long) _vox.getFrames(),
+                     (unsigned long long) _vox.getVoiceFrames(),
+                     (unsigned long long) _vox.getTransmittedFrames());
+    const DriftStats driftStats = _drift.getStats();
+    _logger.info("output fill %.0f target %zu correction %.0f ppm inserted %llu "
+                 "dropped %llu resampled frames %llu silence frames %llu",
+                 driftStats.fillSamples,
+                 _drift.getTargetFill(),
+                 driftStats.correctionPpm,
+                 (unsigned long long) driftStats.insertedSamples,
+                 (unsigned long long) driftStats.droppedSamples,
+                 (unsigned long long) driftStats.resampledFrames,
+                 (unsigned long long) driftStats.silenceAdjustedFrames);
+    for(auto &entry : _speakers->getStats()) {
+        const JitterBufferStats &stats = entry.second;
+        _logger.info("session %d: received %llu late %llu lost %llu concealed %llu reordered %llu "
+                     "underruns %llu depth %zu target %zu jitter %.1f ms",
+                     entry.first,
+                     (unsigned long long) stats.received,
+                     (unsigned long long) stats.late,
+                     (unsigned long long) stats.lost,
+                     (unsigned long long) stats.concealed,
+                     (unsigned long long) stats.reordered,
+                     (unsigned long long) stats.underruns,
+                     stats.depthSamples,
+                     stats.targetDelaySamples,
+                     stats.jitterMs);
+    }
+    logBufferStats("capture", _pipeline.getCaptureBuffer());
+    logBufferStats("playout", _pipeline.getPlayoutBuffer());
+    const uint64_t rejected = _speakers->getRejectedPackets();
+    if(rejected > 0)
+        _logger.info("%llu packets dropped with every jitter buffer busy", (unsigned long long) rejected);
+    if(_recorder)
+        _logger.info("recorder: %llu samples recorded %llu dropped, %llu files %llu bytes written, %llu errors",
+                     (unsigned long long) _recorder->getRecordedSamples(),
+                     (unsigned long long) _recorder->getDroppedSamples(),
+                     (unsigned long long) _recorder->getFilesWritten(),
+                     (unsigned long long) _recorder->getBytesWritten(),
+                     (unsigned long long) _recorder->getErrors());
+}
+
+/**
+ * @brief Logs what a ring buffer's overflow policy discarded and how often
+ * its consumer ran dry
+ */
+void Bridge::logBufferStats(const char *name, const SpscRingBuffer<int16_t> &buffer) {
+    const ringbuffer::Stats stats = buffer.getStats();
+    _logger.info("%s buffer (%s): fill %zu of %zu overwritten %llu dropped %llu rejected pushes %llu "
+                 "underruns %llu padded %llu",
+                 name,
+                 ringbuffer::getOverflowPolicyName(buffer.getOverflowPolicy()),
+                 buffer.getRemaining(),
+                 buffer.getSize(),
+                 (unsigned long long) stats.overwritten,
+                 (unsigned long long) stats.dropped,
+                 (unsigned long long) stats.rejected,
+                 (unsigned long long) stats.underruns,
+                 (unsigned long long) stats.padded);
+}
+
+/**
+ * @brief Logs the per-stage latency histograms. Requested explicitly, so
+ * logged at a level that's shown without --verbose.
+ */
+void Bridge::logLatency() {
+    PipelineLatency &latency = _pipeline.getLatency();
+    const LatencyHistogram *histograms[] = {
+        &latency.captureToVox,
+        &latency.voxToSent,
+        &latency.receiveToPlayout
+    };
+    for(const LatencyHistogram *histogram : histograms) {
+        const LatencySummary summary = histogram->getSummary();
+        _logger.warn("latency %-16s count %llu mean %.2f ms p50 %.2f ms p99 %.2f ms max %.2f ms",
+                     histogram->getName().c_str(),
+                     (unsigned long long) summary.count,
+                     summary.meanUs / 1000.0,
+                     summary.p50Us / 1000.0,
+                     summary.p99Us / 1000.0,
+                     summary.maxUs / 1000.0);
+    }
+}
@@ -0,0 +1,303 @@
+#include "BridgeConfig.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <set>
+#include "BridgeConfigException.hpp"
+
+static const int DEFAULT_PORT = 64738;
+static const int MAX_PRE_ROLL = 50;     // frames
+static const int MIN_BITRATE = 6000;    // Opus' range, bit/s
+static const int MAX_BITRATE = 510000;
+static const int MIN_DEVICE_RATE = 8000;
+static const int MAX_DEVICE_RATE = 192000;
+static const int MAX_CHANNELS = 32;
+static const int MIN_RECORD_SEGMENT = 60;       // s
+static const int MAX_RECORD_SEGMENT = 86400;
+static const int MAX_REPLAY_MINUTES = 1440;
+
+static std::string trim(const std::string &str) {
+    size_t begin = 0;
+    size_t end = str.size();
+    while(begin < end && std::isspace((unsigned char) str[begin]))
+        begin++;
+    while(end > begin && std::isspace((unsigned char) str[end - 1]))
+        end--;
+    return str.substr(begin, end - begin);
+}
+
+static double toDouble(const std::string &key, const std::string &value) {
+    try {
+        size_t used;
+        const double val = std::stod(value, &used);
+        if(used == value.size())
+            return val;
+    } catch(std::exception &exp) {
+    }
+    throw BridgeConfigException("Invalid number for " + key + ": " + value);
+}
+
+static int toInt(const std::string &key, const std::string &value) {
+    const double val = toDouble(key, value);
+    if(val != (int) val)
+        throw BridgeConfigException("Invalid integer for " + key + ": " + value);
+    return (int) val;
+}
+
+// a 1-based channel, or 0 for the word meaning every channel
+static int toChannel(const std::string &key, const std::string &value, const char *every) {
+    if(value == every)
+        return 0;
+    const int channel = toInt(key, value);
+    if(channel < 1)
+        throw BridgeConfigException("Invalid " + key + ", expected a channel from 1 or " + every + ": " + value);
+    return channel;
+}
+
+static bool toBool(const std::string &key, const std::string &value) {
+    if(value == "true" || value == "yes" || value == "1")
+        return true;
+    if(value == "false" || value == "no" || value == "0")
+        return false;
+    throw BridgeConfigException("Invalid boolean for " + key + ": " + value);
+}
+
+BridgeConfig::BridgeConfig() :
+        port(DEFAULT_PORT),
+        sampleRate(48000),
+        deviceRate(0),
+        resampleQuality(Resampler::MEDIUM),
+        inputChannels(1),
+        inputChannel(0),
+        outputChannels(1),
+        outputChannel(0),
+        frameMs(20),
+        bitrate(32000),
+        voxThreshold(-90.0),
+        voiceHold(0.050),
+        vad(false),
+        vadHangover(10),
+        vadPreRoll(3),
+        targetDelay(0.05),
+        outputDelay(-1.0),
+        captureOverflow(ringbuffer::DROP_NEWEST),
+        playoutOverflow(ringbuffer::DROP_NEWEST),
+        fullDuplex(false),
+        unpaced(false),
+        recordSegment(3600),
+        replayMinutes(10) {
+}
+
+/**
+ * @brief Sets one setting by its name, which is the matching mumpi long
+ * option (e.g. "vox-threshold")
+ *
+ * @throws BridgeConfigException for unknown keys or malformed values
+ */
+void BridgeConfig::set(const std::string &key, const std::string &value) {
+    if(key == "server") {
+        // IP[:PORT]
+        const size_t sep = value.rfind(':');
+        server = value.substr(0, sep);
+        port = sep != std::string::npos ? toInt(key, value.substr(sep + 1)) : DEFAULT_PORT;
+    } else if(key == "username") {
+        username = value;
+    } else if(key == "password") {
+        password = value;
+    } else if(key == "delay") {
+        outputDelay = toDouble(key, value);
+    } else if(key == "sample-rate") {
+        sampleRate = toInt(key, value);
+    } else if(key == "device-rate") {
+        deviceRate = toInt(key, value);
+    } else if(key == "resample-quality") {
+        if(!Resampler::parseQuality(value, resampleQuality))
+            throw BridgeConfigException("Invalid resample-quality, expected low, medium or high: " + value);
+    } else if(key == "input-channels") {
+        inputChannels = toInt(key, value);
+    } else if(key == "input-channel") {
+        inputChannel = toChannel(key, value, "mix");
+    } else if(key == "output-channels") {
+        outputChannels = toInt(key, value);
+    } else if(key == "output-channel") {
+        outputChannel = toChannel(key, value, "all");
+    } else if(key == "frame-ms") {
+        frameMs = toInt(key, value);
+    } else if(key == "bitrate") {
+        bitrate = toInt(key, value);
+    } else if(key == "vox-threshold") {
+        voxThreshold = toDouble(key, value);
+    } else if(key == "voice-hold") {
+        voiceHold = toDouble(key, value);
+    } else if(key == "vad") {
+        vad = toBool(key, value);
+    } else if(key == "vad-hangover") {
+        vadHangover = toInt(key, value);
+    } else if(key == "vad-pre-roll") {
+        vadPreRoll = toInt(key, value);
+    } else if(key == "target-delay") {
+        targetDelay = toDouble(key, value);
+    } else if(key == "capture-overflow" || key == "playout-overflow") {
+        if(!ringbuffer::parseOverflowPolicy(value, key == "capture-overflow" ? captureOverflow : playoutOverflow))
+            throw BridgeConfigException("Invalid " + key + ", expected drop-newest, drop-oldest or reject: " + value);
+    } else if(key == "full-duplex") {
+        fullDuplex = toBool(key, value);
+    } else if(key == "input-device") {
+        inputDevice = value;
+    } else if(key == "output-device") {
+        outputDevice = value;
+    } else if(key == "input-file") {
+        inputFile = value;
+    } else if(key == "output-file") {
+        outputFile = value;
+    } else if(key == "unpaced") {
+        unpaced = toBool(key, value);
+    } else if(key == "record-dir") {
+        recordDir = value;
+    } else if(key == "record-segment") {
+        recordSegment = toInt(key, value);
+    } else if(key == "replay-file") {
+        replayFile = value;
+    } else if(key == "replay-minutes") {
+        replayMinutes = toInt(key, value);
+    } else {
+        throw BridgeConfigException("Unknown setting " + key);
+    }
+}
+
+/**
+ * @param requireServer false to only check the audio and encoder settings
+ * @throws BridgeConfigException if a required setting is missing or a value
+ *         is out of range
+ */
+void BridgeConfig::validate(bool requireServer) const {
+    const std::string where = name.empty() ? "" : " for bridge " + name;
+    if(requireServer && (server.empty() || username.empty()))
+        throw BridgeConfigException("server and username are required" + where);
+    if(port <= 0 || port > 65535)
+        throw BridgeConfigException("Invalid server port" + where);
+    if(sampleRate != 48000 && sampleRate != 24000 && sampleRate != 12000)
+        throw BridgeConfigException("sample-rate must be 12000, 24000, or 48000" + where);
+    if(deviceRate != 0 && (deviceRate < MIN_DEVICE_RATE || deviceRate > MAX_DEVICE_RATE
+                           || Resampler::getPhases(deviceRate, sampleRate) > Resampler::MAX_PHASES
+                           || Resampler::getPhases(sampleRate, deviceRate) > Resampler::MAX_PHASES))
+        throw BridgeConfigException("device-rate must be " + std::to_string(MIN_DEVICE_RATE) + " - "
+                                    + std::to_string(MAX_DEVICE_RATE) + " Hz in a simple ratio to sample-rate,"
+                                    " e.g. 16000 or 44100" + where);
+    if(inputChannels < 1 || inputChannels > MAX_CHANNELS || outputChannels < 1 || outputChannels > MAX_CHANNELS)
+        throw BridgeConfigException("input-channels and output-channels must be 1 - "
+                                    + std::to_string(MAX_CHANNELS) + where);
+    if(inputChannel > inputChannels || outputChannel > outputChannels)
+        throw BridgeConfigException("input-channel and output-channel must be one of the device's channels" + where);
+    if(frameMs != 10 && frameMs != 20 && frameMs != 40 && frameMs != 60)
+        throw BridgeConfigException("frame-ms must be 10, 20, 40, or 60" + where);
+    if(bitrate < MIN_BITRATE || bitrate > MAX_BITRATE)
+        throw BridgeConfigException("bitrate must be " + std::to_string(MIN_BITRATE) + " - "
+                                    + std::to_string(MAX_BITRATE) + " bit/s" + where);
+    if(voiceHold < 0.0 || targetDelay < 0.0)
+        throw BridgeConfigException("voice-hold and target-delay can't be negative" + where);
+    if(vadHangover < 0 || vadPreRoll < 0 || vadPreRoll > MAX_PRE_ROLL)
+        throw BridgeConfigException("vad-hangover can't be negative and vad-pre-roll must be 0 - "
+                                    + std::to_string(MAX_PRE_ROLL) + where);
+    if(!recordDir.empty() && (recordSegment < MIN_RECORD_SEGMENT || recordSegment > MAX_RECORD_SEGMENT))
+        throw BridgeConfigException("record-segment must be " + std::to_string(MIN_RECORD_SEGMENT) + " - "
+                                    + std::to_string(MAX_RECORD_SEGMENT) + " s" + where);
+    if(!replayFile.empty() && (replayMinutes < 1 || replayMinutes > MAX_REPLAY_MINUTES))
+        throw BridgeConfigException("replay-minutes must be 1 - " + std::to_string(MAX_REPLAY_MINUTES) + where);
+}
+
+/**
+ * @brief Whether both bridges use the same sound card or files, and so share
+ * one audio backend, each on its own channels
+ */
+bool BridgeConfig::sharesDevice(const BridgeConfig &other) const {
+    return inputDevice == other.inputDevice && outputDevice == other.outputDevice
+           && inputFile == other.inputFile && outputFile == other.outputFile;
+}
+
+/**
+ * @brief Parses an INI style configuration with one [section] per bridge.
+ *
+ *     # settings before the first section apply to every bridge
+ *     server = 192.168.1.10
+ *
+ *     [repeater]
+ *     username = repeater
+ *     input-device = USB Audio
+ *     vox-threshold = -45
+ *
+ * Keys are mumpi's long option names. Lines starting with # or ; are
+ * comments.
+ *
+ * @return the bridges, validated, in file order
+ * @throws BridgeConfigException on syntax errors, unknown keys, invalid or
+ *         duplicate bridges, or if there are no bridges
+ */
+std::vector<BridgeConfig> BridgeConfig::parse(std::istream &in) {
+    BridgeConfig defaults;
+    std::vector<BridgeConfig> bridges;
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(in, line)) {
+        lineNumber++;
+        line = trim(line);
+        if(line.empty() || line[0] == '#' || line[0] == ';')
+            continue;
+
+        const std::string where = " on line " + std::to_string(lineNumber);
+        if(line[0] == '[') {
+            if(line.back() != ']' || trim(line.substr(1, line.size() - 2)).empty())
+                throw BridgeConfigException("Invalid section" + where);
+            bridges.push_back(defaults);
+            bridges.back().name = trim(line.substr(1, line.size() - 2));
+            continue;
+        }
+
+        const size_t eq = line.find('=');
+        if(eq == std::string::npos)
+            throw BridgeConfigException("Expected key = value" + where);
+        const std::string key = trim(line.substr(0, eq));
+        const std::string value = trim(line.substr(eq + 1));
+        try {
+            (bridges.empty() ? defaults : bridges.back()).set(key, value);
+        } catch(BridgeConfigException &exp) {
+            throw BridgeConfigException(exp.what() + where);
+        }
+    }
+
+    if(bridges.empty())
+        throw BridgeConfigException("No bridges configured");
+    std::set<std::string> names;
+    for(const BridgeConfig &bridge : bridges) {
+        if(!names.insert(bridge.name).second)
+            throw BridgeConfigException("Duplicate bridge " + bridge.name);
+        bridge.validate();
+    }
+    // one stream serves the bridges on a sound card, so they must agree on its format
+    for(size_t i = 0; i < bridges.size(); i++) {
+        for(size_t j = 0; j < i; j++) {
+            const BridgeConfig &a = bridges[j];
+            const BridgeConfig &b = bridges[i];
+            if(a.sharesDevice(b) && (a.getDeviceRate() != b.getDeviceRate()
+                                     || a.inputChannels != b.inputChannels || a.outputChannels != b.outputChannels
+                                     || a.fullDuplex != b.fullDuplex || a.outputDelay != b.outputDelay
+                                     || a.unpaced != b.unpaced))
+                throw BridgeConfigException("Bridges " + a.name + " and " + b.name + " share a sound card but differ"
+                                            " in its rate, channels, delay, full-duplex or unpaced setting");
+            if(!a.replayFile.empty() && a.replayFile == b.replayFile)
+                throw BridgeConfigException("Bridges " + a.name + " and " + b.name + " share replay-file "
+                                            + a.replayFile);
+        }
+    }
+    return bridges;
+}
+
+/**
+ * @brief Reads and parses a configuration file, see parse()
+ */
+std::vector<BridgeConfig> BridgeConfig::parseFile(const std::string &path) {
+    std::ifstream in(path.c_str());
+    if(!in)
+        throw BridgeConfigException("Can't open " + path);
+    return parse(in);
+}
@@ -0,0 +1,67 @@
+#include "BridgeScheduler.hpp"
+
+#include <algorithm>
+#include "Bridge.hpp"
+
+// bounds how long shutdown takes when nothing is due
+static const std::chrono::milliseconds MAX_SLEEP(100);
+
+/**
+ * @param pool       workers to run Bridge::service() on
+ * @param frameReady the signal every bridge's AudioPipeline raises
+ */
+BridgeScheduler::BridgeScheduler(WorkerPool &pool, EventSignal &frameReady) :
+        _pool(pool),
+        _frameReady(frameReady),
+        _running(false),
+        _submitted(0) {
+}
+
+BridgeScheduler::~BridgeScheduler() {
+    stop();
+}
+
+/**
+ * @brief Adds a bridge. Must be called before start().
+ */
+void BridgeScheduler::add(Bridge &bridge) {
+    _bridges.push_back(&bridge);
+}
+
+void BridgeScheduler::start() {
+    _running = true;
+    _thread = std::thread(&BridgeScheduler::run, this);
+}
+
+/**
+ * @brief Stops scheduling. Work already submitted finishes on the pool.
+ */
+void BridgeScheduler::stop() {
+    if(!_running.exchange(false))
+        return;
+    _frameReady.notify();
+    _thread.join();
+}
+
+void BridgeScheduler::run() {
+    while(_running.load(std::memory_order_relaxed)) {
+        const Bridge::Clock::time_point now = Bridge::Clock::now();
+        Bridge::Clock::time_point wake = now + MAX_SLEEP;
+        for(Bridge *bridge : _bridges) {
+            if(!bridge->needsService(now)) {
+                wake = std::min(wake, bridge->getNextPlayout());
+            } else if(bridge->trySchedule()) {
+                if(_pool.submit(&Bridge::service, bridge)) {
+                    _submitted.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    bridge->cancelSchedule();
+                    wake = std::min(wake, now + std::chrono::milliseconds(1));
+                }
+            }
+            // a bridge already being serviced signals when it's done, see
+            // Bridge::service()
+        }
+        if(wake > now)
+            _frameReady.waitFor(wake - now);
+    }
+}
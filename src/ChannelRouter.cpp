@@ -0,0 +1,237 @@
+#include "ChannelRouter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ROUTER_NEON 1
+#endif
+
+/**
+ * @brief Constructor
+ *
+ * @param inputChannels  channels of the capture device
+ * @param inputChannel   0-based channel to capture, or ALL for their average
+ * @param outputChannels channels of the playout device
+ * @param outputChannel  0-based channel to play on, or ALL for every one
+ */
+ChannelRouter::ChannelRouter(int inputChannels, int inputChannel, int outputChannels, int outputChannel) :
+        _inputChannels(inputChannels),
+        _inputChannel(inputChannel),
+        _outputChannels(outputChannels),
+        _outputChannel(outputChannel) {
+}
+
+static int16_t saturate(int32_t value) {
+    return (int16_t) std::max(-32768, std::min(32767, value));
+}
+
+// the scalar kernels, on any number of channels
+
+static void downmixFrames(const int16_t *input, size_t frames, int16_t *mono, int channels, int channel) {
+    if(channel != ChannelRouter::ALL) {
+        for(size_t i = 0; i < frames; i++)
+            mono[i] = input[i * channels + channel];
+        return;
+    }
+    for(size_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for(int c = 0; c < channels; c++)
+            sum += input[i * channels + c];
+        // rounded down, like the SIMD kernels' arithmetic shift
+        mono[i] = (int16_t) (sum >= 0 ? sum / channels : -((-sum + channels - 1) / channels));
+    }
+}
+
+static void upmixFrames(const int16_t *mono, size_t frames, int16_t *output, bool mix, int channels, int channel) {
+    for(size_t i = 0; i < frames; i++) {
+        for(int c = 0; c < channels; c++) {
+            const int16_t v = channel == ChannelRouter::ALL || c == channel ? mono[i] : 0;
+            int16_t &out = output[i * channels + c];
+            out = mix ? saturate(out + v) : v;
+        }
+    }
+}
+
+void ChannelRouter::downmixScalar(const int16_t *input, size_t frames, int16_t *mono) const {
+    downmixFrames(input, frames, mono, _inputChannels, _inputChannel);
+}
+
+void ChannelRouter::upmixScalar(const int16_t *mono, size_t frames, int16_t *output, bool mix) const {
+    upmixFrames(mono, frames, output, mix, _outputChannels, _outputChannel);
+}
+
+#if defined(__SSE2__)
+/**
+ * Stereo to mono, 8 frames at a time. Returns the frames done.
+ */
+static size_t downmixStereo(const int16_t *input, size_t frames, int16_t *mono, int channel) {
+    size_t i = 0;
+    if(channel == 0) {
+        for(; i + 8 <= frames; i += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i*) (input + 2 * i));
+            const __m128i b = _mm_loadu_si128((const __m128i*) (input + 2 * i + 8));
+            // sign-extend the low (left) half of each frame
+            _mm_storeu_si128((__m128i*) (mono + i), _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                                                    _mm_srai_epi32(_mm_slli_epi32(b, 16), 16)));
+        }
+    } else if(channel == 1) {
+        for(; i + 8 <= frames; i += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i*) (input + 2 * i));
+            const __m128i b = _mm_loadu_si128((const __m128i*) (input + 2 * i + 8));
+            _mm_storeu_si128((__m128i*) (mono + i), _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+        }
+    } else {
+        const __m128i ones = _mm_set1_epi16(1);
+        for(; i + 8 <= frames; i += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i*) (input + 2 * i));
+            const __m128i b = _mm_loadu_si128((const __m128i*) (input + 2 * i + 8));
+            // left + right per frame in 32 bits, halved
+            _mm_storeu_si128((__m128i*) (mono + i), _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(a, ones), 1),
+                                                                    _mm_srai_epi32(_mm_madd_epi16(b, ones), 1)));
+        }
+    }
+    return i;
+}
+
+/**
+ * Mono to stereo, 8 frames at a time. Returns the frames done.
+ */
+static size_t upmixStereo(const int16_t *mono, size_t frames, int16_t *output, bool mix, int channel) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*) (mono + i));
+        __m128i lo, hi;
+        if(channel == 0) {
+            lo = _mm_unpacklo_epi16(x, zero);
+            hi = _mm_unpackhi_epi16(x, zero);
+        } else if(channel == 1) {
+            lo = _mm_unpacklo_epi16(zero, x);
+            hi = _mm_unpackhi_epi16(zero, x);
+        } else {
+            lo = _mm_unpacklo_epi16(x, x);
+            hi = _mm_unpackhi_epi16(x, x);
+        }
+        __m128i *out = (__m128i*) (output + 2 * i);
+        if(mix) {
+            lo = _mm_adds_epi16(lo, _mm_loadu_si128(out));
+            hi = _mm_adds_epi16(hi, _mm_loadu_si128(out + 1));
+        }
+        _mm_storeu_si128(out, lo);
+        _mm_storeu_si128(out + 1, hi);
+    }
+    return i;
+}
+
+/**
+ * Saturating mono += mono
+ */
+static size_t mixMono(const int16_t *mono, size_t frames, int16_t *output) {
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8) {
+        __m128i *out = (__m128i*) (output + i);
+        _mm_storeu_si128(out, _mm_adds_epi16(_mm_loadu_si128(out), _mm_loadu_si128((const __m128i*) (mono + i))));
+    }
+    return i;
+}
+#endif
+
+#if defined(ROUTER_NEON)
+static size_t downmixStereo(const int16_t *input, size_t frames, int16_t *mono, int channel) {
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8) {
+        const int16x8x2_t lr = vld2q_s16(input + 2 * i);
+        const int16x8_t m = channel == 0 ? lr.val[0]
+                          : channel == 1 ? lr.val[1]
+                          : vhaddq_s16(lr.val[0], lr.val[1]);   // (left + right) >> 1
+        vst1q_s16(mono + i, m);
+    }
+    return i;
+}
+
+static size_t upmixStereo(const int16_t *mono, size_t frames, int16_t *output, bool mix, int channel) {
+    const int16x8_t zero = vdupq_n_s16(0);
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8) {
+        const int16x8_t x = vld1q_s16(mono + i);
+        int16x8x2_t lr;
+        lr.val[0] = channel == 1 ? zero : x;
+        lr.val[1] = channel == 0 ? zero : x;
+        if(mix) {
+            const int16x8x2_t out = vld2q_s16(output + 2 * i);
+            lr.val[0] = vqaddq_s16(lr.val[0], out.val[0]);
+            lr.val[1] = vqaddq_s16(lr.val[1], out.val[1]);
+        }
+        vst2q_s16(output + 2 * i, lr);
+    }
+    return i;
+}
+
+static size_t mixMono(const int16_t *mono, size_t frames, int16_t *output) {
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8)
+        vst1q_s16(output + i, vqaddq_s16(vld1q_s16(output + i), vld1q_s16(mono + i)));
+    return i;
+}
+#endif
+
+/**
+ * @brief Captured device frames to the pipeline's mono samples
+ *
+ * @param input  interleaved frames from the device
+ * @param frames number of frames
+ * @param mono   frames samples to fill
+ */
+void ChannelRouter::downmix(const int16_t *input, size_t frames, int16_t *mono) const {
+    if(_inputChannels == 1) {
+        std::memcpy(mono, input, frames * sizeof(int16_t));
+        return;
+    }
+    size_t done = 0;
+#if defined(__SSE2__) || defined(ROUTER_NEON)
+    if(_inputChannels == 2)
+        done = downmixStereo(input, frames, mono, _inputChannel);
+#endif
+    downmixFrames(input + done * _inputChannels, frames - done, mono + done, _inputChannels, _inputChannel);
+}
+
+/**
+ * @brief The pipeline's mono samples to device frames
+ *
+ * @param mono   samples to play
+ * @param frames number of frames
+ * @param output interleaved frames for the device
+ * @param mix    true to add to what output holds, with saturation, false to
+ *               overwrite it, silencing the channels not played on
+ */
+void ChannelRouter::upmix(const int16_t *mono, size_t frames, int16_t *output, bool mix) const {
+    if(_outputChannels == 1 && !mix) {
+        std::memcpy(output, mono, frames * sizeof(int16_t));
+        return;
+    }
+    size_t done = 0;
+#if defined(__SSE2__) || defined(ROUTER_NEON)
+    if(_outputChannels == 1)
+        done = mixMono(mono, frames, output);
+    else if(_outputChannels == 2)
+        done = upmixStereo(mono, frames, output, mix, _outputChannel);
+#endif
+    upmixFrames(mono + done, frames - done, output + done * _outputChannels, mix, _outputChannels, _outputChannel);
+}
+
+/**
+ * @brief Name of the stereo kernels on this machine
+ */
+const char* ChannelRouter::getKernelName() {
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(ROUTER_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,68 @@
+#include "CommandPipe.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CommandPipeException.hpp"
+
+/**
+ * @brief Opens the named pipe at path, creating it if necessary
+ *
+ * @throws CommandPipeException if path can't be created or opened, or isn't
+ *         a named pipe
+ */
+CommandPipe::CommandPipe(const std::string &path) :
+        _fd(-1),
+        _discarding(false) {
+    if(mkfifo(path.c_str(), 0600) != 0 && errno != EEXIST)
+        throw CommandPipeException("Can't create " + path + ": " + std::strerror(errno));
+    _fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if(_fd < 0)
+        throw CommandPipeException("Can't open " + path + ": " + std::strerror(errno));
+    struct stat status;
+    if(fstat(_fd, &status) != 0 || !S_ISFIFO(status.st_mode)) {
+        close(_fd);
+        throw CommandPipeException(path + " isn't a named pipe");
+    }
+}
+
+CommandPipe::~CommandPipe() {
+    close(_fd);
+}
+
+/**
+ * @brief Returns the next complete line, without its line end
+ *
+ * @param line set to the command
+ * @return false if no complete line has been written yet
+ */
+bool CommandPipe::readLine(std::string &line) {
+    while(true) {
+        const size_t end = _buffer.find('\n');
+        if(end != std::string::npos) {
+            const bool discarded = _discarding;
+            line = _buffer.substr(0, end);
+            _buffer.erase(0, end + 1);
+            _discarding = false;
+            if(discarded)
+                continue;
+            if(!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);
+            return true;
+        }
+        if(_buffer.size() > MAX_LINE) {
+            _buffer.clear();
+            _discarding = true;
+        }
+
+        char chunk[256];
+        const ssize_t len = read(_fd, chunk, sizeof(chunk));
+        if(len < 0 && errno == EINTR)
+            continue;
+        if(len <= 0)
+            return false;
+        _buffer.append(chunk, len);
+    }
+}
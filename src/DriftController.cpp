@@ -0,0 +1,145 @@
+#include "DriftController.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// smoothing of the fill level, per call to updateFill() (every 10 ms: ~0.5 s)
+static const double FILL_SMOOTHING = 0.02;
+// time over which a fill error is corrected while speech is playing
+static const double CORRECTION_SECONDS = 10.0;
+// fill errors below this are left alone, in seconds
+static const double DEADBAND_SECONDS = 0.002;
+
+/**
+ * @brief Constructor
+ *
+ * @param sampleRate        output sample rate
+ * @param targetFillSamples fill level of the output buffer to hold
+ * @param maxCorrectionPpm  largest resampling correction applied to speech
+ */
+DriftController::DriftController(int sampleRate, size_t targetFillSamples, double maxCorrectionPpm) :
+        _sampleRate(sampleRate),
+        _targetFill(targetFillSamples),
+        _maxCorrection(maxCorrectionPpm / 1e6),
+        _fill(0.0),
+        _haveFill(false),
+        _correction(0.0),
+        _pos(0.0),
+        _prev(0),
+        _fillStat(0),
+        _correctionPpmStat(0),
+        _inserted(0),
+        _dropped(0),
+        _resampledFrames(0),
+        _silenceAdjustedFrames(0) {
+}
+
+/**
+ * @brief Reports the output buffer's current fill level and updates the
+ * correction.
+ *
+ * @param fillSamples samples currently queued for the sound card
+ */
+void DriftController::updateFill(size_t fillSamples) {
+    if(_haveFill) {
+        _fill += (fillSamples - _fill) * FILL_SMOOTHING;
+    } else {
+        _fill = fillSamples;
+        _haveFill = true;
+    }
+
+    const double error = _fill - _targetFill;
+    if(std::fabs(error) < DEADBAND_SECONDS * _sampleRate)
+        _correction = 0.0;
+    else
+        _correction = std::max(-_maxCorrection,
+                               std::min(_maxCorrection, error / (CORRECTION_SECONDS * _sampleRate)));
+
+    _fillStat.store((int64_t) _fill, std::memory_order_relaxed);
+    _correctionPpmStat.store((int64_t) (_correction * 1e6), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Applies the current correction to one frame.
+ *
+ * @param in          input frame
+ * @param len         samples in the input frame
+ * @param silent      true if the frame is silence, which allows a fast correction
+ * @param out         output buffer
+ * @param outCapacity size of out, at least getMaxOutput(len)
+ * @return number of samples written to out
+ */
+size_t DriftController::process(const int16_t *in, size_t len, bool silent, int16_t *out, size_t outCapacity) {
+    size_t outLen;
+    if(silent) {
+        // drop or insert up to 1/10 of the frame, but not past the target
+        const double error = _fill - _targetFill;
+        long adjust = 0;
+        if(std::fabs(error) >= DEADBAND_SECONDS * _sampleRate) {
+            const long limit = len / 10;
+            adjust = std::max(-limit, std::min(limit, (long) error));
+        }
+        outLen = std::min(outCapacity, (size_t) ((long) len - adjust));
+        std::memset(out, 0, outLen * sizeof(int16_t));
+        _pos = 0.0;
+        _prev = 0;
+        if(adjust != 0)
+            _silenceAdjustedFrames.fetch_add(1, std::memory_order_relaxed);
+        // the frame was consumed, so the fill level moves by outLen not len
+        _fill += (double) outLen - len;
+    } else if(_correction != 0.0 || _pos != 0.0) {
+        outLen = resample(in, len, out, outCapacity);
+        _resampledFrames.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        outLen = std::min(len, outCapacity);
+        std::memcpy(out, in, outLen * sizeof(int16_t));
+        _prev = len > 0 ? in[len - 1] : _prev;
+    }
+
+    if(outLen > len)
+        _inserted.fetch_add(outLen - len, std::memory_order_relaxed);
+    else
+        _dropped.fetch_add(len - outLen, std::memory_order_relaxed);
+    return outLen;
+}
+
+/**
+ * @brief Linear-interpolating resampler. Each output sample advances the read
+ * position by 1 + correction input samples. The position carries over between
+ * frames, with index -1 being the previous frame's last sample.
+ */
+size_t DriftController::resample(const int16_t *in, size_t len, int16_t *out, size_t outCapacity) {
+    const double step = 1.0 + _correction;
+    const double end = (double) len - 1.0;
+    size_t outLen = 0;
+    while(_pos < end && outLen < outCapacity) {
+        const double floorPos = std::floor(_pos);
+        const long index = (long) floorPos;
+        const double frac = _pos - floorPos;
+        const int16_t a = index < 0 ? _prev : in[index];
+        const int16_t b = in[index + 1];
+        out[outLen++] = (int16_t) std::lround(a + frac * (b - a));
+        _pos += step;
+    }
+    _pos -= len;
+    if(len > 0)
+        _prev = in[len - 1];
+    if(std::fabs(_pos) < 1e-9)
+        _pos = 0.0;
+    return outLen;
+}
+
+/**
+ * @brief Returns a snapshot of the counters. Safe from any thread.
+ */
+DriftStats DriftController::getStats() const {
+    DriftStats stats;
+    stats.fillSamples = _fillStat.load(std::memory_order_relaxed);
+    stats.correctionPpm = _correctionPpmStat.load(std::memory_order_relaxed);
+    stats.insertedSamples = _inserted.load(std::memory_order_relaxed);
+    stats.droppedSamples = _dropped.load(std::memory_order_relaxed);
+    stats.resampledFrames = _resampledFrames.load(std::memory_order_relaxed);
+    stats.silenceAdjustedFrames = _silenceAdjustedFrames.load(std::memory_order_relaxed);
+    return stats;
+}
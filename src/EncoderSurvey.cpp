@@ -0,0 +1,152 @@
+#include "EncoderSurvey.hpp"
+
+#include <ctime>
+#include <memory>
+#include <opus/opus.h>
+#include "EncoderException.hpp"
+#include "VadGate.hpp"
+#include "VoxGate.hpp"
+
+static const size_t MAX_PACKET_BYTES = 4000;
+static const int32_t DTX_MAX_BYTES = 2;     // Opus packets this small carry no audio
+// per packet: Mumble voice header (type, sequence, length), OCB-AES128
+// crypt header, UDP and IPv4 headers
+static const int WIRE_OVERHEAD_BYTES = 5 + 4 + 8 + 20;
+static const int FRAME_MS[] = { 10, 20, 40, 60 };
+
+const char* EncoderSetting::getModeName() const {
+    switch(mode) {
+    case CBR:
+        return "cbr";
+    case CVBR:
+        return "cvbr";
+    default:
+        return "vbr";
+    }
+}
+
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param config the bridge's sample rate, bitrate and VOX or VAD settings
+ * @param audio  the recording, mono at config.sampleRate; must outlive the
+ *               survey
+ */
+EncoderSurvey::EncoderSurvey(const BridgeConfig &config, const std::vector<int16_t> &audio) :
+        _config(config),
+        _audio(audio) {
+}
+
+/**
+ * @brief Encodes the recording with one setting
+ *
+ * @throws EncoderException if libopus rejects the setting
+ */
+EncoderResult EncoderSurvey::measure(const EncoderSetting &setting) const {
+    int error;
+    std::unique_ptr<OpusEncoder, void (*)(OpusEncoder*)> encoder(
+            opus_encoder_create(_config.sampleRate, 1, OPUS_APPLICATION_VOIP, &error),
+            opus_encoder_destroy);
+    if(error != OPUS_OK)
+        throw EncoderException(std::string("Could not create Opus encoder: ") + opus_strerror(error));
+    if(opus_encoder_ctl(encoder.get(), OPUS_SET_BITRATE(_config.bitrate)) != OPUS_OK
+            || opus_encoder_ctl(encoder.get(), OPUS_SET_VBR(setting.mode != EncoderSetting::CBR)) != OPUS_OK
+            || opus_encoder_ctl(encoder.get(), OPUS_SET_VBR_CONSTRAINT(setting.mode == EncoderSetting::CVBR)) != OPUS_OK
+            || opus_encoder_ctl(encoder.get(), OPUS_SET_DTX(setting.dtx)) != OPUS_OK)
+        throw EncoderException("Could not configure Opus encoder");
+
+    const size_t frameSize = _config.sampleRate / 1000 * setting.frameMs;
+    VoxGate vox(_config.sampleRate, _config.voxThreshold, _config.voiceHold);
+    std::unique_ptr<VadGate> vad;
+    if(_config.vad)
+        vad.reset(new VadGate(_config.sampleRate, frameSize, _config.voxThreshold,
+                              _config.vadHangover, _config.vadPreRoll));
+
+    EncoderResult result = EncoderResult();
+    result.setting = setting;
+    uint64_t payloadBytes = 0;
+    double cpuSeconds = 0.0;
+    unsigned char packet[MAX_PACKET_BYTES];
+    auto encode = [&](const int16_t *frame) {
+        const double start = threadCpuSeconds();
+        const opus_int32 len = opus_encode(encoder.get(), frame, frameSize, packet, sizeof(packet));
+        cpuSeconds += threadCpuSeconds() - start;
+        if(len < 0)
+            throw EncoderException(std::string("Opus encoding failed: ") + opus_strerror(len));
+        result.frames++;
+        if(!setting.dtx || len > DTX_MAX_BYTES) {
+            result.packets++;
+            payloadBytes += len;
+        }
+    };
+
+    for(size_t pos = 0; pos + frameSize <= _audio.size(); pos += frameSize) {
+        const int16_t *frame = &_audio[pos];
+        if(vad) {
+            if(!vad->process(frame))
+                continue;
+            for(size_t i = 0; i < vad->getPreRollCount(); i++)
+                encode(vad->getPreRoll(i));
+        } else if(!vox.process(frame, frameSize)) {
+            continue;
+        }
+        encode(frame);
+    }
+
+    const double seconds = (double) _audio.size() / _config.sampleRate;
+    if(result.frames > 0)
+        result.cpuUsPerFrame = cpuSeconds * 1e6 / result.frames;
+    if(seconds > 0.0) {
+        result.cpuPercent = 100.0 * cpuSeconds / seconds;
+        result.packetsPerSecond = result.packets / seconds;
+        result.payloadKbps = payloadBytes * 8 / seconds / 1000.0;
+        result.wireKbps = (payloadBytes + result.packets * WIRE_OVERHEAD_BYTES) * 8 / seconds / 1000.0;
+    }
+    return result;
+}
+
+/**
+ * @brief Measures every frame duration with CBR, constrained VBR and VBR,
+ * each without and with DTX
+ */
+std::vector<EncoderResult> EncoderSurvey::measureAll() const {
+    std::vector<EncoderResult> results;
+    for(int frameMs : FRAME_MS) {
+        for(int mode = EncoderSetting::CBR; mode <= EncoderSetting::VBR; mode++) {
+            for(int dtx = 0; dtx <= 1; dtx++) {
+                EncoderSetting setting;
+                setting.frameMs = frameMs;
+                setting.mode = (EncoderSetting::Mode) mode;
+                setting.dtx = dtx != 0;
+                results.push_back(measure(setting));
+            }
+        }
+    }
+    return results;
+}
+
+/**
+ * @brief Prints the results as a table
+ */
+void EncoderSurvey::print(FILE *out, const std::vector<EncoderResult> &results) {
+    fprintf(out, "%7s %5s %4s %10s %8s %8s %10s %10s %11s\n",
+            "frame", "mode", "dtx", "frames", "us/frame", "cpu %", "packets/s", "kbit/s", "wire kbit/s");
+    for(const EncoderResult &result : results) {
+        fprintf(out, "%4d ms %5s %4s %10llu %8.1f %8.3f %10.1f %10.1f %11.1f\n",
+                result.setting.frameMs,
+                result.setting.getModeName(),
+                result.setting.dtx ? "on" : "off",
+                (unsigned long long) result.frames,
+                result.cpuUsPerFrame,
+                result.cpuPercent,
+                result.packetsPerSecond,
+                result.payloadKbps,
+                result.wireKbps);
+    }
+}
@@ -0,0 +1,61 @@
+#include "EventSignal.hpp"
+
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static long futex(std::atomic<int> *addr, int op, int val, const struct timespec *timeout) {
+    return syscall(SYS_futex, reinterpret_cast<int*>(addr), op, val, timeout, NULL, 0);
+}
+
+EventSignal::EventSignal() :
+        _state(IDLE) {
+}
+
+/**
+ * @brief Wakes the waiter, or makes its next waitFor() return immediately.
+ * Real-time safe.
+ */
+void EventSignal::notify() {
+    if(_state.exchange(SIGNALED, std::memory_order_release) == WAITING)
+        futex(&_state, FUTEX_WAKE_PRIVATE, 1, NULL);
+}
+
+/**
+ * @brief Blocks until notify() is called or timeout expires. Consumes the
+ * notification.
+ *
+ * @param timeout maximum time to wait
+ * @return true if notified, false on timeout
+ */
+bool EventSignal::waitFor(std::chrono::nanoseconds timeout) {
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+
+    while(true) {
+        int expected = IDLE;
+        if(!_state.compare_exchange_strong(expected, WAITING, std::memory_order_acquire)) {
+            // already signaled, only notify() can have changed it
+            _state.exchange(IDLE, std::memory_order_acquire);
+            return true;
+        }
+
+        const std::chrono::nanoseconds left = deadline - std::chrono::steady_clock::now();
+        if(left.count() > 0) {
+            struct timespec ts;
+            ts.tv_sec = left.count() / 1000000000;
+            ts.tv_nsec = left.count() % 1000000000;
+            // sleeps only while the state is still WAITING
+            futex(&_state, FUTEX_WAIT_PRIVATE, WAITING, &ts);
+        }
+
+        // back to IDLE in one step, so a notify() landing now isn't lost:
+        // either it's consumed here or it stays pending for the next wait
+        if(_state.exchange(IDLE, std::memory_order_acquire) == SIGNALED)
+            return true;
+        if(left.count() <= 0)
+            return false;
+        // spurious wakeup, wait for the rest of the timeout
+    }
+}
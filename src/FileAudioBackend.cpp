@@ -0,0 +1,150 @@
+#include "FileAudioBackend.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "AudioBackendException.hpp"
+
+/**
+ * @brief Constructor
+ *
+ * @param inputPath       WAV or raw PCM file or pipe to capture from, "-" for
+ *                        stdin, empty to capture silence
+ * @param outputPath      file or pipe to play into (WAV if it ends in ".wav"),
+ *                        "-" for stdout, empty to discard
+ * @param paced           true to run in real time, false as fast as possible
+ * @param framesPerBuffer frames per capture and render call
+ * @param pipelines       bridges sharing the files, see start()
+ */
+FileAudioBackend::FileAudioBackend(const std::string &inputPath,
+                                   const std::string &outputPath,
+                                   bool paced,
+                                   size_t framesPerBuffer,
+                                   size_t pipelines) :
+        _inputPath(inputPath),
+        _outputPath(outputPath),
+        _paced(paced),
+        _framesPerBuffer(framesPerBuffer),
+        _pipelines(pipelines),
+        _tuningError(0),
+        _running(false),
+        _finished(false),
+        _framesCaptured(0),
+        _busyNs(0),
+        _elapsedNs(0) {
+}
+
+FileAudioBackend::~FileAudioBackend() {
+    stop();
+}
+
+/**
+ * @brief Opens the files and starts the audio thread, once the last of the
+ * pipelines sharing them has been added
+ *
+ * @throws AudioBackendException if a file can't be opened, or the input is a
+ *         WAV file whose rate or channel count doesn't match the pipeline
+ */
+void FileAudioBackend::start(AudioPipeline &pipeline) {
+    if(!_pipelines.add(pipeline))
+        return;
+    if(!_inputPath.empty()) {
+        _reader.reset(new WavReader(_inputPath));
+        if(_reader->isWav() && (_reader->getSampleRate() != _pipelines.getDeviceRate() ||
+                                _reader->getChannels() != _pipelines.getInputChannels())) {
+            throw AudioBackendException("Input " + _inputPath + " is " +
+                                        std::to_string(_reader->getSampleRate()) + " Hz, " +
+                                        std::to_string(_reader->getChannels()) + " channel(s), expected " +
+                                        std::to_string(_pipelines.getDeviceRate()) + " Hz, " +
+                                        std::to_string(_pipelines.getInputChannels()) + " channel(s)");
+        }
+    }
+    if(!_outputPath.empty())
+        _writer.reset(new WavWriter(_outputPath, _pipelines.getDeviceRate(), _pipelines.getOutputChannels()));
+
+    _running = true;
+    _thread = std::thread(&FileAudioBackend::run, this);
+    _tuningError = _tuning.apply(_thread.native_handle());
+}
+
+/**
+ * @brief Stops the audio thread and closes the files
+ */
+void FileAudioBackend::stop() {
+    if(!_running.exchange(false))
+        return;
+    _thread.join();
+    if(_writer)
+        _writer->close();
+    _writer.reset();
+    _reader.reset();
+}
+
+/**
+ * @brief Fraction of the time since start() spent inside the pipeline
+ */
+double FileAudioBackend::getCpuLoad() const {
+    const uint64_t elapsed = _elapsedNs.load(std::memory_order_relaxed);
+    return elapsed > 0 ? (double) _busyNs.load(std::memory_order_relaxed) / elapsed : 0.0;
+}
+
+/**
+ * @brief The audio thread's scheduling and CPUs, empty unless started
+ */
+std::string FileAudioBackend::getThreadReport() {
+    if(!_thread.joinable())
+        return "";
+    return "audio thread " + _tuning.report(_thread.native_handle(), _tuningError);
+}
+
+void FileAudioBackend::run() {
+    typedef std::chrono::steady_clock Clock;
+    const size_t samples = _framesPerBuffer * _pipelines.getInputChannels();
+    const std::chrono::duration<double> period((double) _framesPerBuffer / _pipelines.getDeviceRate());
+    std::vector<int16_t> input(samples);
+    std::vector<int16_t> output(_framesPerBuffer * _pipelines.getOutputChannels());
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point next = start;
+    while(_running.load(std::memory_order_relaxed)) {
+        const bool capturing = _reader && !isFinished();
+        size_t got = 0;
+        if(capturing) {
+            got = _reader->read(input.data(), samples);
+            if(got == 0) {
+                _finished.store(true, std::memory_order_release);
+                if(!_paced)
+                    break;
+            }
+            std::fill(input.begin() + got, input.end(), 0);
+        }
+
+        // unpaced: wait for the encoder rather than overflow the capture buffer
+        if(!_paced) {
+            while(!_pipelines.hasCaptureRoom(_framesPerBuffer) && _running.load(std::memory_order_relaxed))
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        // a file has no ADC or DAC delay: buffers are captured and played now
+        const Clock::time_point busyStart = Clock::now();
+        const double now = AudioPipeline::steadySeconds();
+        if(got > 0 || !_reader)
+            _pipelines.capture(_reader ? input.data() : NULL, _framesPerBuffer, now, now);
+        _pipelines.render(output.data(), _framesPerBuffer, now, now);
+        const Clock::time_point busyEnd = Clock::now();
+
+        if(_writer)
+            _writer->write(output.data(), output.size());
+        if(got > 0)
+            _framesCaptured.fetch_add(got / _pipelines.getInputChannels(), std::memory_order_relaxed);
+        _busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(busyEnd - busyStart).count(),
+                          std::memory_order_relaxed);
+        _elapsedNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(busyEnd - start).count(),
+                         std::memory_order_relaxed);
+
+        if(_paced) {
+            next += std::chrono::duration_cast<Clock::duration>(period);
+            std::this_thread::sleep_until(next);
+        }
+    }
+}
@@ -0,0 +1,374 @@
+#include "JitterBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// a sequence number this far behind the playout point means the sender
+// restarted its numbering rather than a late packet (1 s of 10 ms frames)
+static const int RESYNC_FRAMES = 100;
+// concealment plays at full level this long before fading out
+static const double CONCEAL_HOLD_MS = 20.0;
+static const double CROSSFADE_MS = 2.5;
+// pitch search runs on every n-th sample so it costs the same at any rate
+static const int PITCH_SEARCH_RATE = 12000;
+
+/**
+ * @brief Constructor. Allocates storage for all packet slots up front.
+ *
+ * @param sampleRate sample rate of the decoded PCM
+ * @param minDelayMs lower bound of the adaptive playout delay
+ * @param maxDelayMs upper bound of the adaptive playout delay
+ */
+JitterBuffer::JitterBuffer(int sampleRate, double minDelayMs, double maxDelayMs) :
+        _sampleRate(sampleRate),
+        _frameSamples(sampleRate / 100),
+        _maxPacketSamples(sampleRate * 60 / 1000),
+        _minDelaySamples(minDelayMs * sampleRate / 1000.0),
+        _maxDelaySamples(maxDelayMs * sampleRate / 1000.0),
+        _slots(NUM_SLOTS),
+        _samples(NUM_SLOTS * _maxPacketSamples),
+        _minPitch(sampleRate / 400),
+        _maxPitch(sampleRate / 60),
+        _crossfadeSamples(msToSamples(CROSSFADE_MS)),
+        _decay(std::pow(0.5, 1.0 / _frameSamples)),
+        _history(2 * _maxPitch),
+        _concealBuf(_frameSamples),
+        _fadeBuf(_crossfadeSamples) {
+    clearStats();
+    reset();
+}
+
+/**
+ * @brief Zeroes the statistics and the jitter estimate, for a new session
+ */
+void JitterBuffer::clearStats() {
+    std::memset(&_stats, 0, sizeof(_stats));
+    _jitterMs = 0.0;
+}
+
+/**
+ * @brief Discards all buffered audio and playout state. Statistics and the
+ * jitter estimate are kept.
+ */
+void JitterBuffer::reset() {
+    for(auto &slot : _slots)
+        slot.used = false;
+    _numBuffered = 0;
+    _playing = false;
+    _nextSeq = 0;
+    _readOffset = 0;
+    _highestSeq = 0;
+    _haveHighest = false;
+    _haveTransit = false;
+    _lastTransitMs = 0.0;
+    _lastPacketSamples = 0;
+    std::fill(_history.begin(), _history.end(), 0);
+    _concealing = false;
+}
+
+/**
+ * @brief Stores a received packet.
+ *
+ * @param sequenceNumber Mumble sequence number of the packet
+ * @param pcm decoded PCM samples
+ * @param len number of samples, truncated to 60 ms
+ * @param arrival time the packet was received
+ */
+void JitterBuffer::push(int sequenceNumber, const int16_t *pcm, size_t len, TimePoint arrival) {
+    if(pcm == NULL || len == 0)
+        return;
+    len = std::min(len, _maxPacketSamples);
+
+    if(isIdle()) {
+        // new talk spurt: the silence gap is not jitter
+        _haveTransit = false;
+        _haveHighest = false;
+    }
+
+    if(_playing && sequenceNumber < _nextSeq) {
+        if(_nextSeq - sequenceNumber < RESYNC_FRAMES) {
+            _stats.late++;
+            return;
+        }
+        reset();
+    }
+    if(_playing && sequenceNumber > _nextSeq) {
+        // starts inside the packet being played, its first frames overlap it
+        Slot *current = findSlot(_nextSeq);
+        if(current != NULL && sequenceNumber < _nextSeq + current->frames) {
+            _stats.duplicates++;
+            return;
+        }
+    }
+
+    if(findSlot(sequenceNumber) != NULL) {
+        _stats.duplicates++;
+        return;
+    }
+    if(_haveHighest && sequenceNumber < _highestSeq)
+        _stats.reordered++;
+
+    Slot *slot = findFree();
+    if(slot == NULL) {
+        // full: make room by dropping the oldest packet, unless this one is older
+        Slot *earliest = findEarliest();
+        _stats.dropped++;
+        if(sequenceNumber < earliest->seq)
+            return;
+        if(_playing && earliest->seq <= _nextSeq) {
+            _nextSeq = earliest->seq + earliest->frames;
+            _readOffset = 0;
+        }
+        release(*earliest);
+        slot = earliest;
+    }
+
+    slot->used = true;
+    slot->seq = sequenceNumber;
+    slot->frames = std::max<size_t>(1, (len + _frameSamples / 2) / _frameSamples);
+    slot->len = len;
+    slot->arrival = arrival;
+    std::memcpy(slotSamples(*slot), pcm, len * sizeof(int16_t));
+    _numBuffered++;
+
+    if(!_haveHighest || sequenceNumber > _highestSeq) {
+        _highestSeq = sequenceNumber;
+        _haveHighest = true;
+    }
+    updateJitter(sequenceNumber, arrival);
+    _lastPacketSamples = len;
+    _stats.received++;
+}
+
+/**
+ * @brief Reads up to len samples in sequence order. Returns fewer than len
+ * (possibly 0) while buffering towards the target delay or when the buffer
+ * runs dry; the caller supplies silence for the rest. Frames lost before a
+ * buffered packet are concealed.
+ *
+ * @param dest destination buffer
+ * @param len number of samples wanted
+ * @param arrival if not NULL and samples were written, set to the time the
+ *                packet holding the first of them was received
+ * @return number of samples written to dest
+ */
+size_t JitterBuffer::pull(int16_t *dest, size_t len, TimePoint *arrival) {
+    if(!_playing) {
+        if(_numBuffered == 0)
+            return 0;
+        if(getDepth() < getStats().targetDelaySamples && findFree() != NULL)
+            return 0;
+        _playing = true;
+        _nextSeq = findEarliest()->seq;
+        _readOffset = 0;
+    }
+
+    size_t written = 0;
+    while(written < len) {
+        if(_readOffset == 0)
+            releasePlayed();
+        Slot *slot = findSlot(_nextSeq);
+        if(slot != NULL) {
+            const size_t n = std::min(len - written, slot->len - _readOffset);
+            if(written == 0 && arrival != NULL)
+                *arrival = slot->arrival;
+            std::memcpy(dest + written, slotSamples(*slot) + _readOffset, n * sizeof(int16_t));
+            if(_concealing) {
+                // fade from the concealment into the received audio
+                const size_t fade = std::min(n, _crossfadeSamples);
+                synthesize(_fadeBuf.data(), fade);
+                for(size_t i = 0; i < fade; i++) {
+                    const float w = (float) (i + 1) / (_crossfadeSamples + 1);
+                    dest[written + i] = (int16_t) (w * dest[written + i] + (1.0f - w) * _fadeBuf[i]);
+                }
+                _concealing = false;
+            }
+            remember(dest + written, n);
+            written += n;
+            _readOffset += n;
+            if(_readOffset == slot->len) {
+                _nextSeq += slot->frames;
+                _readOffset = 0;
+                release(*slot);
+            }
+        } else if(_numBuffered == 0) {
+            // ran dry, rebuffer to the target delay before playing again
+            _playing = false;
+            _stats.underruns++;
+            break;
+        } else if(_readOffset == 0 && findEarliest()->seq - _nextSeq > MAX_CONCEAL_FRAMES) {
+            // too long a gap to conceal, skip to the next buffered packet
+            Slot *next = findEarliest();
+            _stats.lost += next->seq - _nextSeq;
+            _nextSeq = next->seq;
+            _concealing = false;
+        } else {
+            // the frame never arrived, play a concealment frame in its place
+            if(_readOffset == 0) {
+                if(!_concealing)
+                    startConcealment();
+                synthesize(_concealBuf.data(), _frameSamples);
+                _stats.lost++;
+                _stats.concealed++;
+            }
+            const size_t n = std::min(len - written, _frameSamples - _readOffset);
+            if(written == 0 && arrival != NULL)
+                *arrival = findEarliest()->arrival;
+            std::memcpy(dest + written, _concealBuf.data() + _readOffset, n * sizeof(int16_t));
+            written += n;
+            _readOffset += n;
+            if(_readOffset == _frameSamples) {
+                _nextSeq++;
+                _readOffset = 0;
+            }
+        }
+    }
+    return written;
+}
+
+/**
+ * @brief Number of buffered samples not played yet
+ */
+size_t JitterBuffer::getDepth() const {
+    size_t depth = 0;
+    for(const auto &slot : _slots) {
+        if(slot.used)
+            depth += slot.len;
+    }
+    return _playing ? depth - _readOffset : depth;
+}
+
+/**
+ * @brief Returns the counters plus the current depth and target delay
+ */
+JitterBufferStats JitterBuffer::getStats() const {
+    JitterBufferStats stats = _stats;
+    stats.depthSamples = getDepth();
+    // one packet plus three times the jitter covers nearly all arrivals
+    const size_t target = _lastPacketSamples + msToSamples(3.0 * _jitterMs);
+    stats.targetDelaySamples = std::min(std::max(target, _minDelaySamples), _maxDelaySamples);
+    stats.jitterMs = _jitterMs;
+    return stats;
+}
+
+JitterBuffer::Slot* JitterBuffer::findSlot(int seq) {
+    for(auto &slot : _slots) {
+        if(slot.used && slot.seq == seq)
+            return &slot;
+    }
+    return NULL;
+}
+
+JitterBuffer::Slot* JitterBuffer::findEarliest() {
+    Slot *earliest = NULL;
+    for(auto &slot : _slots) {
+        if(slot.used && (earliest == NULL || slot.seq < earliest->seq))
+            earliest = &slot;
+    }
+    return earliest;
+}
+
+JitterBuffer::Slot* JitterBuffer::findFree() {
+    for(auto &slot : _slots) {
+        if(!slot.used)
+            return &slot;
+    }
+    return NULL;
+}
+
+void JitterBuffer::release(Slot &slot) {
+    slot.used = false;
+    _numBuffered--;
+}
+
+/**
+ * Releases packets starting behind the playout position. Those overlapping
+ * the one played before them were buffered before playout started, they can't
+ * be played in order and would otherwise never leave the buffer.
+ */
+void JitterBuffer::releasePlayed() {
+    for(auto &slot : _slots) {
+        if(slot.used && slot.seq < _nextSeq)
+            release(slot);
+    }
+}
+
+/**
+ * @brief Updates the interarrival jitter estimate as in RFC 3550 6.4.1, using
+ * the 10 ms sequence step as the media clock.
+ */
+void JitterBuffer::updateJitter(int seq, TimePoint arrival) {
+    const double arrivalMs = std::chrono::duration<double, std::milli>(arrival.time_since_epoch()).count();
+    const double transitMs = arrivalMs - seq * 10.0;
+    if(_haveTransit) {
+        const double d = std::fabs(transitMs - _lastTransitMs);
+        _jitterMs += (d - _jitterMs) / 16.0;
+    }
+    _lastTransitMs = transitMs;
+    _haveTransit = true;
+}
+
+size_t JitterBuffer::msToSamples(double ms) const {
+    return (size_t) (ms * _sampleRate / 1000.0);
+}
+
+/**
+ * Picks the pitch period to repeat: the lag between 2.5 and 16 ms with the
+ * highest normalized autocorrelation over the last _maxPitch samples played.
+ * Noise has no clear peak, repeating whatever period wins is good enough for
+ * it.
+ */
+void JitterBuffer::startConcealment() {
+    const size_t step = std::max(1, _sampleRate / PITCH_SEARCH_RATE);
+    const int16_t *recent = &_history[_history.size() - _maxPitch];
+    double best = -1.0;
+    _pitch = _maxPitch;
+    for(size_t lag = _minPitch; lag <= _maxPitch; lag += step) {
+        const int16_t *past = recent - lag;
+        double corr = 0.0, energy = 0.0;
+        for(size_t i = 0; i < _maxPitch; i += step) {
+            corr += (double) recent[i] * past[i];
+            energy += (double) past[i] * past[i];
+        }
+        const double score = energy > 0.0 ? corr / std::sqrt(energy) : 0.0;
+        if(score > best) {
+            best = score;
+            _pitch = lag;
+        }
+    }
+    _pitchPos = 0;
+    _concealedSamples = 0;
+    _gain = 1.0;
+    _concealing = true;
+}
+
+/**
+ * Writes the next len concealment samples: the last pitch period played,
+ * repeated, at full level for CONCEAL_HOLD_MS and then fading out.
+ */
+void JitterBuffer::synthesize(int16_t *dest, size_t len) {
+    const int16_t *period = &_history[_history.size() - _pitch];
+    const size_t hold = msToSamples(CONCEAL_HOLD_MS);
+    for(size_t i = 0; i < len; i++) {
+        if(_concealedSamples >= hold)
+            _gain *= _decay;
+        dest[i] = (int16_t) (_gain * period[_pitchPos]);
+        _pitchPos = _pitchPos + 1 < _pitch ? _pitchPos + 1 : 0;
+        _concealedSamples++;
+    }
+}
+
+/**
+ * Keeps the last samples received for the pitch search. Concealment isn't
+ * added, so the repeated period stays the last one received.
+ */
+void JitterBuffer::remember(const int16_t *pcm, size_t len) {
+    const size_t size = _history.size();
+    if(len >= size) {
+        std::memcpy(_history.data(), pcm + len - size, size * sizeof(int16_t));
+    } else {
+        std::memmove(_history.data(), _history.data() + len, (size - len) * sizeof(int16_t));
+        std::memcpy(_history.data() + size - len, pcm, len * sizeof(int16_t));
+    }
+}
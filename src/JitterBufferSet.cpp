@@ -0,0 +1,123 @@
+#include "JitterBufferSet.hpp"
+
+/**
+ * @brief Constructor. Allocates every speaker's jitter buffer up front.
+ *
+ * @param sampleRate  sample rate of the decoded PCM
+ * @param minDelayMs  lower bound of each speaker's playout delay
+ * @param maxDelayMs  upper bound of each speaker's playout delay
+ * @param maxSpeakers sessions that can be buffered at the same time
+ */
+JitterBufferSet::JitterBufferSet(int sampleRate, double minDelayMs, double maxDelayMs, size_t maxSpeakers) :
+        _speakers(maxSpeakers),
+        _pushes(0),
+        _rejected(0),
+        _speakerBuf(sampleRate / 10),
+        _mixer(sampleRate / 10) {
+    for(Speaker &speaker : _speakers) {
+        speaker.assigned = false;
+        speaker.sessionId = 0;
+        speaker.lastPush = 0;
+        speaker.buffer.reset(new JitterBuffer(sampleRate, minDelayMs, maxDelayMs));
+    }
+}
+
+/**
+ * @brief The session's speaker, or a free or the longest idle one for a new
+ * session, or NULL if every speaker is busy
+ */
+JitterBufferSet::Speaker* JitterBufferSet::findSpeaker(int sessionId) {
+    Speaker *reuse = NULL;
+    for(Speaker &speaker : _speakers) {
+        if(speaker.assigned && speaker.sessionId == sessionId)
+            return &speaker;
+        // a free speaker beats any idle one
+        if(reuse != NULL && !reuse->assigned)
+            continue;
+        if(!speaker.assigned || (speaker.buffer->isIdle() && (reuse == NULL || speaker.lastPush < reuse->lastPush)))
+            reuse = &speaker;
+    }
+    if(reuse != NULL) {
+        // the previous session's statistics go with it
+        reuse->buffer->reset();
+        reuse->buffer->clearStats();
+        reuse->assigned = true;
+        reuse->sessionId = sessionId;
+    }
+    return reuse;
+}
+
+/**
+ * @brief Stores a received packet in the session's jitter buffer, taking a
+ * buffer from the pool on the session's first packet.
+ *
+ * @param sessionId      session of the speaker
+ * @param sequenceNumber sequence number of the packet
+ * @param pcm            decoded PCM samples
+ * @param len            number of samples
+ */
+void JitterBufferSet::push(int sessionId, int sequenceNumber, const int16_t *pcm, size_t len) {
+    const JitterBuffer::TimePoint arrival = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(_mutex);
+    Speaker *speaker = findSpeaker(sessionId);
+    if(speaker == NULL) {
+        _rejected++;
+        return;
+    }
+    speaker->lastPush = ++_pushes;
+    speaker->buffer->push(sequenceNumber, pcm, len, arrival);
+}
+
+/**
+ * @brief Pulls len samples from every active speaker and mixes them.
+ * dest is always fully written, with silence where no speaker has audio.
+ *
+ * @param dest destination buffer
+ * @param len number of samples to produce
+ * @param oldestArrival if not NULL and any speaker contributed, set to the
+ *                      earliest receive time of the packets played
+ * @return number of speakers that contributed audio
+ */
+size_t JitterBufferSet::pull(int16_t *dest, size_t len, JitterBuffer::TimePoint *oldestArrival) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_speakerBuf.size() < len)
+        _speakerBuf.resize(len);
+
+    _mixer.clear(len);
+    for(Speaker &speaker : _speakers) {
+        if(!speaker.assigned || speaker.buffer->isIdle())
+            continue;
+        JitterBuffer::TimePoint arrival;
+        const size_t n = speaker.buffer->pull(_speakerBuf.data(), len, &arrival);
+        if(n > 0) {
+            if(oldestArrival != NULL && (_mixer.getSourceCount() == 0 || arrival < *oldestArrival))
+                *oldestArrival = arrival;
+            _mixer.add(_speakerBuf.data(), n);
+        }
+    }
+    _mixer.mixTo(dest);
+    return _mixer.getSourceCount();
+}
+
+/**
+ * @brief Returns a snapshot of the statistics of every session holding a
+ * jitter buffer
+ */
+std::map<int, JitterBufferStats> JitterBufferSet::getStats() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::map<int, JitterBufferStats> stats;
+    for(Speaker &speaker : _speakers) {
+        if(speaker.assigned)
+            stats[speaker.sessionId] = speaker.buffer->getStats();
+    }
+    return stats;
+}
+
+/**
+ * @brief Packets dropped because every jitter buffer was busy with another
+ * session
+ */
+uint64_t JitterBufferSet::getRejectedPackets() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _rejected;
+}
@@ -0,0 +1,95 @@
+#include "LatencyHistogram.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Constructor
+ *
+ * @param name name of the measured stage, used when reporting
+ */
+LatencyHistogram::LatencyHistogram(const std::string &name) :
+        _name(name),
+        _count(0),
+        _sum(0),
+        _max(0) {
+    for(auto &bucket : _buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records one latency. Negative values count as 0. Real-time safe.
+ *
+ * @param us latency in microseconds
+ */
+void LatencyHistogram::record(int64_t us) {
+    const uint64_t value = us > 0 ? (uint64_t) us : 0;
+    _buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = _max.load(std::memory_order_relaxed);
+    while(value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Returns count, mean, p50, p99 and max. Percentiles are the middle
+ * of their bucket. Recording can continue meanwhile, the summary is then
+ * approximately consistent.
+ */
+LatencySummary LatencyHistogram::getSummary() const {
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total = 0;
+    for(size_t i = 0; i < NUM_BUCKETS; i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    LatencySummary summary;
+    summary.count = total;
+    summary.maxUs = _max.load(std::memory_order_relaxed);
+    summary.meanUs = total > 0 ? (double) _sum.load(std::memory_order_relaxed) / total : 0.0;
+    summary.p50Us = std::min(percentile(counts, total, 0.50), summary.maxUs);
+    summary.p99Us = std::min(percentile(counts, total, 0.99), summary.maxUs);
+    return summary;
+}
+
+double LatencyHistogram::percentile(const uint64_t *counts, uint64_t total, double fraction) const {
+    if(total == 0)
+        return 0.0;
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t) (fraction * total + 0.5));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += counts[i];
+        if(seen >= rank) {
+            const uint64_t low = bucketLowerBound(i);
+            const uint64_t high = i + 1 < NUM_BUCKETS ? bucketLowerBound(i + 1) : low + 1;
+            return (low + high - 1) / 2.0;
+        }
+    }
+    return 0.0;
+}
+
+/**
+ * @brief Bucket holding a latency. Values below 16 us get a bucket each,
+ * above that each power of 2 is split into 16 buckets.
+ */
+size_t LatencyHistogram::bucketIndex(uint64_t us) {
+    const uint64_t SUB_BUCKETS = 1u << SUB_BITS;
+    us = std::min(us, (UINT64_C(1) << MAX_BITS) - 1);
+    if(us < SUB_BUCKETS)
+        return us;
+    const unsigned msb = 63 - __builtin_clzll(us);
+    return ((msb - SUB_BITS + 1) << SUB_BITS) + ((us >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Smallest latency that falls into a bucket
+ */
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    const uint64_t SUB_BUCKETS = 1u << SUB_BITS;
+    if(index < SUB_BUCKETS)
+        return index;
+    const unsigned msb = (index >> SUB_BITS) + SUB_BITS - 1;
+    return (SUB_BUCKETS + (index & (SUB_BUCKETS - 1))) << (msb - SUB_BITS);
+}
@@ -0,0 +1,36 @@
+#include "LogRateLimiter.hpp"
+
+#include <limits>
+
+/**
+ * @brief Constructor
+ *
+ * @param maxPerSecond messages allowed per second, evenly spaced
+ */
+LogRateLimiter::LogRateLimiter(double maxPerSecond) :
+        _intervalNs(maxPerSecond > 0.0 ? (int64_t) (1e9 / maxPerSecond) : std::numeric_limits<int64_t>::max() / 2),
+        _nextNs(std::numeric_limits<int64_t>::min()),
+        _suppressed(0) {
+}
+
+/**
+ * @brief Decides whether to log now
+ *
+ * @param suppressed set to the number of messages suppressed since the last
+ *                   one allowed, when returning true
+ * @return true if the message should be logged
+ */
+bool LogRateLimiter::allow(uint64_t &suppressed) {
+    return allow(suppressed, std::chrono::steady_clock::now());
+}
+
+bool LogRateLimiter::allow(uint64_t &suppressed, std::chrono::steady_clock::time_point now) {
+    const int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    int64_t next = _nextNs.load(std::memory_order_relaxed);
+    if(nowNs < next || !_nextNs.compare_exchange_strong(next, nowNs + _intervalNs, std::memory_order_relaxed)) {
+        _suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,117 @@
+#include "LogRecord.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+void LogRecord::add(const char *str) {
+    if(numArgs == MAX_ARGS)
+        return;
+    LogArg &arg = args[numArgs++];
+    arg.type = LogArg::STRING;
+    arg.textOffset = textUsed;
+    if(str == NULL)
+        str = "(null)";
+    const size_t len = std::min(std::strlen(str), TEXT_SIZE - 1 - textUsed);
+    std::memcpy(text + textUsed, str, len);
+    textUsed += len;
+    text[textUsed] = '\0';
+    if(textUsed < TEXT_SIZE - 1)
+        textUsed++;
+}
+
+void LogRecord::add(double val) {
+    if(numArgs == MAX_ARGS)
+        return;
+    LogArg &arg = args[numArgs++];
+    arg.type = LogArg::DOUBLE;
+    arg.d = val;
+}
+
+/**
+ * @brief Formats the message like snprintf would have at capture time.
+ * Conversions without a matching argument are printed as-is.
+ *
+ * @param dest destination buffer
+ * @param size size of dest
+ * @return length of the formatted message, truncated to size - 1
+ */
+size_t LogRecord::formatTo(char *dest, size_t size) const {
+    if(size == 0)
+        return 0;
+    size_t len = 0;
+    size_t nextArg = 0;
+    const char *p = format;
+
+    // appends up to n chars of src, always leaving dest terminated
+    auto append = [&](const char *src, size_t n) {
+        n = std::min(n, size - 1 - len);
+        std::memcpy(dest + len, src, n);
+        len += n;
+    };
+
+    while(*p != '\0' && len < size - 1) {
+        const char *percent = std::strchr(p, '%');
+        if(percent == NULL) {
+            append(p, std::strlen(p));
+            break;
+        }
+        append(p, percent - p);
+        if(percent[1] == '%') {
+            append("%", 1);
+            p = percent + 2;
+            continue;
+        }
+
+        // copy flags, width and precision; drop length modifiers
+        char spec[32];
+        size_t specLen = 0;
+        const char *q = percent;
+        spec[specLen++] = *q++;
+        while(*q != '\0' && std::strchr("-+ #0123456789.", *q) != NULL && specLen < 24)
+            spec[specLen++] = *q++;
+        while(*q != '\0' && std::strchr("hlLqjzt", *q) != NULL)
+            q++;
+        const char conversion = *q;
+        if(conversion == '\0' || nextArg == numArgs) {
+            append(percent, (conversion == '\0' ? q : q + 1) - percent);
+            p = conversion == '\0' ? q : q + 1;
+            continue;
+        }
+        p = q + 1;
+
+        const LogArg &arg = args[nextArg++];
+        char piece[128];
+        int n = 0;
+        if(std::strchr("diouxXc", conversion) != NULL) {
+            spec[specLen++] = 'l';
+            spec[specLen++] = 'l';
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            if(arg.type == LogArg::DOUBLE)
+                n = snprintf(piece, sizeof(piece), spec, (long long) arg.d);
+            else if(arg.type == LogArg::STRING)
+                n = snprintf(piece, sizeof(piece), "%s", text + arg.textOffset);
+            else
+                n = snprintf(piece, sizeof(piece), spec, arg.i);
+        } else if(std::strchr("eEfFgGaA", conversion) != NULL) {
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            const double val = arg.type == LogArg::DOUBLE ? arg.d :
+                               arg.type == LogArg::INT ? (double) arg.i :
+                               arg.type == LogArg::UINT ? (double) arg.u : 0.0;
+            n = snprintf(piece, sizeof(piece), spec, val);
+        } else if(conversion == 's' && arg.type == LogArg::STRING) {
+            spec[specLen++] = 's';
+            spec[specLen] = '\0';
+            n = snprintf(piece, sizeof(piece), spec, text + arg.textOffset);
+        } else {
+            append(percent, p - percent);
+            continue;
+        }
+        if(n > 0)
+            append(piece, std::min((size_t) n, sizeof(piece) - 1));
+    }
+    dest[len] = '\0';
+    return len;
+}
@@ -0,0 +1,124 @@
+#include "Mixer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_NEON 1
+#endif
+
+/**
+ * @brief Constructor. Allocates the accumulator up front.
+ *
+ * @param maxFrameSize largest frame that will be mixed, in samples
+ */
+Mixer::Mixer(size_t maxFrameSize) :
+        _acc(maxFrameSize, 0),
+        _len(0),
+        _sources(0) {
+}
+
+/**
+ * @brief Starts a new frame of len samples. Frames longer than maxFrameSize
+ * grow the accumulator.
+ */
+void Mixer::clear(size_t len) {
+    if(len > _acc.size())
+        _acc.resize(len);
+    _len = len;
+    _sources = 0;
+    std::memset(_acc.data(), 0, _len * sizeof(int32_t));
+}
+
+/**
+ * @brief Adds a source to the frame. A source shorter than the frame is
+ * treated as silence for the rest of it.
+ *
+ * @param src source samples
+ * @param len number of samples in src
+ */
+void Mixer::add(const int16_t *src, size_t len) {
+    accumulate(_acc.data(), src, std::min(len, _len));
+    _sources++;
+}
+
+/**
+ * @brief Writes the saturated mix of all added sources to dest
+ *
+ * @param dest destination buffer of at least the frame length
+ */
+void Mixer::mixTo(int16_t *dest) const {
+    saturate(dest, _acc.data(), _len);
+}
+
+/**
+ * @brief acc[i] += src[i]
+ */
+void Mixer::accumulate(int32_t *acc, const int16_t *src, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for(; i + 8 <= len; i += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+        // sign-extend by placing each sample in the high half and shifting down
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        __m128i *a = (__m128i*) (acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), lo));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), hi));
+    }
+#elif defined(MIXER_NEON)
+    for(; i + 8 <= len; i += 8) {
+        const int16x8_t s = vld1q_s16(src + i);
+        vst1q_s32(acc + i, vaddw_s16(vld1q_s32(acc + i), vget_low_s16(s)));
+        vst1q_s32(acc + i + 4, vaddw_s16(vld1q_s32(acc + i + 4), vget_high_s16(s)));
+    }
+#endif
+    accumulateScalar(acc + i, src + i, len - i);
+}
+
+/**
+ * @brief dest[i] = acc[i] clamped to the int16 range
+ */
+void Mixer::saturate(int16_t *dest, const int32_t *acc, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for(; i + 8 <= len; i += 8) {
+        const __m128i lo = _mm_loadu_si128((const __m128i*) (acc + i));
+        const __m128i hi = _mm_loadu_si128((const __m128i*) (acc + i + 4));
+        _mm_storeu_si128((__m128i*) (dest + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(MIXER_NEON)
+    for(; i + 8 <= len; i += 8) {
+        const int16x4_t lo = vqmovn_s32(vld1q_s32(acc + i));
+        const int16x4_t hi = vqmovn_s32(vld1q_s32(acc + i + 4));
+        vst1q_s16(dest + i, vcombine_s16(lo, hi));
+    }
+#endif
+    saturateScalar(dest + i, acc + i, len - i);
+}
+
+void Mixer::accumulateScalar(int32_t *acc, const int16_t *src, size_t len) {
+    for(size_t i = 0; i < len; i++)
+        acc[i] += src[i];
+}
+
+void Mixer::saturateScalar(int16_t *dest, const int32_t *acc, size_t len) {
+    for(size_t i = 0; i < len; i++)
+        dest[i] = (int16_t) std::min<int32_t>(INT16_MAX, std::max<int32_t>(INT16_MIN, acc[i]));
+}
+
+/**
+ * @brief Name of the kernel set compiled in: "sse2", "neon" or "scalar"
+ */
+const char* Mixer::getKernelName() {
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(MIXER_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,80 @@
+#include "MumbleService.hpp"
+
+#include "Bridge.hpp"
+
+// how often connections are checked and retried
+static const std::chrono::seconds CHECK_INTERVAL(1);
+
+MumbleService::MumbleService() :
+        _timer(_ioService),
+        _stopping(false) {
+}
+
+MumbleService::~MumbleService() {
+    stop();
+}
+
+/**
+ * @brief Adds a bridge whose Mumlib was created on getIoService(). Must be
+ * called before start().
+ */
+void MumbleService::add(Bridge &bridge) {
+    _bridges.push_back(&bridge);
+}
+
+/**
+ * @brief Connects all bridges and starts the network thread
+ */
+void MumbleService::start() {
+    _work.reset(new boost::asio::io_service::work(_ioService));
+    _ioService.post([this]() { checkConnections(); });
+    _thread = std::thread(&MumbleService::run, this);
+}
+
+/**
+ * @brief Disconnects all bridges and waits for the network thread, which
+ * exits once mumlib has no more work
+ */
+void MumbleService::stop() {
+    if(!_thread.joinable())
+        return;
+    _ioService.post([this]() {
+        _stopping = true;
+        _timer.cancel();
+        for(Bridge *bridge : _bridges)
+            bridge->disconnect();
+    });
+    _work.reset();
+    _thread.join();
+}
+
+void MumbleService::scheduleCheck() {
+    _timer.expires_from_now(CHECK_INTERVAL);
+    _timer.async_wait([this](const boost::system::error_code &error) {
+        if(!error)
+            checkConnections();
+    });
+}
+
+void MumbleService::checkConnections() {
+    if(_stopping)
+        return;
+    const Bridge::Clock::time_point now = Bridge::Clock::now();
+    for(Bridge *bridge : _bridges)
+        bridge->maintainConnection(now);
+    scheduleCheck();
+}
+
+void MumbleService::run() {
+    while(true) {
+        try {
+            _ioService.run();
+            return;
+        } catch (mumlib::TransportException &exp) {
+            const Bridge::Clock::time_point now = Bridge::Clock::now();
+            for(Bridge *bridge : _bridges)
+                bridge->connectionFailed(now, exp.what());
+            _ioService.reset();
+        }
+    }
+}
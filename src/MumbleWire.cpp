@@ -0,0 +1,224 @@
+#include "MumbleWire.hpp"
+
+#include <algorithm>
+#include "MumbleWireException.hpp"
+
+void ProtoWriter::addVarint(int field, uint64_t val) {
+    putVarint((uint64_t) field << 3 | ProtoReader::VARINT);
+    putVarint(val);
+}
+
+void ProtoWriter::addString(int field, const std::string &str) {
+    addBytes(field, (const uint8_t*) str.data(), str.size());
+}
+
+void ProtoWriter::addBytes(int field, const uint8_t *data, size_t len) {
+    putVarint((uint64_t) field << 3 | ProtoReader::LENGTH_DELIMITED);
+    putVarint(len);
+    _data.insert(_data.end(), data, data + len);
+}
+
+void ProtoWriter::putVarint(uint64_t val) {
+    while(val >= 0x80) {
+        _data.push_back((uint8_t) (val | 0x80));
+        val >>= 7;
+    }
+    _data.push_back((uint8_t) val);
+}
+
+ProtoReader::ProtoReader(const uint8_t *data, size_t len) :
+        _data(data),
+        _len(len),
+        _pos(0),
+        _field(0),
+        _wireType(VARINT),
+        _varint(0),
+        _bytes(NULL),
+        _bytesLen(0) {
+}
+
+/**
+ * @brief Advances to the next field
+ *
+ * @return false at the end of the message
+ * @throws MumbleWireException if the message is truncated or uses a wire
+ *         type Mumble doesn't
+ */
+bool ProtoReader::next() {
+    if(_pos >= _len)
+        return false;
+    const uint64_t key = readVarint();
+    _field = (int) (key >> 3);
+    _wireType = (WireType) (key & 7);
+    switch(_wireType) {
+    case VARINT:
+        _varint = readVarint();
+        break;
+    case FIXED64:
+    case FIXED32: {
+        const size_t size = _wireType == FIXED64 ? 8 : 4;
+        if(_len - _pos < size)
+            throw MumbleWireException("Truncated protobuf fixed field");
+        _varint = 0;
+        for(size_t i = 0; i < size; i++)
+            _varint |= (uint64_t) _data[_pos + i] << (8 * i);
+        _pos += size;
+        break;
+    }
+    case LENGTH_DELIMITED: {
+        const uint64_t size = readVarint();
+        if(size > _len - _pos)
+            throw MumbleWireException("Truncated protobuf field");
+        _bytes = _data + _pos;
+        _bytesLen = size;
+        _pos += size;
+        break;
+    }
+    default:
+        throw MumbleWireException("Unsupported protobuf wire type " + std::to_string((int) _wireType));
+    }
+    return true;
+}
+
+/**
+ * @brief Contents of the current LENGTH_DELIMITED field
+ */
+std::string ProtoReader::getString() const {
+    if(_wireType != LENGTH_DELIMITED)
+        return std::string();
+    return std::string((const char*) _bytes, _bytesLen);
+}
+
+uint64_t ProtoReader::readVarint() {
+    uint64_t val = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        if(_pos >= _len)
+            throw MumbleWireException("Truncated protobuf varint");
+        const uint8_t byte = _data[_pos++];
+        val |= (uint64_t) (byte & 0x7f) << shift;
+        if((byte & 0x80) == 0)
+            return val;
+    }
+    throw MumbleWireException("Protobuf varint too long");
+}
+
+/**
+ * @brief Prefixes a control message with its type and length
+ */
+std::vector<uint8_t> MumbleWire::frame(MumbleMessageType type, const std::vector<uint8_t> &payload) {
+    std::vector<uint8_t> message(HEADER_SIZE + payload.size());
+    const uint16_t t = (uint16_t) type;
+    const uint32_t len = payload.size();
+    message[0] = t >> 8;
+    message[1] = t;
+    message[2] = len >> 24;
+    message[3] = len >> 16;
+    message[4] = len >> 8;
+    message[5] = len;
+    std::copy(payload.begin(), payload.end(), message.begin() + HEADER_SIZE);
+    return message;
+}
+
+/**
+ * @brief Reads the type and payload length from a control message header
+ *
+ * @param header HEADER_SIZE bytes
+ */
+void MumbleWire::parseHeader(const uint8_t *header, uint16_t &type, uint32_t &len) {
+    type = (uint16_t) (header[0] << 8 | header[1]);
+    len = (uint32_t) header[2] << 24 | (uint32_t) header[3] << 16 | (uint32_t) header[4] << 8 | header[5];
+}
+
+/**
+ * @brief Encodes val in Mumble's voice packet varint format, which unlike
+ * protobuf's puts the length in the leading bits of the first byte
+ *
+ * @param dest at least MAX_VARINT_SIZE bytes
+ * @return number of bytes written
+ */
+size_t MumbleWire::writeVarint(int64_t val, uint8_t *dest) {
+    if(val < 0) {
+        if(val >= -4) {
+            dest[0] = 0xfc | (uint8_t) (~val);
+            return 1;
+        }
+        dest[0] = 0xf8;
+        return 1 + writeVarint(~val, dest + 1);
+    }
+    const uint64_t v = (uint64_t) val;
+    if(v < 0x80) {
+        dest[0] = v;
+        return 1;
+    } else if(v < 0x4000) {
+        dest[0] = 0x80 | (v >> 8);
+        dest[1] = v;
+        return 2;
+    } else if(v < 0x200000) {
+        dest[0] = 0xc0 | (v >> 16);
+        dest[1] = v >> 8;
+        dest[2] = v;
+        return 3;
+    } else if(v < 0x10000000) {
+        dest[0] = 0xe0 | (v >> 24);
+        dest[1] = v >> 16;
+        dest[2] = v >> 8;
+        dest[3] = v;
+        return 4;
+    } else if(v < 0x100000000ULL) {
+        dest[0] = 0xf0;
+        for(int i = 0; i < 4; i++)
+            dest[1 + i] = v >> (24 - 8 * i);
+        return 5;
+    }
+    dest[0] = 0xf4;
+    for(int i = 0; i < 8; i++)
+        dest[1 + i] = v >> (56 - 8 * i);
+    return 9;
+}
+
+/**
+ * @brief Decodes a Mumble voice packet varint
+ *
+ * @return number of bytes read
+ * @throws MumbleWireException if src is truncated
+ */
+size_t MumbleWire::readVarint(const uint8_t *src, size_t len, int64_t &val) {
+    if(len == 0)
+        throw MumbleWireException("Truncated voice varint");
+    const uint8_t b = src[0];
+    size_t size;
+    uint64_t v;
+    if((b & 0x80) == 0x00) {
+        val = b;
+        return 1;
+    } else if((b & 0xc0) == 0x80) {
+        size = 2;
+        v = b & 0x3f;
+    } else if((b & 0xe0) == 0xc0) {
+        size = 3;
+        v = b & 0x1f;
+    } else if((b & 0xf0) == 0xe0) {
+        size = 4;
+        v = b & 0x0f;
+    } else if((b & 0xfc) == 0xf0) {
+        size = 5;
+        v = 0;
+    } else if((b & 0xfc) == 0xf4) {
+        size = 9;
+        v = 0;
+    } else if((b & 0xfc) == 0xf8) {
+        int64_t inner;
+        const size_t used = readVarint(src + 1, len - 1, inner);
+        val = ~inner;
+        return 1 + used;
+    } else {
+        val = ~(int64_t) (b & 0x03);
+        return 1;
+    }
+    if(len < size)
+        throw MumbleWireException("Truncated voice varint");
+    for(size_t i = 1; i < size; i++)
+        v = v << 8 | src[i];
+    val = (int64_t) v;
+    return size;
+}
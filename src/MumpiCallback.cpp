@@ -1,8 +1,17 @@
 #include "MumpiCallback.hpp"
 
+#include "AudioPipeline.hpp"
 
-MumpiCallback::MumpiCallback(std::shared_ptr<RingBuffer<int16_t>> out_buf) :
-        _out_buf(out_buf) {
+
+// per-packet messages logged at most this often
+static const double AUDIO_LOG_RATE = 1.0;  // per second
+
+MumpiCallback::MumpiCallback(std::shared_ptr<JitterBufferSet> speakers, AsyncLogger &asyncLogger,
+                             Recorder *recorder) :
+        _speakers(speakers),
+        _asyncLogger(asyncLogger),
+        _recorder(recorder),
+        _audioLogLimit(AUDIO_LOG_RATE) {
 }
 
 MumpiCallback::~MumpiCallback() {
@@ -26,10 +35,11 @@ void MumpiCallback::serverSync(std::string welcome_text,
 }
 
 /**
- * Handles received audio packets and pushes them to the circular buffer
+ * Handles received audio packets and pushes them to the speaker's jitter buffer,
+ * and to the recorder in arrival order
  *
  * @param target         target
- * @param sessionId      session ifndef
+ * @param sessionId      session id of the speaker
  * @param sequenceNumber sequence number
  * @param pcm_data       raw PCM data (int16_t)
  * @param pcm_data_size  PCM data buf size
@@ -39,9 +49,12 @@ void MumpiCallback::audio(int target,
                           int sequenceNumber,
                           int16_t *pcm_data,
                           uint32_t pcm_data_size) {
-    _logger.info("Received audio: pcm_data_size: %d", pcm_data_size);
+    _asyncLogger.log(_audioLogLimit, _logger, log4cpp::Priority::INFO,
+                     "Received audio: session %d pcm_data_size: %u", sessionId, pcm_data_size);
     if(pcm_data != NULL) {
-        _out_buf->push(pcm_data, 0, pcm_data_size);
+        _speakers->push(sessionId, sequenceNumber, pcm_data, pcm_data_size);
+        if(_recorder != NULL)
+            _recorder->recordReceived(sessionId, pcm_data, pcm_data_size, AudioPipeline::steadySeconds());
     }
 }
 
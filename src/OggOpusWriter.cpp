@@ -0,0 +1,163 @@
+#include "OggOpusWriter.hpp"
+
+static const size_t MAX_SEGMENTS = 255;
+
+static void putLe16(std::vector<unsigned char> &out, uint16_t val) {
+    out.push_back(val & 0xff);
+    out.push_back(val >> 8);
+}
+
+static void putLe32(std::vector<unsigned char> &out, uint32_t val) {
+    for(int i = 0; i < 4; i++)
+        out.push_back((val >> (8 * i)) & 0xff);
+}
+
+static void putLe64(std::vector<unsigned char> &out, uint64_t val) {
+    for(int i = 0; i < 8; i++)
+        out.push_back((val >> (8 * i)) & 0xff);
+}
+
+static void putString(std::vector<unsigned char> &out, const std::string &str) {
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+/**
+ * @brief Constructor, writes the two header pages
+ *
+ * @param serial          the logical stream's serial number, should be random
+ * @param inputSampleRate rate the audio was encoded from, informational
+ * @param preSkip         48 kHz samples to discard at the start, the
+ *                        encoder's lookahead
+ * @param vendor          encoder name for OpusTags
+ * @param comments        "KEY=value" tags
+ */
+OggOpusWriter::OggOpusWriter(uint32_t serial,
+                             int inputSampleRate,
+                             int preSkip,
+                             const std::string &vendor,
+                             const std::vector<std::string> &comments) :
+        _serial(serial),
+        _sequence(0),
+        _granule(0),
+        _pageStart(0),
+        _finished(false) {
+    std::vector<unsigned char> head;
+    putString(head, "OpusHead");
+    head.push_back(1);              // version
+    head.push_back(1);              // channels
+    putLe16(head, (uint16_t) preSkip);
+    putLe32(head, (uint32_t) inputSampleRate);
+    putLe16(head, 0);               // output gain
+    head.push_back(0);              // mapping family: mono or stereo, no table
+    addPacket(head.data(), head.size());
+    writePage(BEGIN_OF_STREAM);
+
+    // audio starts on a fresh page
+    std::vector<unsigned char> tags;
+    putString(tags, "OpusTags");
+    putLe32(tags, (uint32_t) vendor.size());
+    putString(tags, vendor);
+    putLe32(tags, (uint32_t) comments.size());
+    for(const std::string &comment : comments) {
+        putLe32(tags, (uint32_t) comment.size());
+        putString(tags, comment);
+    }
+    addPacket(tags.data(), tags.size());
+    writePage(0);
+}
+
+/**
+ * @brief Adds one Opus packet
+ *
+ * @param packet  the packet, as opus_encode() produced it
+ * @param len     its length, at most MAX_PACKET_BYTES
+ * @param samples its duration in 48 kHz samples
+ * @return false if the packet is too long or the stream is finished
+ */
+bool OggOpusWriter::writePacket(const unsigned char *packet, size_t len, int samples) {
+    if(_finished || len > MAX_PACKET_BYTES)
+        return false;
+    if(_lacing.size() + len / 255 + 1 > MAX_SEGMENTS)
+        flush();
+    addPacket(packet, len);
+    _granule += samples;
+    if(_granule - _pageStart >= MAX_PAGE_DURATION)
+        flush();
+    return true;
+}
+
+/**
+ * @brief Completes the open page, if it has packets, so getPages() returns
+ * everything written so far
+ */
+void OggOpusWriter::flush() {
+    if(!_lacing.empty() && !_finished)
+        writePage(0);
+}
+
+/**
+ * @brief Completes the stream with an end-of-stream page. Packets can't be
+ * added afterwards.
+ */
+void OggOpusWriter::finish() {
+    if(_finished)
+        return;
+    // an empty last page is allowed and just carries the flag
+    writePage(END_OF_STREAM);
+    _finished = true;
+}
+
+void OggOpusWriter::addPacket(const unsigned char *packet, size_t len) {
+    // lacing values of 255 continue the packet, a shorter one ends it
+    for(size_t left = len; ; left -= 255) {
+        _lacing.push_back((unsigned char) (left < 255 ? left : 255));
+        if(left < 255)
+            break;
+    }
+    _body.insert(_body.end(), packet, packet + len);
+}
+
+void OggOpusWriter::writePage(uint8_t flags) {
+    const size_t start = _pages.size();
+    putString(_pages, "OggS");
+    _pages.push_back(0);            // version
+    _pages.push_back(flags);
+    putLe64(_pages, _granule);
+    putLe32(_pages, _serial);
+    putLe32(_pages, _sequence++);
+    putLe32(_pages, 0);             // CRC, filled in below
+    _pages.push_back((unsigned char) _lacing.size());
+    _pages.insert(_pages.end(), _lacing.begin(), _lacing.end());
+    _pages.insert(_pages.end(), _body.begin(), _body.end());
+
+    const uint32_t crc = checksum(&_pages[start], _pages.size() - start);
+    for(int i = 0; i < 4; i++)
+        _pages[start + 22 + i] = (crc >> (8 * i)) & 0xff;
+
+    _lacing.clear();
+    _body.clear();
+    _pageStart = _granule;
+}
+
+/**
+ * @brief Ogg's CRC-32: polynomial 0x04c11db7, not reflected, starting from
+ * 0 with no final XOR
+ */
+uint32_t OggOpusWriter::checksum(const unsigned char *data, size_t len) {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for(uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i << 24;
+                for(int bit = 0; bit < 8; bit++)
+                    crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+                entries[i] = crc;
+            }
+        }
+    } table;
+
+    uint32_t crc = 0;
+    for(size_t i = 0; i < len; i++)
+        crc = (crc << 8) ^ table.entries[((crc >> 24) ^ data[i]) & 0xff];
+    return crc;
+}
@@ -0,0 +1,342 @@
+#include "PortAudioBackend.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "AudioBackendException.hpp"
+
+static const char *const STREAM_NAMES[] = { "duplex", "input", "output" };
+enum { DUPLEX_STREAM, INPUT_STREAM, OUTPUT_STREAM };
+
+// per-callback messages logged at most this often
+static const double OUTPUT_LOG_RATE = 1.0;    // per second
+
+/**
+ * @brief Constructor
+ *
+ * @param outputDelay     suggested output latency in seconds, negative for
+ *                        the output device's default high latency
+ * @param fullDuplex      true to try a single full-duplex stream
+ * @param framesPerBuffer frames per PortAudio callback
+ * @param asyncLogger     logger usable from the callbacks
+ * @param inputDevice     input device index or part of its name, empty for
+ *                        the default input device
+ * @param outputDevice    output device index or part of its name, empty for
+ *                        the default output device
+ * @param pipelines       bridges sharing the devices, see start()
+ */
+PortAudioBackend::PortAudioBackend(double outputDelay,
+                                   bool fullDuplex,
+                                   unsigned long framesPerBuffer,
+                                   AsyncLogger &asyncLogger,
+                                   const std::string &inputDevice,
+                                   const std::string &outputDevice,
+                                   size_t pipelines) :
+        _inputDevice(inputDevice),
+        _outputDevice(outputDevice),
+        _outputDelay(outputDelay),
+        _fullDuplex(fullDuplex),
+        _framesPerBuffer(framesPerBuffer),
+        _asyncLogger(asyncLogger),
+        _outputLogLimit(OUTPUT_LOG_RATE),
+        _pipelines(pipelines),
+        _initialized(false) {
+    for(int i = 0; i < NUM_STREAMS; i++) {
+        _streams[i] = NULL;
+        _callbackThreads[i].tuned = false;
+    }
+}
+
+PortAudioBackend::~PortAudioBackend() {
+    stop();
+}
+
+/**
+ * Record callback for PortAudio engine. This gets called when audio input is
+ * available and hands it to the pipelines, which queue it for the encoder.
+ *
+ * @param  inputBuffer     input sample buffer (interleaved if multi channel)
+ * @param  outputBuffer    output sample buffer (interleaved if multi channel)
+ * @param  framesPerBuffer number of frames per buffer
+ * @param  timeInfo        time information for stream
+ * @param  statusFlags     i/o buffer status flags
+ * @param  userData        the PortAudioBackend
+ * @return                 PaStreamCallbackResult, paContinue usually
+ */
+int PortAudioBackend::recordCallback(const void *inputBuffer,
+                                     void *outputBuffer,
+                                     unsigned long framesPerBuffer,
+                                     const PaStreamCallbackTimeInfo* timeInfo,
+                                     PaStreamCallbackFlags statusFlags,
+                                     void *userData) {
+    PortAudioBackend *backend = (PortAudioBackend*) userData;
+    (void) outputBuffer;
+    (void) statusFlags;
+
+    backend->tuneCallbackThread(backend->_streams[DUPLEX_STREAM] != NULL ? DUPLEX_STREAM : INPUT_STREAM);
+
+    backend->_pipelines.capture((const int16_t*) inputBuffer, framesPerBuffer,
+                                timeInfo != NULL ? timeInfo->inputBufferAdcTime : 0.0,
+                                timeInfo != NULL ? timeInfo->currentTime : 0.0);
+    return paContinue;
+}
+
+/**
+ * Output callback for PortAudio engine. This gets called when audio output is
+ * ready to be sent and fills it from the pipelines, with silence on underrun.
+ *
+ * @param  inputBuffer     input sample buffer (interleaved if multi channel)
+ * @param  outputBuffer    output sample buffer (interleaved if multi channel)
+ * @param  framesPerBuffer number of frames per buffer
+ * @param  timeInfo        time information for stream
+ * @param  statusFlags     i/o buffer status flags
+ * @param  userData        the PortAudioBackend
+ * @return                 PaStreamCallbackResult, paContinue usually
+ */
+int PortAudioBackend::outputCallback(const void *inputBuffer,
+                                     void *outputBuffer,
+                                     unsigned long framesPerBuffer,
+                                     const PaStreamCallbackTimeInfo* timeInfo,
+                                     PaStreamCallbackFlags statusFlags,
+                                     void *userData) {
+    PortAudioBackend *backend = (PortAudioBackend*) userData;
+    (void) inputBuffer;
+    (void) statusFlags;
+
+    backend->tuneCallbackThread(backend->_streams[DUPLEX_STREAM] != NULL ? DUPLEX_STREAM : OUTPUT_STREAM);
+
+    const size_t requested_samples = framesPerBuffer * backend->_pipelines.getOutputChannels();
+    const size_t retrieved_samples = backend->_pipelines.render((int16_t*) outputBuffer, framesPerBuffer,
+                                                                timeInfo != NULL ? timeInfo->outputBufferDacTime : 0.0,
+                                                                timeInfo != NULL ? timeInfo->currentTime : 0.0);
+    backend->_asyncLogger.log(backend->_outputLogLimit, backend->_logger, log4cpp::Priority::INFO,
+                              "requested_samples: %zu retrieved_samples: %zu", requested_samples, retrieved_samples);
+    return paContinue;
+}
+
+/**
+ * Full-duplex callback for PortAudio engine. Capture and playout run in the
+ * same callback with the same timeInfo, so they share one device clock and
+ * cost one wakeup per buffer instead of two.
+ */
+int PortAudioBackend::duplexCallback(const void *inputBuffer,
+                                     void *outputBuffer,
+                                     unsigned long framesPerBuffer,
+                                     const PaStreamCallbackTimeInfo* timeInfo,
+                                     PaStreamCallbackFlags statusFlags,
+                                     void *userData) {
+    recordCallback(inputBuffer, NULL, framesPerBuffer, timeInfo, statusFlags, userData);
+    return outputCallback(NULL, outputBuffer, framesPerBuffer, timeInfo, statusFlags, userData);
+}
+
+/**
+ * Applies the ThreadTuning to the calling callback thread, the first time
+ * it's called for stream. Real-time safe.
+ */
+void PortAudioBackend::tuneCallbackThread(int stream) {
+    CallbackThread &callbackThread = _callbackThreads[stream];
+    if(callbackThread.tuned.load(std::memory_order_relaxed))
+        return;
+    callbackThread.thread = pthread_self();
+    callbackThread.error = _tuning.applyToCurrentThread();
+    callbackThread.tuned.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Initializes PortAudio, opens the devices and starts the streams,
+ * once the last of the pipelines sharing them has been added
+ *
+ * @throws AudioBackendException on any PortAudio error, or if the pipelines
+ *         can't share the devices
+ */
+void PortAudioBackend::start(AudioPipeline &pipeline) {
+    if(!_pipelines.add(pipeline))
+        return;
+    const double sample_rate = _pipelines.getDeviceRate();
+
+    PaError err = Pa_Initialize();
+    if(err != paNoError)
+        throw AudioBackendException(std::string("PortAudio error: ") + Pa_GetErrorText(err));
+    _initialized = true;
+
+    _logger.info(Pa_GetVersionText());
+
+    PaStreamParameters inputParameters;
+    inputParameters.device = findDevice(_inputDevice, true);
+    inputParameters.channelCount = _pipelines.getInputChannels();
+    inputParameters.sampleFormat = paInt16;
+    inputParameters.suggestedLatency = Pa_GetDeviceInfo(inputParameters.device)->defaultLowInputLatency;
+    inputParameters.hostApiSpecificStreamInfo = NULL;
+
+    _logger.info("inputParameters.suggestedLatency: %.4f", inputParameters.suggestedLatency);
+
+    PaStreamParameters output_parameters;
+    output_parameters.device = findDevice(_outputDevice, false);
+    output_parameters.channelCount = _pipelines.getOutputChannels();
+    output_parameters.sampleFormat =  paInt16;
+
+    if(_outputDelay < 0.0)
+        _outputDelay = Pa_GetDeviceInfo(output_parameters.device)->defaultHighOutputLatency;
+    output_parameters.suggestedLatency = _outputDelay;
+    output_parameters.hostApiSpecificStreamInfo = NULL;
+
+    _logger.info("output_parameters.suggestedLatency: %.4f", output_parameters.suggestedLatency);
+
+    if(_fullDuplex) {
+        err = Pa_IsFormatSupported(&inputParameters, &output_parameters, sample_rate);
+        if(err == paFormatIsSupported) {
+            err = Pa_OpenStream(&_streams[DUPLEX_STREAM],   // the duplex stream
+                                &inputParameters,           // input params
+                                &output_parameters,         // output params
+                                sample_rate,                // sample rate
+                                _framesPerBuffer,           // frames per buffer
+                                paClipOff,                  // we won't output out of range samples so don't bother clipping them
+                                duplexCallback,             // PortAudio callback function
+                                this);                      // data pointer
+        }
+        if(err != paNoError) {
+            _logger.warn("Full-duplex stream not available (%s), using separate input and output streams",
+                         Pa_GetErrorText(err));
+            _streams[DUPLEX_STREAM] = NULL;
+        }
+    }
+
+    if(_streams[DUPLEX_STREAM] == NULL) {
+        err = Pa_OpenStream(&_streams[INPUT_STREAM],    // the input stream
+                            &inputParameters,           // input params
+                            NULL,                       // output params
+                            sample_rate,                // sample rate
+                            _framesPerBuffer,           // frames per buffer
+                            paClipOff,                  // we won't output out of range samples so don't bother clipping them
+                            recordCallback,             // PortAudio callback function
+                            this);                      // data pointer
+        if(err != paNoError)
+            throw AudioBackendException(std::string("Failed to open input stream: ") + Pa_GetErrorText(err));
+
+        err = Pa_OpenStream(&_streams[OUTPUT_STREAM],   // the output stream
+                            NULL,                       // input params
+                            &output_parameters,         // output params
+                            sample_rate,                // sample rate
+                            _framesPerBuffer,           // frames per buffer
+                            paClipOff,                  // we won't output out of range samples so don't bother clipping them
+                            outputCallback,             // PortAudio callback function
+                            this);                      // data pointer
+        if(err != paNoError)
+            throw AudioBackendException(std::string("Failed to open output stream: ") + Pa_GetErrorText(err));
+    }
+
+    // start the streams
+    for(int i = 0; i < NUM_STREAMS; i++) {
+        if(_streams[i] == NULL)
+            continue;
+        err = Pa_StartStream(_streams[i]);
+        if(err != paNoError)
+            throw AudioBackendException(std::string("Failed to start ") + STREAM_NAMES[i] + " stream: " +
+                                        Pa_GetErrorText(err));
+        logStreamInfo(_streams[i], STREAM_NAMES[i]);
+    }
+}
+
+/**
+ * @brief Closes the streams and terminates PortAudio
+ */
+void PortAudioBackend::stop() {
+    for(int i = 0; i < NUM_STREAMS; i++) {
+        if(_streams[i] == NULL)
+            continue;
+        _logger.info("Closing %s stream", STREAM_NAMES[i]);
+        const PaError err = Pa_CloseStream(_streams[i]);
+        if(err != paNoError)
+            _logger.error("Failed to close %s stream: %s", STREAM_NAMES[i], Pa_GetErrorText(err));
+        _streams[i] = NULL;
+        _callbackThreads[i].tuned = false;
+    }
+
+    if(_initialized) {
+        _logger.info("Terminating PortAudio engine");
+        const PaError err = Pa_Terminate();
+        if(err != paNoError)
+            _logger.error("PortAudio error: %s", Pa_GetErrorText(err));
+        _initialized = false;
+    }
+}
+
+/**
+ * @brief Highest CPU load PortAudio reports for any of the streams
+ */
+double PortAudioBackend::getCpuLoad() const {
+    double load = 0.0;
+    for(int i = 0; i < NUM_STREAMS; i++) {
+        if(_streams[i] != NULL)
+            load = std::max(load, Pa_GetStreamCpuLoad(_streams[i]));
+    }
+    return load;
+}
+
+/**
+ * @brief The callback threads' scheduling and CPUs, for the streams that
+ * have had a callback
+ */
+std::string PortAudioBackend::getThreadReport() {
+    std::string report;
+    for(int i = 0; i < NUM_STREAMS; i++) {
+        if(_streams[i] == NULL || !_callbackThreads[i].tuned.load(std::memory_order_acquire))
+            continue;
+        if(!report.empty())
+            report += "; ";
+        report += std::string(STREAM_NAMES[i]) + " callback " +
+                  _tuning.report(_callbackThreads[i].thread, _callbackThreads[i].error);
+    }
+    return report;
+}
+
+const char* PortAudioBackend::getName() const {
+    return _streams[DUPLEX_STREAM] != NULL ? "PortAudio duplex" : "PortAudio";
+}
+
+/**
+ * Looks up an audio device by index or name
+ *
+ * @param device device index, part of the device name, or empty for the
+ *               default device
+ * @param input  true for an input device, false for an output device
+ * @return the device index
+ * @throws AudioBackendException if no such device has channels in that
+ *         direction
+ */
+PaDeviceIndex PortAudioBackend::findDevice(const std::string &device, bool input) {
+    const char *direction = input ? "input" : "output";
+    if(device.empty()) {
+        const PaDeviceIndex index = input ? Pa_GetDefaultInputDevice() : Pa_GetDefaultOutputDevice();
+        if(index == paNoDevice)
+            throw AudioBackendException(std::string("No default ") + direction + " device.");
+        return index;
+    }
+
+    const int numDevices = Pa_GetDeviceCount();
+    const bool isIndex = device.find_first_not_of("0123456789") == std::string::npos;
+    for(PaDeviceIndex index = 0; index < numDevices; index++) {
+        const PaDeviceInfo *info = Pa_GetDeviceInfo(index);
+        if(info == NULL || (input ? info->maxInputChannels : info->maxOutputChannels) <= 0)
+            continue;
+        if(isIndex ? index == std::atoi(device.c_str()) : std::strstr(info->name, device.c_str()) != NULL) {
+            _logger.info("%s device %d: %s", direction, index, info->name);
+            return index;
+        }
+    }
+    throw AudioBackendException(std::string("No ") + direction + " device matching \"" + device + "\"");
+}
+
+/**
+ * Logs the latencies PortAudio actually granted for a stream
+ *
+ * @param stream the stream
+ * @param name   name to log the stream as
+ */
+void PortAudioBackend::logStreamInfo(PaStream *stream, const char *name) {
+    const PaStreamInfo *info = Pa_GetStreamInfo(stream);
+    if(info != NULL) {
+        _logger.info("%s stream: input latency %.4f s, output latency %.4f s, sample rate %.0f",
+                     name, info->inputLatency, info->outputLatency, info->sampleRate);
+    }
+}
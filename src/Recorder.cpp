@@ -0,0 +1,382 @@
+#include "Recorder.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <opus/opus.h>
+#include "AudioPipeline.hpp"
+#include "RecorderException.hpp"
+
+static const int OPUS_RATE = 48000;
+static const int FRAME_SAMPLES_48K = 960;           // 20 ms
+static const size_t MAX_OPUS_PACKET = 1500;
+static const size_t WRITE_BATCH = 64 * 1024;
+static const double FLUSH_INTERVAL = 5.0;           // seconds of audio an unsynced crash can lose
+static const double CLOSE_GRACE = 1.0;              // seconds a segment's streams outlive it, for queued audio
+static const unsigned char DEFAULT_DTX_TOC = 0x08;  // SILK NB 20 ms, one frame
+
+/**
+ * @brief Formats a wall clock time as UTC with strftime()
+ */
+static std::string formatUtc(double wallTime, const char *format) {
+    const time_t seconds = (time_t) std::floor(wallTime);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    char text[64];
+    strftime(text, sizeof(text), format, &utc);
+    return text;
+}
+
+Recorder::Stream::Stream() :
+        source(TRANSMITTED),
+        segment(0),
+        fd(-1),
+        encoder(nullptr, opus_encoder_destroy),
+        startTime(0.0),
+        frames(0),
+        pendingLen(0),
+        dtxToc(DEFAULT_DTX_TOC) {
+}
+
+/**
+ * @brief Constructor. Allocates the whole queue up front.
+ *
+ * @param directory      where the files are written
+ * @param name           the bridge's name, starts every file name
+ * @param sampleRate     rate of the recorded audio, one Opus supports
+ * @param bitrate        Opus bitrate in bits per second
+ * @param segmentSeconds length of each file, files start at multiples of it
+ * @param capacity       number of 20 ms chunks that can wait to be written
+ */
+Recorder::Recorder(const std::string &directory,
+                   const std::string &name,
+                   int sampleRate,
+                   int bitrate,
+                   int segmentSeconds,
+                   size_t capacity) :
+        _directory(directory),
+        _name(name),
+        _sampleRate(sampleRate),
+        _bitrate(bitrate),
+        _segmentSeconds(segmentSeconds),
+        _frameSize(sampleRate / 50),
+        _queue(capacity),
+        _running(false),
+        _packet(MAX_OPUS_PACKET),
+        _lastFlush(0.0),
+        _recordedSamples(0),
+        _droppedSamples(0),
+        _bytesWritten(0),
+        _filesWritten(0),
+        _errors(0) {
+}
+
+/**
+ * @brief Destructor, stops the writer thread and closes the files
+ */
+Recorder::~Recorder() {
+    stop();
+}
+
+/**
+ * @brief Starts the writer thread
+ *
+ * @throws RecorderException if the directory isn't writable
+ */
+void Recorder::start() {
+    if(_running.load())
+        return;
+    if(access(_directory.c_str(), W_OK) != 0)
+        throw RecorderException("Can't write recordings to " + _directory + ": " + std::strerror(errno));
+    _lastFlush = AudioPipeline::steadySeconds();
+    _running = true;
+    _thread = std::thread(&Recorder::run, this);
+}
+
+/**
+ * @brief Writes everything queued so far, closes the files and stops the
+ * writer thread
+ */
+void Recorder::stop() {
+    if(!_running.exchange(false))
+        return;
+    _pending.notify();
+    _thread.join();
+    drain();
+    closeStreams(std::numeric_limits<int64_t>::max());
+}
+
+/**
+ * @brief Queues audio the bridge sent to Mumble. Real-time safe.
+ *
+ * @param pcm  the samples, mono at the recorder's rate
+ * @param len  number of samples
+ * @param time steady clock seconds at the end of the samples
+ * @return false if any of it was dropped
+ */
+bool Recorder::recordTransmitted(const int16_t *pcm, size_t len, double time) {
+    return record(TRANSMITTED, pcm, len, time);
+}
+
+/**
+ * @brief Queues audio received from a Mumble session. Doesn't block.
+ *
+ * @param sessionId the sender's session
+ * @param pcm       the decoded samples, mono at the recorder's rate
+ * @param len       number of samples
+ * @param time      steady clock seconds at the end of the samples
+ * @return false if any of it was dropped
+ */
+bool Recorder::recordReceived(int sessionId, const int16_t *pcm, size_t len, double time) {
+    return record(sessionId, pcm, len, time);
+}
+
+bool Recorder::record(int source, const int16_t *pcm, size_t len, double time) {
+    if(!_running.load(std::memory_order_relaxed))
+        return false;
+    bool queued = true;
+    Chunk chunk;
+    chunk.source = source;
+    for(size_t done = 0; done < len; ) {
+        const size_t n = std::min((size_t) CHUNK_SAMPLES, len - done);
+        chunk.len = (uint32_t) n;
+        chunk.time = time - (double) (len - done - n) / _sampleRate;
+        std::memcpy(chunk.pcm, pcm + done, n * sizeof(int16_t));
+        if(_queue.push(chunk)) {
+            _recordedSamples.fetch_add(n, std::memory_order_relaxed);
+        } else {
+            _droppedSamples.fetch_add(n, std::memory_order_relaxed);
+            queued = false;
+        }
+        done += n;
+    }
+    return queued;
+}
+
+void Recorder::run() {
+    while(_running.load(std::memory_order_relaxed)) {
+        drain();
+        const double now = AudioPipeline::steadySeconds();
+        closeStreams(getSegment(toWallTime(now - CLOSE_GRACE)));
+        if(now - _lastFlush >= FLUSH_INTERVAL) {
+            for(auto &entry : _streams) {
+                entry.second->ogg->flush();
+                writePages(*entry.second, true);
+            }
+            _lastFlush = now;
+        }
+        // polled rather than notified per chunk: the queue holds seconds
+        _pending.waitFor(std::chrono::milliseconds(100));
+    }
+}
+
+void Recorder::drain() {
+    Chunk chunk;
+    while(_queue.pop(chunk))
+        process(chunk);
+}
+
+void Recorder::process(const Chunk &chunk) {
+    const double start = chunk.time - (double) chunk.len / _sampleRate;
+    const int64_t segment = getSegment(toWallTime(start));
+
+    Stream *stream = nullptr;
+    auto it = _streams.find(chunk.source);
+    if(it != _streams.end()) {
+        stream = it->second.get();
+        // audio queued before the boundary stays in the old file
+        if(segment > stream->segment) {
+            closeStream(*stream);
+            _streams.erase(it);
+            stream = nullptr;
+        }
+    }
+    if(stream == nullptr)
+        stream = openStream(chunk.source, segment, start);
+    if(!stream->encoder)
+        return;
+
+    // a gap of at least a frame: finish the partial frame with silence, then
+    // DTX packets up to where this chunk starts
+    const double frameDuration = (double) _frameSize / _sampleRate;
+    const double expected = stream->startTime + (stream->frames * _frameSize + stream->pendingLen) / (double) _sampleRate;
+    if(start - expected >= frameDuration) {
+        if(stream->pendingLen > 0)
+            encodeFrame(*stream);
+        const double gap = start - (stream->startTime + stream->frames * frameDuration);
+        for(int64_t n = (int64_t) (gap / frameDuration); n > 0; n--)
+            writeDtx(*stream);
+    }
+
+    for(size_t done = 0; done < chunk.len; ) {
+        const size_t n = std::min((size_t) chunk.len - done, _frameSize - stream->pendingLen);
+        std::copy(chunk.pcm + done, chunk.pcm + done + n, stream->pending.begin() + stream->pendingLen);
+        stream->pendingLen += n;
+        done += n;
+        if(stream->pendingLen == _frameSize)
+            encodeFrame(*stream);
+    }
+    writePages(*stream, false);
+}
+
+Recorder::Stream* Recorder::openStream(int source, int64_t segment, double time) {
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->source = source;
+    stream->segment = segment;
+    stream->startTime = time;
+    stream->pending.resize(_frameSize);
+
+    const double wallTime = toWallTime(time);
+    const std::string direction = source == TRANSMITTED ? "tx" : "rx" + std::to_string(source);
+    const std::string base = _directory + "/" + _name + "-" + formatUtc(wallTime, "%Y%m%d-%H%M%S") + "-" + direction;
+    stream->path = base + ".opus";
+    for(int suffix = 1; ; suffix++) {
+        stream->fd = open(stream->path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if(stream->fd >= 0 || errno != EEXIST)
+            break;
+        stream->path = base + "-" + std::to_string(suffix) + ".opus";
+    }
+    if(stream->fd < 0) {
+        _errors.fetch_add(1, std::memory_order_relaxed);
+        _logger.error("Can't create %s: %s", stream->path.c_str(), std::strerror(errno));
+    }
+
+    int error;
+    stream->encoder.reset(opus_encoder_create(_sampleRate, 1, OPUS_APPLICATION_VOIP, &error));
+    if(!stream->encoder) {
+        _errors.fetch_add(1, std::memory_order_relaxed);
+        _logger.error("Can't create an Opus encoder for %s: %s", stream->path.c_str(), opus_strerror(error));
+        if(stream->fd >= 0) {
+            close(stream->fd);
+            unlink(stream->path.c_str());
+            stream->fd = -1;
+        }
+    } else {
+        opus_encoder_ctl(stream->encoder.get(), OPUS_SET_BITRATE(_bitrate));
+        opus_encoder_ctl(stream->encoder.get(), OPUS_SET_DTX(1));
+        opus_int32 lookahead = 0;
+        opus_encoder_ctl(stream->encoder.get(), OPUS_GET_LOOKAHEAD(&lookahead));
+
+        std::vector<std::string> comments;
+        comments.push_back("BRIDGE=" + _name);
+        comments.push_back(std::string("DIRECTION=") + (source == TRANSMITTED ? "transmitted" : "received"));
+        if(source != TRANSMITTED)
+            comments.push_back("SESSION=" + std::to_string(source));
+        char millis[8];
+        snprintf(millis, sizeof(millis), ".%03dZ", (int) ((wallTime - std::floor(wallTime)) * 1000));
+        comments.push_back("START_TIME=" + formatUtc(wallTime, "%Y-%m-%dT%H:%M:%S") + millis);
+
+        std::random_device random;
+        stream->ogg.reset(new OggOpusWriter(random(), _sampleRate, lookahead * OPUS_RATE / _sampleRate,
+                                            "mumpi", comments));
+        if(stream->fd >= 0)
+            _logger.info("Recording to %s", stream->path.c_str());
+    }
+
+    Stream *result = stream.get();
+    _streams[source] = std::move(stream);
+    return result;
+}
+
+/**
+ * Encodes the pending frame, padding it with silence if it's partial
+ */
+void Recorder::encodeFrame(Stream &stream) {
+    std::fill(stream.pending.begin() + stream.pendingLen, stream.pending.end(), 0);
+    stream.pendingLen = 0;
+    const opus_int32 len = opus_encode(stream.encoder.get(), stream.pending.data(), (int) _frameSize,
+                                       _packet.data(), (opus_int32) _packet.size());
+    if(len < 0) {
+        _errors.fetch_add(1, std::memory_order_relaxed);
+        _logger.error("Opus encoding failed for %s: %s", stream.path.c_str(), opus_strerror(len));
+        writeDtx(stream);
+        return;
+    }
+    // the same mode and bandwidth, with no audio, is what a gap is filled with
+    stream.dtxToc = _packet[0] & 0xfc;
+    stream.ogg->writePacket(_packet.data(), len, FRAME_SAMPLES_48K);
+    stream.frames++;
+}
+
+void Recorder::writeDtx(Stream &stream) {
+    stream.ogg->writePacket(&stream.dtxToc, 1, FRAME_SAMPLES_48K);
+    stream.frames++;
+}
+
+/**
+ * Writes the stream's completed pages once there are WRITE_BATCH bytes of
+ * them, or any if forced. A failed write stops this file; the next segment
+ * starts a new one.
+ */
+void Recorder::writePages(Stream &stream, bool force) {
+    std::vector<unsigned char> &pages = stream.ogg->getPages();
+    if(pages.empty() || (!force && pages.size() < WRITE_BATCH))
+        return;
+    for(size_t done = 0; stream.fd >= 0 && done < pages.size(); ) {
+        const ssize_t written = write(stream.fd, &pages[done], pages.size() - done);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            _errors.fetch_add(1, std::memory_order_relaxed);
+            _logger.error("Can't write %s, stopping it: %s", stream.path.c_str(), std::strerror(errno));
+            close(stream.fd);
+            stream.fd = -1;
+            break;
+        }
+        done += written;
+        _bytesWritten.fetch_add(written, std::memory_order_relaxed);
+    }
+    pages.clear();
+}
+
+void Recorder::closeStream(Stream &stream) {
+    if(stream.encoder) {
+        if(stream.pendingLen > 0)
+            encodeFrame(stream);
+        stream.ogg->finish();
+        writePages(stream, true);
+    }
+    if(stream.fd < 0)
+        return;
+    // close even when fsync fails, or a failing card leaks a descriptor per segment
+    const int syncError = fsync(stream.fd) != 0 ? errno : 0;
+    const int closeError = close(stream.fd) != 0 ? errno : 0;
+    if(syncError != 0 || closeError != 0) {
+        _errors.fetch_add(1, std::memory_order_relaxed);
+        _logger.error("Can't complete %s: %s", stream.path.c_str(), std::strerror(syncError != 0 ? syncError : closeError));
+    } else {
+        _filesWritten.fetch_add(1, std::memory_order_relaxed);
+        _logger.info("Completed %s, %.0f s", stream.path.c_str(), stream.frames * (double) _frameSize / _sampleRate);
+    }
+    stream.fd = -1;
+}
+
+/**
+ * Closes the files of the segments before beforeSegment
+ */
+void Recorder::closeStreams(int64_t beforeSegment) {
+    for(auto it = _streams.begin(); it != _streams.end(); ) {
+        if(it->second->segment < beforeSegment) {
+            closeStream(*it->second);
+            it = _streams.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int64_t Recorder::getSegment(double wallTime) const {
+    return (int64_t) std::floor(wallTime / _segmentSeconds);
+}
+
+double Recorder::toWallTime(double steadyTime) const {
+    const double now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return now - (AudioPipeline::steadySeconds() - steadyTime);
+}
@@ -0,0 +1,254 @@
+#include "ReplayBuffer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AudioPipeline.hpp"
+#include "RecorderException.hpp"
+#include "WavFile.hpp"
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the mapped sequence numbers must be lock-free");
+
+static const char MAGIC[8] = { 'M', 'U', 'M', 'P', 'I', 'R', 'B', '1' };
+static const uint32_t VERSION = 1;
+static const size_t HEADER_BYTES = 4096;    // a page, so the blocks start page aligned
+static const int BLOCKS_PER_SECOND = 100;   // 10 ms blocks
+static const int TRACKS = 2;
+
+/**
+ * @brief Opens the history at path, keeping what's in it if it was written
+ * with the same sample rate and length, or starts an empty one
+ *
+ * @param path       the file, created if missing
+ * @param sampleRate rate of the audio
+ * @param seconds    length of the history if both directions carried audio
+ *                   all the time
+ * @throws RecorderException if the file can't be created or mapped
+ */
+ReplayBuffer::ReplayBuffer(const std::string &path, int sampleRate, double seconds) :
+        _sampleRate(sampleRate),
+        _blockSamples(sampleRate / BLOCKS_PER_SECOND),
+        // blocks stay 8-byte aligned for their sequence numbers
+        _blockBytes((sizeof(BlockHeader) + _blockSamples * sizeof(int16_t) + 7) & ~(size_t) 7),
+        _blockCount(TRACKS * (size_t) std::ceil(seconds * BLOCKS_PER_SECOND)),
+        _mapSize(HEADER_BYTES + _blockCount * _blockBytes),
+        _fd(-1),
+        _map(NULL),
+        _header(NULL),
+        _writeIndex(0),
+        _restored(false),
+        _locked(false) {
+    _fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(_fd < 0)
+        throw RecorderException("Can't open " + path + ": " + std::strerror(errno));
+
+    struct stat status;
+    const bool sized = fstat(_fd, &status) == 0 && (size_t) status.st_size == _mapSize;
+    // a different size starts over with a sparse, zeroed file
+    if(!sized && (ftruncate(_fd, 0) != 0 || ftruncate(_fd, _mapSize) != 0)) {
+        const int error = errno;
+        close(_fd);
+        throw RecorderException("Can't size " + path + ": " + std::strerror(error));
+    }
+    void *map = mmap(NULL, _mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, 0);
+    if(map == MAP_FAILED) {
+        const int error = errno;
+        close(_fd);
+        throw RecorderException("Can't map " + path + ": " + std::strerror(error));
+    }
+    _map = (unsigned char*) map;
+    _header = (FileHeader*) _map;
+    _locked = mlock(_map, _mapSize) == 0;
+
+    _restored = sized
+            && std::memcmp(_header->magic, MAGIC, sizeof(MAGIC)) == 0
+            && _header->version == VERSION
+            && _header->sampleRate == (uint32_t) sampleRate
+            && _header->blockSamples == _blockSamples
+            && _header->blockCount == _blockCount;
+    if(_restored) {
+        _writeIndex = _header->writeIndex.load(std::memory_order_relaxed);
+    } else {
+        // a resized file is already zeroed
+        if(sized)
+            std::memset(_map, 0, _mapSize);
+        std::memcpy(_header->magic, MAGIC, sizeof(MAGIC));
+        _header->version = VERSION;
+        _header->sampleRate = sampleRate;
+        _header->blockSamples = _blockSamples;
+        _header->blockCount = _blockCount;
+        _header->writeIndex.store(0, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief Destructor, unmaps the file. What was written stays in it.
+ */
+ReplayBuffer::~ReplayBuffer() {
+    munmap(_map, _mapSize);
+    close(_fd);
+}
+
+/**
+ * @brief Appends audio to a track, overwriting the oldest blocks. Real-time
+ * safe, one thread at a time.
+ *
+ * @param track which direction
+ * @param pcm   the samples, mono at the buffer's rate
+ * @param len   number of samples
+ * @param time  steady clock seconds at the end of the samples
+ */
+void ReplayBuffer::append(Track track, const int16_t *pcm, size_t len, double time) {
+    const double start = wallSeconds() - (AudioPipeline::steadySeconds() - time) - (double) len / _sampleRate;
+    for(size_t done = 0; done < len; ) {
+        const size_t n = std::min(_blockSamples, len - done);
+        BlockHeader *block = blockAt(_writeIndex);
+        // readers that see 0, or a sequence number changing under them,
+        // discard the block
+        block->sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        block->time = start + (double) done / _sampleRate;
+        block->track = track;
+        block->len = (uint32_t) n;
+        std::memcpy((unsigned char*) (block + 1), pcm + done, n * sizeof(int16_t));
+        block->sequence.store(_writeIndex + 1, std::memory_order_release);
+        _header->writeIndex.store(++_writeIndex, std::memory_order_release);
+        done += n;
+    }
+}
+
+/**
+ * @brief Copies a track's audio between two wall clock times, in order
+ *
+ * @param track  which direction
+ * @param from   wall clock seconds of the window's start
+ * @param to     and of its end
+ * @param maxGap longest silence kept, in seconds, where nothing was
+ *               recorded (including before the first audio); longer gaps are
+ *               shortened to it
+ * @return the samples, empty if there was no audio in the window
+ */
+std::vector<int16_t> ReplayBuffer::extract(Track track, double from, double to, double maxGap) const {
+    std::vector<int16_t> out;
+    std::vector<int16_t> pcm(_blockSamples);
+    // a block starting this close to where the previous one ended follows it
+    // directly, so scheduling jitter doesn't insert silence
+    const double tolerance = 0.5 * _blockSamples / _sampleRate;
+    double outTime = from;  // wall clock time of the next output sample
+
+    const uint64_t end = getBlocksWritten();
+    const uint64_t begin = end > _blockCount ? end - _blockCount : 0;
+    for(uint64_t index = begin; index < end; index++) {
+        BlockHeader block;
+        if(!readBlock(index, block, pcm.data()) || block.track != (uint32_t) track)
+            continue;
+        size_t first = 0;
+        size_t last = block.len;
+        if(block.time < from)
+            first = std::min(last, (size_t) ((from - block.time) * _sampleRate));
+        if(block.time + (double) block.len / _sampleRate > to)
+            last = (size_t) std::max(0.0, std::min((double) last, (to - block.time) * _sampleRate));
+        if(first >= last)
+            continue;
+
+        const double start = block.time + (double) first / _sampleRate;
+        if(start - outTime > tolerance) {
+            out.insert(out.end(), (size_t) std::lround(std::min(start - outTime, maxGap) * _sampleRate), 0);
+            outTime = start;
+        }
+        out.insert(out.end(), pcm.begin() + first, pcm.begin() + last);
+        outTime += (double) (last - first) / _sampleRate;
+    }
+    return out;
+}
+
+/**
+ * @brief Writes a window of both tracks to a stereo file, transmitted on the
+ * left and received on the right, on the wall clock timeline
+ *
+ * @param path WAV file, or raw PCM if it doesn't end in ".wav"
+ * @param from wall clock seconds of the window's start, moved up to the
+ *             oldest block if it's earlier
+ * @param to   and of its end, moved back to now if it's later
+ * @return frames written
+ * @throws AudioBackendException if the file can't be created
+ */
+uint64_t ReplayBuffer::exportWav(const std::string &path, double from, double to) const {
+    // nothing is older than the oldest block, don't fill the time before it
+    // with silence
+    from = std::max(from, getOldestTime());
+    to = std::max(from, std::min(to, wallSeconds()));
+    const double infinite = to - from;
+    const std::vector<int16_t> transmitted = extract(TRANSMITTED, from, to, infinite);
+    const std::vector<int16_t> received = extract(RECEIVED, from, to, infinite);
+    const size_t frames = std::max(transmitted.size(), received.size());
+
+    std::vector<int16_t> stereo(2 * frames, 0);
+    for(size_t i = 0; i < transmitted.size(); i++)
+        stereo[2 * i] = transmitted[i];
+    for(size_t i = 0; i < received.size(); i++)
+        stereo[2 * i + 1] = received[i];
+    WavWriter writer(path, _sampleRate, 2);
+    writer.write(stereo.data(), stereo.size());
+    writer.close();
+    return frames;
+}
+
+/**
+ * @brief Number of blocks ever appended, including those since overwritten
+ * and before a restart
+ */
+uint64_t ReplayBuffer::getBlocksWritten() const {
+    return _header->writeIndex.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Wall clock time of the oldest block still in the history, now if
+ * it's empty
+ */
+double ReplayBuffer::getOldestTime() const {
+    std::vector<int16_t> pcm(_blockSamples);
+    const uint64_t end = getBlocksWritten();
+    const uint64_t begin = end > _blockCount ? end - _blockCount : 0;
+    for(uint64_t index = begin; index < end; index++) {
+        BlockHeader block;
+        if(readBlock(index, block, pcm.data()))
+            return block.time;
+    }
+    return wallSeconds();
+}
+
+/**
+ * @brief The wall clock in seconds since the epoch, which the blocks are
+ * stamped with so they keep their meaning across restarts
+ */
+double ReplayBuffer::wallSeconds() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ReplayBuffer::BlockHeader* ReplayBuffer::blockAt(uint64_t index) const {
+    return (BlockHeader*) (_map + HEADER_BYTES + (index % _blockCount) * _blockBytes);
+}
+
+/**
+ * Copies a block out, false if it isn't the block with that index or it was
+ * overwritten while being copied
+ */
+bool ReplayBuffer::readBlock(uint64_t index, BlockHeader &header, int16_t *pcm) const {
+    const BlockHeader *block = blockAt(index);
+    const uint64_t sequence = block->sequence.load(std::memory_order_acquire);
+    if(sequence != index + 1)
+        return false;
+    header.time = block->time;
+    header.track = block->track;
+    header.len = std::min((uint32_t) _blockSamples, block->len);
+    std::memcpy(pcm, (const unsigned char*) (block + 1), header.len * sizeof(int16_t));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return block->sequence.load(std::memory_order_relaxed) == sequence;
+}
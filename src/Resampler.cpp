@@ -0,0 +1,361 @@
+#include "Resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define RESAMPLER_AVX2_DISPATCH 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON 1
+#endif
+
+static const size_t TAP_MULTIPLE = 8;   // one AVX register of floats
+// per quality: taps per phase at the input rate, stopband attenuation in dB
+static const size_t QUALITY_TAPS[] = { 16, 32, 64 };
+static const double QUALITY_ATTENUATION[] = { 60.0, 80.0, 96.0 };
+static const char *const QUALITY_NAMES[] = { "low", "medium", "high" };
+
+static size_t gcd(size_t a, size_t b) {
+    while(b != 0) {
+        const size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * Zeroth order modified Bessel function of the first kind, for the Kaiser
+ * window
+ */
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for(int k = 1; k < 50 && term > sum * 1e-12; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Constructor. Designs the filter and allocates all buffers.
+ *
+ * @param inRate         input sample rate
+ * @param outRate        output sample rate
+ * @param channels       interleaved channels per frame
+ * @param quality        filter length and attenuation, see the table above
+ * @param maxInputFrames the most frames passed to one process() call;
+ *                       getPhases(inRate, outRate) must not exceed MAX_PHASES
+ */
+Resampler::Resampler(int inRate, int outRate, int channels, Quality quality, size_t maxInputFrames) :
+        _inRate(inRate),
+        _outRate(outRate),
+        _channels(channels),
+        _phases(getPhases(inRate, outRate)),
+        _step(inRate / gcd(inRate, outRate)),
+        _stepWhole(_step / _phases),
+        _stepRemainder(_step % _phases),
+        _maxInput(maxInputFrames) {
+    // downsampling needs the same filter length in time at the output rate
+    size_t taps = QUALITY_TAPS[quality];
+    if(inRate > outRate)
+        taps = (size_t) std::ceil((double) taps * inRate / outRate);
+    _taps = (taps + TAP_MULTIPLE - 1) / TAP_MULTIPLE * TAP_MULTIPLE;
+
+    // Kaiser design: the transition band this many taps gives at the
+    // attenuation, ending at the lower rate's Nyquist frequency
+    const double attenuation = QUALITY_ATTENUATION[quality];
+    const double beta = 0.1102 * (attenuation - 8.7);
+    const double transition = (attenuation - 8.0) * inRate / (2.285 * 2.0 * M_PI * _taps);
+    const double stop = 0.5 * std::min(inRate, outRate);
+    const double cutoff = std::max(stop - transition / 2.0, 0.1 * stop) / ((double) inRate * _phases);
+
+    const size_t length = _taps * _phases;
+    const double center = (length - 1) / 2.0;
+    std::vector<double> h(length);
+    double sum = 0.0;
+    for(size_t k = 0; k < length; k++) {
+        const double x = k - center;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+        const double r = x / (center + 0.5);
+        h[k] = 2.0 * cutoff * sinc * besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / besselI0(beta);
+        sum += h[k];
+    }
+
+    // unity gain at DC for each phase's share, taps reversed so the dot
+    // product runs forward through the history
+    _coeffs.resize(length);
+    for(size_t p = 0; p < _phases; p++)
+        for(size_t j = 0; j < _taps; j++)
+            _coeffs[p * _taps + j] = (float) (h[p + (_taps - 1 - j) * _phases] * _phases / sum);
+
+    // the taps - 1 samples before the next output, one more when a capped
+    // process() call stopped early, and the next call's input
+    _historySize = _taps + _maxInput;
+    _history.resize(_historySize * _channels);
+    const size_t maxOutput = getMaxOutput(_maxInput);
+    _offsets.resize(maxOutput);
+    _phaseIndex.resize(maxOutput);
+    _out.resize(maxOutput);
+    reset();
+}
+
+/**
+ * @brief Forgets all past input, as if newly constructed
+ */
+void Resampler::reset() {
+    std::fill(_history.begin(), _history.end(), 0.0f);
+    _historyLen = _taps - 1;
+    _next = _taps - 1;
+    _phase = 0;
+}
+
+/**
+ * @brief L of the rates' reduced ratio L / M, the number of filter phases
+ */
+size_t Resampler::getPhases(int inRate, int outRate) {
+    return outRate / gcd(inRate, outRate);
+}
+
+/**
+ * @brief Parses "low", "medium" or "high"
+ *
+ * @return false if name isn't a quality
+ */
+bool Resampler::parseQuality(const std::string &name, Quality &quality) {
+    for(int q = LOW; q <= HIGH; q++) {
+        if(name == QUALITY_NAMES[q]) {
+            quality = (Quality) q;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Resampler::getQualityName(Quality quality) {
+    return QUALITY_NAMES[quality];
+}
+
+/**
+ * @brief Output frames the next process() calls produce from inFrames input
+ * frames, at most
+ */
+size_t Resampler::getMaxOutput(size_t inFrames) const {
+    return (inFrames * _phases + _step - 1) / _step + 1;
+}
+
+/**
+ * @brief Input frames the next process() call needs to produce exactly
+ * outFrames output frames, with maxOutput = outFrames. For pulling input on
+ * demand, e.g. to fill a playout buffer. At most (outFrames + 1) * M / L + 2,
+ * rounded up, which must not exceed getMaxInput().
+ */
+size_t Resampler::getInputNeeded(size_t outFrames) const {
+    if(outFrames == 0)
+        return 0;
+    const size_t last = _next + (_phase + (outFrames - 1) * _step) / _phases;
+    return last >= _historyLen ? last + 1 - _historyLen : 0;
+}
+
+/**
+ * @brief Delay the filter adds, in seconds
+ */
+double Resampler::getDelay() const {
+    return (_taps * _phases - 1) / 2.0 / ((double) _inRate * _phases);
+}
+
+#if !defined(__SSE2__) && !defined(RESAMPLER_NEON)
+static void dotScalar(const float *history, const float *coeffs, size_t taps,
+                      const uint32_t *offsets, const uint32_t *phases, size_t count, float *out) {
+    for(size_t k = 0; k < count; k++) {
+        const float *x = history + offsets[k];
+        const float *h = coeffs + (size_t) phases[k] * taps;
+        float sum = 0.0f;
+        for(size_t i = 0; i < taps; i++)
+            sum += x[i] * h[i];
+        out[k] = sum;
+    }
+}
+#endif
+
+#if defined(__SSE2__)
+static void dotSse(const float *history, const float *coeffs, size_t taps,
+                   const uint32_t *offsets, const uint32_t *phases, size_t count, float *out) {
+    for(size_t k = 0; k < count; k++) {
+        const float *x = history + offsets[k];
+        const float *h = coeffs + (size_t) phases[k] * taps;
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for(size_t i = 0; i < taps; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(h + i + 4)));
+        }
+        acc0 = _mm_add_ps(acc0, acc1);
+        acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+        acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+        out[k] = _mm_cvtss_f32(acc0);
+    }
+}
+#endif
+
+#if defined(RESAMPLER_AVX2_DISPATCH)
+__attribute__((target("avx2,fma")))
+static void dotAvx2(const float *history, const float *coeffs, size_t taps,
+                    const uint32_t *offsets, const uint32_t *phases, size_t count, float *out) {
+    for(size_t k = 0; k < count; k++) {
+        const float *x = history + offsets[k];
+        const float *h = coeffs + (size_t) phases[k] * taps;
+        __m256 acc = _mm256_setzero_ps();
+        for(size_t i = 0; i < taps; i += 8)
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i), acc);
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        out[k] = _mm_cvtss_f32(sum);
+    }
+    // see VoxDetector: dirty upper halves slow down the SSE code after us
+    _mm256_zeroupper();
+}
+
+static bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+#endif
+
+#if defined(RESAMPLER_NEON)
+static void dotNeon(const float *history, const float *coeffs, size_t taps,
+                    const uint32_t *offsets, const uint32_t *phases, size_t count, float *out) {
+    for(size_t k = 0; k < count; k++) {
+        const float *x = history + offsets[k];
+        const float *h = coeffs + (size_t) phases[k] * taps;
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for(size_t i = 0; i < taps; i += 8) {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(x + i), vld1q_f32(h + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(x + i + 4), vld1q_f32(h + i + 4));
+        }
+        const float32x4_t acc = vaddq_f32(acc0, acc1);
+        const float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        out[k] = vget_lane_f32(vpadd_f32(pair, pair), 0);
+    }
+}
+#endif
+
+/**
+ * Rounds to int16 with saturation, into every stride-th sample of pcm
+ */
+static void toPcm(const float *samples, size_t count, int16_t *pcm, int stride) {
+    size_t k = 0;
+#if defined(__SSE2__)
+    if(stride == 1) {
+        for(; k + 8 <= count; k += 8) {
+            const __m128i lo = _mm_cvtps_epi32(_mm_loadu_ps(samples + k));
+            const __m128i hi = _mm_cvtps_epi32(_mm_loadu_ps(samples + k + 4));
+            _mm_storeu_si128((__m128i*) (pcm + k), _mm_packs_epi32(lo, hi));
+        }
+    }
+#endif
+    for(; k < count; k++) {
+        const float v = std::max(-32768.0f, std::min(32767.0f, samples[k]));
+        pcm[k * stride] = (int16_t) std::lrint(v);
+    }
+}
+
+static void dot(const float *history, const float *coeffs, size_t taps,
+                const uint32_t *offsets, const uint32_t *phases, size_t count, float *out) {
+#if defined(RESAMPLER_AVX2_DISPATCH)
+    if(hasAvx2())
+        return dotAvx2(history, coeffs, taps, offsets, phases, count, out);
+#endif
+#if defined(__SSE2__)
+    dotSse(history, coeffs, taps, offsets, phases, count, out);
+#elif defined(RESAMPLER_NEON)
+    dotNeon(history, coeffs, taps, offsets, phases, count, out);
+#else
+    dotScalar(history, coeffs, taps, offsets, phases, count, out);
+#endif
+}
+
+/**
+ * @brief Name of the kernel process() uses on this machine
+ */
+const char* Resampler::getKernelName() {
+#if defined(RESAMPLER_AVX2_DISPATCH)
+    if(hasAvx2())
+        return "avx2";
+#endif
+#if defined(__SSE2__)
+    return "sse";
+#elif defined(RESAMPLER_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * @brief Converts one buffer. Output lags input by getDelay(), and frames
+ * are produced as soon as all input they depend on has arrived. Real-time
+ * safe.
+ *
+ * @param input       interleaved samples, or NULL for silence
+ * @param frames      input frames, at most getMaxInput()
+ * @param output      room for getMaxOutput(frames) frames, or maxOutput
+ * @param maxOutput   stop after this many output frames and keep the rest
+ *                    of the input for the next call
+ * @return output frames written
+ */
+size_t Resampler::process(const int16_t *input, size_t frames, int16_t *output, size_t maxOutput) {
+    // append the input to each channel's history
+    for(int c = 0; c < _channels; c++) {
+        float *history = &_history[c * _historySize + _historyLen];
+        if(input == NULL) {
+            std::fill(history, history + frames, 0.0f);
+        } else {
+            for(size_t i = 0; i < frames; i++)
+                history[i] = input[i * _channels + c];
+        }
+    }
+    _historyLen += frames;
+
+    // which phase each output takes, and from where in the history
+    size_t count = 0;
+    while(_next < _historyLen && count < maxOutput) {
+        _offsets[count] = (uint32_t) (_next + 1 - _taps);
+        _phaseIndex[count] = (uint32_t) _phase;
+        count++;
+        // _next += (_phase + M) / L, _phase = (_phase + M) % L without dividing
+        _phase += _stepRemainder;
+        _next += _stepWhole;
+        if(_phase >= _phases) {
+            _phase -= _phases;
+            _next++;
+        }
+    }
+
+    for(int c = 0; c < _channels; c++) {
+        dot(&_history[c * _historySize], _coeffs.data(), _taps, _offsets.data(), _phaseIndex.data(),
+            count, _out.data());
+        toPcm(_out.data(), count, output + c, _channels);
+    }
+
+    // keep only the history the next outputs need
+    const size_t drop = std::min(_next + 1 - _taps, _historyLen);
+    if(drop > 0) {
+        for(int c = 0; c < _channels; c++) {
+            float *history = &_history[c * _historySize];
+            std::memmove(history, history + drop, (_historyLen - drop) * sizeof(float));
+        }
+        _historyLen -= drop;
+        _next -= drop;
+    }
+    return count;
+}
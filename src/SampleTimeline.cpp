@@ -0,0 +1,70 @@
+#include "SampleTimeline.hpp"
+
+/**
+ * @brief Constructor
+ *
+ * @param sampleRate sample rate used to interpolate between marks
+ * @param capacity   number of marks that can be pending
+ */
+SampleTimeline::SampleTimeline(int sampleRate, size_t capacity) :
+        _sampleRate(sampleRate),
+        _marks(capacity),
+        _haveCurrent(false) {
+    _current.sampleIndex = 0;
+    _current.time = 0.0;
+}
+
+/**
+ * @brief Marks a sample index with a time. Producer only, real-time safe.
+ *
+ * @param sampleIndex index of the sample in the stream
+ * @param time        time of that sample in seconds
+ * @return false if the consumer has fallen behind and the mark was dropped
+ */
+bool SampleTimeline::mark(uint64_t sampleIndex, double time) {
+    Mark mark;
+    mark.sampleIndex = sampleIndex;
+    mark.time = time;
+    return _marks.push(mark);
+}
+
+/**
+ * @brief Interpolates the time of a sample from the newest mark at or before
+ * it. Marks before that one are discarded, so indexes must not go backwards.
+ * Consumer only.
+ *
+ * @param sampleIndex index of the sample in the stream
+ * @param time        set to the sample's time in seconds
+ * @return false if no mark at or before sampleIndex has been seen
+ */
+bool SampleTimeline::timeAt(uint64_t sampleIndex, double &time) {
+    while(!_marks.isEmpty()) {
+        const SpscRingBuffer<Mark>::Region next = _marks.peekRead(1);
+        if(next.data[0].sampleIndex > sampleIndex)
+            break;
+        _current = next.data[0];
+        _haveCurrent = true;
+        _marks.consumeRead(1);
+    }
+    if(!_haveCurrent || _current.sampleIndex > sampleIndex)
+        return false;
+    time = _current.time + (sampleIndex - _current.sampleIndex) / _sampleRate;
+    return true;
+}
+
+/**
+ * @brief Takes the oldest pending mark if its index is before endIndex.
+ * Consumer only, real-time safe.
+ *
+ * @param endIndex index one past the last sample consumed so far
+ * @param mark     set to the mark
+ * @return false if there is no such mark
+ */
+bool SampleTimeline::popBefore(uint64_t endIndex, Mark &mark) {
+    const SpscRingBuffer<Mark>::Region next = _marks.peekRead(1);
+    if(next.len == 0 || next.data[0].sampleIndex >= endIndex)
+        return false;
+    mark = next.data[0];
+    _marks.consumeRead(1);
+    return true;
+}
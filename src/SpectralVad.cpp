@@ -0,0 +1,233 @@
+#include "SpectralVad.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define VAD_SSE2 1
+#endif
+
+static const double LOW_BAND_HZ = 250.0;    // speech bands, log spaced
+static const double HIGH_BAND_HZ = 4000.0;
+static const double FLAT_LOW_HZ = 300.0;    // flatness range
+static const double FLAT_HIGH_HZ = 3400.0;
+// white noise periodograms have a flatness around 0.56, voiced speech well
+// below 0.2
+static const double MAX_FLATNESS = 0.3;
+static const double NOISE_FALL = 0.5;       // per frame, the floor follows quieter frames quickly
+static const double NOISE_RISE = 0.02;      // per non-voice frame, about 1 s at 20 ms frames
+static const double NOISE_RISE_VOICE = 0.001;
+static const float POWER_FLOOR = 1e-3f;     // keeps logs of digital silence finite
+
+static size_t nextPowerOf2(size_t val) {
+    size_t n = 1;
+    while(n < val)
+        n <<= 1;
+    return n;
+}
+
+static size_t hzToBin(double hz, int sampleRate, size_t fftSize) {
+    return std::min<size_t>((size_t) (hz * fftSize / sampleRate + 0.5), fftSize / 2);
+}
+
+/**
+ * @brief Constructor. Allocates and precomputes everything the per-frame
+ * analysis needs.
+ *
+ * @param sampleRate  sample rate of the frames
+ * @param frameSize   samples per frame, the Opus frame size
+ * @param thresholdDb minimum frame level in dB relative to full scale, as
+ *                    the energy VOX threshold
+ * @param snrDb       minimum mean band SNR above the noise floor
+ */
+SpectralVad::SpectralVad(int sampleRate, size_t frameSize, double thresholdDb, double snrDb) :
+        _frameSize(frameSize),
+        _fftSize(std::max<size_t>(nextPowerOf2(frameSize), 16)),
+        _snrDb(snrDb),
+        _level(thresholdDb),
+        _window(frameSize),
+        _windowed(_fftSize, 0.0f),
+        _re(_fftSize / 2),
+        _im(_fftSize / 2),
+        _twiddleRe(_fftSize / 2),
+        _twiddleIm(_fftSize / 2),
+        _postRe(_fftSize / 2 + 1),
+        _postIm(_fftSize / 2 + 1),
+        _bitReverse(_fftSize / 2),
+        _power(_fftSize / 2 + 1),
+        _lastSnrDb(0.0),
+        _lastFlatness(1.0) {
+    const size_t half = _fftSize / 2;
+    for(size_t i = 0; i < frameSize; i++)
+        _window[i] = (float) (0.5 - 0.5 * std::cos(2.0 * M_PI * i / frameSize));
+
+    size_t bits = 0;
+    while(((size_t) 1 << bits) < half)
+        bits++;
+    for(size_t i = 0; i < half; i++) {
+        uint32_t rev = 0;
+        for(size_t b = 0; b < bits; b++)
+            rev |= ((i >> b) & 1) << (bits - 1 - b);
+        _bitReverse[i] = rev;
+    }
+    for(size_t h = 1; h < half; h *= 2) {
+        for(size_t j = 0; j < h; j++) {
+            _twiddleRe[h - 1 + j] = (float) std::cos(-M_PI * j / h);
+            _twiddleIm[h - 1 + j] = (float) std::sin(-M_PI * j / h);
+        }
+    }
+    for(size_t k = 0; k <= half; k++) {
+        _postRe[k] = (float) std::cos(-2.0 * M_PI * k / _fftSize);
+        _postIm[k] = (float) std::sin(-2.0 * M_PI * k / _fftSize);
+    }
+
+    for(size_t b = 0; b <= NUM_BANDS; b++) {
+        const double hz = LOW_BAND_HZ * std::pow(HIGH_BAND_HZ / LOW_BAND_HZ, (double) b / NUM_BANDS);
+        _bandStart[b] = hzToBin(hz, sampleRate, _fftSize);
+        if(b > 0 && _bandStart[b] <= _bandStart[b - 1])
+            _bandStart[b] = std::min(_bandStart[b - 1] + 1, half);
+    }
+    _flatStart = hzToBin(FLAT_LOW_HZ, sampleRate, _fftSize);
+    _flatEnd = std::max(hzToBin(FLAT_HIGH_HZ, sampleRate, _fftSize), _flatStart + 1);
+    // the floor starts at silence and rises to the actual noise within a
+    // couple of seconds; until then the flatness test alone rejects static
+    std::fill(_noise, _noise + NUM_BANDS, (double) POWER_FLOOR);
+}
+
+/**
+ * @brief Decides whether a frame is voice and updates the noise floor.
+ *
+ * @param pcm getFrameSize() samples
+ * @return true if the frame is loud enough, stands out from the noise floor
+ *         and isn't noise-like
+ */
+bool SpectralVad::isVoice(const int16_t *pcm) {
+    const bool loud = _level.isVoice(pcm, _frameSize);
+    powerSpectrum(pcm);
+
+    double energy[NUM_BANDS];
+    for(size_t b = 0; b < NUM_BANDS; b++) {
+        double sum = 0.0;
+        for(size_t k = _bandStart[b]; k < _bandStart[b + 1]; k++)
+            sum += _power[k];
+        energy[b] = sum + POWER_FLOOR;
+    }
+    double snr = 0.0;
+    for(size_t b = 0; b < NUM_BANDS; b++)
+        snr += std::max(0.0, 10.0 * std::log10(energy[b] / _noise[b]));
+    _lastSnrDb = snr / NUM_BANDS;
+
+    double logSum = 0.0;
+    double sum = 0.0;
+    for(size_t k = _flatStart; k < _flatEnd; k++) {
+        const float p = _power[k] + POWER_FLOOR;
+        logSum += std::log(p);
+        sum += p;
+    }
+    const double n = (double) (_flatEnd - _flatStart);
+    _lastFlatness = std::exp(logSum / n) / (sum / n);
+
+    const bool voice = loud && _lastSnrDb >= _snrDb && _lastFlatness <= MAX_FLATNESS;
+
+    for(size_t b = 0; b < NUM_BANDS; b++) {
+        const double rate = energy[b] < _noise[b] ? NOISE_FALL : (voice ? NOISE_RISE_VOICE : NOISE_RISE);
+        _noise[b] += rate * (energy[b] - _noise[b]);
+    }
+    return voice;
+}
+
+/**
+ * Windows the frame and computes _power from a complex FFT of half the size,
+ * with the even samples as real and the odd samples as imaginary part.
+ */
+void SpectralVad::powerSpectrum(const int16_t *pcm) {
+    size_t i = 0;
+#if defined(VAD_SSE2)
+    for(; i + 8 <= _frameSize; i += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i*) (pcm + i));
+        // sign-extend to 32 bits by unpacking into the high halves and shifting down
+        const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        _mm_storeu_ps(&_windowed[i], _mm_mul_ps(lo, _mm_loadu_ps(&_window[i])));
+        _mm_storeu_ps(&_windowed[i + 4], _mm_mul_ps(hi, _mm_loadu_ps(&_window[i + 4])));
+    }
+#endif
+    for(; i < _frameSize; i++)
+        _windowed[i] = pcm[i] * _window[i];
+
+    const size_t half = _fftSize / 2;
+    for(size_t m = 0; m < half; m++) {
+        _re[m] = _windowed[2 * _bitReverse[m]];
+        _im[m] = _windowed[2 * _bitReverse[m] + 1];
+    }
+    fft();
+
+    // split the half-size transform into the spectrum of the real input
+    for(size_t k = 0; k <= half; k++) {
+        const size_t a = k & (half - 1);     // half is a power of 2
+        const size_t b = (half - k) & (half - 1);
+        const float er = 0.5f * (_re[a] + _re[b]);
+        const float ei = 0.5f * (_im[a] - _im[b]);
+        const float orr = 0.5f * (_im[a] + _im[b]);
+        const float oi = -0.5f * (_re[a] - _re[b]);
+        const float xr = er + orr * _postRe[k] - oi * _postIm[k];
+        const float xi = ei + orr * _postIm[k] + oi * _postRe[k];
+        _power[k] = xr * xr + xi * xi;
+    }
+}
+
+/**
+ * In-place radix-2 decimation in time FFT of _re/_im, which hold the input in
+ * bit-reversed order. The split layout lets each butterfly stage run four
+ * butterflies per SSE instruction once the half size reaches 4.
+ */
+void SpectralVad::fft() {
+    const size_t n = _fftSize / 2;
+    float *re = _re.data();
+    float *im = _im.data();
+    for(size_t h = 1; h < n; h *= 2) {
+        const float *wr = &_twiddleRe[h - 1];
+        const float *wi = &_twiddleIm[h - 1];
+        for(size_t s = 0; s < n; s += 2 * h) {
+            size_t j = 0;
+#if defined(VAD_SSE2)
+            for(; j + 4 <= h; j += 4) {
+                const __m128 twr = _mm_loadu_ps(wr + j);
+                const __m128 twi = _mm_loadu_ps(wi + j);
+                const __m128 ar = _mm_loadu_ps(re + s + j);
+                const __m128 ai = _mm_loadu_ps(im + s + j);
+                const __m128 cr = _mm_loadu_ps(re + s + j + h);
+                const __m128 ci = _mm_loadu_ps(im + s + j + h);
+                const __m128 br = _mm_sub_ps(_mm_mul_ps(cr, twr), _mm_mul_ps(ci, twi));
+                const __m128 bi = _mm_add_ps(_mm_mul_ps(cr, twi), _mm_mul_ps(ci, twr));
+                _mm_storeu_ps(re + s + j, _mm_add_ps(ar, br));
+                _mm_storeu_ps(im + s + j, _mm_add_ps(ai, bi));
+                _mm_storeu_ps(re + s + j + h, _mm_sub_ps(ar, br));
+                _mm_storeu_ps(im + s + j + h, _mm_sub_ps(ai, bi));
+            }
+#endif
+            for(; j < h; j++) {
+                const float cr = re[s + j + h];
+                const float ci = im[s + j + h];
+                const float br = cr * wr[j] - ci * wi[j];
+                const float bi = cr * wi[j] + ci * wr[j];
+                re[s + j + h] = re[s + j] - br;
+                im[s + j + h] = im[s + j] - bi;
+                re[s + j] += br;
+                im[s + j] += bi;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Name of the kernels the analysis uses on this machine
+ */
+const char* SpectralVad::getKernelName() {
+#if defined(VAD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
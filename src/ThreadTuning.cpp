@@ -0,0 +1,219 @@
+#include "ThreadTuning.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <sys/mman.h>
+
+static int toSchedPolicy(ThreadTuning::Policy policy) {
+    return policy == ThreadTuning::FIFO ? SCHED_FIFO : policy == ThreadTuning::RR ? SCHED_RR : SCHED_OTHER;
+}
+
+static const char* getSchedPolicyName(int policy) {
+    switch(policy) {
+    case SCHED_FIFO:
+        return "SCHED_FIFO";
+    case SCHED_RR:
+        return "SCHED_RR";
+    case SCHED_OTHER:
+        return "SCHED_OTHER";
+#ifdef SCHED_BATCH
+    case SCHED_BATCH:
+        return "SCHED_BATCH";
+#endif
+#ifdef SCHED_IDLE
+    case SCHED_IDLE:
+        return "SCHED_IDLE";
+#endif
+    default:
+        return "unknown policy";
+    }
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param policy   scheduling policy, OTHER to leave the thread's as it is
+ * @param priority real-time priority for FIFO and RR, see getMaxPriority()
+ * @param cpus     CPUs to pin the thread to, empty to leave its affinity
+ */
+ThreadTuning::ThreadTuning(Policy policy, int priority, const std::vector<int> &cpus) :
+        _policy(policy),
+        _priority(priority),
+        _cpus(cpus) {
+}
+
+/**
+ * @brief Sets thread's policy, priority and affinity. Doesn't allocate, so
+ * a real-time callback can tune its own thread.
+ *
+ * @return 0, or the errno of the first request the kernel refused. The
+ *         others are still tried.
+ */
+int ThreadTuning::apply(pthread_t thread) const {
+    int error = 0;
+    if(_policy != OTHER) {
+        struct sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = _priority;
+        error = pthread_setschedparam(thread, toSchedPolicy(_policy), &param);
+    }
+    if(!_cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu : _cpus) {
+            if(cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+        const int affinityError = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if(error == 0)
+            error = affinityError;
+    }
+    return error;
+}
+
+/**
+ * @brief What thread runs with, followed by what was refused if error isn't 0
+ *
+ * @param thread a thread apply() was called for
+ * @param error  apply()'s result
+ */
+std::string ThreadTuning::report(pthread_t thread, int error) const {
+    std::string text = describe(thread);
+    if(error != 0) {
+        std::string requested = _policy != OTHER ? std::string(getSchedPolicyName(toSchedPolicy(_policy))) + " " +
+                                                   std::to_string(_priority) : "";
+        if(!_cpus.empty())
+            requested += (requested.empty() ? "CPUs " : " on CPUs ") + formatCpus(_cpus);
+        text += " (requested " + requested + ": " + std::strerror(error) + ")";
+    }
+    return text;
+}
+
+/**
+ * @brief thread's policy, priority if real-time and CPUs, e.g.
+ * "SCHED_FIFO 60, CPUs 2-3"
+ */
+std::string ThreadTuning::describe(pthread_t thread) {
+    std::string text;
+    int policy;
+    struct sched_param param;
+    if(pthread_getschedparam(thread, &policy, &param) == 0) {
+        text = getSchedPolicyName(policy);
+        if(policy == SCHED_FIFO || policy == SCHED_RR)
+            text += " " + std::to_string(param.sched_priority);
+    } else {
+        text = "unknown policy";
+    }
+
+    cpu_set_t set;
+    if(pthread_getaffinity_np(thread, sizeof(set), &set) == 0) {
+        std::vector<int> cpus;
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if(CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+        text += ", CPUs " + formatCpus(cpus);
+    }
+    return text;
+}
+
+/**
+ * @brief Parses "fifo", "rr" or "other"
+ *
+ * @return false if name is none of them
+ */
+bool ThreadTuning::parsePolicy(const std::string &name, Policy &policy) {
+    if(name == "fifo")
+        policy = FIFO;
+    else if(name == "rr")
+        policy = RR;
+    else if(name == "other")
+        policy = OTHER;
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Parses a CPU list such as "3" or "0,2-3", in the format of
+ * taskset -c and /sys/devices/system/cpu/online
+ *
+ * @param list  comma separated CPU numbers and ranges
+ * @param cpus  the CPUs, sorted and without duplicates
+ * @return false if list is empty or malformed
+ */
+bool ThreadTuning::parseCpus(const std::string &list, std::vector<int> &cpus) {
+    std::vector<bool> seen(CPU_SETSIZE, false);
+    size_t start = 0;
+    while(start <= list.size()) {
+        size_t end = list.find(',', start);
+        if(end == std::string::npos)
+            end = list.size();
+        const std::string item = list.substr(start, end - start);
+        const size_t dash = item.find('-');
+        const std::string firstText = item.substr(0, dash);
+        const std::string lastText = dash == std::string::npos ? firstText : item.substr(dash + 1);
+        if(firstText.empty() || lastText.empty() ||
+           firstText.find_first_not_of("0123456789") != std::string::npos ||
+           lastText.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        const long first = std::strtol(firstText.c_str(), NULL, 10);
+        const long last = std::strtol(lastText.c_str(), NULL, 10);
+        if(first > last || last >= CPU_SETSIZE)
+            return false;
+        for(long cpu = first; cpu <= last; cpu++)
+            seen[cpu] = true;
+        start = end + 1;
+    }
+
+    cpus.clear();
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if(seen[cpu])
+            cpus.push_back(cpu);
+    }
+    return true;
+}
+
+/**
+ * @brief The opposite of parseCpus(), with consecutive CPUs as ranges
+ *
+ * @param cpus sorted CPU numbers
+ */
+std::string ThreadTuning::formatCpus(const std::vector<int> &cpus) {
+    std::string text;
+    for(size_t i = 0; i < cpus.size(); ) {
+        size_t j = i;
+        while(j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            j++;
+        if(!text.empty())
+            text += ",";
+        text += std::to_string(cpus[i]);
+        if(j > i)
+            text += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return text.empty() ? "none" : text;
+}
+
+/**
+ * @brief Highest priority policy allows, 0 for OTHER
+ */
+int ThreadTuning::getMaxPriority(Policy policy) {
+    return policy == OTHER ? 0 : sched_get_priority_max(toSchedPolicy(policy));
+}
+
+/**
+ * @brief Locks the process's memory, current and future, into RAM.
+ *
+ * Locking faults in every page that is mapped: heap, ring buffers and the
+ * full stack of every thread, and later mappings as they are made, so the
+ * audio threads never wait for a page fault. Needs CAP_IPC_LOCK or an
+ * RLIMIT_MEMLOCK covering the process.
+ *
+ * @return 0, or the errno mlockall() failed with
+ */
+int ThreadTuning::lockMemory() {
+    return mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ? 0 : errno;
+}
@@ -0,0 +1,75 @@
+#include "VadGate.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Constructor
+ *
+ * @param sampleRate     sample rate of the frames
+ * @param frameSize      samples per frame
+ * @param thresholdDb    minimum voice level in dB relative to full scale
+ * @param hangoverFrames frames to keep transmitting after the last voice frame
+ * @param preRollFrames  frames before voice to send when it starts
+ */
+VadGate::VadGate(int sampleRate, size_t frameSize, double thresholdDb,
+                 size_t hangoverFrames, size_t preRollFrames) :
+        _detector(sampleRate, frameSize, thresholdDb),
+        _frameSize(frameSize),
+        _hangoverFrames(hangoverFrames),
+        _preRollFrames(preRollFrames),
+        _preRoll(preRollFrames * frameSize),
+        _preRollNext(0),
+        _preRollHeld(0),
+        _preRollCount(0),
+        _sinceVoice(0),
+        _heardVoice(false),
+        _frames(0),
+        _voiceFrames(0),
+        _transmittedFrames(0) {
+}
+
+/**
+ * @brief Runs the VAD on one frame. When it returns true, the caller sends
+ * getPreRollCount() frames from getPreRoll() first, then this frame.
+ *
+ * @param frame getDetector().getFrameSize() samples
+ * @return true if the frame should be transmitted
+ */
+bool VadGate::process(const int16_t *frame) {
+    _frames++;
+    _preRollCount = 0;
+    bool transmit;
+    if(_detector.isVoice(frame)) {
+        _voiceFrames++;
+        _heardVoice = true;
+        _sinceVoice = 0;
+        transmit = true;
+    } else {
+        _sinceVoice++;
+        transmit = _heardVoice && _sinceVoice <= _hangoverFrames;
+    }
+
+    if(transmit) {
+        _preRollCount = _preRollHeld;
+        _preRollHeld = 0;
+        _transmittedFrames += _preRollCount + 1;
+    } else if(_preRollFrames > 0) {
+        std::memcpy(&_preRoll[_preRollNext * _frameSize], frame, _frameSize * sizeof(int16_t));
+        _preRollNext = (_preRollNext + 1) % _preRollFrames;
+        _preRollHeld = std::min(_preRollHeld + 1, _preRollFrames);
+    }
+    return transmit;
+}
+
+/**
+ * @brief One of the frames to send ahead of the last processed one, valid
+ * until the next process()
+ *
+ * @param i 0 for the oldest, up to getPreRollCount() - 1
+ */
+int16_t* VadGate::getPreRoll(size_t i) {
+    // the held frames are the _preRollCount slots before _preRollNext
+    const size_t slot = (_preRollNext + _preRollFrames - _preRollCount + i) % _preRollFrames;
+    return &_preRoll[slot * _frameSize];
+}
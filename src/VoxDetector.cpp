@@ -0,0 +1,173 @@
+#include "VoxDetector.hpp"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define VOX_AVX2_DISPATCH 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VOX_NEON 1
+#endif
+
+static const double FULL_SCALE = 32767.0;
+
+/**
+ * @brief Constructor
+ *
+ * @param thresholdDb VOX threshold in dB relative to full scale, e.g. -40.0
+ */
+VoxDetector::VoxDetector(double thresholdDb) :
+        _thresholdDb(thresholdDb),
+        _thresholdPerSample(std::pow(FULL_SCALE * std::pow(10.0, thresholdDb / 20.0), 2.0)),
+        _thresholdLength(0),
+        _threshold(0),
+        _lastSumOfSquares(0),
+        _lastLength(0) {
+}
+
+/**
+ * @brief Decides whether a frame is voice.
+ *
+ * @param pcm frame samples
+ * @param len number of samples
+ * @return true if the frame's level is at or above the threshold
+ */
+bool VoxDetector::isVoice(const int16_t *pcm, size_t len) {
+    if(len != _thresholdLength) {
+        // only when the frame size changes
+        const double threshold = std::ceil(_thresholdPerSample * len);
+        _threshold = threshold >= (double) std::numeric_limits<uint64_t>::max()
+                ? std::numeric_limits<uint64_t>::max()
+                : (uint64_t) threshold;
+        _thresholdLength = len;
+    }
+    _lastSumOfSquares = sumOfSquares(pcm, len);
+    _lastLength = len;
+    return len > 0 && _lastSumOfSquares >= _threshold;
+}
+
+/**
+ * @brief Level of the last frame passed to isVoice(), in dB relative to full
+ * scale. For logging and metering only, this is where the log is taken.
+ */
+double VoxDetector::getLastDb() const {
+    return toDb(_lastSumOfSquares, _lastLength);
+}
+
+/**
+ * @brief Converts a sum of squares over len samples to an RMS level in dB
+ * relative to full scale. Returns -infinity for silence.
+ */
+double VoxDetector::toDb(uint64_t sumOfSquares, size_t len) {
+    if(len == 0 || sumOfSquares == 0)
+        return -std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10((double) sumOfSquares / len / (FULL_SCALE * FULL_SCALE));
+}
+
+uint64_t VoxDetector::sumOfSquaresScalar(const int16_t *pcm, size_t len) {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < len; i++)
+        sum += (uint64_t) ((int32_t) pcm[i] * pcm[i]);
+    return sum;
+}
+
+#if defined(__SSE2__)
+// _mm_madd_epi16 adds two squares into 32 bits. That is at most 2 * 32768^2 =
+// 2^31, which only fits unsigned, so the pair sums are zero-extended to 64 bits.
+static uint64_t sumOfSquaresSse2(const int16_t *pcm, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i*) (pcm + i));
+        const __m128i pairs = _mm_madd_epi16(s, s);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(pairs, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(pairs, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*) lanes, acc);
+    return lanes[0] + lanes[1] + VoxDetector::sumOfSquaresScalar(pcm + i, len - i);
+}
+#endif
+
+#if defined(VOX_AVX2_DISPATCH)
+__attribute__((target("avx2")))
+static uint64_t sumOfSquaresAvx2(const int16_t *pcm, size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        const __m256i s = _mm256_loadu_si256((const __m256i*) (pcm + i));
+        const __m256i pairs = _mm256_madd_epi16(s, s);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(pairs, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(pairs, zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    // GCC doesn't clear the upper halves itself here; leaving them dirty
+    // slows down every SSE instruction that follows, e.g. SpectralVad's FFT
+    _mm256_zeroupper();
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumOfSquaresSse2(pcm + i, len - i);
+}
+
+static bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+#if defined(VOX_NEON)
+static uint64_t sumOfSquaresNeon(const int16_t *pcm, size_t len) {
+    uint64x2_t acc = vdupq_n_u64(0);
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8) {
+        const int16x8_t s = vld1q_s16(pcm + i);
+        // each square fits in 31 bits, pairwise-accumulate into 64 bits
+        const int32x4_t lo = vmull_s16(vget_low_s16(s), vget_low_s16(s));
+        const int32x4_t hi = vmull_s16(vget_high_s16(s), vget_high_s16(s));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(lo));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(hi));
+    }
+    return vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1)
+            + VoxDetector::sumOfSquaresScalar(pcm + i, len - i);
+}
+#endif
+
+/**
+ * @brief Sum of the squared samples, exact for any frame length
+ */
+uint64_t VoxDetector::sumOfSquares(const int16_t *pcm, size_t len) {
+#if defined(VOX_AVX2_DISPATCH)
+    if(hasAvx2())
+        return sumOfSquaresAvx2(pcm, len);
+#endif
+#if defined(__SSE2__)
+    return sumOfSquaresSse2(pcm, len);
+#elif defined(VOX_NEON)
+    return sumOfSquaresNeon(pcm, len);
+#else
+    return sumOfSquaresScalar(pcm, len);
+#endif
+}
+
+/**
+ * @brief Name of the kernel sumOfSquares() uses on this machine
+ */
+const char* VoxDetector::getKernelName() {
+#if defined(VOX_AVX2_DISPATCH)
+    if(hasAvx2())
+        return "avx2";
+#endif
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(VOX_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,43 @@
+#include "VoxGate.hpp"
+
+/**
+ * @brief Constructor
+ *
+ * @param sampleRate  sample rate of the frames
+ * @param thresholdDb VOX threshold in dB relative to full scale
+ * @param holdSeconds how long to keep transmitting after the last voice frame
+ */
+VoxGate::VoxGate(int sampleRate, double thresholdDb, double holdSeconds) :
+        _detector(thresholdDb),
+        _holdSamples(holdSeconds > 0.0 ? (uint64_t) (holdSeconds * sampleRate) : 0),
+        _sinceVoice(0),
+        _heardVoice(false),
+        _frames(0),
+        _voiceFrames(0),
+        _transmittedFrames(0) {
+}
+
+/**
+ * @brief Runs the VOX on one frame
+ *
+ * @param frame samples of the frame
+ * @param len   number of samples
+ * @return true if the frame should be transmitted
+ */
+bool VoxGate::process(const int16_t *frame, size_t len) {
+    _frames++;
+    bool transmit;
+    if(_detector.isVoice(frame, len)) {
+        _voiceFrames++;
+        _heardVoice = true;
+        _sinceVoice = 0;
+        transmit = true;
+    } else {
+        // frames starting within the hold time after voice still go out
+        transmit = _heardVoice && _sinceVoice < _holdSamples;
+        _sinceVoice += len;
+    }
+    if(transmit)
+        _transmittedFrames++;
+    return transmit;
+}
@@ -0,0 +1,204 @@
+#include "WavFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "AudioBackendException.hpp"
+
+static uint32_t readLe32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t readLe16(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void writeLe32(unsigned char *p, uint32_t val) {
+    p[0] = val;
+    p[1] = val >> 8;
+    p[2] = val >> 16;
+    p[3] = val >> 24;
+}
+
+static void writeLe16(unsigned char *p, uint16_t val) {
+    p[0] = val;
+    p[1] = val >> 8;
+}
+
+static bool endsWith(const std::string &str, const std::string &suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * @brief Opens path and detects whether it is WAV or raw PCM
+ *
+ * @param path file or pipe to read, "-" for stdin
+ * @throws AudioBackendException if the file can't be opened or is an
+ *         unsupported WAV format
+ */
+WavReader::WavReader(const std::string &path) :
+        _file(path == "-" ? stdin : fopen(path.c_str(), "rb")),
+        _ownsFile(path != "-"),
+        _isWav(false),
+        _sampleRate(0),
+        _channels(0),
+        _dataRemaining(0),
+        _prefixLen(0),
+        _prefixPos(0) {
+    if(_file == NULL)
+        throw AudioBackendException("Can't open " + path + ": " + std::strerror(errno));
+    try {
+        parseHeader();
+    } catch(...) {
+        if(_ownsFile)
+            fclose(_file);
+        throw;
+    }
+}
+
+WavReader::~WavReader() {
+    if(_ownsFile)
+        fclose(_file);
+}
+
+void WavReader::parseHeader() {
+    _prefixLen = fread(_prefix, 1, sizeof(_prefix), _file);
+    if(_prefixLen < 12 || std::memcmp(_prefix, "RIFF", 4) != 0 || std::memcmp(_prefix + 8, "WAVE", 4) != 0)
+        return;     // raw PCM, the prefix bytes are samples
+
+    _isWav = true;
+    _prefixLen = 0;
+    bool haveFormat = false;
+    unsigned char chunk[8];
+    while(fread(chunk, 1, sizeof(chunk), _file) == sizeof(chunk)) {
+        const uint32_t size = readLe32(chunk + 4);
+        if(std::memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[16];
+            if(size < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), _file) != sizeof(fmt))
+                throw AudioBackendException("Truncated WAV format chunk");
+            const uint16_t format = readLe16(fmt);
+            _channels = readLe16(fmt + 2);
+            _sampleRate = readLe32(fmt + 4);
+            const uint16_t bits = readLe16(fmt + 14);
+            // 1 is PCM, 0xFFFE is WAVE_FORMAT_EXTENSIBLE (assumed to hold PCM)
+            if((format != 1 && format != 0xFFFE) || bits != 16)
+                throw AudioBackendException("Only 16-bit PCM WAV files are supported");
+            for(uint32_t skip = size - sizeof(fmt) + (size & 1); skip > 0; skip--)
+                fgetc(_file);
+            haveFormat = true;
+        } else if(std::memcmp(chunk, "data", 4) == 0) {
+            if(!haveFormat)
+                throw AudioBackendException("WAV data chunk before format chunk");
+            // streamed WAVs often carry 0 or 0xFFFFFFFF here: read to the end
+            _dataRemaining = (size == 0 || size == 0xFFFFFFFF) ? UINT64_MAX : size;
+            return;
+        } else {
+            for(uint32_t skip = size + (size & 1); skip > 0; skip--)
+                fgetc(_file);
+        }
+    }
+    throw AudioBackendException("WAV file has no data chunk");
+}
+
+/**
+ * @brief Reads up to len samples. Returns fewer only at the end of the input.
+ *
+ * @param dest destination buffer
+ * @param len number of samples wanted
+ * @return number of samples read, 0 at the end of the input
+ */
+size_t WavReader::read(int16_t *dest, size_t len) {
+    unsigned char *bytes = (unsigned char*) dest;
+    size_t wanted = len * sizeof(int16_t);
+    if(_isWav)
+        wanted = (size_t) std::min<uint64_t>(wanted, _dataRemaining);
+
+    size_t got = 0;
+    if(_prefixPos < _prefixLen) {
+        got = std::min(wanted, _prefixLen - _prefixPos);
+        std::memcpy(bytes, _prefix + _prefixPos, got);
+        _prefixPos += got;
+    }
+    while(got < wanted) {
+        const size_t n = fread(bytes + got, 1, wanted - got, _file);
+        if(n == 0)
+            break;
+        got += n;
+    }
+    if(_isWav && _dataRemaining != UINT64_MAX)
+        _dataRemaining -= got;
+    // a trailing odd byte can't form a sample
+    return got / sizeof(int16_t);
+}
+
+/**
+ * @brief Creates path, writing a WAV header if it ends in ".wav"
+ *
+ * @param path       file or pipe to write, "-" for stdout
+ * @param sampleRate sample rate stored in the WAV header
+ * @param channels   channel count stored in the WAV header
+ * @throws AudioBackendException if the file can't be created
+ */
+WavWriter::WavWriter(const std::string &path, int sampleRate, int channels) :
+        _file(path == "-" ? stdout : fopen(path.c_str(), "wb")),
+        _ownsFile(path != "-"),
+        _isWav(endsWith(path, ".wav") || endsWith(path, ".WAV")),
+        _sampleRate(sampleRate),
+        _channels(channels),
+        _samplesWritten(0) {
+    if(_file == NULL)
+        throw AudioBackendException("Can't create " + path + ": " + std::strerror(errno));
+    if(_isWav)
+        writeHeader(0xFFFFFFFF - 36);
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+/**
+ * @brief Appends samples
+ *
+ * @param src samples to write
+ * @param len number of samples
+ * @return number of samples written
+ */
+size_t WavWriter::write(const int16_t *src, size_t len) {
+    if(_file == NULL)
+        return 0;
+    const size_t n = fwrite(src, sizeof(int16_t), len, _file);
+    _samplesWritten += n;
+    return n;
+}
+
+/**
+ * @brief Fills in the WAV header's sizes if possible and closes the file
+ */
+void WavWriter::close() {
+    if(_file == NULL)
+        return;
+    if(_isWav && fseek(_file, 0, SEEK_SET) == 0)
+        writeHeader((uint32_t) std::min<uint64_t>(_samplesWritten * sizeof(int16_t), 0xFFFFFFFF - 36));
+    if(_ownsFile)
+        fclose(_file);
+    else
+        fflush(_file);
+    _file = NULL;
+}
+
+void WavWriter::writeHeader(uint32_t dataBytes) {
+    unsigned char header[44];
+    std::memcpy(header, "RIFF", 4);
+    writeLe32(header + 4, 36 + dataBytes);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    writeLe32(header + 16, 16);
+    writeLe16(header + 20, 1);
+    writeLe16(header + 22, _channels);
+    writeLe32(header + 24, _sampleRate);
+    writeLe32(header + 28, _sampleRate * _channels * sizeof(int16_t));
+    writeLe16(header + 32, _channels * sizeof(int16_t));
+    writeLe16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    writeLe32(header + 40, dataBytes);
+    fwrite(header, 1, sizeof(header), _file);
+}
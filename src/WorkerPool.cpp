@@ -0,0 +1,76 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Constructor. Starts the worker threads.
+ *
+ * @param numThreads number of workers, 0 for one per core
+ * @param capacity   maximum number of queued tasks
+ */
+WorkerPool::WorkerPool(size_t numThreads, size_t capacity) :
+        _tasks(capacity),
+        _head(0),
+        _count(0),
+        _stopping(false),
+        _completed(0) {
+    if(numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for(size_t i = 0; i < numThreads; i++)
+        _threads.push_back(std::thread(&WorkerPool::run, this));
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+/**
+ * @brief Queues a task for the next free worker
+ *
+ * @return false if the queue is full or the pool is stopping
+ */
+bool WorkerPool::submit(TaskFunction function, void *arg) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_stopping || _count == _tasks.size())
+            return false;
+        Task &task = _tasks[(_head + _count) % _tasks.size()];
+        task.function = function;
+        task.arg = arg;
+        _count++;
+    }
+    _ready.notify_one();
+    return true;
+}
+
+/**
+ * @brief Runs the tasks already queued, then stops the workers
+ */
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+    for(auto &thread : _threads) {
+        if(thread.joinable())
+            thread.join();
+    }
+}
+
+void WorkerPool::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(true) {
+        _ready.wait(lock, [this]() { return _count > 0 || _stopping; });
+        if(_count == 0)
+            return;     // stopping and drained
+        const Task task = _tasks[_head];
+        _head = (_head + 1) % _tasks.size();
+        _count--;
+
+        lock.unlock();
+        task.function(task.arg);
+        _completed.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+}
@@ -1,25 +1,45 @@
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <exception>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <memory>
 #include <thread>
-#include <cmath>
 #include <chrono>
 #include <log4cpp/Category.hh>
 #include <log4cpp/FileAppender.hh>
 #include <log4cpp/OstreamAppender.hh>
-#include <portaudio.h>
 #include <mumlib/Transport.hpp>
-#include "MumpiCallback.hpp"
-#include "RingBuffer.hpp"
-
-int sample_rate = 48000;
-const int NUM_CHANNELS = 1;
-const int FRAMES_PER_BUFFER = 512;
+#include "AsyncLogger.hpp"
+#include "AudioBackendException.hpp"
+#include "Bridge.hpp"
+#include "BridgeConfig.hpp"
+#include "BridgeConfigException.hpp"
+#include "BridgeScheduler.hpp"
+#include "ChannelRouter.hpp"
+#include "CommandPipe.hpp"
+#include "CommandPipeException.hpp"
+#include "EncoderException.hpp"
+#include "EncoderSurvey.hpp"
+#include "MumbleService.hpp"
+#include "RecorderException.hpp"
+#include "SpectralVad.hpp"
+#include "ThreadTuning.hpp"
+#include "VoxDetector.hpp"
+#include "WavFile.hpp"
+#include "WorkerPool.hpp"
 
 static log4cpp::Appender *appender = new log4cpp::OstreamAppender("console", &std::cout);
 static log4cpp::Category& logger = log4cpp::Category::getRoot();
+// the audio and network threads log through async_logger, which formats and
+// writes on its own thread. Per-buffer and per-frame messages are rate limited.
+static AsyncLogger async_logger;
 static volatile sig_atomic_t sig_caught = 0;
+static volatile sig_atomic_t latency_dump_requested = 0;
 static bool mumble_thread_run_flag = true;
 static bool input_consumer_thread_run_flag = true;
 
@@ -34,116 +54,13 @@ static void sigHandler(int signal) {
 }
 
 /**
- * Simple data structure for storing audio sample data
- */
-struct PaData {
-	std::shared_ptr<RingBuffer<int16_t>> rec_buf;	// recording ring buffer
-	std::shared_ptr<RingBuffer<int16_t>> out_buf;	// output ring buffer
-};
-
-/**
- * Record callback for PortAudio engine. This gets called when audio input is
- * available. This will simply take the data from the input buffer and store
- * it in a ring buffer that we allocated. That data will then be consumed by
- * another thread.
- *
- * @param  inputBuffer     input sample buffer (interleaved if multi channel)
- * @param  outputBuffer    output sample buffer (interleaved if multi channel)
- * @param  framesPerBuffer number of frames per buffer
- * @param  timeInfo        time information for stream
- * @param  statusFlags     i/o buffer status flags
- * @param  userData        circular buffer
- * @return                 PaStreamCallbackResult, paContinue usually
- */
-static int paRecordCallback(const void *inputBuffer,
-                            void *outputBuffer,
-                            unsigned long framesPerBuffer,
-                            const PaStreamCallbackTimeInfo* timeInfo,
-                            PaStreamCallbackFlags statusFlags,
-                            void *userData ) {
-	int result = paContinue;
-	// cast the pointers to the appropriate types
-	const PaData *pa_data = (const PaData*) userData;
-	int16_t *input_buffer = (int16_t*) inputBuffer;
-	(void) outputBuffer;
-	(void) timeInfo;
-	(void) statusFlags;
-
-	if(inputBuffer != NULL) {
-		// fill ring buffer with samples
-		pa_data->rec_buf->push(input_buffer, 0, framesPerBuffer * NUM_CHANNELS);
-	} else {
-		// fill ring buffer with silence
-		for(int i = 0; i < framesPerBuffer * NUM_CHANNELS; i += NUM_CHANNELS) {
-			for(int j = 0; j < NUM_CHANNELS; j++) {
-				pa_data->rec_buf->push(0);
-			}
-		}
-	}
-
-	return result;
-}
-
-/**
- * Output callback for PortAudio engine. This gets called when audio output is
- * ready to be sent. This will simply consume data from a ring buffer that we
- * allocated which is being filled by another thread.
+ * SIGUSR1 handler, asks the main loop to log the latency histograms
  *
- * @param  inputBuffer     input sample buffer (interleaved if multi channel)
- * @param  outputBuffer    output sample buffer (interleaved if multi channel)
- * @param  framesPerBuffer number of frames per buffer
- * @param  timeInfo        time information for stream
- * @param  statusFlags     i/o buffer status flags
- * @param  userData        circular buffer
- * @return                 PaStreamCallbackResult, paContinue usually
- */
-static int paOutputCallback(const void *inputBuffer,
-                            void *outputBuffer,
-                            unsigned long framesPerBuffer,
-                            const PaStreamCallbackTimeInfo* timeInfo,
-                            PaStreamCallbackFlags statusFlags,
-                            void *userData ) {
-	int result = paContinue;
-	// cast the pointers to the appropriate types
-	const PaData *pa_data = (const PaData*) userData;
-	int16_t *output_buffer = (int16_t*) outputBuffer;
-	(void) inputBuffer;
-	(void) timeInfo;
-	(void) framesPerBuffer;
-	(void) statusFlags;
-
-	// output pcm data to PortAudio's output_buffer by reading from our ring buffer
-	// if we dont have enough samples in our ring buffer, we have to still supply 0s to the output_buffer
-	const size_t requested_samples = (framesPerBuffer * NUM_CHANNELS);
-	const size_t available_samples = pa_data->out_buf->getRemaining();
-	logger.info("requested_samples: %d", requested_samples);
-	logger.info("available_samples: %d", available_samples);
-	if(requested_samples > available_samples) {
-		pa_data->out_buf->top(output_buffer, 0, available_samples);
-		for(size_t i = available_samples; i < requested_samples - available_samples; i++) {
-			output_buffer[i] = 0;
-		}
-	} else {
-		pa_data->out_buf->top(output_buffer, 0, requested_samples);
-	}
-
-	return result;
-}
-
-/**
- * Gets the next power of 2 for the passed argument
- *
- * @param  val input value
- * @return     next power of 2 for passed arg
+ * @param signal the signal
  */
-static unsigned nextPowerOf2(unsigned val) {
-    val--;
-    val = (val >> 1) | val;
-    val = (val >> 2) | val;
-    val = (val >> 4) | val;
-    val = (val >> 8) | val;
-    val = (val >> 16) | val;
-    return ++val;
+static void latencyDumpHandler(int signal) {
+	(void) signal;
+	latency_dump_requested = 1;
 }
 
 /**
@@ -155,8 +72,33 @@ void help() {
 	printf("mumpi [options]\n\n");
 	printf("Options:\n");
 	printf("-h, --help                Displays this information.\n");
+	printf("-c, --config <file>       run the bridges configured in file instead\n");
+	printf("                          of the single one given by the options\n");
+	printf("                          below. See mumpi.conf.example.\n");
+	printf("-w, --workers <n>         threads for encoding, VOX and playout,\n");
+	printf("                          shared by all bridges. Default: one per\n");
+	printf("                          core.\n");
+	printf("--rt-policy <policy>      fifo or rr to run the audio threads and\n");
+	printf("                          workers with real-time scheduling, other\n");
+	printf("                          for the normal scheduler. Needs root,\n");
+	printf("                          CAP_SYS_NICE or an rtprio limit.\n");
+	printf("                          Default: other\n");
+	printf("--rt-priority <n>         real-time priority of the workers, 1-99;\n");
+	printf("                          the audio threads run one higher.\n");
+	printf("                          Default: 50\n");
+	printf("--audio-cpus <list>       pin the sound card callbacks (or file\n");
+	printf("                          threads) to these CPUs, e.g. 3 or 2-3\n");
+	printf("--worker-cpus <list>      pin the workers and their scheduler\n");
+	printf("--network-cpus <list>     pin the network, logging and main\n");
+	printf("                          threads\n");
+	printf("--lock-memory             lock all memory into RAM, so the audio\n");
+	printf("                          threads never wait for a page fault.\n");
+	printf("                          Needs root or a memlock limit.\n");
+	printf("                          What was granted is logged at startup.\n");
+	printf("--control <fifo>          read commands from this named pipe, see\n");
+	printf("                          below. Created if missing.\n");
 	printf("-v, --verbose             Verbose mode on.\n");
-	printf("-s, --server <string>     mumble server IP:PORT. Required.\n");
+	printf("-s, --server <string>     mumble server IP[:PORT]. Required.\n");
 	printf("-u, --username <username> username. Required.\n");
 	printf("-p, --password <password> password.\n");
 	printf("-d, --delay <delay>       output delay in seconds. Default: \n");
@@ -165,49 +107,331 @@ void help() {
 	printf("-r, --sample-rate <rate>  sample rate for recording and encoding\n");
 	printf("                          Default: 48000. Available options are:\n");
 	printf("                          12000, 24000, or 48000\n");
+	printf("--device-rate <rate>      open the sound card (or files) at this\n");
+	printf("                          rate and resample to and from\n");
+	printf("                          --sample-rate, for devices that only do\n");
+	printf("                          e.g. 44100 or 16000. Default: --sample-rate\n");
+	printf("--resample-quality <q>    low, medium or high: longer filters pass\n");
+	printf("                          more bandwidth for more CPU. Default: medium\n");
+	printf("--input-channels <n>      channels of the capture device or input\n");
+	printf("                          file. Default: 1\n");
+	printf("--input-channel <c>       channel to capture, from 1, or mix to\n");
+	printf("                          average them all. Default: mix\n");
+	printf("--output-channels <n>     channels of the playout device or output\n");
+	printf("                          file. Default: 1\n");
+	printf("--output-channel <c>      channel to play on, from 1, or all.\n");
+	printf("                          Bridges in a --config on the same device\n");
+	printf("                          share it, each on its own channel.\n");
+	printf("                          Default: all\n");
+	printf("--capture-overflow <p>    what to do when the encoder falls behind\n");
+	printf("                          and the capture buffer fills up:\n");
+	printf("                          drop-newest (keep the queued audio),\n");
+	printf("                          drop-oldest (keep the latest audio) or\n");
+	printf("                          reject (only take whole buffers).\n");
+	printf("                          Default: drop-newest\n");
+	printf("--playout-overflow <p>    the same for the playout buffer, when the\n");
+	printf("                          output device falls behind\n");
+	printf("--frame-ms <ms>           Opus frame duration: 10, 20, 40 or 60 ms.\n");
+	printf("                          Longer frames send fewer packets for more\n");
+	printf("                          latency. Default: 20\n");
+	printf("-b, --bitrate <bps>       Opus target bitrate in bit/s. Default: 32000\n");
+	printf("--measure-encoder         encode --input-file with every frame\n");
+	printf("                          duration, CBR/constrained VBR/VBR and DTX\n");
+	printf("                          off/on at --sample-rate and --bitrate,\n");
+	printf("                          gated by the VOX or --vad settings, print\n");
+	printf("                          encode CPU and packet and bit rates, and\n");
+	printf("                          exit. No server is needed.\n");
 	printf("-x, --vox-threshold <threshold>\n");
-	printf("                          vox threshold in dB. Default: -90dB\n");
+	printf("                          vox threshold in dB relative to full\n");
+	printf("                          scale (frame RMS). Default: -90dB\n");
 	printf("-i, --voice-hold <interval>\n");
 	printf("                          voice hold interval in seconds. This \n");
 	printf("                          is how long to keep transmitting after \n");
 	printf("                          silence. Default: 0.050s \n");
+	printf("--vad                     gate transmission with a spectral voice\n");
+	printf("                          activity detector instead of the level\n");
+	printf("                          alone. Rejects static and squelch tails;\n");
+	printf("                          --vox-threshold is still the minimum level\n");
+	printf("                          and --voice-hold is replaced by:\n");
+	printf("--vad-hangover <frames>   Opus frames to keep transmitting after\n");
+	printf("                          voice. Default: 10\n");
+	printf("--vad-pre-roll <frames>   Opus frames before voice to send with it,\n");
+	printf("                          so word starts aren't cut. Default: 3\n");
+	printf("-t, --target-delay <delay>\n");
+	printf("                          audio kept queued for the output device\n");
+	printf("                          in seconds. Clock drift between sender\n");
+	printf("                          and sound card is corrected to hold\n");
+	printf("                          it. Default: 0.05s\n");
+	printf("-f, --full-duplex         capture and play out through one full-duplex\n");
+	printf("                          stream. Falls back to separate streams if\n");
+	printf("                          the devices don't support it.\n");
+	printf("--input-device <device>   input device index or part of its name.\n");
+	printf("                          Default: the default input device.\n");
+	printf("--output-device <device>  output device index or part of its name.\n");
+	printf("                          Default: the default output device.\n");
+	printf("--input-file <path>       capture from a WAV or raw 16-bit PCM file\n");
+	printf("                          or named pipe instead of the sound card.\n");
+	printf("                          - reads stdin.\n");
+	printf("--output-file <path>      play out into a file or named pipe instead\n");
+	printf("                          of the sound card. WAV if it ends in .wav,\n");
+	printf("                          raw PCM otherwise. - writes stdout.\n");
+	printf("--unpaced                 read the input file as fast as the encoder\n");
+	printf("                          takes it instead of in real time.\n");
+	printf("--record-dir <dir>        record the transmitted audio and each received\n");
+	printf("                          session to Ogg Opus files in this directory.\n");
+	printf("--record-segment <s>      start new recording files every <s> seconds,\n");
+	printf("                          60 - 86400. Default: 3600\n");
+	printf("--replay-file <path>      keep a history of both directions in this\n");
+	printf("                          memory-mapped file, kept across restarts.\n");
+	printf("--replay-minutes <n>      length of the history with audio in both\n");
+	printf("                          directions all the time. Default: 10\n");
+	printf("\nSend SIGUSR1 to log per-stage latency histograms.\n");
+	printf("\nCommands for --control, on bridges with a replay-file:\n");
+	printf("replay <bridge> <ago> <seconds> [tx|rx]\n");
+	printf("                          send <seconds> of the history from <ago>\n");
+	printf("                          seconds ago into the channel, between live\n");
+	printf("                          transmissions. Default: tx, the radio side.\n");
+	printf("export <bridge> <ago> <seconds> <file>\n");
+	printf("                          write them to a stereo WAV file, transmitted\n");
+	printf("                          left and received right. At most\n");
+	printf("                          replay-minutes long.\n");
 	exit(1);
 }
 
+// a thread tuned at startup, see reportThreads()
+struct TunedThread {
+	std::string name;
+	pthread_t thread;
+	const ThreadTuning *tuning;
+	int error;
+};
+
+/**
+ * Applies tuning to a thread and remembers it for the startup report
+ */
+static void tuneThread(std::vector<TunedThread> &threads, const std::string &name, pthread_t thread,
+                       const ThreadTuning &tuning) {
+	threads.push_back(TunedThread{name, thread, &tuning, tuning.apply(thread)});
+}
+
+/**
+ * Logs the scheduling and CPUs every thread actually got and whether memory
+ * is locked. Asked for explicitly, so logged at a level that's shown without
+ * --verbose.
+ */
+static void reportThreads(const std::vector<TunedThread> &threads, const std::vector<BridgeConfig> &configs,
+                          const std::vector<std::shared_ptr<AudioBackend>> &backends, bool requested,
+                          bool lock_memory, int lock_error) {
+	const log4cpp::Priority::Value priority = requested ? log4cpp::Priority::WARN : log4cpp::Priority::INFO;
+	for(size_t i = 0; i < backends.size(); i++) {
+		// bridges sharing a backend report it once, under the first one's name
+		if(std::find(backends.begin(), backends.begin() + i, backends[i]) != backends.begin() + i)
+			continue;
+		const std::string report = backends[i]->getThreadReport();
+		logger.log(priority, "%s %s: %s", configs[i].name.c_str(), backends[i]->getName(),
+		           report.empty() ? "no audio thread running yet" : report.c_str());
+	}
+	for(const TunedThread &thread : threads)
+		logger.log(priority, "%s thread %s", thread.name.c_str(),
+		           thread.tuning->report(thread.thread, thread.error).c_str());
+	if(!lock_memory)
+		logger.log(priority, "memory not locked");
+	else if(lock_error == 0)
+		logger.log(priority, "memory locked");
+	else
+		logger.log(priority, "memory not locked: %s", strerror(lock_error));
+}
+
+/**
+ * --measure-encoder: runs EncoderSurvey on the input file and prints the
+ * results
+ */
+static int measureEncoder(const BridgeConfig &config) {
+	try {
+		config.validate(false);
+		if(config.inputFile.empty())
+			throw BridgeConfigException("--measure-encoder needs an --input-file");
+		WavReader reader(config.inputFile);
+		if(reader.isWav() && (reader.getSampleRate() != config.sampleRate || reader.getChannels() != 1))
+			throw BridgeConfigException("--input-file must be mono at the sample rate");
+		std::vector<int16_t> audio;
+		std::vector<int16_t> chunk(config.sampleRate);
+		size_t n;
+		while((n = reader.read(chunk.data(), chunk.size())) > 0)
+			audio.insert(audio.end(), chunk.begin(), chunk.begin() + n);
+
+		EncoderSurvey survey(config, audio);
+		printf("%.1f s at %d Hz, %d bit/s, %s\n\n", (double) audio.size() / config.sampleRate,
+		       config.sampleRate, config.bitrate, config.vad ? "VAD" : "VOX");
+		EncoderSurvey::print(stdout, survey.measureAll());
+	} catch (BridgeConfigException &exp) {
+		logger.error("%s", exp.what());
+		return -1;
+	} catch (AudioBackendException &exp) {
+		logger.error("%s", exp.what());
+		return -1;
+	} catch (EncoderException &exp) {
+		logger.error("%s", exp.what());
+		return -1;
+	}
+	return 0;
+}
+
+// longest replay into a channel; the clip is held in memory while it plays
+static const double MAX_REPLAY_SECONDS = 600.0;
+
+/**
+ * Runs one command from the --control pipe, see help()
+ */
+static void runCommand(const std::string &line, std::vector<std::unique_ptr<Bridge>> &bridges) {
+	std::istringstream in(line);
+	std::string command, name;
+	double ago = 0.0, seconds = 0.0;
+	if(!(in >> command))
+		return;     // blank line
+	in >> name >> ago >> seconds;
+	if((command != "replay" && command != "export") || in.fail() || ago <= 0.0 || seconds <= 0.0) {
+		logger.warn("Invalid command: %s", line.c_str());
+		return;
+	}
+	Bridge *bridge = NULL;
+	for(auto &candidate : bridges) {
+		if(candidate->getConfig().name == name)
+			bridge = candidate.get();
+	}
+	if(bridge == NULL || bridge->getReplayBuffer() == NULL) {
+		logger.warn("No bridge %s with a replay-file", name.c_str());
+		return;
+	}
+	const double from = ReplayBuffer::wallSeconds() - ago;
+	const double to = from + seconds;
+
+	if(command == "export") {
+		std::string path;
+		if(!(in >> path)) {
+			logger.warn("Invalid command, no file to export to: %s", line.c_str());
+			return;
+		}
+		// the whole window is held in memory while it's written
+		const double maxSeconds = 60.0 * bridge->getConfig().replayMinutes;
+		if(seconds > maxSeconds) {
+			logger.warn("Exports are limited to the replay-minutes, %.0f s: %s", maxSeconds, line.c_str());
+			return;
+		}
+		try {
+			const uint64_t frames = bridge->getReplayBuffer()->exportWav(path, from, to);
+			logger.warn("Exported %.1f s of %s to %s", (double) frames / bridge->getConfig().sampleRate,
+			            name.c_str(), path.c_str());
+		} catch (std::exception &exp) {
+			// a bad command mustn't take the bridges down
+			logger.error("Export of %s failed: %s", name.c_str(), exp.what());
+		}
+		return;
+	}
+
+	std::string direction = "tx";
+	in >> direction;
+	if(direction != "tx" && direction != "rx") {
+		logger.warn("Invalid command, expected tx or rx: %s", line.c_str());
+		return;
+	}
+	if(seconds > MAX_REPLAY_SECONDS) {
+		logger.warn("Replays are limited to %.0f s: %s", MAX_REPLAY_SECONDS, line.c_str());
+		return;
+	}
+	if(bridge->isReplaying()) {
+		logger.warn("%s is already replaying", name.c_str());
+		return;
+	}
+	const size_t samples = bridge->replay(direction == "tx" ? ReplayBuffer::TRANSMITTED : ReplayBuffer::RECEIVED,
+	                                      from, to);
+	if(samples == 0)
+		logger.warn("Nothing to replay on %s in that window", name.c_str());
+	else
+		logger.warn("Replaying %.1f s of %s %s", (double) samples / bridge->getConfig().sampleRate,
+		            name.c_str(), direction.c_str());
+}
+
 /**
  * main function
  *
  * Program flow:
- * 1. Parse command line args
- * 2. Init PortAudio engine and open default input and output audio devices
- * 3. Init mumlib client
- * 4. Busy loop until CTRL+C
- * 5. Clean up mumlib client
- * 6. Clean up PortAudio engine
+ * 1. Parse command line args, or the bridges' config file
+ * 2. Start each bridge's audio backend: PortAudio devices, or files with
+ *    --input-file/--output-file
+ * 3. Connect each bridge's mumlib client, all on one network thread
+ * 4. Busy loop until CTRL+C, or until every input file is used up, while
+ *    the worker pool does the bridges' encoding, VOX and playout
+ * 5. Disconnect the mumlib clients
+ * 6. Stop the audio backends
  */
 int main(int argc, char *argv[]) {
 	bool verbose = false;
-	std::string server;
-	std::string username;
-	std::string password;
+	bool measure_encoder = false;
+	std::string config_file;
+	int workers = 0;
+	ThreadTuning::Policy rt_policy = ThreadTuning::OTHER;
+	int rt_priority = 50;
+	std::vector<int> audio_cpus, worker_cpus, network_cpus;
+	bool lock_memory = false;
+	std::string control_path;
+	BridgeConfig cli;
 	int next_option;
-	const char* const short_options = "hvs:u:p:d:r:x:i:";
+	// long-only options
+	enum { OPT_INPUT_FILE = 256, OPT_OUTPUT_FILE, OPT_UNPACED, OPT_INPUT_DEVICE, OPT_OUTPUT_DEVICE,
+		OPT_VAD, OPT_VAD_HANGOVER, OPT_VAD_PRE_ROLL, OPT_FRAME_MS, OPT_MEASURE_ENCODER, OPT_DEVICE_RATE,
+		OPT_RESAMPLE_QUALITY, OPT_INPUT_CHANNELS, OPT_INPUT_CHANNEL, OPT_OUTPUT_CHANNELS, OPT_OUTPUT_CHANNEL,
+		OPT_CAPTURE_OVERFLOW, OPT_PLAYOUT_OVERFLOW, OPT_RT_POLICY, OPT_RT_PRIORITY, OPT_AUDIO_CPUS,
+		OPT_WORKER_CPUS, OPT_NETWORK_CPUS, OPT_LOCK_MEMORY, OPT_RECORD_DIR, OPT_RECORD_SEGMENT,
+		OPT_REPLAY_FILE, OPT_REPLAY_MINUTES, OPT_CONTROL };
+	const char* const short_options = "hvc:w:s:u:p:d:r:b:x:i:t:f";
 	const struct option long_options[] =
 	{
 		{ "help", no_argument, NULL, 'h' },
 		{ "verbose", required_argument, NULL, 'v' },
+		{ "config", required_argument, NULL, 'c' },
+		{ "workers", required_argument, NULL, 'w' },
+		{ "rt-policy", required_argument, NULL, OPT_RT_POLICY },
+		{ "rt-priority", required_argument, NULL, OPT_RT_PRIORITY },
+		{ "audio-cpus", required_argument, NULL, OPT_AUDIO_CPUS },
+		{ "worker-cpus", required_argument, NULL, OPT_WORKER_CPUS },
+		{ "network-cpus", required_argument, NULL, OPT_NETWORK_CPUS },
+		{ "lock-memory", no_argument, NULL, OPT_LOCK_MEMORY },
+		{ "control", required_argument, NULL, OPT_CONTROL },
 		{ "server", required_argument, NULL, 's' },
 		{ "username", required_argument, NULL, 'u' },
 		{ "password", required_argument, NULL, 'p' },
 		{ "delay", required_argument, NULL, 'd'},
 		{ "sample-rate", required_argument, NULL, 'r'},
+		{ "device-rate", required_argument, NULL, OPT_DEVICE_RATE},
+		{ "resample-quality", required_argument, NULL, OPT_RESAMPLE_QUALITY},
+		{ "input-channels", required_argument, NULL, OPT_INPUT_CHANNELS},
+		{ "input-channel", required_argument, NULL, OPT_INPUT_CHANNEL},
+		{ "output-channels", required_argument, NULL, OPT_OUTPUT_CHANNELS},
+		{ "output-channel", required_argument, NULL, OPT_OUTPUT_CHANNEL},
+		{ "capture-overflow", required_argument, NULL, OPT_CAPTURE_OVERFLOW},
+		{ "playout-overflow", required_argument, NULL, OPT_PLAYOUT_OVERFLOW},
+		{ "frame-ms", required_argument, NULL, OPT_FRAME_MS},
+		{ "bitrate", required_argument, NULL, 'b'},
+		{ "measure-encoder", no_argument, NULL, OPT_MEASURE_ENCODER},
 		{ "vox-threshold", required_argument, NULL, 'x'},
 		{ "voice-hold", required_argument, NULL, 'i'},
+		{ "vad", no_argument, NULL, OPT_VAD},
+		{ "vad-hangover", required_argument, NULL, OPT_VAD_HANGOVER},
+		{ "vad-pre-roll", required_argument, NULL, OPT_VAD_PRE_ROLL},
+		{ "target-delay", required_argument, NULL, 't'},
+		{ "full-duplex", no_argument, NULL, 'f'},
+		{ "input-device", required_argument, NULL, OPT_INPUT_DEVICE},
+		{ "output-device", required_argument, NULL, OPT_OUTPUT_DEVICE},
+		{ "input-file", required_argument, NULL, OPT_INPUT_FILE},
+		{ "output-file", required_argument, NULL, OPT_OUTPUT_FILE},
+		{ "unpaced", no_argument, NULL, OPT_UNPACED},
+		{ "record-dir", required_argument, NULL, OPT_RECORD_DIR},
+		{ "record-segment", required_argument, NULL, OPT_RECORD_SEGMENT},
+		{ "replay-file", required_argument, NULL, OPT_REPLAY_FILE},
+		{ "replay-minutes", required_argument, NULL, OPT_REPLAY_MINUTES},
 		{ NULL, 0, NULL, 0 }
 	};
-	double output_delay = -1.0;
-	double vox_threshold = -90.0;	// dB
-	std::chrono::duration<double> voice_hold_interval(0.050);	// 50 ms
 
 	// init logger
 	appender->setLayout(new log4cpp::BasicLayout());
@@ -215,279 +439,337 @@ int main(int argc, char *argv[]) {
 	logger.addAppender(appender);
 
 	// parse command line args using getopt
-	while(1) {
-		// obtain a option
-		next_option = getopt_long(argc, argv, short_options, long_options, NULL);
+	// bridge settings go through BridgeConfig::set() under their long option
+	// name, the same as in a config file
+	try {
+		while(1) {
+			// obtain a option
+			next_option = getopt_long(argc, argv, short_options, long_options, NULL);
+
+			if(next_option == -1)
+				break;  // no more options
+
+			switch(next_option) {
+
+			case 'h':      // -h or --help
+				help();
+				break;
+
+			case 'v':      // -v or --verbose
+				verbose = true;
+				break;
+
+			case 'c':      // -c or --config
+				config_file = std::string(optarg);
+				break;
+
+			case 'w':      // -w or --workers
+				workers = std::atoi(optarg);
+				break;
+
+			case OPT_RT_POLICY:
+				if(!ThreadTuning::parsePolicy(optarg, rt_policy))
+					throw BridgeConfigException(std::string("Invalid rt-policy: ") + optarg);
+				break;
+
+			case OPT_RT_PRIORITY:
+				rt_priority = std::atoi(optarg);
+				break;
+
+			case OPT_AUDIO_CPUS:
+				if(!ThreadTuning::parseCpus(optarg, audio_cpus))
+					throw BridgeConfigException(std::string("Invalid audio-cpus: ") + optarg);
+				break;
+
+			case OPT_WORKER_CPUS:
+				if(!ThreadTuning::parseCpus(optarg, worker_cpus))
+					throw BridgeConfigException(std::string("Invalid worker-cpus: ") + optarg);
+				break;
+
+			case OPT_NETWORK_CPUS:
+				if(!ThreadTuning::parseCpus(optarg, network_cpus))
+					throw BridgeConfigException(std::string("Invalid network-cpus: ") + optarg);
+				break;
+
+			case OPT_LOCK_MEMORY:
+				lock_memory = true;
+				break;
+
+			case OPT_CONTROL:
+				control_path = optarg;
+				break;
+
+			case 's':      // -s or --server
+				cli.set("server", optarg);
+				break;
+
+			case 'u':      // -u or --username
+				cli.set("username", optarg);
+				break;
+
+			case 'p':
+				cli.set("password", optarg);
+				break;
+
+			case 'd':
+				cli.set("delay", optarg);
+				break;
+
+			case 'r':
+				cli.set("sample-rate", optarg);
+				break;
+
+			case OPT_DEVICE_RATE:
+				cli.set("device-rate", optarg);
+				break;
+
+			case OPT_RESAMPLE_QUALITY:
+				cli.set("resample-quality", optarg);
+				break;
+
+			case OPT_INPUT_CHANNELS:
+				cli.set("input-channels", optarg);
+				break;
+
+			case OPT_INPUT_CHANNEL:
+				cli.set("input-channel", optarg);
+				break;
+
+			case OPT_OUTPUT_CHANNELS:
+				cli.set("output-channels", optarg);
+				break;
+
+			case OPT_OUTPUT_CHANNEL:
+				cli.set("output-channel", optarg);
+				break;
 
-		if(next_option == -1)
-			break;  // no more options
+			case OPT_CAPTURE_OVERFLOW:
+				cli.set("capture-overflow", optarg);
+				break;
 
-		switch(next_option) {
+			case OPT_PLAYOUT_OVERFLOW:
+				cli.set("playout-overflow", optarg);
+				break;
 
-		case 'h':      // -h or --help
-			help();
-			break;
+			case OPT_FRAME_MS:
+				cli.set("frame-ms", optarg);
+				break;
 
-		case 'v':      // -v or --verbose
-			verbose = true;
-			break;
+			case 'b':
+				cli.set("bitrate", optarg);
+				break;
 
-		case 's':      // -s or --server
-			server = std::string(optarg);
-			break;
+			case OPT_MEASURE_ENCODER:
+				measure_encoder = true;
+				break;
 
-		case 'u':      // -u or --username
-			username = std::string(optarg);
-			break;
+			case 'x':
+				cli.set("vox-threshold", optarg);
+				break;
 
-		case 'p':
-			password = std::string(optarg);
-			break;
+			case 'i':
+				cli.set("voice-hold", optarg);
+				break;
 
-		case 'd':
-			output_delay = std::stod(optarg);
-			break;
+			case OPT_VAD:
+				cli.set("vad", "true");
+				break;
 
-		case 'r':
-			sample_rate = std::atoi(optarg);
-			break;
+			case OPT_VAD_HANGOVER:
+				cli.set("vad-hangover", optarg);
+				break;
 
-		case 'x':
-			vox_threshold = std::stod(optarg);
-			break;
+			case OPT_VAD_PRE_ROLL:
+				cli.set("vad-pre-roll", optarg);
+				break;
 
-		case 'i':
-			voice_hold_interval = std::chrono::duration<double>(std::stod(optarg));
-			break;
+			case 't':
+				cli.set("target-delay", optarg);
+				break;
 
-		case '?':      // Invalid option
-			help();
+			case 'f':
+				cli.set("full-duplex", "true");
+				break;
 
-		case -1:      // No more options
-			break;
+			case OPT_INPUT_DEVICE:
+				cli.set("input-device", optarg);
+				break;
 
-		default:      // shouldn't happen :-)
-			return(1);
-		}
-	}
+			case OPT_OUTPUT_DEVICE:
+				cli.set("output-device", optarg);
+				break;
 
-	if(verbose)
-		logger.setPriority(log4cpp::Priority::INFO);
+			case OPT_INPUT_FILE:
+				cli.set("input-file", optarg);
+				break;
 
-	// check for mandatory arguments
-	if(server.empty() || username.empty()) {
-		logger.error("Mandatory arguments not specified");
-		help();
-	}
+			case OPT_OUTPUT_FILE:
+				cli.set("output-file", optarg);
+				break;
 
-	// check for valid sample rate
-	if(sample_rate != 48000 && sample_rate != 24000 && sample_rate != 12000) {
-		logger.error("--sample-rate option must be 12000, 24000, or 48000");
-		exit(-1);
-	}
+			case OPT_UNPACED:
+				cli.set("unpaced", "true");
+				break;
 
-	logger.info("Server:        %s", server.c_str());
-	logger.info("Username:      %s", username.c_str());
-	logger.info("delay:         %f", output_delay);
-	logger.info("sample rate    %d", sample_rate);
-	logger.info("vox threshold  %f", vox_threshold);
-	logger.info("voice hold interval %f", voice_hold_interval);
+			case OPT_RECORD_DIR:
+				cli.set("record-dir", optarg);
+				break;
 
-	// logger.info("Starting in 5 seconds...");
-	// std::this_thread::sleep_for(std::chrono::seconds(5));
+			case OPT_RECORD_SEGMENT:
+				cli.set("record-segment", optarg);
+				break;
 
-	///////////////////////
-	// init audio library
-	///////////////////////
-	PaError err;
-	err = Pa_Initialize();
-	if(err != paNoError) {
-		logger.error("PortAudio error: %s", Pa_GetErrorText(err));
-		exit(-1);
-	}
+			case OPT_REPLAY_FILE:
+				cli.set("replay-file", optarg);
+				break;
 
-	logger.info(Pa_GetVersionText());
+			case OPT_REPLAY_MINUTES:
+				cli.set("replay-minutes", optarg);
+				break;
 
-	// init audio I/O streams
-	PaStream *input_stream;
-	PaStream *output_stream;
-	PaData data;
-	PaStreamParameters inputParameters;
-	PaStreamParameters output_parameters;
+			case '?':      // Invalid option
+				help();
 
-	// set ring buffer size to about 500ms
-	const size_t MAX_SAMPLES = nextPowerOf2(0.5 * sample_rate * NUM_CHANNELS);
-	data.rec_buf = std::make_shared<RingBuffer<int16_t>>(MAX_SAMPLES);
-	data.out_buf = std::make_shared<RingBuffer<int16_t>>(MAX_SAMPLES);
+			case -1:      // No more options
+				break;
 
-	inputParameters.device = Pa_GetDefaultInputDevice();
-	if (inputParameters.device == paNoDevice) {
-		logger.error("No default input device.");
+			default:      // shouldn't happen :-)
+				return(1);
+			}
+		}
+	} catch (BridgeConfigException &exp) {
+		logger.error("%s", exp.what());
 		exit(-1);
 	}
-	inputParameters.channelCount = NUM_CHANNELS;
-	inputParameters.sampleFormat = paInt16;
-	inputParameters.suggestedLatency = Pa_GetDeviceInfo(inputParameters.device)->defaultLowInputLatency;
-	inputParameters.hostApiSpecificStreamInfo = NULL;
-
-	logger.info("inputParameters.suggestedLatency: %.4f", inputParameters.suggestedLatency);
-
-	err = Pa_OpenStream(&input_stream,         // the input stream
-						&inputParameters,      // input params
-						NULL,                  // output params
-						sample_rate,           // sample rate
-						FRAMES_PER_BUFFER,     // frames per buffer
-						paClipOff,             // we won't output out of range samples so don't bother clipping them
-						paRecordCallback,      // PortAudio callback function
-						&data);                // data pointer
-
-	logger.info("defaultHighOutputLatency: %.4f", Pa_GetDeviceInfo(inputParameters.device)->defaultHighOutputLatency);
-
-	if(err != paNoError) {
-	    logger.error("Failed to open input stream: %s", Pa_GetErrorText(err));
+
+	if(verbose)
+		logger.setPriority(log4cpp::Priority::INFO);
+
+	if(measure_encoder)
+		return measureEncoder(cli);
+
+	const int max_priority = ThreadTuning::getMaxPriority(rt_policy);
+	if(rt_policy != ThreadTuning::OTHER && (rt_priority < 1 || rt_priority > max_priority)) {
+		logger.error("rt-priority must be from 1 to %d", max_priority);
 		exit(-1);
 	}
-
-	output_parameters.device = Pa_GetDefaultOutputDevice();
-	if(output_parameters.device == paNoDevice) {
-		logger.error("No default output device.");
+	// the audio threads feed the workers, so they must not wait behind them
+	const ThreadTuning audio_tuning(rt_policy, std::min(rt_priority + 1, max_priority), audio_cpus);
+	const ThreadTuning worker_tuning(rt_policy, rt_priority, worker_cpus);
+	const ThreadTuning network_tuning(ThreadTuning::OTHER, 0, network_cpus);
+	const bool tuning_requested = rt_policy != ThreadTuning::OTHER || !audio_cpus.empty() || !worker_cpus.empty() ||
+	                              !network_cpus.empty() || lock_memory;
+
+	std::vector<BridgeConfig> configs;
+	if(config_file.empty()) {
+		// check for mandatory arguments
+		if(cli.server.empty() || cli.username.empty()) {
+			logger.error("Mandatory arguments not specified");
+			help();
+		}
+		cli.name = cli.username;
+		configs.push_back(cli);
+	}
+	try {
+		if(!config_file.empty())
+			configs = BridgeConfig::parseFile(config_file);
+		for(const BridgeConfig &config : configs)
+			config.validate();
+	} catch (BridgeConfigException &exp) {
+		logger.error("%s", exp.what());
 		exit(-1);
 	}
-	output_parameters.channelCount = NUM_CHANNELS;
-	output_parameters.sampleFormat =  paInt16;
-
-	if(output_delay < 0.0)
-		output_delay = Pa_GetDeviceInfo(output_parameters.device)->defaultHighOutputLatency;
-	output_parameters.suggestedLatency = output_delay;
-	output_parameters.hostApiSpecificStreamInfo = NULL;
 
-	logger.info("output_parameters.suggestedLatency: %.4f", output_parameters.suggestedLatency);
+	async_logger.start();
 
-	err = Pa_OpenStream(&output_stream,		// the output stream
-						NULL, 				// input params
-						&output_parameters,	// output params
-						sample_rate,		// sample rate
-						FRAMES_PER_BUFFER,	// frames per buffer
-						paClipOff,      	// we won't output out of range samples so don't bother clipping them
-						paOutputCallback,	// PortAudio callback function
-						&data);				// data pointer
-
-	logger.info("defaultHighOutputLatency: %.4f", Pa_GetDeviceInfo(output_parameters.device)->defaultHighOutputLatency);
+	// logger.info("Starting in 5 seconds...");
+	// std::this_thread::sleep_for(std::chrono::seconds(5));
 
-	if(err != paNoError) {
-		logger.error("Failed to open output stream: %s", Pa_GetErrorText(err));
-		exit(-1);
+	///////////////////////
+	// init bridges
+	///////////////////////
+	// every bridge's capture wakes the scheduler through one signal, and all
+	// Mumble connections share the network thread. Bridges on the same sound
+	// card or files share its backend, each on its own channels
+	EventSignal frame_ready;
+	MumbleService network;
+	std::vector<std::unique_ptr<Bridge>> bridges;
+	std::vector<std::shared_ptr<AudioBackend>> backends(configs.size());
+	for(size_t i = 0; i < configs.size(); i++) {
+		if(!backends[i]) {
+			std::vector<size_t> sharing;
+			for(size_t j = i; j < configs.size(); j++) {
+				if(configs[i].sharesDevice(configs[j]))
+					sharing.push_back(j);
+			}
+			const std::shared_ptr<AudioBackend> backend = Bridge::createBackend(configs[i], async_logger,
+			                                                                    sharing.size());
+			backend->setThreadTuning(audio_tuning);
+			for(size_t j : sharing)
+				backends[j] = backend;
+		}
+		bridges.emplace_back(new Bridge(configs[i], backends[i], network.getIoService(), async_logger, frame_ready));
 	}
-
-	// start the streams
-	err = Pa_StartStream(input_stream);
-	if(err != paNoError) {
-		logger.error("Failed to start input stream: %s", Pa_GetErrorText(err));
+	logger.info("VOX kernel: %s", VoxDetector::getKernelName());
+	logger.info("VAD kernel: %s", SpectralVad::getKernelName());
+	logger.info("Channel router kernel: %s", ChannelRouter::getKernelName());
+
+	// the ring buffers are allocated; locking faults them in, and the stacks
+	// of the threads started below as they are created
+	const int lock_error = lock_memory ? ThreadTuning::lockMemory() : 0;
+
+	try {
+		for(auto &bridge : bridges)
+			bridge->start();
+	} catch (AudioBackendException &exp) {
+		logger.error("%s", exp.what());
+		bridges.clear();
+		async_logger.stop();
+		exit(-1);
+	} catch (RecorderException &exp) {
+		logger.error("%s", exp.what());
+		bridges.clear();
+		async_logger.stop();
 		exit(-1);
 	}
 
-	err = Pa_StartStream(output_stream);
-	if(err != paNoError) {
-		logger.error("Failed to start output stream: %s", Pa_GetErrorText(err));
+	// replay and export commands run on the main thread, between its checks
+	std::unique_ptr<CommandPipe> control;
+	try {
+		if(!control_path.empty())
+			control.reset(new CommandPipe(control_path));
+	} catch (CommandPipeException &exp) {
+		logger.error("%s", exp.what());
+		bridges.clear();
+		async_logger.stop();
 		exit(-1);
 	}
 
-	///////////////////////
-	// init mumble library
-	///////////////////////
-	// open output audio stream, pipe incoming audio PCM data to output audio stream
-
-	// This stuff should be on a separate thread
-	MumpiCallback mumble_callback(data.out_buf);
-	mumlib::MumlibConfiguration conf;
-	conf.opusEncoderBitrate = sample_rate;
-	mumlib::Mumlib mum(mumble_callback, conf);
-	mumble_callback.mum = &mum;
-
-	std::thread mumble_thread([&]() {
-		while(!sig_caught) {
-			try {
-				logger.info("Connecting to %s", server.c_str());
-				mum.connect(server, 64738, username, password);
-				mum.run();
-			} catch (mumlib::TransportException &exp) {
-				logger.error("TransportException: %s.", exp.what());
-				logger.error("Attempting to reconnect in 5 s.");
-				std::this_thread::sleep_for(std::chrono::seconds(5));
-			}
-		}
-	});
-
-	std::thread input_consumer_thread([&]() {
-		// consumes the data that the input audio thread receives and sends it
-		// through mumble client
-		// this will continuously read from the input data circular buffer
-
-		// Opus can encode frames of 2.5, 5, 10, 20, 40, or 60 ms
-		// the Opus RFC 6716 recommends using 20ms frame sizes
-		// so at 48k sample rate, 20ms is 960 samples
-		const int OPUS_FRAME_SIZE = (sample_rate / 1000.0)*20.0;
-
-		logger.info("OPUS_FRAME_SIZE: %d", OPUS_FRAME_SIZE);
-
-		std::chrono::steady_clock::time_point start;
-		std::chrono::steady_clock::time_point now;
-		bool voice_hold_flag = false;
-		bool first_run_flag = true;
-		int16_t *out_buf = new int16_t[MAX_SAMPLES];
-		while(!sig_caught) {
-			if(!data.rec_buf->isEmpty() && data.rec_buf->getRemaining() >= OPUS_FRAME_SIZE) {
-
-				// perform VOX algorithm
-				// convert each sample to dB
-				// take average (RMS) of all samples
-				// if average >= threshold, transmit, else ignore
-				// dB = 20 * log_10(rms)
-
-				// also perform a "voice hold" for aprox voice_hold_interval
-				// if we have just transmitted
-
-				// do a bulk get and send it through mumble client
-				if(mum.getConnectionState() == mumlib::ConnectionState::CONNECTED) {
-					data.rec_buf->top(out_buf, 0, OPUS_FRAME_SIZE);
-
-					// compute RMS of sample window
-					double sum = 0;
-					for(int i = 0; i < OPUS_FRAME_SIZE; i++) {
-						const double sample = std::abs(out_buf[i]) / INT16_MAX;
-						sum += sample * sample;
-					}
-					const double rms = std::sqrt(sum / OPUS_FRAME_SIZE);
-
-					double db = vox_threshold;
-					if(rms > 0.0)
-						db = 20.0 * std::log10(rms);
-
-					logger.info("Recorded voice dB: %.2f", db);
-
-					if(!first_run_flag) {
-						now = std::chrono::steady_clock::now();
-						auto duration = now - start;
-						if(duration < voice_hold_interval)
-							voice_hold_flag = true;
-						else
-							voice_hold_flag = false;
-					}
-
-					if(db >= vox_threshold || voice_hold_flag)	{ // only tx if vox threshold met
-						mum.sendAudioData(out_buf, OPUS_FRAME_SIZE);
-						if(!voice_hold_flag) {
-							start = std::chrono::steady_clock::now();
-							first_run_flag = false;
-						}
-					}
-				}
-			} else {
-				std::this_thread::sleep_for(std::chrono::milliseconds(20));
-			}
-		}
-		delete[] out_buf;
-	});
+	WorkerPool pool(workers);
+	BridgeScheduler scheduler(pool, frame_ready);
+	for(auto &bridge : bridges) {
+		scheduler.add(*bridge);
+		network.add(*bridge);
+	}
+	logger.info("%zu bridge(s), %zu worker thread(s)", bridges.size(), pool.getSize());
+	scheduler.start();
+	network.start();
+
+	// new threads inherit their creator's affinity, so the main thread is
+	// pinned after starting all of them. The audio threads tune themselves.
+	std::vector<TunedThread> tuned_threads;
+	for(size_t i = 0; i < pool.getSize(); i++)
+		tuneThread(tuned_threads, "worker " + std::to_string(i), pool.getNativeHandle(i), worker_tuning);
+	tuneThread(tuned_threads, "scheduler", scheduler.getNativeHandle(), worker_tuning);
+	tuneThread(tuned_threads, "network", network.getNativeHandle(), network_tuning);
+	tuneThread(tuned_threads, "logger", async_logger.getNativeHandle(), network_tuning);
+	for(auto &bridge : bridges) {
+		if(bridge->getRecorder() != NULL)
+			tuneThread(tuned_threads, "recorder " + bridge->getConfig().name,
+			           bridge->getRecorder()->getNativeHandle(), network_tuning);
+	}
+	tuneThread(tuned_threads, "main", pthread_self(), network_tuning);
+	bool threads_reported = false;
 
 	// init signal handler
 	struct sigaction action;
@@ -496,51 +778,66 @@ int main(int argc, char *argv[]) {
 	sigemptyset(&action.sa_mask);
 	sigaction(SIGINT, &action, NULL);
 	sigaction(SIGTERM, &action, NULL);
+	action.sa_handler = latencyDumpHandler;
+	sigaction(SIGUSR1, &action, NULL);
 
-	// busy loop until signal is caught
+	// busy loop until signal is caught, periodically reporting receive stats
+	const std::chrono::seconds STATS_INTERVAL(30);
+	std::chrono::steady_clock::time_point last_stats = std::chrono::steady_clock::now();
 	while(!sig_caught) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		// by now the audio callbacks have run and tuned their threads
+		if(!threads_reported) {
+			reportThreads(tuned_threads, configs, backends, tuning_requested, lock_memory, lock_error);
+			threads_reported = true;
+		}
+		// input files are done once their last full frame has been consumed
+		bool finished = true;
+		for(auto &bridge : bridges)
+			finished = finished && bridge->isFinished();
+		if(finished) {
+			logger.info("Input file finished");
+			sig_caught = SIGTERM;
+			break;
+		}
+		std::string command;
+		while(control && control->readLine(command))
+			runCommand(command, bridges);
+		for(auto &bridge : bridges)
+			bridge->pumpReplay();
+		if(latency_dump_requested) {
+			latency_dump_requested = 0;
+			for(auto &bridge : bridges)
+				bridge->logLatency();
+		}
+		if(std::chrono::steady_clock::now() - last_stats >= STATS_INTERVAL) {
+			last_stats = std::chrono::steady_clock::now();
+			if(async_logger.getDropped() > 0)
+				logger.info("log messages dropped: %llu", (unsigned long long) async_logger.getDropped());
+			logger.info("worker tasks: %llu", (unsigned long long) pool.getCompleted());
+			for(auto &bridge : bridges)
+				bridge->logStats();
+		}
 	}
 
 	///////////////////////
 	// CLEAN UP
 	///////////////////////
 	logger.info("Cleaning up...");
+	scheduler.stop();
+	pool.stop();
 
 	///////////////////////////
 	// clean up mumble library
 	///////////////////////////
-	logger.info("Disconnecting...");
-	input_consumer_thread.join();
-	mum.disconnect();
-	mumble_thread.join();
+	network.stop();
 
 	///////////////////////////
-	// clean up audio library
+	// clean up audio backends
 	///////////////////////////
-	logger.info("Cleaning up PortAudio...");
-
-	// close streams
-	logger.info("Closing input stream");
-	err = Pa_CloseStream(input_stream);
-	if(err != paNoError) {
-		logger.error("Failed to close inputstream: %s", Pa_GetErrorText(err));
-		exit(-1);
-	}
-	logger.info("Closing output stream");
-	err = Pa_CloseStream(output_stream);
-	if(err != paNoError) {
-		logger.error("Failed to close output stream: %s", Pa_GetErrorText(err));
-		exit(-1);
-	}
-
-	// terminate PortAudio engine
-	logger.info("Terminating PortAudio engine");
-	err = Pa_Terminate();
-	if(err != paNoError) {
-		logger.error("PortAudio error: %s", Pa_GetErrorText(err));
-		exit(-1);
-	}
+	for(auto &bridge : bridges)
+		bridge->stop();
+	async_logger.stop();
 
 	return 0;
 }
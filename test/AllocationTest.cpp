@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+#include "AllocationCounter.hpp"
+#include "AudioPipeline.hpp"
+#include "DriftController.hpp"
+#include "JitterBufferSet.hpp"
+#include "VadGate.hpp"
+#include "VoxGate.hpp"
+
+
+static const int SAMPLE_RATE = 48000;
+static const int DEVICE_RATE = 44100;
+static const size_t FRAME = 960;			// 20 ms, one Opus frame and one received packet
+static const size_t PLAYOUT_FRAME = 480;	// 10 ms
+static const size_t BUFFER_FRAMES = 512;
+// device buffers or 20 ms steps: the first ones may size buffers, the rest
+// must not allocate
+static const int WARM_UP = 50;
+static const int STEPS = 1000;
+
+/**
+ * @brief Runs step(i) WARM_UP times, then STEPS more times, and returns the
+ * allocations made by the latter
+ */
+template <class Step>
+static uint64_t countSteadyState(Step step) {
+	for(int i = 0; i < WARM_UP; i++)
+		step(i);
+	const uint64_t before = AllocationCounter::getAllocations();
+	for(int i = WARM_UP; i < WARM_UP + STEPS; i++)
+		step(i);
+	return AllocationCounter::getAllocations() - before;
+}
+
+static std::vector<int16_t> noise(size_t len, uint32_t seed) {
+	std::vector<int16_t> pcm(len);
+	for(size_t i = 0; i < len; i++) {
+		seed = seed * 1664525 + 1013904223;
+		pcm[i] = (int16_t) (seed >> 20);
+	}
+	return pcm;
+}
+
+TEST(AllocationTest, TestCounts) {
+	ASSERT_TRUE(AllocationCounter::isEnabled());
+	const uint64_t before = AllocationCounter::getAllocations();
+	int *volatile value = new int(1);
+	delete value;
+	std::vector<int16_t> samples(10);
+	ASSERT_EQ(before + 2, AllocationCounter::getAllocations());
+}
+
+/**
+ * Capture, from a 44.1 kHz stereo card's second channel, then the VOX, the
+ * VAD and the encoder's reads from the capture buffer, as serviceCapture()
+ */
+TEST(AllocationTest, TestCaptureAndVox) {
+	DeviceFormat device;
+	device.rate = DEVICE_RATE;
+	device.inputChannels = 2;
+	device.inputChannel = 1;
+	AudioPipeline pipeline(SAMPLE_RATE, 1, FRAME, 16384, NULL, device);
+	VoxGate vox(SAMPLE_RATE, -60.0, 0.5);
+	VadGate vad(SAMPLE_RATE, FRAME, -60.0, 10, 3);
+	const std::vector<int16_t> input = noise(2 * BUFFER_FRAMES, 1);
+	std::vector<int16_t> wrap(FRAME);
+	SpscRingBuffer<int16_t> &captured = pipeline.getCaptureBuffer();
+	size_t frames = 0;
+
+	const uint64_t allocations = countSteadyState([&](int) {
+		const double now = AudioPipeline::steadySeconds();
+		pipeline.capture(input.data(), BUFFER_FRAMES, now, now);
+		while(int16_t *frame = captured.peekReadLinear(FRAME, wrap.data())) {
+			vox.process(frame, FRAME);
+			vad.process(frame);
+			captured.consumeRead(FRAME);
+			frames++;
+		}
+	});
+	ASSERT_EQ(0, allocations);
+	ASSERT_GT(frames, STEPS / 2);
+}
+
+/**
+ * Received packets from a speaker who keeps talking and from a new session
+ * every talk spurt, mixed, drift corrected and rendered to a 44.1 kHz stereo
+ * card, as MumpiCallback::audio() and servicePlayout()
+ */
+TEST(AllocationTest, TestReceiveAndPlayout) {
+	JitterBufferSet speakers(SAMPLE_RATE, 0.0, 400.0, 4);
+	DriftController drift(SAMPLE_RATE, 4800);
+	DeviceFormat device;
+	device.rate = DEVICE_RATE;
+	device.outputChannels = 2;
+	AudioPipeline pipeline(SAMPLE_RATE, 1, FRAME, 16384, NULL, device);
+	const std::vector<int16_t> packet = noise(FRAME, 2);
+	std::vector<int16_t> frame(PLAYOUT_FRAME);
+	std::vector<int16_t> corrected(DriftController::getMaxOutput(PLAYOUT_FRAME));
+	// 20 ms at the device rate
+	std::vector<int16_t> output(2 * DEVICE_RATE / 50);
+	size_t mixed = 0;
+
+	const uint64_t allocations = countSteadyState([&](int i) {
+		speakers.push(1000, 2 * i, packet.data(), packet.size());
+		// 400 ms spurts 600 ms apart, each from a session not seen before
+		if(i % 50 < 20)
+			speakers.push(1 + i / 50, 2 * i, packet.data(), packet.size());
+
+		for(int j = 0; j < 2; j++) {
+			const size_t active = speakers.pull(frame.data(), frame.size());
+			mixed += active > 1;
+			SpscRingBuffer<int16_t> &playout = pipeline.getPlayoutBuffer();
+			drift.updateFill(playout.getRemaining());
+			const size_t len = drift.process(frame.data(), frame.size(), active == 0,
+			                                 corrected.data(), corrected.size());
+			playout.push(corrected.data(), 0, len);
+		}
+		const double now = AudioPipeline::steadySeconds();
+		pipeline.render(output.data(), output.size() / 2, now, now);
+	});
+	ASSERT_EQ(0, allocations);
+	ASSERT_GT(mixed, 0);
+	ASSERT_EQ(0, speakers.getRejectedPackets());
+	// the long-gone sessions' buffers went to later ones
+	ASSERT_EQ(4, speakers.getStats().size());
+}
@@ -0,0 +1,144 @@
+#include <sstream>
+#include "gtest/gtest.h"
+#include "BridgeConfig.hpp"
+#include "BridgeConfigException.hpp"
+
+
+TEST(BridgeConfigTest, TestParse) {
+	std::istringstream in(
+		"# shared settings\n"
+		"server = 10.0.0.1:1234\n"
+		"vox-threshold = -45\n"
+		"\n"
+		"[repeater]\n"
+		"username = repeater\n"
+		"input-device = USB Audio\n"
+		"\n"
+		"[ marine ]\n"
+		"; overrides the shared server\n"
+		"server = 10.0.0.2\n"
+		"username = marine\n"
+		"full-duplex = yes\n"
+		"sample-rate = 24000\n"
+		"vad = true\n"
+		"vad-pre-roll = 5\n"
+		"frame-ms = 40\n"
+		"bitrate = 16000\n"
+		"device-rate = 44100\n"
+		"resample-quality = high\n"
+		"input-channels = 2\n"
+		"input-channel = 2\n"
+		"output-channels = 2\n"
+		"capture-overflow = drop-oldest\n"
+		"record-dir = /var/lib/mumpi\n"
+		"record-segment = 900\n"
+		"replay-file = /var/lib/mumpi/marine.replay\n"
+		"replay-minutes = 30\n");
+	std::vector<BridgeConfig> bridges = BridgeConfig::parse(in);
+	ASSERT_EQ(2, bridges.size());
+
+	ASSERT_EQ("repeater", bridges[0].name);
+	ASSERT_EQ("10.0.0.1", bridges[0].server);
+	ASSERT_EQ(1234, bridges[0].port);
+	ASSERT_EQ("USB Audio", bridges[0].inputDevice);
+	ASSERT_DOUBLE_EQ(-45.0, bridges[0].voxThreshold);
+	ASSERT_FALSE(bridges[0].fullDuplex);
+	ASSERT_FALSE(bridges[0].vad);
+
+	ASSERT_EQ("marine", bridges[1].name);
+	ASSERT_EQ("10.0.0.2", bridges[1].server);
+	ASSERT_EQ(64738, bridges[1].port);
+	ASSERT_DOUBLE_EQ(-45.0, bridges[1].voxThreshold);
+	ASSERT_TRUE(bridges[1].fullDuplex);
+	ASSERT_EQ(24000, bridges[1].sampleRate);
+	ASSERT_TRUE(bridges[1].vad);
+	ASSERT_EQ(10, bridges[1].vadHangover);
+	ASSERT_EQ(5, bridges[1].vadPreRoll);
+	ASSERT_EQ(40, bridges[1].frameMs);
+	ASSERT_EQ(16000, bridges[1].bitrate);
+	ASSERT_EQ(20, bridges[0].frameMs);
+	ASSERT_EQ(32000, bridges[0].bitrate);
+	ASSERT_EQ(0, bridges[0].deviceRate);
+	ASSERT_EQ(Resampler::MEDIUM, bridges[0].resampleQuality);
+	ASSERT_EQ(44100, bridges[1].deviceRate);
+	ASSERT_EQ(Resampler::HIGH, bridges[1].resampleQuality);
+	ASSERT_EQ(1, bridges[0].inputChannels);
+	ASSERT_EQ(0, bridges[0].inputChannel);
+	ASSERT_EQ(2, bridges[1].inputChannels);
+	ASSERT_EQ(2, bridges[1].inputChannel);
+	ASSERT_EQ(2, bridges[1].outputChannels);
+	ASSERT_EQ(0, bridges[1].outputChannel);
+	ASSERT_EQ(ringbuffer::DROP_NEWEST, bridges[0].captureOverflow);
+	ASSERT_EQ(ringbuffer::DROP_OLDEST, bridges[1].captureOverflow);
+	ASSERT_EQ(ringbuffer::DROP_NEWEST, bridges[1].playoutOverflow);
+	ASSERT_TRUE(bridges[0].recordDir.empty());
+	ASSERT_EQ(3600, bridges[0].recordSegment);
+	ASSERT_EQ("/var/lib/mumpi", bridges[1].recordDir);
+	ASSERT_EQ(900, bridges[1].recordSegment);
+	ASSERT_TRUE(bridges[0].replayFile.empty());
+	ASSERT_EQ(10, bridges[0].replayMinutes);
+	ASSERT_EQ("/var/lib/mumpi/marine.replay", bridges[1].replayFile);
+	ASSERT_EQ(30, bridges[1].replayMinutes);
+	ASSERT_FALSE(bridges[0].sharesDevice(bridges[1]));
+}
+
+TEST(BridgeConfigTest, TestErrors) {
+	const char *invalid[] = {
+		"",											// no bridges
+		"[a]\nserver = s\n",						// no username
+		"[a]\nserver = s\nusername = u\nbogus = 1\n",
+		"[a]\nserver = s\nusername = u\nvoice-hold = soon\n",
+		"[a]\nserver = s\nusername = u\nsample-rate = 44100\n",
+		"[a]\nserver = s\nusername = u\nvad-pre-roll = -1\n",
+		"[a]\nserver = s\nusername = u\nframe-ms = 30\n",
+		"[a]\nserver = s\nusername = u\nbitrate = 1000\n",
+		"[a]\nserver = s\nusername = u\ndevice-rate = 44123\n",
+		"[a]\nserver = s\nusername = u\nresample-quality = best\n",
+		"[a]\nserver = s\nusername = u\ninput-channels = 0\n",
+		"[a]\nserver = s\nusername = u\ninput-channels = 2\ninput-channel = 3\n",
+		"[a]\nserver = s\nusername = u\noutput-channel = left\n",
+		"[a]\nserver = s\nusername = u\nplayout-overflow = bogus\n",
+		"[a]\nserver = s\nusername = u\nrecord-dir = /tmp\nrecord-segment = 10\n",
+		"[a]\nserver = s\nusername = u\nreplay-file = /tmp/a\nreplay-minutes = 0\n",
+		// one history file for two bridges
+		"replay-file = /tmp/r\n[a]\nserver = s\nusername = u\n[b]\nserver = s\nusername = v\n"
+		"input-device = 1\noutput-device = 1\n",
+		// sharing the default sound card at different channel counts
+		"[a]\nserver = s\nusername = u\n[b]\nserver = s\nusername = v\noutput-channels = 2\n",
+		"[a]\nserver = s\nusername = u\n[a]\nserver = s\nusername = v\n",
+		"[a\nserver = s\nusername = u\n",
+		"[a]\nserver s\n"
+	};
+	for(const char *config : invalid) {
+		std::istringstream in(config);
+		ASSERT_THROW(BridgeConfig::parse(in), BridgeConfigException) << config;
+	}
+}
+
+TEST(BridgeConfigTest, TestSharedDevice) {
+	std::istringstream in(
+		"server = s\n"
+		"input-device = USB Audio\n"
+		"output-device = USB Audio\n"
+		"input-channels = 2\n"
+		"output-channels = 2\n"
+		"[left]\n"
+		"username = l\n"
+		"input-channel = 1\n"
+		"output-channel = 1\n"
+		"[right]\n"
+		"username = r\n"
+		"input-channel = 2\n"
+		"output-channel = 2\n"
+		"[other]\n"
+		"username = o\n"
+		"input-device = 2\n"
+		"output-device = 2\n"
+		"input-channels = 1\n"
+		"output-channels = 1\n");
+	std::vector<BridgeConfig> bridges = BridgeConfig::parse(in);
+	ASSERT_EQ(3, bridges.size());
+	ASSERT_TRUE(bridges[0].sharesDevice(bridges[1]));
+	ASSERT_FALSE(bridges[0].sharesDevice(bridges[2]));
+	ASSERT_EQ(48000, bridges[0].getDeviceRate());
+}
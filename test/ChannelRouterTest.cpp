@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+#include "ChannelRouter.hpp"
+
+
+static std::vector<int16_t> noise(size_t len, uint32_t seed) {
+	std::vector<int16_t> pcm(len);
+	for(size_t i = 0; i < len; i++) {
+		seed = seed * 1664525 + 1013904223;
+		pcm[i] = (int16_t) (seed >> 16);
+	}
+	return pcm;
+}
+
+TEST(ChannelRouterTest, TestDownmix) {
+	const int16_t stereo[] = { 100, -7, -3, 2, 32767, 32767, -32768, -32768 };
+	int16_t mono[4];
+	ChannelRouter(2, 0, 1, 0).downmix(stereo, 4, mono);
+	ASSERT_EQ(100, mono[0]);
+	ASSERT_EQ(-3, mono[1]);
+	ChannelRouter(2, 1, 1, 0).downmix(stereo, 4, mono);
+	ASSERT_EQ(-7, mono[0]);
+	ASSERT_EQ(2, mono[1]);
+	// the average, rounded down
+	ChannelRouter(2, ChannelRouter::ALL, 1, 0).downmix(stereo, 4, mono);
+	ASSERT_EQ(46, mono[0]);
+	ASSERT_EQ(-1, mono[1]);
+	ASSERT_EQ(32767, mono[2]);
+	ASSERT_EQ(-32768, mono[3]);
+}
+
+TEST(ChannelRouterTest, TestUpmix) {
+	const int16_t mono[] = { 10, -20 };
+	int16_t stereo[4] = { 1, 1, 1, 1 };
+	ChannelRouter(1, 0, 2, 1).upmix(mono, 2, stereo, false);
+	ASSERT_EQ(0, stereo[0]);
+	ASSERT_EQ(10, stereo[1]);
+	ASSERT_EQ(0, stereo[2]);
+	ASSERT_EQ(-20, stereo[3]);
+
+	// a second pipeline on the left mixes in without touching the right
+	ChannelRouter(1, 0, 2, 0).upmix(mono, 2, stereo, true);
+	ASSERT_EQ(10, stereo[0]);
+	ASSERT_EQ(10, stereo[1]);
+	ASSERT_EQ(-20, stereo[2]);
+	ASSERT_EQ(-20, stereo[3]);
+
+	const int16_t loud[] = { 30000 };
+	int16_t out[2] = { 10000, -10000 };
+	ChannelRouter(1, 0, 2, ChannelRouter::ALL).upmix(loud, 1, out, true);
+	ASSERT_EQ(32767, out[0]);
+	ASSERT_EQ(20000, out[1]);
+}
+
+TEST(ChannelRouterTest, TestKernelsMatchScalar) {
+	// odd lengths leave a scalar tail after the SIMD kernels
+	const size_t FRAMES = 1003;
+	for(int channels = 1; channels <= 3; channels++) {
+		for(int channel = ChannelRouter::ALL; channel < channels; channel++) {
+			const ChannelRouter router(channels, channel, channels, channel);
+			const std::vector<int16_t> device = noise(FRAMES * channels, 1 + channel);
+			const std::vector<int16_t> mono = noise(FRAMES, 7 + channel);
+
+			std::vector<int16_t> expected(FRAMES), actual(FRAMES);
+			router.downmixScalar(device.data(), FRAMES, expected.data());
+			router.downmix(device.data(), FRAMES, actual.data());
+			ASSERT_EQ(expected, actual) << channels << " channels, channel " << channel;
+
+			for(int mix = 0; mix <= 1; mix++) {
+				std::vector<int16_t> expectedOut = device, actualOut = device;
+				router.upmixScalar(mono.data(), FRAMES, expectedOut.data(), mix != 0);
+				router.upmix(mono.data(), FRAMES, actualOut.data(), mix != 0);
+				ASSERT_EQ(expectedOut, actualOut) << channels << " channels, channel " << channel << ", mix " << mix;
+			}
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "CommandPipe.hpp"
+#include "CommandPipeException.hpp"
+
+
+/**
+ * @brief Test fixture for CommandPipe, using a temporary named pipe
+ */
+class CommandPipeTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		_path = "/tmp/mumpi-pipetest-" + std::to_string(getpid());
+	}
+
+	virtual void TearDown() {
+		std::remove(_path.c_str());
+	}
+
+	void write(const std::string &text) {
+		const int fd = open(_path.c_str(), O_WRONLY | O_NONBLOCK);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ((ssize_t) text.size(), ::write(fd, text.data(), text.size()));
+		close(fd);
+	}
+
+	std::string _path;
+};
+
+TEST_F(CommandPipeTest, TestLines) {
+	CommandPipe pipe(_path);
+	std::string line;
+	ASSERT_FALSE(pipe.readLine(line));
+
+	write("replay a 60 30\r\nexport a 60 ");
+	ASSERT_TRUE(pipe.readLine(line));
+	ASSERT_EQ("replay a 60 30", line);
+	// the second line isn't complete yet, and the writer closing isn't an end
+	ASSERT_FALSE(pipe.readLine(line));
+	write("30 /tmp/a.wav\n\n");
+	ASSERT_TRUE(pipe.readLine(line));
+	ASSERT_EQ("export a 60 30 /tmp/a.wav", line);
+	ASSERT_TRUE(pipe.readLine(line));
+	ASSERT_EQ("", line);
+	ASSERT_FALSE(pipe.readLine(line));
+}
+
+TEST_F(CommandPipeTest, TestLongLine) {
+	CommandPipe pipe(_path);
+	std::string line;
+	write(std::string(CommandPipe::MAX_LINE + 500, 'x'));
+	ASSERT_FALSE(pipe.readLine(line));
+	write(std::string(100, 'x') + "\nstats\n");
+	ASSERT_TRUE(pipe.readLine(line));
+	ASSERT_EQ("stats", line);
+}
+
+TEST_F(CommandPipeTest, TestNotAPipe) {
+	FILE *file = fopen(_path.c_str(), "w");
+	ASSERT_TRUE(file != NULL);
+	fclose(file);
+	ASSERT_THROW(CommandPipe pipe(_path), CommandPipeException);
+}
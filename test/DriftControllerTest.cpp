@@ -0,0 +1,107 @@
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "DriftController.hpp"
+
+
+static const int SAMPLE_RATE = 48000;
+static const size_t FRAME = SAMPLE_RATE / 100;
+static const size_t TARGET = SAMPLE_RATE / 20;	// 50 ms
+
+TEST(DriftControllerTest, TestPassThroughAtTarget) {
+	DriftController drift(SAMPLE_RATE, TARGET);
+	std::vector<int16_t> in(FRAME);
+	for(size_t i = 0; i < FRAME; i++)
+		in[i] = (int16_t) i;
+	std::vector<int16_t> out(DriftController::getMaxOutput(FRAME));
+
+	for(int i = 0; i < 100; i++) {
+		drift.updateFill(TARGET);
+		ASSERT_EQ(FRAME, drift.process(in.data(), FRAME, false, out.data(), out.size()));
+		ASSERT_TRUE(std::equal(in.begin(), in.end(), out.begin()));
+	}
+	const DriftStats stats = drift.getStats();
+	ASSERT_EQ(0u, stats.insertedSamples);
+	ASSERT_EQ(0u, stats.droppedSamples);
+	ASSERT_EQ(0.0, stats.correctionPpm);
+}
+
+TEST(DriftControllerTest, TestSilenceDropAndInsert) {
+	std::vector<int16_t> in(FRAME, 0);
+	std::vector<int16_t> out(DriftController::getMaxOutput(FRAME));
+
+	// 20 ms too full: silent frames shrink by at most a tenth
+	DriftController full(SAMPLE_RATE, TARGET);
+	full.updateFill(TARGET + SAMPLE_RATE / 50);
+	ASSERT_EQ(FRAME - FRAME / 10, full.process(in.data(), FRAME, true, out.data(), out.size()));
+	ASSERT_EQ(FRAME / 10, full.getStats().droppedSamples);
+	ASSERT_EQ(1u, full.getStats().silenceAdjustedFrames);
+
+	// 1 ms too empty: inside the deadband, nothing changes
+	DriftController close(SAMPLE_RATE, TARGET);
+	close.updateFill(TARGET - SAMPLE_RATE / 1000);
+	ASSERT_EQ(FRAME, close.process(in.data(), FRAME, true, out.data(), out.size()));
+
+	// 5 ms too empty: insert 48 samples (the tenth-of-a-frame limit)
+	DriftController empty(SAMPLE_RATE, TARGET);
+	empty.updateFill(TARGET - SAMPLE_RATE / 200);
+	ASSERT_EQ(FRAME + FRAME / 10, empty.process(in.data(), FRAME, true, out.data(), out.size()));
+	ASSERT_EQ(FRAME / 10, empty.getStats().insertedSamples);
+}
+
+TEST(DriftControllerTest, TestSpeechIsResampledSmoothly) {
+	DriftController drift(SAMPLE_RATE, TARGET, 2000.0);
+	std::vector<int16_t> in(FRAME);
+	std::vector<int16_t> out(DriftController::getMaxOutput(FRAME));
+	std::vector<int16_t> played;
+
+	// a buffer far too full settles at the maximum correction
+	size_t t = 0;
+	for(int i = 0; i < 200; i++) {
+		for(size_t j = 0; j < FRAME; j++, t++)
+			in[j] = (int16_t) (10000 * std::sin(2 * M_PI * 440.0 * t / SAMPLE_RATE));
+		drift.updateFill(TARGET * 4);
+		const size_t n = drift.process(in.data(), FRAME, false, out.data(), out.size());
+		ASSERT_LE(n, FRAME);
+		played.insert(played.end(), out.begin(), out.begin() + n);
+	}
+	const DriftStats stats = drift.getStats();
+	ASSERT_EQ(2000.0, stats.correctionPpm);
+	ASSERT_GT(stats.droppedSamples, 0u);
+	ASSERT_NEAR(200 * FRAME * 0.998, played.size(), 2.0);
+
+	// no clicks: a 440 Hz sine at 10000 moves at most ~576 per sample
+	for(size_t i = 1; i < played.size(); i++)
+		ASSERT_LE(std::abs(played[i] - played[i - 1]), 600);
+}
+
+/**
+ * Plays 30 minutes of speech into a simulated sound card whose clock runs
+ * driftPpm fast and checks the fill level stays at the target.
+ */
+static void simulateDrift(double driftPpm, bool silent) {
+	DriftController drift(SAMPLE_RATE, TARGET);
+	std::vector<int16_t> in(FRAME, silent ? 0 : 1000);
+	std::vector<int16_t> out(DriftController::getMaxOutput(FRAME));
+
+	double fill = TARGET;
+	const double consumed = FRAME * (1.0 + driftPpm / 1e6);
+	double maxError = 0.0;
+	for(int tick = 0; tick < 30 * 60 * 100; tick++) {
+		drift.updateFill((size_t) fill);
+		fill += drift.process(in.data(), FRAME, silent, out.data(), out.size());
+		fill -= consumed;
+		ASSERT_GT(fill, 0.0);
+		if(tick > 60 * 100)
+			maxError = std::max(maxError, std::fabs(fill - TARGET));
+	}
+	// within 5 ms once settled, without drift the buffer would be 90 ms off
+	ASSERT_LT(maxError, SAMPLE_RATE * 0.005);
+}
+
+TEST(DriftControllerTest, TestHoldsTargetUnderDrift) {
+	simulateDrift(100.0, false);
+	simulateDrift(-100.0, false);
+	simulateDrift(100.0, true);
+	simulateDrift(-100.0, true);
+}
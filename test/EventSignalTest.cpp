@@ -0,0 +1,67 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "EventSignal.hpp"
+
+
+TEST(EventSignalTest, TestNotifyBeforeWait) {
+	EventSignal signal;
+	signal.notify();
+	signal.notify();	// coalesces with the first
+	ASSERT_TRUE(signal.waitFor(std::chrono::seconds(1)));
+	ASSERT_FALSE(signal.waitFor(std::chrono::milliseconds(10)));
+}
+
+TEST(EventSignalTest, TestTimeout) {
+	EventSignal signal;
+	auto start = std::chrono::steady_clock::now();
+	ASSERT_FALSE(signal.waitFor(std::chrono::milliseconds(30)));
+	ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(30));
+}
+
+TEST(EventSignalTest, TestWakesWaiter) {
+	EventSignal signal;
+	const int ROUNDS = 1000;
+	int woken = 0;
+
+	std::thread waiter([&]() {
+		for(int i = 0; i < ROUNDS; i++) {
+			if(signal.waitFor(std::chrono::seconds(5)))
+				woken++;
+		}
+	});
+	for(int i = 0; i < ROUNDS; i++) {
+		signal.notify();
+		// let the waiter consume it so notifications don't coalesce
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+	waiter.join();
+	ASSERT_EQ(ROUNDS, woken);
+}
+
+TEST(EventSignalTest, TestManyNotifiers) {
+	EventSignal signal;
+	const int NOTIFIERS = 4;
+	const int ROUNDS = 20000;
+	std::atomic<int> sent(0);
+
+	std::vector<std::thread> notifiers;
+	for(int n = 0; n < NOTIFIERS; n++) {
+		notifiers.emplace_back([&]() {
+			for(int i = 0; i < ROUNDS; i++) {
+				sent.fetch_add(1);
+				signal.notify();
+			}
+		});
+	}
+	// every increment is followed by a notify(), so while some are unseen a
+	// wakeup is pending and the wait can't time out
+	bool timedOut = false;
+	while(sent.load() < NOTIFIERS * ROUNDS && !timedOut)
+		timedOut = !signal.waitFor(std::chrono::seconds(5));
+	for(auto &notifier : notifiers)
+		notifier.join();
+	ASSERT_FALSE(timedOut);
+}
@@ -0,0 +1,178 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "AudioPipeline.hpp"
+#include "FileAudioBackend.hpp"
+#include "WavFile.hpp"
+
+
+static const int SAMPLE_RATE = 48000;
+static const size_t FRAME = 960;
+static const size_t BUFFER_FRAMES = 512;
+
+TEST(FileAudioBackendTest, TestUnpacedDeliversEverySample) {
+	const std::string base = "/tmp/mumpi-backendtest-" + std::to_string(getpid());
+	const std::string inputPath = base + "-in.wav";
+	const std::string outputPath = base + "-out.wav";
+
+	// several times the capture buffer, so the backend has to wait for the consumer
+	const size_t TOTAL = 100000;
+	{
+		std::vector<int16_t> input(TOTAL);
+		for(size_t i = 0; i < TOTAL; i++)
+			input[i] = (int16_t) i;
+		WavWriter writer(inputPath, SAMPLE_RATE, 1);
+		writer.write(input.data(), input.size());
+	}
+
+	AudioPipeline pipeline(SAMPLE_RATE, 1, FRAME, 8192);
+	const int16_t PLAYOUT[] = {11, 12, 13};
+	pipeline.getPlayoutBuffer().push(PLAYOUT, 0, 3);
+
+	FileAudioBackend backend(inputPath, outputPath, false, BUFFER_FRAMES);
+	backend.start(pipeline);
+
+	// the last partial buffer is padded with zeros to a whole buffer
+	const size_t expected = (TOTAL + BUFFER_FRAMES - 1) / BUFFER_FRAMES * BUFFER_FRAMES;
+	size_t received = 0;
+	bool ordered = true;
+	std::vector<int16_t> chunk(FRAME);
+	while(received < expected) {
+		const size_t n = pipeline.getCaptureBuffer().top(chunk.data(), 0, chunk.size());
+		if(n == 0) {
+			ASSERT_FALSE(backend.isFinished() && pipeline.getCaptureBuffer().isEmpty());
+			pipeline.getFrameReady().waitFor(std::chrono::milliseconds(10));
+			continue;
+		}
+		for(size_t i = 0; i < n; i++) {
+			const int16_t want = received + i < TOTAL ? (int16_t) (received + i) : 0;
+			if(chunk[i] != want)
+				ordered = false;
+		}
+		received += n;
+	}
+	ASSERT_TRUE(ordered);
+	while(!backend.isFinished())
+		std::this_thread::yield();
+	ASSERT_EQ(TOTAL, backend.getFramesCaptured());
+	backend.stop();
+
+	// playout is rendered in step with capture: the queued samples, then silence
+	WavReader reader(outputPath);
+	std::vector<int16_t> out(5, -1);
+	ASSERT_EQ(5, reader.read(out.data(), out.size()));
+	ASSERT_EQ(11, out[0]);
+	ASSERT_EQ(13, out[2]);
+	ASSERT_EQ(0, out[3]);
+
+	std::remove(inputPath.c_str());
+	std::remove(outputPath.c_str());
+}
+
+TEST(FileAudioBackendTest, TestDeviceRate) {
+	const std::string base = "/tmp/mumpi-backendtest-rate-" + std::to_string(getpid());
+	const std::string inputPath = base + "-in.wav";
+	const std::string outputPath = base + "-out.wav";
+	const int DEVICE_RATE = 44100;
+
+	// files at the device rate, resampled to and from the pipeline's 48 kHz
+	{
+		std::vector<int16_t> input(DEVICE_RATE, 1000);
+		WavWriter writer(inputPath, DEVICE_RATE, 1);
+		writer.write(input.data(), input.size());
+	}
+	DeviceFormat device;
+	device.rate = DEVICE_RATE;
+	AudioPipeline pipeline(SAMPLE_RATE, 1, FRAME, 65536, NULL, device);
+	ASSERT_EQ(DEVICE_RATE, pipeline.getDeviceRate());
+	const std::vector<int16_t> playout(SAMPLE_RATE / 10, 2000);
+	pipeline.getPlayoutBuffer().push(playout.data(), 0, playout.size());
+
+	FileAudioBackend backend(inputPath, outputPath, false, BUFFER_FRAMES);
+	backend.start(pipeline);
+	while(!backend.isFinished())
+		std::this_thread::yield();
+	backend.stop();
+
+	// every device buffer becomes 48/44.1 as many samples
+	const size_t deviceFrames = (DEVICE_RATE + BUFFER_FRAMES - 1) / BUFFER_FRAMES * BUFFER_FRAMES;
+	SpscRingBuffer<int16_t> &captured = pipeline.getCaptureBuffer();
+	ASSERT_NEAR(deviceFrames * SAMPLE_RATE / DEVICE_RATE, captured.getRemaining(), 1);
+	std::vector<int16_t> samples(captured.getRemaining());
+	captured.top(samples.data(), 0, samples.size());
+	ASSERT_NEAR(1000, samples[SAMPLE_RATE / 2], 1);
+
+	// 100 ms queued for playout come out as 100 ms at the device rate
+	WavReader reader(outputPath);
+	ASSERT_EQ(DEVICE_RATE, reader.getSampleRate());
+	std::vector<int16_t> out(DEVICE_RATE / 5);
+	ASSERT_EQ(out.size(), reader.read(out.data(), out.size()));
+	ASSERT_NEAR(2000, out[DEVICE_RATE / 20], 1);
+	ASSERT_EQ(0, out[DEVICE_RATE / 10 + 100]);
+
+	std::remove(inputPath.c_str());
+	std::remove(outputPath.c_str());
+}
+
+TEST(FileAudioBackendTest, TestSharedStereo) {
+	const std::string base = "/tmp/mumpi-backendtest-stereo-" + std::to_string(getpid());
+	const std::string inputPath = base + "-in.wav";
+	const std::string outputPath = base + "-out.wav";
+	const size_t FRAMES = 8192;
+
+	// one radio on each channel of a stereo file
+	{
+		std::vector<int16_t> input(2 * FRAMES);
+		for(size_t i = 0; i < FRAMES; i++) {
+			input[2 * i] = 1000;
+			input[2 * i + 1] = -500;
+		}
+		WavWriter writer(inputPath, SAMPLE_RATE, 2);
+		writer.write(input.data(), input.size());
+	}
+	DeviceFormat left, right;
+	left.inputChannels = right.inputChannels = 2;
+	left.outputChannels = right.outputChannels = 2;
+	left.inputChannel = left.outputChannel = 0;
+	right.inputChannel = right.outputChannel = 1;
+	AudioPipeline leftPipeline(SAMPLE_RATE, 1, FRAME, 16384, NULL, left);
+	AudioPipeline rightPipeline(SAMPLE_RATE, 1, FRAME, 16384, NULL, right);
+	const std::vector<int16_t> leftPlayout(1000, 2000), rightPlayout(500, 3000);
+	leftPipeline.getPlayoutBuffer().push(leftPlayout.data(), 0, leftPlayout.size());
+	rightPipeline.getPlayoutBuffer().push(rightPlayout.data(), 0, rightPlayout.size());
+
+	// the files are opened once both bridges have started
+	FileAudioBackend backend(inputPath, outputPath, false, BUFFER_FRAMES, 2);
+	backend.start(leftPipeline);
+	ASSERT_FALSE(backend.isFinished());
+	backend.start(rightPipeline);
+	while(!backend.isFinished())
+		std::this_thread::yield();
+	backend.stop();
+
+	std::vector<int16_t> samples(FRAMES);
+	ASSERT_EQ(FRAMES, leftPipeline.getCaptureBuffer().getRemaining());
+	leftPipeline.getCaptureBuffer().top(samples.data(), 0, FRAMES);
+	ASSERT_EQ(std::vector<int16_t>(FRAMES, 1000), samples);
+	ASSERT_EQ(FRAMES, rightPipeline.getCaptureBuffer().getRemaining());
+	rightPipeline.getCaptureBuffer().top(samples.data(), 0, FRAMES);
+	ASSERT_EQ(std::vector<int16_t>(FRAMES, -500), samples);
+
+	// each bridge plays on its own channel of the stereo output
+	WavReader reader(outputPath);
+	ASSERT_EQ(2, reader.getChannels());
+	std::vector<int16_t> out(2 * 2000);
+	ASSERT_EQ(out.size(), reader.read(out.data(), out.size()));
+	ASSERT_EQ(2000, out[2 * 400]);
+	ASSERT_EQ(3000, out[2 * 400 + 1]);
+	ASSERT_EQ(2000, out[2 * 700]);
+	ASSERT_EQ(0, out[2 * 700 + 1]);
+	ASSERT_EQ(0, out[2 * 1500]);
+	ASSERT_EQ(0, out[2 * 1500 + 1]);
+
+	std::remove(inputPath.c_str());
+	std::remove(outputPath.c_str());
+}
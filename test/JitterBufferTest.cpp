@@ -0,0 +1,213 @@
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "JitterBuffer.hpp"
+#include "JitterBufferSet.hpp"
+
+
+static const int SAMPLE_RATE = 48000;
+static const size_t PACKET_SAMPLES = 960;	// 20 ms, advances the sequence by 2
+
+/**
+ * @brief Test fixture for JitterBuffer
+ */
+class JitterBufferTest : public ::testing::Test {
+protected:
+	JitterBufferTest() :
+		_jitterBuffer(SAMPLE_RATE, 40.0, 400.0),
+		_start(std::chrono::steady_clock::now()) {
+	}
+
+	// pushes a 20 ms packet filled with value, arriving at ms after start
+	void pushPacket(int seq, int16_t value, int ms) {
+		std::vector<int16_t> pcm(PACKET_SAMPLES, value);
+		_jitterBuffer.push(seq, pcm.data(), pcm.size(), _start + std::chrono::milliseconds(ms));
+	}
+
+	// pulls one 20 ms packet worth and returns its last sample, or -1 if nothing
+	// played. The first samples after concealed audio are crossfaded.
+	int pullPacket() {
+		std::vector<int16_t> pcm(PACKET_SAMPLES, -1);
+		const size_t n = _jitterBuffer.pull(pcm.data(), pcm.size());
+		if(n == 0)
+			return -1;
+		EXPECT_EQ(PACKET_SAMPLES, n);
+		return pcm[n - 1];
+	}
+
+	JitterBuffer _jitterBuffer;
+	std::chrono::steady_clock::time_point _start;
+};
+
+TEST_F(JitterBufferTest, TestBuffersToTargetDelay) {
+	pushPacket(0, 1, 0);
+	ASSERT_EQ(-1, pullPacket());	// 20 ms buffered, target is 40 ms
+	pushPacket(2, 2, 20);
+	ASSERT_EQ(1, pullPacket());
+	ASSERT_EQ(2, pullPacket());
+	ASSERT_EQ(-1, pullPacket());	// ran dry, rebuffers for the next talk spurt
+	ASSERT_TRUE(_jitterBuffer.isIdle());
+	ASSERT_EQ(1, _jitterBuffer.getStats().underruns);
+}
+
+TEST_F(JitterBufferTest, TestReorders) {
+	pushPacket(0, 1, 0);
+	pushPacket(4, 3, 20);
+	pushPacket(2, 2, 21);
+	ASSERT_EQ(1, pullPacket());
+	ASSERT_EQ(2, pullPacket());
+	ASSERT_EQ(3, pullPacket());
+	JitterBufferStats stats = _jitterBuffer.getStats();
+	ASSERT_EQ(3, stats.received);
+	ASSERT_EQ(1, stats.reordered);
+	ASSERT_EQ(0, stats.lost);
+}
+
+TEST_F(JitterBufferTest, TestReportsArrival) {
+	pushPacket(2, 2, 25);
+	pushPacket(0, 1, 30);
+	std::vector<int16_t> pcm(PACKET_SAMPLES);
+	JitterBuffer::TimePoint arrival;
+	// each pull reports the arrival of the packet its first sample came from
+	ASSERT_EQ(PACKET_SAMPLES, _jitterBuffer.pull(pcm.data(), pcm.size(), &arrival));
+	ASSERT_TRUE(arrival == _start + std::chrono::milliseconds(30));
+	ASSERT_EQ(PACKET_SAMPLES, _jitterBuffer.pull(pcm.data(), pcm.size(), &arrival));
+	ASSERT_TRUE(arrival == _start + std::chrono::milliseconds(25));
+}
+
+TEST_F(JitterBufferTest, TestLateAndLost) {
+	pushPacket(0, 1, 0);
+	pushPacket(4, 3, 40);
+	ASSERT_EQ(1, pullPacket());
+	ASSERT_EQ(1, pullPacket());	// seq 2 missing, the last audio is repeated
+	ASSERT_EQ(3, pullPacket());
+	pushPacket(2, 2, 60);			// arrives after its playout time
+	JitterBufferStats stats = _jitterBuffer.getStats();
+	ASSERT_EQ(2, stats.lost);		// two 10 ms frames
+	ASSERT_EQ(2, stats.concealed);
+	ASSERT_EQ(1, stats.late);
+}
+
+TEST_F(JitterBufferTest, TestConcealsLoss) {
+	// a 200 Hz tone, period 240 samples, with packet seq 4 lost
+	std::vector<int16_t> tone(5 * PACKET_SAMPLES);
+	for(size_t i = 0; i < tone.size(); i++)
+		tone[i] = (int16_t) (10000.0 * std::sin(2.0 * M_PI * 200.0 * i / SAMPLE_RATE));
+	for(int p = 0; p < 5; p++) {
+		if(p != 2)
+			_jitterBuffer.push(2 * p, &tone[p * PACKET_SAMPLES], PACKET_SAMPLES, _start);
+	}
+
+	std::vector<int16_t> out(5 * PACKET_SAMPLES, 0);
+	for(int p = 0; p < 5; p++)
+		ASSERT_EQ(PACKET_SAMPLES, _jitterBuffer.pull(&out[p * PACKET_SAMPLES], PACKET_SAMPLES));
+
+	// the tone continues through the gap and the 2.5 ms crossfade after it
+	// without a jump
+	const size_t resumed = 3 * PACKET_SAMPLES + SAMPLE_RATE / 400;
+	for(size_t i = 2 * PACKET_SAMPLES; i < resumed; i++)
+		ASSERT_NEAR(tone[i], out[i], 500) << "sample " << i;
+	for(size_t i = resumed; i < out.size(); i++)
+		ASSERT_EQ(tone[i], out[i]);
+	JitterBufferStats stats = _jitterBuffer.getStats();
+	ASSERT_EQ(2, stats.lost);
+	ASSERT_EQ(2, stats.concealed);
+}
+
+TEST_F(JitterBufferTest, TestSkipsLongGaps) {
+	pushPacket(0, 1, 0);
+	pushPacket(50, 3, 500);		// after a 480 ms gap
+	ASSERT_EQ(1, pullPacket());
+	ASSERT_EQ(3, pullPacket());
+	JitterBufferStats stats = _jitterBuffer.getStats();
+	ASSERT_EQ(48, stats.lost);
+	ASSERT_EQ(0, stats.concealed);
+}
+
+TEST_F(JitterBufferTest, TestDuplicate) {
+	pushPacket(0, 1, 0);
+	pushPacket(0, 1, 1);
+	ASSERT_EQ(1, _jitterBuffer.getStats().duplicates);
+	ASSERT_EQ(PACKET_SAMPLES, _jitterBuffer.getStats().depthSamples);
+}
+
+TEST_F(JitterBufferTest, TestOverlappingPacketsDrain) {
+	// seq 1 starts inside the 20 ms packet seq 0
+	pushPacket(0, 1, 0);
+	pushPacket(1, 2, 1);
+	ASSERT_EQ(1, pullPacket());
+	ASSERT_EQ(-1, pullPacket());	// seq 1 is behind the playout position
+	ASSERT_TRUE(_jitterBuffer.isIdle());
+
+	// one arriving inside the packet being played is refused
+	pushPacket(2, 3, 500);
+	pushPacket(4, 4, 520);
+	ASSERT_EQ(3, pullPacket());
+	pushPacket(5, 5, 540);
+	ASSERT_EQ(4, pullPacket());
+	ASSERT_EQ(-1, pullPacket());
+	ASSERT_TRUE(_jitterBuffer.isIdle());
+	JitterBufferStats stats = _jitterBuffer.getStats();
+	ASSERT_EQ(1, stats.duplicates);
+	ASSERT_EQ(0, stats.lost);
+	ASSERT_EQ(0, stats.concealed);
+}
+
+TEST_F(JitterBufferTest, TestTargetFollowsJitter) {
+	// perfectly paced arrivals keep the minimum delay
+	for(int i = 0; i < 20; i++)
+		pushPacket(2 * i, 1, 20 * i);
+	ASSERT_NEAR(0.0, _jitterBuffer.getStats().jitterMs, 0.01);
+	ASSERT_EQ(1920, _jitterBuffer.getStats().targetDelaySamples);
+
+	// bursty arrivals raise the target delay
+	JitterBuffer bursty(SAMPLE_RATE, 40.0, 400.0);
+	std::vector<int16_t> pcm(PACKET_SAMPLES, 1);
+	for(int i = 0; i < 20; i++) {
+		const int ms = (i / 4) * 80 + (i % 2) * 15;
+		bursty.push(2 * i, pcm.data(), pcm.size(), _start + std::chrono::milliseconds(ms));
+	}
+	JitterBufferStats stats = bursty.getStats();
+	ASSERT_GT(stats.jitterMs, 5.0);
+	ASSERT_GT(stats.targetDelaySamples, 1920);
+	ASSERT_LE(stats.targetDelaySamples, 400 * SAMPLE_RATE / 1000);
+}
+
+TEST(JitterBufferSetTest, TestMixesSpeakers) {
+	JitterBufferSet speakers(SAMPLE_RATE, 0.0, 400.0);
+	std::vector<int16_t> a(PACKET_SAMPLES, 1000);
+	std::vector<int16_t> b(PACKET_SAMPLES, 30000);
+	speakers.push(1, 0, a.data(), a.size());
+	speakers.push(2, 0, b.data(), b.size());
+	speakers.push(3, 0, b.data(), b.size());
+
+	std::vector<int16_t> out(PACKET_SAMPLES);
+	ASSERT_EQ(3, speakers.pull(out.data(), out.size()));
+	ASSERT_EQ(INT16_MAX, out[0]);	// saturated instead of wrapping
+
+	ASSERT_EQ(0, speakers.pull(out.data(), out.size()));
+	ASSERT_EQ(0, out[0]);
+	ASSERT_EQ(3, speakers.getStats().size());
+}
+
+TEST(JitterBufferSetTest, TestReusesIdleBuffers) {
+	JitterBufferSet speakers(SAMPLE_RATE, 0.0, 400.0, 2);
+	std::vector<int16_t> pcm(PACKET_SAMPLES, 1000);
+	std::vector<int16_t> out(PACKET_SAMPLES);
+	speakers.push(1, 0, pcm.data(), pcm.size());
+	speakers.push(2, 0, pcm.data(), pcm.size());
+	// both buffers busy
+	speakers.push(3, 0, pcm.data(), pcm.size());
+	ASSERT_EQ(1, speakers.getRejectedPackets());
+	ASSERT_EQ(2, speakers.pull(out.data(), out.size()));
+
+	// once drained, session 1's buffer goes to session 3, without its stats
+	speakers.push(2, 2, pcm.data(), pcm.size());
+	ASSERT_EQ(1, speakers.pull(out.data(), out.size()));
+	speakers.push(3, 0, pcm.data(), pcm.size());
+	std::map<int, JitterBufferStats> stats = speakers.getStats();
+	ASSERT_EQ(2, stats.size());
+	ASSERT_EQ(1, stats.count(3));
+	ASSERT_EQ(1, stats[3].received);
+	ASSERT_EQ(2, stats[2].received);
+}
@@ -0,0 +1,54 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "LatencyHistogram.hpp"
+
+
+TEST(LatencyHistogramTest, TestBucketsCoverRange) {
+	// every value lands in the bucket whose bounds contain it
+	for(uint64_t us : {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 20000ull, 123456789ull}) {
+		const size_t index = LatencyHistogram::bucketIndex(us);
+		ASSERT_LE(LatencyHistogram::bucketLowerBound(index), us);
+		ASSERT_GT(LatencyHistogram::bucketLowerBound(index + 1), us);
+	}
+	for(size_t index = 1; index < 500; index++)
+		ASSERT_GT(LatencyHistogram::bucketLowerBound(index), LatencyHistogram::bucketLowerBound(index - 1));
+}
+
+TEST(LatencyHistogramTest, TestSummary) {
+	LatencyHistogram histogram("test");
+	LatencySummary summary = histogram.getSummary();
+	ASSERT_EQ(0u, summary.count);
+	ASSERT_EQ(0.0, summary.p99Us);
+
+	// 1..1000 ms in 1 ms steps
+	for(int ms = 1; ms <= 1000; ms++)
+		histogram.record(ms * 1000);
+	histogram.record(-5);	// clock step: counted as 0
+
+	summary = histogram.getSummary();
+	ASSERT_EQ(1001u, summary.count);
+	ASSERT_EQ(1000000.0, summary.maxUs);
+	ASSERT_NEAR(500000.0, summary.p50Us, 500000.0 * 0.07);
+	ASSERT_NEAR(990000.0, summary.p99Us, 990000.0 * 0.07);
+	ASSERT_NEAR(500000.0, summary.meanUs, 1000.0);
+}
+
+TEST(LatencyHistogramTest, TestConcurrentRecord) {
+	LatencyHistogram histogram("test");
+	const int THREADS = 4;
+	const int PER_THREAD = 100000;
+	std::vector<std::thread> threads;
+	for(int t = 0; t < THREADS; t++) {
+		threads.push_back(std::thread([&histogram, t]() {
+			for(int i = 0; i < PER_THREAD; i++)
+				histogram.record(t * 1000 + i % 100);
+		}));
+	}
+	for(auto &thread : threads)
+		thread.join();
+
+	const LatencySummary summary = histogram.getSummary();
+	ASSERT_EQ((uint64_t) THREADS * PER_THREAD, summary.count);
+	ASSERT_EQ((THREADS - 1) * 1000 + 99, summary.maxUs);
+}
@@ -0,0 +1,18 @@
+#include <chrono>
+#include "gtest/gtest.h"
+#include "LogRateLimiter.hpp"
+
+
+TEST(LogRateLimiterTest, TestLimitsAndCountsSuppressed) {
+	LogRateLimiter limiter(2.0);	// one every 500 ms
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t suppressed = 99;
+
+	ASSERT_TRUE(limiter.allow(suppressed, start));
+	ASSERT_EQ(0u, suppressed);
+	for(int ms = 10; ms < 500; ms += 10)
+		ASSERT_FALSE(limiter.allow(suppressed, start + std::chrono::milliseconds(ms)));
+	ASSERT_TRUE(limiter.allow(suppressed, start + std::chrono::milliseconds(500)));
+	ASSERT_EQ(49u, suppressed);
+	ASSERT_FALSE(limiter.allow(suppressed, start + std::chrono::milliseconds(600)));
+}
@@ -0,0 +1,51 @@
+#include <string>
+#include "gtest/gtest.h"
+#include "LogRecord.hpp"
+
+
+static std::string format(const LogRecord &record) {
+	char buf[256];
+	record.formatTo(buf, sizeof(buf));
+	return buf;
+}
+
+TEST(LogRecordTest, TestFormatsLikePrintf) {
+	LogRecord record;
+	const size_t samples = 512;
+	const uint32_t size = 960;
+	record.capture(NULL, 600, "requested %zu available %d size %u", samples, -3, size);
+	ASSERT_EQ("requested 512 available -3 size 960", format(record));
+
+	record.capture(NULL, 600, "dB: %.2f hex %04x %s%%", -42.125, 255, "done");
+	ASSERT_EQ("dB: -42.12 hex 00ff done%", format(record));
+
+	// 64-bit values keep their width even with a mismatched length modifier
+	record.capture(NULL, 600, "%d %llu", (int64_t) 1 << 40, (uint64_t) 7);
+	ASSERT_EQ("1099511627776 7", format(record));
+}
+
+TEST(LogRecordTest, TestCopiesStrings) {
+	LogRecord record;
+	std::string message = "hello";
+	record.capture(NULL, 600, "text: %s, %-6s|", message, "two");
+	message = "changed";
+	ASSERT_EQ("text: hello, two   |", format(record));
+
+	// too long for the record: truncated, not overflowing
+	const std::string longText(500, 'x');
+	record.capture(NULL, 600, "%s %d", longText, 5);
+	const std::string formatted = format(record);
+	ASSERT_EQ(LogRecord::TEXT_SIZE - 1 + 2, formatted.size());
+	ASSERT_EQ(" 5", formatted.substr(formatted.size() - 2));
+}
+
+TEST(LogRecordTest, TestMissingArguments) {
+	LogRecord record;
+	record.capture(NULL, 600, "a %d b %d", 1);
+	ASSERT_EQ("a 1 b %d", format(record));
+
+	char small[8];
+	record.capture(NULL, 600, "value %d", 123456);
+	ASSERT_EQ(7u, record.formatTo(small, sizeof(small)));
+	ASSERT_STREQ("value 1", small);
+}
@@ -0,0 +1,58 @@
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Mixer.hpp"
+
+
+TEST(MixerTest, TestKernelsMatchScalar) {
+	// odd length exercises the scalar tail after the vector loop
+	const size_t LEN = 1003;
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+
+	std::vector<int32_t> acc(LEN, 0);
+	std::vector<int32_t> accRef(LEN, 0);
+	for(int speaker = 0; speaker < 16; speaker++) {
+		std::vector<int16_t> src(LEN);
+		for(auto &sample : src)
+			sample = (int16_t) dist(rng);
+		Mixer::accumulate(acc.data(), src.data(), LEN);
+		Mixer::accumulateScalar(accRef.data(), src.data(), LEN);
+	}
+	ASSERT_EQ(accRef, acc);
+
+	std::vector<int16_t> out(LEN);
+	std::vector<int16_t> outRef(LEN);
+	Mixer::saturate(out.data(), acc.data(), LEN);
+	Mixer::saturateScalar(outRef.data(), accRef.data(), LEN);
+	ASSERT_EQ(outRef, out);
+}
+
+TEST(MixerTest, TestSaturatesOnlyAtTheEnd) {
+	Mixer mixer(16);
+	std::vector<int16_t> loud(16, 30000);
+	std::vector<int16_t> quiet(16, -30000);
+	std::vector<int16_t> out(16);
+
+	// +30000 +30000 -30000 is 30000, not clipped by an intermediate sum
+	mixer.clear(16);
+	mixer.add(loud.data(), 16);
+	mixer.add(loud.data(), 16);
+	mixer.add(quiet.data(), 16);
+	mixer.mixTo(out.data());
+	ASSERT_EQ(3, mixer.getSourceCount());
+	ASSERT_EQ(30000, out[15]);
+
+	mixer.clear(16);
+	mixer.add(loud.data(), 16);
+	mixer.add(loud.data(), 8);	// shorter source is silent for the rest
+	mixer.mixTo(out.data());
+	ASSERT_EQ(INT16_MAX, out[0]);
+	ASSERT_EQ(30000, out[8]);
+
+	mixer.clear(16);
+	mixer.add(quiet.data(), 16);
+	mixer.add(quiet.data(), 16);
+	mixer.mixTo(out.data());
+	ASSERT_EQ(INT16_MIN, out[0]);
+}
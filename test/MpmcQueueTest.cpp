@@ -0,0 +1,65 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "MpmcQueue.hpp"
+
+
+TEST(MpmcQueueTest, TestPushPop) {
+	MpmcQueue<int> queue(3);
+	ASSERT_EQ(4, queue.getSize());	// rounded up to a power of 2
+
+	int val = -1;
+	ASSERT_FALSE(queue.pop(val));
+	for(int i = 0; i < 4; i++)
+		ASSERT_TRUE(queue.push(i));
+	ASSERT_FALSE(queue.push(4));	// full
+	for(int i = 0; i < 4; i++) {
+		ASSERT_TRUE(queue.pop(val));
+		ASSERT_EQ(i, val);
+	}
+	ASSERT_FALSE(queue.pop(val));
+
+	// wraps around
+	for(int lap = 0; lap < 10; lap++) {
+		ASSERT_TRUE(queue.push(lap));
+		ASSERT_TRUE(queue.pop(val));
+		ASSERT_EQ(lap, val);
+	}
+}
+
+TEST(MpmcQueueTest, TestConcurrentProducers) {
+	const int PRODUCERS = 4;
+	const int PER_PRODUCER = 200000;
+	MpmcQueue<int> queue(256);
+	std::atomic<int> done(0);
+
+	std::vector<std::thread> producers;
+	for(int p = 0; p < PRODUCERS; p++) {
+		producers.push_back(std::thread([&queue, &done, p]() {
+			for(int i = 0; i < PER_PRODUCER; i++) {
+				while(!queue.push(p * PER_PRODUCER + i))
+					std::this_thread::yield();
+			}
+			done++;
+		}));
+	}
+
+	// every value arrives exactly once, and each producer's values in order
+	std::vector<int> next(PRODUCERS, 0);
+	int received = 0;
+	while(received < PRODUCERS * PER_PRODUCER) {
+		int val;
+		if(!queue.pop(val)) {
+			std::this_thread::yield();
+			continue;
+		}
+		const int producer = val / PER_PRODUCER;
+		ASSERT_EQ(next[producer], val % PER_PRODUCER);
+		next[producer]++;
+		received++;
+	}
+	for(auto &thread : producers)
+		thread.join();
+	ASSERT_EQ(PRODUCERS, done.load());
+}
@@ -0,0 +1,56 @@
+#include <vector>
+#include "gtest/gtest.h"
+#include "MumbleWire.hpp"
+#include "MumbleWireException.hpp"
+
+
+TEST(MumbleWireTest, TestProtobufRoundTrip) {
+	ProtoWriter writer;
+	writer.addVarint(1, 42);
+	writer.addString(3, "mumpi");
+	writer.addVarint(4, 0x123456789ULL);
+	const std::vector<uint8_t> &data = writer.getData();
+
+	ProtoReader reader(data.data(), data.size());
+	ASSERT_TRUE(reader.next());
+	ASSERT_EQ(1, reader.getField());
+	ASSERT_EQ(42, reader.getVarint());
+	ASSERT_TRUE(reader.next());
+	ASSERT_EQ(3, reader.getField());
+	ASSERT_EQ(ProtoReader::LENGTH_DELIMITED, reader.getWireType());
+	ASSERT_EQ("mumpi", reader.getString());
+	ASSERT_TRUE(reader.next());
+	ASSERT_EQ(0x123456789ULL, reader.getVarint());
+	ASSERT_FALSE(reader.next());
+
+	// truncated in the middle of the string
+	ProtoReader truncated(data.data(), 5);
+	ASSERT_TRUE(truncated.next());
+	ASSERT_THROW(truncated.next(), MumbleWireException);
+}
+
+TEST(MumbleWireTest, TestVoiceVarint) {
+	const int64_t values[] = { 0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000,
+	                           0xfffffff, 0x10000000, 0xffffffffLL, 0x100000000LL,
+	                           -1, -4, -5, -100000 };
+	const size_t sizes[] = { 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 9, 1, 1, 2, 4 };
+	for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		uint8_t buf[MumbleWire::MAX_VARINT_SIZE];
+		ASSERT_EQ(sizes[i], MumbleWire::writeVarint(values[i], buf)) << values[i];
+		int64_t val;
+		ASSERT_EQ(sizes[i], MumbleWire::readVarint(buf, sizes[i], val));
+		ASSERT_EQ(values[i], val);
+	}
+}
+
+TEST(MumbleWireTest, TestFrame) {
+	const std::vector<uint8_t> payload = {1, 2, 3};
+	const std::vector<uint8_t> message = MumbleWire::frame(MumbleMessageType::SERVER_SYNC, payload);
+	ASSERT_EQ(MumbleWire::HEADER_SIZE + 3, message.size());
+	uint16_t type;
+	uint32_t len;
+	MumbleWire::parseHeader(message.data(), type, len);
+	ASSERT_EQ(5, type);
+	ASSERT_EQ(3, len);
+	ASSERT_EQ(3, message.back());
+}
@@ -0,0 +1,166 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "OggOpusWriter.hpp"
+
+
+// one parsed Ogg page
+struct Page {
+	uint8_t flags;
+	uint64_t granule;
+	uint32_t serial;
+	uint32_t sequence;
+	std::vector<std::vector<unsigned char>> packets;	// packets ending on the page
+};
+
+static uint64_t getLe(const unsigned char *p, int bytes) {
+	uint64_t val = 0;
+	for(int i = bytes - 1; i >= 0; i--)
+		val = (val << 8) | p[i];
+	return val;
+}
+
+/**
+ * Splits a stream into pages, checking each page's capture pattern and CRC
+ */
+static std::vector<Page> parse(const std::vector<unsigned char> &data) {
+	std::vector<Page> pages;
+	size_t pos = 0;
+	while(pos < data.size()) {
+		const unsigned char *header = &data[pos];
+		EXPECT_EQ("OggS", std::string((const char*) header, 4));
+		Page page;
+		page.flags = header[5];
+		page.granule = getLe(header + 6, 8);
+		page.serial = (uint32_t) getLe(header + 14, 4);
+		page.sequence = (uint32_t) getLe(header + 18, 4);
+		const uint32_t crc = (uint32_t) getLe(header + 22, 4);
+		const size_t segments = header[26];
+		size_t bodyLen = 0;
+		for(size_t i = 0; i < segments; i++)
+			bodyLen += header[27 + i];
+		const size_t pageLen = 27 + segments + bodyLen;
+
+		std::vector<unsigned char> copy(header, header + pageLen);
+		copy[22] = copy[23] = copy[24] = copy[25] = 0;
+		EXPECT_EQ(crc, OggOpusWriter::checksum(copy.data(), copy.size()));
+
+		const unsigned char *body = header + 27 + segments;
+		std::vector<unsigned char> packet;
+		for(size_t i = 0; i < segments; i++) {
+			packet.insert(packet.end(), body, body + header[27 + i]);
+			body += header[27 + i];
+			if(header[27 + i] < 255) {
+				page.packets.push_back(packet);
+				packet.clear();
+			}
+		}
+		EXPECT_TRUE(packet.empty()) << "packets don't span pages";
+		pages.push_back(page);
+		pos += pageLen;
+	}
+	return pages;
+}
+
+TEST(OggOpusWriterTest, TestChecksum) {
+	// CRC-32 with polynomial 0x04c11db7, init 0, no reflection or final XOR
+	const std::string check = "123456789";
+	ASSERT_EQ(0x89a1897fu, OggOpusWriter::checksum((const unsigned char*) check.data(), check.size()));
+}
+
+TEST(OggOpusWriterTest, TestHeaders) {
+	OggOpusWriter writer(1234, 24000, 312, "mumpi", {"BRIDGE=repeater", "DIRECTION=transmitted"});
+	std::vector<Page> pages = parse(writer.getPages());
+	ASSERT_EQ(2, pages.size());
+	ASSERT_EQ(2, writer.getPageCount());
+
+	// OpusHead alone on the first page
+	ASSERT_EQ(0x02, pages[0].flags);
+	ASSERT_EQ(0u, pages[0].granule);
+	ASSERT_EQ(1234u, pages[0].serial);
+	ASSERT_EQ(0u, pages[0].sequence);
+	ASSERT_EQ(1, pages[0].packets.size());
+	const std::vector<unsigned char> &head = pages[0].packets[0];
+	ASSERT_EQ(19, head.size());
+	ASSERT_EQ("OpusHead", std::string(head.begin(), head.begin() + 8));
+	ASSERT_EQ(1, head[8]);
+	ASSERT_EQ(1, head[9]);
+	ASSERT_EQ(312u, getLe(&head[10], 2));
+	ASSERT_EQ(24000u, getLe(&head[12], 4));
+	ASSERT_EQ(0, head[18]);
+
+	// then OpusTags
+	ASSERT_EQ(0, pages[1].flags);
+	ASSERT_EQ(1u, pages[1].sequence);
+	ASSERT_EQ(1, pages[1].packets.size());
+	const std::vector<unsigned char> &tags = pages[1].packets[0];
+	ASSERT_EQ("OpusTags", std::string(tags.begin(), tags.begin() + 8));
+	ASSERT_EQ(5u, getLe(&tags[8], 4));
+	ASSERT_EQ("mumpi", std::string(tags.begin() + 12, tags.begin() + 17));
+	ASSERT_EQ(2u, getLe(&tags[17], 4));
+	ASSERT_EQ(15u, getLe(&tags[21], 4));
+	ASSERT_EQ("BRIDGE=repeater", std::string(tags.begin() + 25, tags.begin() + 40));
+}
+
+TEST(OggOpusWriterTest, TestPackets) {
+	OggOpusWriter writer(7, 48000, 312, "mumpi", {});
+	writer.getPages().clear();
+
+	// lengths around the 255 byte lacing boundaries
+	const size_t lengths[] = { 1, 254, 255, 256, 510, 3 };
+	std::vector<std::vector<unsigned char>> written;
+	for(size_t len : lengths) {
+		written.push_back(std::vector<unsigned char>(len, (unsigned char) len));
+		ASSERT_TRUE(writer.writePacket(written.back().data(), len, 960));
+	}
+	// nothing is complete until a second of audio or a flush
+	ASSERT_TRUE(writer.getPages().empty());
+	writer.flush();
+	writer.finish();
+	ASSERT_TRUE(writer.isFinished());
+	ASSERT_FALSE(writer.writePacket(written[0].data(), 1, 960));
+
+	std::vector<Page> pages = parse(writer.getPages());
+	ASSERT_EQ(2, pages.size());
+	ASSERT_EQ(written, pages[0].packets);
+	ASSERT_EQ(6u * 960, pages[0].granule);
+	ASSERT_EQ(2u, pages[0].sequence);
+	// the end of stream page carries no packets
+	ASSERT_EQ(0x04, pages[1].flags);
+	ASSERT_EQ(6u * 960, pages[1].granule);
+	ASSERT_TRUE(pages[1].packets.empty());
+}
+
+TEST(OggOpusWriterTest, TestPageLimits) {
+	OggOpusWriter writer(7, 48000, 312, "mumpi", {});
+	writer.getPages().clear();
+	const unsigned char dtx = 0x08;
+
+	// 20 ms packets: a page closes after a second of audio
+	for(int i = 0; i < 60; i++)
+		writer.writePacket(&dtx, 1, 960);
+	std::vector<Page> pages = parse(writer.getPages());
+	ASSERT_EQ(1, pages.size());
+	ASSERT_EQ(50, pages[0].packets.size());
+	ASSERT_EQ(48000u, pages[0].granule);
+
+	// 2.5 ms packets: the lacing table fills first
+	writer.getPages().clear();
+	for(int i = 0; i < 300; i++)
+		writer.writePacket(&dtx, 1, 120);
+	writer.finish();
+	pages = parse(writer.getPages());
+	ASSERT_EQ(2, pages.size());
+	ASSERT_EQ(255, pages[0].packets.size());
+	ASSERT_EQ(48000u + 10 * 960 + 245 * 120, pages[0].granule);
+	// finish() puts what's left on the end of stream page
+	ASSERT_EQ(55, pages[1].packets.size());
+	ASSERT_EQ(0x04, pages[1].flags);
+	ASSERT_EQ(48000u + 10 * 960 + 300 * 120, pages[1].granule);
+
+	std::vector<unsigned char> huge(OggOpusWriter::MAX_PACKET_BYTES + 1);
+	OggOpusWriter other(8, 48000, 312, "mumpi", {});
+	ASSERT_FALSE(other.writePacket(huge.data(), huge.size(), 960));
+	ASSERT_TRUE(other.writePacket(huge.data(), huge.size() - 1, 960));
+}
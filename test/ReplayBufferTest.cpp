@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "AllocationCounter.hpp"
+#include "AudioPipeline.hpp"
+#include "ReplayBuffer.hpp"
+#include "WavFile.hpp"
+
+static const int RATE = 12000;
+static const size_t BLOCK = RATE / 100;
+
+
+/**
+ * @brief Test fixture for ReplayBuffer, using temporary files
+ */
+class ReplayBufferTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		_path = "/tmp/mumpi-replaytest-" + std::to_string(getpid());
+	}
+
+	virtual void TearDown() {
+		std::remove(_path.c_str());
+		std::remove((_path + ".wav").c_str());
+	}
+
+	std::string _path;
+};
+
+static std::vector<int16_t> ramp(size_t len, int16_t first) {
+	std::vector<int16_t> samples(len);
+	std::iota(samples.begin(), samples.end(), first);
+	return samples;
+}
+
+TEST_F(ReplayBufferTest, TestAppendAndExtract) {
+	ReplayBuffer buffer(_path, RATE, 10.0);
+	ASSERT_FALSE(buffer.isRestored());
+	ASSERT_EQ(2000, buffer.getBlockCount());
+
+	// frames that aren't a multiple of the block size
+	const std::vector<int16_t> transmitted = ramp(1000, -500);
+	const std::vector<int16_t> received = ramp(300, 1000);
+	const double now = AudioPipeline::steadySeconds();
+	buffer.append(ReplayBuffer::TRANSMITTED, transmitted.data(), 700, now - 300.0 / RATE);
+	buffer.append(ReplayBuffer::TRANSMITTED, transmitted.data() + 700, 300, now);
+	buffer.append(ReplayBuffer::RECEIVED, received.data(), received.size(), now);
+	ASSERT_EQ(6 + 3 + 3, buffer.getBlocksWritten());
+
+	const double wall = ReplayBuffer::wallSeconds();
+	ASSERT_EQ(transmitted, buffer.extract(ReplayBuffer::TRANSMITTED, wall - 5.0, wall + 1.0, 0.0));
+	ASSERT_EQ(received, buffer.extract(ReplayBuffer::RECEIVED, wall - 5.0, wall + 1.0, 0.0));
+	// nothing before the audio
+	ASSERT_TRUE(buffer.extract(ReplayBuffer::TRANSMITTED, wall - 5.0, wall - 1.0, 0.0).empty());
+
+	// a window in the middle is cut to the sample
+	const double start = wall - 1000.0 / RATE;
+	std::vector<int16_t> middle = buffer.extract(ReplayBuffer::TRANSMITTED, start + 0.01, start + 0.05, 0.0);
+	ASSERT_NEAR(480, (double) middle.size(), 2.0);
+	ASSERT_NEAR(transmitted[120], middle[0], 2.0);
+}
+
+TEST_F(ReplayBufferTest, TestGaps) {
+	ReplayBuffer buffer(_path, RATE, 10.0);
+	const std::vector<int16_t> spurt = ramp(2 * BLOCK, 1);
+	const double now = AudioPipeline::steadySeconds();
+	// two 20 ms spurts, the second starting a second after the first ended
+	buffer.append(ReplayBuffer::TRANSMITTED, spurt.data(), spurt.size(), now - 1.02);
+	buffer.append(ReplayBuffer::TRANSMITTED, spurt.data(), spurt.size(), now);
+
+	const double wall = ReplayBuffer::wallSeconds();
+	std::vector<int16_t> full = buffer.extract(ReplayBuffer::TRANSMITTED, wall - 1.04, wall, 10.0);
+	ASSERT_NEAR(2 * spurt.size() + RATE, (double) full.size(), 2.0);
+	ASSERT_EQ(1, full[0]);
+	ASSERT_EQ(0, full[spurt.size() + RATE / 2]);
+
+	// gaps shortened, including the one before the first spurt
+	std::vector<int16_t> shortened = buffer.extract(ReplayBuffer::TRANSMITTED, wall - 2.0, wall, 0.25);
+	ASSERT_NEAR(2 * spurt.size() + 2 * RATE / 4, (double) shortened.size(), 2.0);
+}
+
+TEST_F(ReplayBufferTest, TestWrapAround) {
+	ReplayBuffer buffer(_path, RATE, 1.0);
+	ASSERT_EQ(200, buffer.getBlockCount());
+	const double now = AudioPipeline::steadySeconds();
+	// 3 s of transmitted audio in one go: the first second is overwritten
+	const std::vector<int16_t> audio = ramp(3 * RATE, -18000);
+	buffer.append(ReplayBuffer::TRANSMITTED, audio.data(), audio.size(), now);
+	ASSERT_EQ(300, buffer.getBlocksWritten());
+
+	const double wall = ReplayBuffer::wallSeconds();
+	std::vector<int16_t> kept = buffer.extract(ReplayBuffer::TRANSMITTED, wall - 10.0, wall + 1.0, 0.0);
+	ASSERT_EQ(std::vector<int16_t>(audio.begin() + RATE, audio.end()), kept);
+}
+
+TEST_F(ReplayBufferTest, TestRestore) {
+	const std::vector<int16_t> audio = ramp(5 * BLOCK, 7);
+	{
+		ReplayBuffer buffer(_path, RATE, 2.0);
+		buffer.append(ReplayBuffer::RECEIVED, audio.data(), audio.size(), AudioPipeline::steadySeconds());
+	}
+	const double wall = ReplayBuffer::wallSeconds();
+	{
+		ReplayBuffer buffer(_path, RATE, 2.0);
+		ASSERT_TRUE(buffer.isRestored());
+		ASSERT_EQ(5, buffer.getBlocksWritten());
+		ASSERT_EQ(audio, buffer.extract(ReplayBuffer::RECEIVED, wall - 5.0, wall + 1.0, 0.0));
+		// appending carries on after the restored blocks
+		buffer.append(ReplayBuffer::RECEIVED, audio.data(), BLOCK, AudioPipeline::steadySeconds());
+		ASSERT_EQ(6, buffer.getBlocksWritten());
+	}
+	// a different length starts over
+	ReplayBuffer buffer(_path, RATE, 3.0);
+	ASSERT_FALSE(buffer.isRestored());
+	ASSERT_EQ(0, buffer.getBlocksWritten());
+	ASSERT_TRUE(buffer.extract(ReplayBuffer::RECEIVED, wall - 5.0, wall + 1.0, 0.0).empty());
+}
+
+TEST_F(ReplayBufferTest, TestExportWav) {
+	ReplayBuffer buffer(_path, RATE, 10.0);
+	const std::vector<int16_t> transmitted = ramp(4 * BLOCK, 100);
+	const std::vector<int16_t> received = ramp(2 * BLOCK, -100);
+	const double now = AudioPipeline::steadySeconds();
+	buffer.append(ReplayBuffer::TRANSMITTED, transmitted.data(), transmitted.size(), now);
+	buffer.append(ReplayBuffer::RECEIVED, received.data(), received.size(), now);
+
+	// the window starts half a second before the audio, at the oldest block
+	const double wall = ReplayBuffer::wallSeconds();
+	const double from = wall - 0.04 - 0.5;
+	const uint64_t frames = buffer.exportWav(_path + ".wav", from, wall + 0.1);
+	ASSERT_NEAR(transmitted.size(), (double) frames, 2.0);
+
+	WavReader reader(_path + ".wav");
+	ASSERT_TRUE(reader.isWav());
+	ASSERT_EQ(2, reader.getChannels());
+	ASSERT_EQ(RATE, reader.getSampleRate());
+	std::vector<int16_t> stereo(2 * frames + 2);
+	ASSERT_EQ(2 * frames, reader.read(stereo.data(), stereo.size()));
+	ASSERT_NEAR(transmitted.front(), stereo[0], 2.0);
+	ASSERT_EQ(0, stereo[1]);
+	// both tracks end together, transmitted on the left
+	ASSERT_EQ(transmitted.back(), stereo[2 * frames - 2]);
+	ASSERT_EQ(received.back(), stereo[2 * frames - 1]);
+}
+
+TEST_F(ReplayBufferTest, TestExportClampsWindow) {
+	ReplayBuffer buffer(_path, RATE, 1.0);
+	const std::vector<int16_t> frame = ramp(2 * BLOCK, 1);
+	buffer.append(ReplayBuffer::TRANSMITTED, frame.data(), frame.size(), AudioPipeline::steadySeconds());
+	ASSERT_NEAR(ReplayBuffer::wallSeconds() - 0.02, buffer.getOldestTime(), 0.01);
+
+	// an hour either side of one 20 ms frame is just the frame
+	const double wall = ReplayBuffer::wallSeconds();
+	const uint64_t frames = buffer.exportWav(_path + ".wav", wall - 3600.0, wall + 3600.0);
+	ASSERT_NEAR(frame.size(), (double) frames, 2.0);
+}
+
+TEST_F(ReplayBufferTest, TestAppendDoesNotAllocate) {
+	ReplayBuffer buffer(_path, RATE, 1.0);
+	const std::vector<int16_t> frame = ramp(2 * BLOCK, 0);
+	const uint64_t before = AllocationCounter::getAllocations();
+	for(int i = 0; i < 500; i++)
+		buffer.append(i % 2 ? ReplayBuffer::RECEIVED : ReplayBuffer::TRANSMITTED,
+		              frame.data(), frame.size(), AudioPipeline::steadySeconds());
+	ASSERT_EQ(before, AllocationCounter::getAllocations());
+}
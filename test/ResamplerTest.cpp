@@ -0,0 +1,125 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Resampler.hpp"
+
+
+static const size_t CHUNK = 256;
+
+// streams input through the resampler in CHUNK frame calls
+static std::vector<int16_t> resample(Resampler &resampler, const std::vector<int16_t> &input, int channels) {
+	std::vector<int16_t> output;
+	std::vector<int16_t> buffer(resampler.getMaxOutput(CHUNK) * channels);
+	const size_t frames = input.size() / channels;
+	for(size_t pos = 0; pos < frames; pos += CHUNK) {
+		const size_t len = std::min(CHUNK, frames - pos);
+		const size_t produced = resampler.process(&input[pos * channels], len, buffer.data());
+		EXPECT_LE(produced, resampler.getMaxOutput(len));
+		output.insert(output.end(), buffer.begin(), buffer.begin() + produced * channels);
+	}
+	return output;
+}
+
+static std::vector<int16_t> sine(int rate, double frequency, double amplitude, size_t len) {
+	std::vector<int16_t> pcm(len);
+	for(size_t i = 0; i < len; i++)
+		pcm[i] = (int16_t) std::lrint(amplitude * std::sin(2.0 * M_PI * frequency * i / rate));
+	return pcm;
+}
+
+// RMS difference in dB between output and the ideal sine at the output rate,
+// delayed by the filter, after the filter has filled
+static double errorDb(const Resampler &resampler, const std::vector<int16_t> &output,
+                      double frequency, double amplitude) {
+	const int rate = resampler.getOutRate();
+	const size_t settle = (size_t) (2.0 * resampler.getDelay() * rate) + 1;
+	double error = 0.0, signal = 0.0;
+	for(size_t i = settle; i < output.size(); i++) {
+		const double expected = amplitude * std::sin(2.0 * M_PI * frequency * ((double) i / rate - resampler.getDelay()));
+		error += (output[i] - expected) * (output[i] - expected);
+		signal += expected * expected;
+	}
+	return 10.0 * std::log10(error / signal);
+}
+
+TEST(ResamplerTest, TestRatios) {
+	EXPECT_EQ(160u, Resampler::getPhases(44100, 48000));
+	EXPECT_EQ(147u, Resampler::getPhases(48000, 44100));
+	EXPECT_EQ(3u, Resampler::getPhases(16000, 48000));
+	EXPECT_EQ(1u, Resampler::getPhases(48000, 16000));
+
+	// one second in, one second out: output starts with the filter still
+	// filling rather than after its delay
+	const int rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 16000, 48000 }, { 48000, 16000 } };
+	for(const auto &rate : rates) {
+		Resampler resampler(rate[0], rate[1], 1, Resampler::MEDIUM, CHUNK);
+		const std::vector<int16_t> output = resample(resampler, std::vector<int16_t>(rate[0], 0), 1);
+		EXPECT_EQ((size_t) rate[1], output.size()) << rate[0] << " -> " << rate[1];
+	}
+}
+
+TEST(ResamplerTest, TestPassband) {
+	const int rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 16000, 48000 }, { 48000, 16000 } };
+	for(const auto &rate : rates) {
+		for(int quality = Resampler::LOW; quality <= Resampler::HIGH; quality++) {
+			Resampler resampler(rate[0], rate[1], 1, (Resampler::Quality) quality, CHUNK);
+			const std::vector<int16_t> output = resample(resampler, sine(rate[0], 1000.0, 16000.0, rate[0] / 2), 1);
+			// int16 rounding alone is about -90 dB at this level
+			EXPECT_LT(errorDb(resampler, output, 1000.0, 16000.0), quality == Resampler::LOW ? -50.0 : -70.0)
+					<< rate[0] << " -> " << rate[1] << " " << Resampler::getQualityName((Resampler::Quality) quality);
+		}
+	}
+}
+
+TEST(ResamplerTest, TestStopband) {
+	// 48 kHz -> 16 kHz: 12 kHz is above the output's Nyquist frequency and
+	// must not alias down to 4 kHz
+	for(int quality = Resampler::LOW; quality <= Resampler::HIGH; quality++) {
+		Resampler resampler(48000, 16000, 1, (Resampler::Quality) quality, CHUNK);
+		const std::vector<int16_t> output = resample(resampler, sine(48000, 12000.0, 30000.0, 48000), 1);
+		double sum = 0.0;
+		for(size_t i = 1000; i < output.size(); i++)
+			sum += (double) output[i] * output[i];
+		const double db = 10.0 * std::log10(sum / (output.size() - 1000) / (30000.0 * 30000.0 / 2) + 1e-20);
+		EXPECT_LT(db, quality == Resampler::LOW ? -55.0 : -75.0) << Resampler::getQualityName((Resampler::Quality) quality);
+	}
+}
+
+TEST(ResamplerTest, TestInputNeeded) {
+	// pulling exactly what getInputNeeded() asks for gives exactly the
+	// requested output, as for a playout buffer
+	const int rates[][2] = { { 48000, 44100 }, { 44100, 48000 }, { 48000, 16000 }, { 16000, 48000 } };
+	for(const auto &rate : rates) {
+		Resampler resampler(rate[0], rate[1], 1, Resampler::MEDIUM, CHUNK);
+		std::vector<int16_t> input(CHUNK, 1000);
+		std::vector<int16_t> output(resampler.getMaxOutput(CHUNK));
+		const size_t maxRequest = (CHUNK - 2) * rate[1] / rate[0] - 1;
+		for(size_t i = 0; i < 200; i++) {
+			const size_t request = 1 + (i * 37) % std::min<size_t>(maxRequest, 200);
+			const size_t needed = resampler.getInputNeeded(request);
+			ASSERT_LE(needed, CHUNK);
+			ASSERT_EQ(request, resampler.process(input.data(), needed, output.data(), request))
+					<< rate[0] << " -> " << rate[1] << " call " << i;
+		}
+		EXPECT_EQ(1000, output[0]);		// settled to the input's DC level
+	}
+}
+
+TEST(ResamplerTest, TestChannels) {
+	// stereo: a tone on the left and silence on the right stay separate
+	const std::vector<int16_t> left = sine(44100, 440.0, 10000.0, 22050);
+	std::vector<int16_t> input(left.size() * 2, 0);
+	for(size_t i = 0; i < left.size(); i++)
+		input[i * 2] = left[i];
+	Resampler resampler(44100, 48000, 2, Resampler::MEDIUM, CHUNK);
+	const std::vector<int16_t> output = resample(resampler, input, 2);
+	ASSERT_EQ(0u, output.size() % 2);
+
+	std::vector<int16_t> outLeft(output.size() / 2);
+	for(size_t i = 0; i < outLeft.size(); i++) {
+		outLeft[i] = output[i * 2];
+		ASSERT_EQ(0, output[i * 2 + 1]);
+	}
+	EXPECT_LT(errorDb(resampler, outLeft, 440.0, 10000.0), -60.0);
+}
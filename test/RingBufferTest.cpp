@@ -1,5 +1,7 @@
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <numeric>
 #include "gtest/gtest.h"
 #include "RingBuffer.hpp"
 
@@ -142,6 +144,40 @@ TEST_F(RingBufferTest, TestWrapOverwrite) {
 	}
 }
 
+TEST_F(RingBufferTest, TestPushLargerThanSize) {
+	std::array<int, 25> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+
+	// only the newest NUM_ELEMENTS survive
+	_pRingBuffer->push(tempBuf.begin(), 0, 3);
+	_pRingBuffer->push(tempBuf.begin(), 3, 22);
+	ASSERT_EQ(NUM_ELEMENTS, _pRingBuffer->getRemaining());
+	ASSERT_EQ(_pRingBuffer->getFront(), _pRingBuffer->getBack());
+	for(int i = 25 - NUM_ELEMENTS; i < 25; i++) {
+		ASSERT_EQ(tempBuf[i], _pRingBuffer->top());
+	}
+}
+
+TEST(RingBufferPowerOf2Test, TestMaskedWrapOverwrite) {
+	RingBuffer<int16_t> ringBuffer(16);
+	ASSERT_TRUE(ringBuffer.isPowerOf2Size());
+
+	std::array<int16_t, 40> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+
+	// push 12, read 12, then push 20 which wraps and overwrites the oldest 4
+	ringBuffer.push(tempBuf.data(), 0, 12);
+	std::array<int16_t, 16> out;
+	ASSERT_EQ(12, ringBuffer.top(out.data(), 0, 12));
+	ringBuffer.push(tempBuf.data(), 12, 20);
+	ASSERT_EQ(16, ringBuffer.getRemaining());
+	ASSERT_EQ(16, ringBuffer.topRemaining(out.data()));
+	for(int i = 0; i < 16; i++) {
+		ASSERT_EQ(tempBuf[16+i], out[i]);
+	}
+	ASSERT_FALSE(RingBuffer<int>(NUM_ELEMENTS).isPowerOf2Size());
+}
+
 int main(int argc, char **argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include "SampleTimeline.hpp"
+
+
+TEST(SampleTimelineTest, TestTimeAtInterpolates) {
+	SampleTimeline timeline(48000);
+	double time = -1.0;
+	ASSERT_FALSE(timeline.timeAt(0, time));
+
+	// two 512-sample capture buffers
+	ASSERT_TRUE(timeline.mark(0, 10.0));
+	ASSERT_TRUE(timeline.mark(512, 10.0 + 512 / 48000.0 + 0.001));
+
+	ASSERT_TRUE(timeline.timeAt(480, time));
+	ASSERT_DOUBLE_EQ(10.0 + 480 / 48000.0, time);
+	// past the second mark: interpolated from it, including its 1 ms offset
+	ASSERT_TRUE(timeline.timeAt(959, time));
+	ASSERT_DOUBLE_EQ(10.0 + 959 / 48000.0 + 0.001, time);
+}
+
+TEST(SampleTimelineTest, TestPopBefore) {
+	SampleTimeline timeline(48000);
+	timeline.mark(100, 1.0);
+	timeline.mark(600, 2.0);
+
+	SampleTimeline::Mark mark;
+	ASSERT_FALSE(timeline.popBefore(100, mark));
+	ASSERT_TRUE(timeline.popBefore(512, mark));
+	ASSERT_EQ(100u, mark.sampleIndex);
+	ASSERT_EQ(1.0, mark.time);
+	ASSERT_FALSE(timeline.popBefore(512, mark));
+	ASSERT_TRUE(timeline.popBefore(1024, mark));
+	ASSERT_EQ(600u, mark.sampleIndex);
+}
+
+TEST(SampleTimelineTest, TestFullDropsMarks) {
+	SampleTimeline timeline(48000, 2);
+	ASSERT_TRUE(timeline.mark(0, 0.0));
+	ASSERT_TRUE(timeline.mark(1, 0.0));
+	ASSERT_FALSE(timeline.mark(2, 0.0));
+}
@@ -0,0 +1,121 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+#include "SpectralVad.hpp"
+#include "VadGate.hpp"
+#include "VoxDetector.hpp"
+
+
+static const int SAMPLE_RATE = 48000;
+static const size_t FRAME = 960;	// 20 ms
+
+// white noise at about level (peak amplitude), from a fixed LCG
+static void addNoise(std::vector<int16_t> &frame, double level, uint32_t &seed) {
+	for(size_t i = 0; i < frame.size(); i++) {
+		seed = seed * 1664525 + 1013904223;
+		frame[i] = (int16_t) (frame[i] + (int32_t) seed / 2147483648.0 * level);
+	}
+}
+
+// voiced speech stand-in: 20 harmonics of a 150 Hz pitch, falling in level
+static void addVoice(std::vector<int16_t> &frame, double level, uint64_t &n) {
+	for(size_t i = 0; i < frame.size(); i++, n++) {
+		double v = 0.0;
+		for(int h = 1; h <= 20; h++)
+			v += std::sin(2.0 * M_PI * 150.0 * h * n / SAMPLE_RATE) / h;
+		frame[i] = (int16_t) (frame[i] + level * v / 3.0);
+	}
+}
+
+TEST(SpectralVadTest, TestPowerSpectrumMatchesDft) {
+	SpectralVad vad(SAMPLE_RATE, FRAME, -40.0);
+	std::vector<int16_t> frame(FRAME, 0);
+	uint32_t seed = 7;
+	uint64_t n = 0;
+	addNoise(frame, 2000.0, seed);
+	addVoice(frame, 5000.0, n);
+	vad.isVoice(frame.data());
+
+	const size_t fftSize = vad.getFftSize();
+	ASSERT_EQ(1024u, fftSize);
+	const std::vector<float> &power = vad.getPowerSpectrum();
+	ASSERT_EQ(fftSize / 2 + 1, power.size());
+
+	double peak = 0.0;
+	std::vector<double> expected(power.size());
+	for(size_t k = 0; k < expected.size(); k++) {
+		double re = 0.0, im = 0.0;
+		for(size_t i = 0; i < FRAME; i++) {
+			const double x = frame[i] * (0.5 - 0.5 * std::cos(2.0 * M_PI * i / FRAME));
+			re += x * std::cos(2.0 * M_PI * k * i / fftSize);
+			im -= x * std::sin(2.0 * M_PI * k * i / fftSize);
+		}
+		expected[k] = re * re + im * im;
+		peak = std::max(peak, expected[k]);
+	}
+	for(size_t k = 0; k < expected.size(); k++)
+		ASSERT_NEAR(expected[k], power[k], peak * 1e-4) << "bin " << k;
+}
+
+TEST(SpectralVadTest, TestRejectsStatic) {
+	SpectralVad vad(SAMPLE_RATE, FRAME, -40.0);
+	VoxDetector vox(-40.0);
+	uint32_t seed = 1;
+	uint64_t n = 0;
+
+	// steady static at about -50 dB, then a burst at about -25 dB that
+	// the energy VOX keys up on
+	for(int f = 0; f < 100; f++) {
+		std::vector<int16_t> frame(FRAME, 0);
+		addNoise(frame, f < 80 ? 180.0 : 3200.0, seed);
+		ASSERT_FALSE(vad.isVoice(frame.data())) << "frame " << f;
+		if(f >= 80) {
+			ASSERT_TRUE(vox.isVoice(frame.data(), FRAME));
+		}
+	}
+	ASSERT_GT(vad.getLastFlatness(), 0.4);
+
+	// voice over the static is detected from its first frame
+	for(int f = 0; f < 10; f++) {
+		std::vector<int16_t> frame(FRAME, 0);
+		addNoise(frame, 180.0, seed);
+		addVoice(frame, 6000.0, n);
+		ASSERT_TRUE(vad.isVoice(frame.data())) << "frame " << f;
+	}
+	ASSERT_LT(vad.getLastFlatness(), 0.3);
+	ASSERT_GT(vad.getLastSnrDb(), 6.0);
+}
+
+TEST(SpectralVadTest, TestGatePreRollAndHangover) {
+	VadGate gate(SAMPLE_RATE, FRAME, -40.0, 2, 3);
+	uint64_t n = 0;
+	std::vector<int16_t> voice(FRAME, 0);
+	addVoice(voice, 6000.0, n);
+
+	// quiet frames, each marked by its value, are held for the pre-roll
+	for(int16_t f = 1; f <= 5; f++) {
+		std::vector<int16_t> quiet(FRAME, f);
+		ASSERT_FALSE(gate.process(quiet.data()));
+		ASSERT_EQ(0u, gate.getPreRollCount());
+	}
+	ASSERT_TRUE(gate.process(voice.data()));
+	ASSERT_EQ(3u, gate.getPreRollCount());
+	ASSERT_EQ(3, gate.getPreRoll(0)[0]);	// oldest first
+	ASSERT_EQ(4, gate.getPreRoll(1)[0]);
+	ASSERT_EQ(5, gate.getPreRoll(2)[0]);
+
+	// two frames of hangover, then quiet frames are held again
+	std::vector<int16_t> quiet(FRAME, 9);
+	ASSERT_TRUE(gate.process(quiet.data()));
+	ASSERT_EQ(0u, gate.getPreRollCount());
+	ASSERT_TRUE(gate.process(quiet.data()));
+	ASSERT_FALSE(gate.process(quiet.data()));
+	ASSERT_TRUE(gate.process(voice.data()));
+	ASSERT_EQ(1u, gate.getPreRollCount());
+	ASSERT_EQ(9, gate.getPreRoll(0)[0]);
+
+	ASSERT_EQ(10u, gate.getFrames());
+	ASSERT_EQ(2u, gate.getVoiceFrames());
+	ASSERT_EQ(8u, gate.getTransmittedFrames());
+}
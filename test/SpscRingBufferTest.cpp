@@ -0,0 +1,382 @@
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "RingBuffer.hpp"
+#include "SpscRingBuffer.hpp"
+
+
+static const int NUM_ELEMENTS = 10;
+
+/**
+ * @brief Test fixture for SpscRingBuffer
+ */
+class SpscRingBufferTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		_pRingBuffer = new SpscRingBuffer<int>(NUM_ELEMENTS);
+	}
+
+	virtual void TearDown() {
+		delete _pRingBuffer;
+	}
+
+	SpscRingBuffer<int> *_pRingBuffer;
+};
+
+TEST_F(SpscRingBufferTest, TestPush) {
+	ASSERT_TRUE(_pRingBuffer->push(0));
+	ASSERT_TRUE(_pRingBuffer->push(1));
+	ASSERT_TRUE(_pRingBuffer->push(2));
+	ASSERT_EQ(NUM_ELEMENTS, _pRingBuffer->getSize());
+	ASSERT_EQ(3, _pRingBuffer->getRemaining());
+	ASSERT_EQ(0, _pRingBuffer->top());
+	ASSERT_EQ(1, _pRingBuffer->top());
+	ASSERT_EQ(2, _pRingBuffer->top());
+	ASSERT_TRUE(_pRingBuffer->isEmpty());
+}
+
+TEST_F(SpscRingBufferTest, TestTopEmpty) {
+	ASSERT_TRUE(_pRingBuffer->isEmpty());
+	ASSERT_THROW(_pRingBuffer->top(), EmptyBufferException);
+	int dest[1];
+	ASSERT_EQ(0, _pRingBuffer->top(dest, 0, 1));
+}
+
+TEST_F(SpscRingBufferTest, TestPushTopBulk) {
+	std::array<int, 5> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+
+	ASSERT_EQ(5, _pRingBuffer->push(tempBuf.data(), 0, 5));
+	tempBuf.fill(-1);
+	ASSERT_EQ(5, _pRingBuffer->top(tempBuf.data(), 0, 10));
+	for(int i = 0; i < 5; i++) {
+		ASSERT_EQ(i, tempBuf[i]);
+	}
+	ASSERT_TRUE(_pRingBuffer->isEmpty());
+}
+
+TEST_F(SpscRingBufferTest, TestFullDropsNewest) {
+	std::array<int, 12> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+
+	// only NUM_ELEMENTS fit, the last two are dropped instead of overwriting
+	ASSERT_EQ(NUM_ELEMENTS, _pRingBuffer->push(tempBuf.data(), 0, 12));
+	ASSERT_EQ(0, _pRingBuffer->getFree());
+	ASSERT_FALSE(_pRingBuffer->push(99));
+	for(int i = 0; i < NUM_ELEMENTS; i++) {
+		ASSERT_EQ(i, _pRingBuffer->top());
+	}
+}
+
+TEST_F(SpscRingBufferTest, TestWrap) {
+	std::array<int, 12> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+
+	_pRingBuffer->push(tempBuf.data(), 0, 5);
+	for(int i = 0; i < 5; i++) {
+		ASSERT_EQ(tempBuf[i], _pRingBuffer->top());
+	}
+
+	// push 7 in, should wrap 2
+	ASSERT_EQ(7, _pRingBuffer->push(tempBuf.data(), 5, 7));
+	std::array<int, 7> out;
+	ASSERT_EQ(7, _pRingBuffer->topRemaining(out.data()));
+	for(int i = 0; i < 7; i++) {
+		ASSERT_EQ(tempBuf[5+i], out[i]);
+	}
+}
+
+TEST_F(SpscRingBufferTest, TestReserveCommit) {
+	// reserve more than fits: region is clamped to the free space
+	SpscRingBuffer<int>::Region region = _pRingBuffer->reserveWrite(12);
+	ASSERT_EQ(NUM_ELEMENTS, region.len);
+	for(int i = 0; i < 6; i++)
+		region.data[i] = i;
+	ASSERT_TRUE(_pRingBuffer->isEmpty());	// nothing visible before commit
+	_pRingBuffer->commitWrite(6);
+	ASSERT_EQ(6, _pRingBuffer->getRemaining());
+
+	region = _pRingBuffer->peekRead(4);
+	ASSERT_EQ(4, region.len);
+	ASSERT_EQ(0, region.data[0]);
+	ASSERT_EQ(3, region.data[3]);
+	_pRingBuffer->consumeRead(4);
+	ASSERT_EQ(2, _pRingBuffer->getRemaining());
+
+	// free space now wraps: first region runs to the end of the storage
+	region = _pRingBuffer->reserveWrite(8);
+	ASSERT_EQ(4, region.len);
+	_pRingBuffer->commitWrite(0);
+}
+
+TEST_F(SpscRingBufferTest, TestPeekReadLinear) {
+	std::array<int, 14> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+	std::array<int, NUM_ELEMENTS> scratch;
+	scratch.fill(-1);
+
+	_pRingBuffer->push(tempBuf.data(), 0, 6);
+	ASSERT_EQ(NULL, _pRingBuffer->peekReadLinear(7, scratch.data()));
+
+	// contiguous: points into the buffer, scratch untouched
+	int *frame = _pRingBuffer->peekReadLinear(6, scratch.data());
+	ASSERT_NE(scratch.data(), frame);
+	ASSERT_EQ(5, frame[5]);
+	_pRingBuffer->consumeRead(6);
+
+	// wrapped: copied into scratch
+	_pRingBuffer->push(tempBuf.data(), 6, 8);
+	frame = _pRingBuffer->peekReadLinear(8, scratch.data());
+	ASSERT_EQ(scratch.data(), frame);
+	for(int i = 0; i < 8; i++) {
+		ASSERT_EQ(tempBuf[6+i], frame[i]);
+	}
+	_pRingBuffer->consumeRead(8);
+	ASSERT_TRUE(_pRingBuffer->isEmpty());
+}
+
+TEST_F(SpscRingBufferTest, TestTopPadded) {
+	std::array<int, 3> tempBuf = {{7, 8, 9}};
+	std::array<int, 6> out;
+	out.fill(-1);
+
+	_pRingBuffer->push(tempBuf.data(), 0, 3);
+	ASSERT_EQ(3, _pRingBuffer->topPadded(out.data(), 1, 5, 0));
+	std::array<int, 6> expected = {{-1, 7, 8, 9, 0, 0}};
+	ASSERT_EQ(expected, out);
+	ASSERT_TRUE(_pRingBuffer->isEmpty());
+}
+
+TEST_F(SpscRingBufferTest, TestDropNewestCounts) {
+	std::array<int, 12> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+	ASSERT_EQ(NUM_ELEMENTS, _pRingBuffer->push(tempBuf.data(), 0, 12));
+	ASSERT_FALSE(_pRingBuffer->push(99));
+	const ringbuffer::Stats stats = _pRingBuffer->getStats();
+	ASSERT_EQ(3, stats.dropped);
+	ASSERT_EQ(0, stats.overwritten);
+	ASSERT_EQ(0, stats.rejected);
+}
+
+TEST(SpscRingBufferPolicyTest, TestReject) {
+	SpscRingBuffer<int> buf(NUM_ELEMENTS, ringbuffer::REJECT);
+	std::array<int, 6> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+	ASSERT_EQ(6, buf.push(tempBuf.data(), 0, 6));
+	// doesn't fit whole, so nothing is stored
+	ASSERT_EQ(0, buf.push(tempBuf.data(), 0, 6));
+	ASSERT_EQ(4, buf.push(tempBuf.data(), 0, 4));
+	ASSERT_EQ(0, buf.getFree());
+	const ringbuffer::Stats stats = buf.getStats();
+	ASSERT_EQ(6, stats.dropped);
+	ASSERT_EQ(1, stats.rejected);
+	ASSERT_EQ(0, buf.top());
+}
+
+TEST(SpscRingBufferPolicyTest, TestDropOldest) {
+	SpscRingBuffer<int> buf(NUM_ELEMENTS, ringbuffer::DROP_OLDEST);
+	std::array<int, 15> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+
+	// longer than the buffer: only the newest NUM_ELEMENTS survive
+	ASSERT_EQ(NUM_ELEMENTS, buf.push(tempBuf.data(), 0, 12));
+	ASSERT_EQ(2, buf.getStats().overwritten);
+	ASSERT_EQ(2, buf.top());
+	ASSERT_EQ(1, buf.getReadPosition());
+
+	ASSERT_EQ(3, buf.push(tempBuf.data(), 12, 3));
+	ASSERT_EQ(4, buf.getStats().overwritten);
+	ASSERT_EQ(NUM_ELEMENTS, buf.getRemaining());
+	std::array<int, NUM_ELEMENTS> out;
+	ASSERT_EQ(NUM_ELEMENTS, buf.top(out.data(), 0, NUM_ELEMENTS));
+	for(int i = 0; i < NUM_ELEMENTS; i++)
+		ASSERT_EQ(5 + i, out[i]);
+	ASSERT_EQ(0, buf.getStats().dropped);
+}
+
+TEST(SpscRingBufferPolicyTest, TestDropOldestWhilePeeked) {
+	SpscRingBuffer<int> buf(NUM_ELEMENTS, ringbuffer::DROP_OLDEST);
+	std::array<int, NUM_ELEMENTS> tempBuf;
+	std::iota(tempBuf.begin(), tempBuf.end(), 0);
+	buf.push(tempBuf.data(), 0, 8);
+
+	std::array<int, 4> scratch;
+	ASSERT_NE(nullptr, buf.peekReadLinear(4, scratch.data()));
+	ASSERT_TRUE(buf.consumeRead(4));
+
+	// the producer overwrites 2 of the 4 elements being worked on
+	ASSERT_NE(nullptr, buf.peekReadLinear(4, scratch.data()));
+	buf.push(tempBuf.data(), 0, 8);
+	ASSERT_EQ(6, buf.getReadPosition());
+	ASSERT_FALSE(buf.consumeRead(4));
+	ASSERT_EQ(8, buf.getReadPosition());
+	ASSERT_EQ(8, buf.getRemaining());
+
+	// and all of them, the read position stays where the producer put it
+	ASSERT_NE(nullptr, buf.peekReadLinear(4, scratch.data()));
+	buf.push(tempBuf.data(), 0, 8);
+	ASSERT_FALSE(buf.consumeRead(4));
+	ASSERT_EQ(14, buf.getReadPosition());
+	ASSERT_EQ(8, buf.getStats().overwritten);
+}
+
+TEST_F(SpscRingBufferTest, TestUnderrunCounts) {
+	std::array<int, 6> out;
+	_pRingBuffer->push(1);
+	ASSERT_EQ(1, _pRingBuffer->topPadded(out.data(), 0, 6, 0));
+	ASSERT_EQ(0, _pRingBuffer->topPadded(out.data(), 0, 6, 0));
+	_pRingBuffer->push(2);
+	_pRingBuffer->push(3);
+	ASSERT_EQ(2, _pRingBuffer->topPadded(out.data(), 0, 2, 0));
+	const ringbuffer::Stats stats = _pRingBuffer->getStats();
+	ASSERT_EQ(2, stats.underruns);
+	ASSERT_EQ(11, stats.padded);
+}
+
+TEST_F(SpscRingBufferTest, TestPushFill) {
+	std::array<int, 6> tempBuf = {{1, 2, 3, 4, 5, 6}};
+	std::array<int, NUM_ELEMENTS> out;
+	_pRingBuffer->push(tempBuf.data(), 0, 6);
+	_pRingBuffer->top(out.data(), 0, 6);
+	// wraps around the end of the storage, and drops what doesn't fit
+	ASSERT_EQ(NUM_ELEMENTS, _pRingBuffer->pushFill(7, 12));
+	ASSERT_EQ(2, _pRingBuffer->getStats().dropped);
+	ASSERT_EQ(NUM_ELEMENTS, _pRingBuffer->top(out.data(), 0, NUM_ELEMENTS));
+	for(int val : out)
+		ASSERT_EQ(7, val);
+}
+
+/**
+ * Runs a producer and a consumer thread against buf, moving total elements
+ * in odd-sized chunks (like PortAudio buffers vs Opus frames), and checks the
+ * consumer sees every value exactly once and in order.
+ *
+ * @return elapsed wall time
+ */
+template <class Buffer, class PushFn, class TopFn>
+static std::chrono::duration<double> runStress(Buffer &buf, size_t total, PushFn pushChunk, TopFn topChunk) {
+	const size_t PUSH_CHUNK = 512;
+	const size_t TOP_CHUNK = 960;
+	bool ordered = true;
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer([&]() {
+		std::vector<int> chunk(PUSH_CHUNK);
+		size_t next = 0;
+		while(next < total) {
+			const size_t n = std::min(PUSH_CHUNK, total - next);
+			for(size_t i = 0; i < n; i++)
+				chunk[i] = (int) (next + i);
+			size_t done = 0;
+			while(done < n) {
+				done += pushChunk(buf, chunk.data(), done, n - done);
+				if(done < n)
+					std::this_thread::yield();
+			}
+			next += n;
+		}
+	});
+
+	std::thread consumer([&]() {
+		std::vector<int> chunk(TOP_CHUNK);
+		size_t expected = 0;
+		while(expected < total) {
+			const size_t n = topChunk(buf, chunk.data(), TOP_CHUNK);
+			if(n == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			for(size_t i = 0; i < n; i++) {
+				if(chunk[i] != (int) (expected + i))
+					ordered = false;
+			}
+			expected += n;
+		}
+	});
+
+	producer.join();
+	consumer.join();
+	EXPECT_TRUE(ordered);
+	return std::chrono::steady_clock::now() - start;
+}
+
+TEST(SpscRingBufferStressTest, TestConcurrentOrderingAndThroughput) {
+	const size_t CAPACITY = 32768;
+	const size_t TOTAL = 20 * 1000 * 1000;
+
+	SpscRingBuffer<int> spsc(CAPACITY);
+	auto spscTime = runStress(spsc, TOTAL,
+		[](SpscRingBuffer<int> &b, const int *src, size_t off, size_t len) {
+			return b.push(src, (int) off, len);
+		},
+		[](SpscRingBuffer<int> &b, int *dest, size_t len) {
+			return b.top(dest, 0, len);
+		});
+	ASSERT_TRUE(spsc.isEmpty());
+
+	// the mutex buffer overwrites when full, so the producer only pushes what fits
+	RingBuffer<int> locked(CAPACITY);
+	auto lockedTime = runStress(locked, TOTAL,
+		[](RingBuffer<int> &b, const int *src, size_t off, size_t len) {
+			const size_t n = std::min(len, b.getSize() - b.getRemaining());
+			b.push(src, (int) off, n);
+			return n;
+		},
+		[](RingBuffer<int> &b, int *dest, size_t len) {
+			return b.top(dest, 0, len);
+		});
+	ASSERT_TRUE(locked.isEmpty());
+
+	std::cout << "SpscRingBuffer: " << spscTime.count() << " s, "
+	          << TOTAL / spscTime.count() / 1e6 << " M elements/s" << std::endl;
+	std::cout << "RingBuffer:     " << lockedTime.count() << " s, "
+	          << TOTAL / lockedTime.count() / 1e6 << " M elements/s" << std::endl;
+}
+
+TEST(SpscRingBufferStressTest, TestConcurrentDropOldest) {
+	// small enough that the producer keeps overwriting what the consumer reads
+	const size_t CAPACITY = 4096;
+	const size_t CHUNK = 512;
+	const size_t TOTAL = CHUNK * 1000;
+	SpscRingBuffer<int> buf(CAPACITY, ringbuffer::DROP_OLDEST);
+	std::atomic<bool> done(false);
+	bool ordered = true;
+	size_t received = 0;
+
+	std::thread producer([&]() {
+		std::vector<int> chunk(CHUNK);
+		for(size_t next = 0; next < TOTAL; next += CHUNK) {
+			for(size_t i = 0; i < CHUNK; i++)
+				chunk[i] = (int) (next + i);
+			buf.push(chunk.data(), 0, CHUNK);
+			std::this_thread::yield();
+		}
+		done = true;
+	});
+
+	// every chunk read is contiguous and later than the one before
+	std::thread consumer([&]() {
+		std::vector<int> chunk(960);
+		int last = -1;
+		while(!done || !buf.isEmpty()) {
+			const size_t n = buf.top(chunk.data(), 0, chunk.size());
+			for(size_t i = 0; i < n; i++) {
+				if(chunk[i] <= last || (i > 0 && chunk[i] != chunk[i - 1] + 1))
+					ordered = false;
+				last = chunk[i];
+			}
+			received += n;
+		}
+	});
+
+	producer.join();
+	consumer.join();
+	ASSERT_TRUE(ordered);
+	ASSERT_GT(received, 0);
+	ASSERT_EQ(TOTAL, received + buf.getStats().overwritten);
+}
@@ -0,0 +1,63 @@
+#include <cerrno>
+#include <chrono>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "ThreadTuning.hpp"
+
+
+TEST(ThreadTuningTest, TestParseCpus) {
+	std::vector<int> cpus;
+	ASSERT_TRUE(ThreadTuning::parseCpus("3", cpus));
+	ASSERT_EQ(std::vector<int>({3}), cpus);
+	ASSERT_TRUE(ThreadTuning::parseCpus("5,0-2,1", cpus));
+	ASSERT_EQ(std::vector<int>({0, 1, 2, 5}), cpus);
+	ASSERT_EQ("0-2,5", ThreadTuning::formatCpus(cpus));
+
+	const char *invalid[] = { "", ",", "1,", "2-1", "-1", "1-", "a", "1 2", "100000" };
+	for(const char *list : invalid)
+		ASSERT_FALSE(ThreadTuning::parseCpus(list, cpus)) << list;
+}
+
+TEST(ThreadTuningTest, TestParsePolicy) {
+	ThreadTuning::Policy policy = ThreadTuning::OTHER;
+	ASSERT_TRUE(ThreadTuning::parsePolicy("fifo", policy));
+	ASSERT_EQ(ThreadTuning::FIFO, policy);
+	ASSERT_TRUE(ThreadTuning::parsePolicy("rr", policy));
+	ASSERT_EQ(ThreadTuning::RR, policy);
+	ASSERT_FALSE(ThreadTuning::parsePolicy("SCHED_FIFO", policy));
+	ASSERT_EQ(0, ThreadTuning::getMaxPriority(ThreadTuning::OTHER));
+	ASSERT_GE(ThreadTuning::getMaxPriority(ThreadTuning::FIFO), 1);
+}
+
+TEST(ThreadTuningTest, TestApply) {
+	cpu_set_t set;
+	ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set));
+	int cpu = 0;
+	while(!CPU_ISSET(cpu, &set))
+		cpu++;
+
+	std::thread thread([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+	// the default changes nothing
+	ASSERT_TRUE(ThreadTuning().isDefault());
+	ASSERT_EQ(0, ThreadTuning().apply(thread.native_handle()));
+
+	const ThreadTuning pinned(ThreadTuning::OTHER, 0, std::vector<int>({cpu}));
+	ASSERT_EQ(0, pinned.apply(thread.native_handle()));
+	ASSERT_EQ("SCHED_OTHER, CPUs " + std::to_string(cpu), pinned.report(thread.native_handle(), 0));
+
+	// real-time scheduling needs privileges the tests may not have; either
+	// way the report says what the thread got
+	const ThreadTuning realtime(ThreadTuning::FIFO, 10);
+	const int error = realtime.apply(thread.native_handle());
+	const std::string report = realtime.report(thread.native_handle(), error);
+	if(error == 0) {
+		ASSERT_EQ("SCHED_FIFO 10, CPUs " + std::to_string(cpu), report);
+	} else {
+		ASSERT_EQ(EPERM, error);
+		ASSERT_EQ(0u, report.find("SCHED_OTHER, CPUs " + std::to_string(cpu) + " (requested SCHED_FIFO 10: "))
+			<< report;
+	}
+	thread.join();
+}
@@ -0,0 +1,76 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "VoxDetector.hpp"
+
+
+/**
+ * Reference implementation: RMS level in dB relative to full scale, all in
+ * double precision.
+ */
+static double referenceDb(const std::vector<int16_t> &pcm) {
+	double sum = 0.0;
+	for(auto sample : pcm) {
+		const double normalized = sample / 32767.0;
+		sum += normalized * normalized;
+	}
+	return 20.0 * std::log10(std::sqrt(sum / pcm.size()));
+}
+
+TEST(VoxDetectorTest, TestSumOfSquaresMatchesScalar) {
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+
+	// odd lengths exercise every vector loop's scalar tail
+	for(size_t len : {0, 1, 7, 15, 17, 960, 1003}) {
+		std::vector<int16_t> pcm(len);
+		for(auto &sample : pcm)
+			sample = (int16_t) dist(rng);
+		ASSERT_EQ(VoxDetector::sumOfSquaresScalar(pcm.data(), len),
+		          VoxDetector::sumOfSquares(pcm.data(), len)) << "len " << len;
+	}
+}
+
+TEST(VoxDetectorTest, TestSumOfSquaresFullScale) {
+	// two -32768 squares overflow a signed 32-bit pair sum
+	std::vector<int16_t> pcm(960, INT16_MIN);
+	ASSERT_EQ(960ull * 32768 * 32768, VoxDetector::sumOfSquares(pcm.data(), pcm.size()));
+}
+
+TEST(VoxDetectorTest, TestDecisionMatchesReference) {
+	std::mt19937 rng(7);
+	std::normal_distribution<double> noise(0.0, 1.0);
+
+	for(double thresholdDb : {-90.0, -60.0, -40.0, -20.0, -6.0}) {
+		VoxDetector vox(thresholdDb);
+		for(double levelDb = -100.0; levelDb <= 0.0; levelDb += 2.5) {
+			const double amplitude = 32767.0 * std::pow(10.0, levelDb / 20.0);
+			std::vector<int16_t> pcm(960);
+			for(auto &sample : pcm)
+				sample = (int16_t) std::max(-32768.0, std::min(32767.0, std::round(amplitude * noise(rng))));
+
+			const double db = referenceDb(pcm);
+			// skip levels within rounding distance of the threshold
+			if(std::fabs(db - thresholdDb) < 0.01)
+				continue;
+			ASSERT_EQ(db >= thresholdDb, vox.isVoice(pcm.data(), pcm.size()))
+				<< "threshold " << thresholdDb << " level " << db;
+			if(std::isfinite(db)) {
+				ASSERT_NEAR(db, vox.getLastDb(), 1e-6);
+			}
+		}
+	}
+}
+
+TEST(VoxDetectorTest, TestSilenceIsNotVoice) {
+	VoxDetector vox(-90.0);
+	std::vector<int16_t> pcm(960, 0);
+	ASSERT_FALSE(vox.isVoice(pcm.data(), pcm.size()));
+	ASSERT_TRUE(std::isinf(vox.getLastDb()));
+
+	// a quiet signal the old integer division rounded down to silence
+	pcm.assign(960, 100);
+	ASSERT_TRUE(vox.isVoice(pcm.data(), pcm.size()));
+	ASSERT_NEAR(20.0 * std::log10(100.0 / 32767.0), vox.getLastDb(), 1e-9);
+}
@@ -0,0 +1,37 @@
+#include <vector>
+#include "gtest/gtest.h"
+#include "VoxGate.hpp"
+
+
+static const int SAMPLE_RATE = 48000;
+static const size_t FRAME = 960;	// 20 ms
+
+TEST(VoxGateTest, TestHoldAfterVoice) {
+	VoxGate gate(SAMPLE_RATE, -40.0, 0.050);
+	std::vector<int16_t> silence(FRAME, 0);
+	std::vector<int16_t> voice(FRAME, 8000);
+
+	ASSERT_FALSE(gate.process(silence.data(), FRAME));	// nothing heard yet
+	ASSERT_TRUE(gate.process(voice.data(), FRAME));
+	// frames starting 0, 20 and 40 ms after the voice are within the 50 ms hold
+	ASSERT_TRUE(gate.process(silence.data(), FRAME));
+	ASSERT_TRUE(gate.process(silence.data(), FRAME));
+	ASSERT_TRUE(gate.process(silence.data(), FRAME));
+	ASSERT_FALSE(gate.process(silence.data(), FRAME));
+
+	// voice restarts the hold
+	ASSERT_TRUE(gate.process(voice.data(), FRAME));
+	ASSERT_TRUE(gate.process(silence.data(), FRAME));
+
+	ASSERT_EQ(8u, gate.getFrames());
+	ASSERT_EQ(2u, gate.getVoiceFrames());
+	ASSERT_EQ(6u, gate.getTransmittedFrames());
+}
+
+TEST(VoxGateTest, TestNoHold) {
+	VoxGate gate(SAMPLE_RATE, -40.0, 0.0);
+	std::vector<int16_t> silence(FRAME, 0);
+	std::vector<int16_t> voice(FRAME, 8000);
+	ASSERT_TRUE(gate.process(voice.data(), FRAME));
+	ASSERT_FALSE(gate.process(silence.data(), FRAME));
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "AudioBackendException.hpp"
+#include "WavFile.hpp"
+
+
+/**
+ * @brief Test fixture for WavReader and WavWriter, using temporary files
+ */
+class WavFileTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		_base = "/tmp/mumpi-wavtest-" + std::to_string(getpid());
+	}
+
+	virtual void TearDown() {
+		std::remove((_base + ".wav").c_str());
+		std::remove((_base + ".raw").c_str());
+	}
+
+	std::string _base;
+};
+
+TEST_F(WavFileTest, TestWavRoundTrip) {
+	std::vector<int16_t> samples(1000);
+	std::iota(samples.begin(), samples.end(), -500);
+	{
+		WavWriter writer(_base + ".wav", 24000, 2);
+		ASSERT_EQ(600, writer.write(samples.data(), 600));
+		ASSERT_EQ(400, writer.write(samples.data() + 600, 400));
+		ASSERT_EQ(1000, writer.getSamplesWritten());
+	}	// sizes patched into the header on close
+
+	WavReader reader(_base + ".wav");
+	ASSERT_TRUE(reader.isWav());
+	ASSERT_EQ(24000, reader.getSampleRate());
+	ASSERT_EQ(2, reader.getChannels());
+	std::vector<int16_t> out(1200, 0);
+	ASSERT_EQ(1000, reader.read(out.data(), out.size()));
+	for(size_t i = 0; i < samples.size(); i++)
+		ASSERT_EQ(samples[i], out[i]);
+	ASSERT_EQ(0, reader.read(out.data(), out.size()));
+}
+
+TEST_F(WavFileTest, TestRawRoundTrip) {
+	// short enough that all of it is read while checking for a WAV header
+	std::vector<int16_t> samples = {1, -2, 3, -4, 5, -6, 7, -8};
+	{
+		WavWriter writer(_base + ".raw", 48000, 1);
+		writer.write(samples.data(), samples.size());
+	}
+
+	WavReader reader(_base + ".raw");
+	ASSERT_FALSE(reader.isWav());
+	std::vector<int16_t> out(3);
+	ASSERT_EQ(3, reader.read(out.data(), 3));
+	ASSERT_EQ(-2, out[1]);
+	ASSERT_EQ(3, reader.read(out.data(), 3));
+	ASSERT_EQ(-4, out[0]);
+	ASSERT_EQ(2, reader.read(out.data(), 3));
+	ASSERT_EQ(-8, out[1]);
+	ASSERT_EQ(0, reader.read(out.data(), 3));
+}
+
+TEST_F(WavFileTest, TestMissingFile) {
+	ASSERT_THROW(WavReader reader(_base + ".missing"), AudioBackendException);
+}
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <vector>
+#include "gtest/gtest.h"
+#include "WorkerPool.hpp"
+
+
+static void increment(void *arg) {
+	((std::atomic<int>*) arg)->fetch_add(1);
+}
+
+TEST(WorkerPoolTest, TestRunsAllTasks) {
+	std::atomic<int> count(0);
+	{
+		WorkerPool pool(4, 1024);
+		ASSERT_EQ(4, pool.getSize());
+		for(int i = 0; i < 1000; i++) {
+			while(!pool.submit(increment, &count)) {
+			}
+		}
+		pool.stop();	// runs what's queued before returning
+		ASSERT_EQ(1000, pool.getCompleted());
+		ASSERT_FALSE(pool.submit(increment, &count));
+	}
+	ASSERT_EQ(1000, count.load());
+}
+
+// sets started, then spins until release is set
+struct Blocker {
+	std::atomic<bool> started;
+	std::atomic<bool> release;
+};
+
+static void block(void *arg) {
+	Blocker *blocker = (Blocker*) arg;
+	blocker->started = true;
+	while(!blocker->release) {
+	}
+}
+
+TEST(WorkerPoolTest, TestFullQueue) {
+	Blocker blocker;
+	blocker.started = false;
+	blocker.release = false;
+	std::atomic<int> count(0);
+	WorkerPool pool(1, 2);
+
+	// occupy the only worker, then fill the queue
+	ASSERT_TRUE(pool.submit(block, &blocker));
+	while(!blocker.started) {
+	}
+	ASSERT_TRUE(pool.submit(increment, &count));
+	ASSERT_TRUE(pool.submit(increment, &count));
+	ASSERT_FALSE(pool.submit(increment, &count));
+
+	blocker.release = true;
+	pool.stop();
+	ASSERT_EQ(2, count.load());
+}